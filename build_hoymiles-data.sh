@@ -20,6 +20,7 @@ cmake \
   -DREGION_KR920="OFF" \
   -DREGION_IN865="OFF" \
   -DREGION_RU864="OFF" \
+  -DSINGLE_REGION="ON" \
   -DBOARD="HeltecLoRa151" \
   -DMBED_RADIO_SHIELD="SX1276MB1MAS" \
   -DUSE_RADIO_DEBUG="ON" ..
@@ -39,6 +39,27 @@
 
 #include "LoRaMacTest.h"
 
+/*!
+ * Maximum number of uplinks held by the uplink queue
+ */
+#ifndef LMHANDLER_UPLINK_QUEUE_SIZE
+#define LMHANDLER_UPLINK_QUEUE_SIZE                 4
+#endif
+
+/*!
+ * Maximum application payload size of a queued uplink
+ */
+#ifndef LMHANDLER_UPLINK_QUEUE_BUFFER_SIZE
+#define LMHANDLER_UPLINK_QUEUE_BUFFER_SIZE          64
+#endif
+
+/*!
+ * Maximum number of downlink port handlers, packages included
+ */
+#ifndef LMHANDLER_PORT_HANDLERS_MAX
+#define LMHANDLER_PORT_HANDLERS_MAX                 ( PKG_MAX_NUMBER + 4 )
+#endif
+
 static CommissioningParams_t CommissioningParams =
 {
     .IsOtaaActivation = OVER_THE_AIR_ACTIVATION,
@@ -146,6 +167,64 @@ static TimerTime_t DutyCycleWaitTime = 0;
  */
 static bool IsUplinkTxPending = false;
 
+/*!
+ * Uplink queue entry
+ */
+typedef struct LmHandlerUplinkQueueEntry_s
+{
+    bool IsPending;
+    LmHandlerUplinkPriorities_t Priority;
+    LmHandlerMsgTypes_t MsgType;
+    TimerTime_t EnqueueTime;
+    uint8_t Port;
+    uint8_t BufferSize;
+    uint8_t Buffer[LMHANDLER_UPLINK_QUEUE_BUFFER_SIZE];
+}LmHandlerUplinkQueueEntry_t;
+
+/*!
+ * Uplink queue
+ */
+static LmHandlerUplinkQueueEntry_t UplinkQueue[LMHANDLER_UPLINK_QUEUE_SIZE];
+
+/*!
+ * Uplink queue statistics
+ */
+static LmHandlerUplinkQueueStats_t UplinkQueueStats;
+
+/*!
+ * Timer used to resume the uplink queue dispatch once the duty-cycle
+ * restriction reported by the MAC layer has elapsed
+ */
+static TimerEvent_t UplinkQueueTimer;
+
+/*!
+ * Indicates if the uplink queue dispatch waits for the duty-cycle restriction to elapse
+ */
+static bool IsUplinkQueueDutyCycleRestricted = false;
+
+/*!
+ * Downlink port handler entry
+ */
+typedef struct LmHandlerPortHandlerEntry_s
+{
+    uint8_t Port;
+    /*!
+     * Package consuming the port, PKG_MAX_NUMBER for an application handler
+     */
+    uint8_t PackageId;
+    LmHandlerPortHandler_t Handler;
+}LmHandlerPortHandlerEntry_t;
+
+/*!
+ * Downlink port handlers, sorted by port
+ */
+static LmHandlerPortHandlerEntry_t PortHandlers[LMHANDLER_PORT_HANDLERS_MAX];
+
+/*!
+ * Number of registered downlink port handlers
+ */
+static uint8_t NbPortHandlers = 0;
+
 /*!
  * \brief   MCPS-Confirm event function
  *
@@ -211,6 +290,18 @@ static void OnBeaconStatusChangeNotify( LoRaMacHandlerBeaconParams_t *params )
  */
 static LmHandlerErrorStatus_t LmHandlerBeaconReq( void );
 
+/*!
+ * Sends the highest priority queued uplink when the MAC layer is idle
+ *
+ * \retval status [true: an uplink has been sent, false: nothing sent]
+ */
+static bool LmHandlerUplinkQueueProcess( void );
+
+/*!
+ * Function executed on UplinkQueueTimer Timeout event
+ */
+static void OnUplinkQueueTimerEvent( void *context );
+
 /*
  *=============================================================================
  * PACKAGES HANDLING
@@ -222,8 +313,33 @@ typedef enum PackageNotifyTypes_e
     PACKAGE_MCPS_INDICATION,
     PACKAGE_MLME_CONFIRM,
     PACKAGE_MLME_INDICATION,
+    /*!
+     * Number of notification types
+     */
+    PACKAGE_NOTIFY_TYPES_NB,
 }PackageNotifyTypes_t;
 
+/*!
+ * Packages subscribed to each notification type, i.e. implementing its
+ * callback
+ */
+static uint8_t LmHandlerPackagesSubscribers[PACKAGE_NOTIFY_TYPES_NB][PKG_MAX_NUMBER];
+
+/*!
+ * Number of packages subscribed to each notification type
+ */
+static uint8_t LmHandlerPackagesNbSubscribers[PACKAGE_NOTIFY_TYPES_NB];
+
+/*!
+ * Packages to be processed. Bit n is set for the package n.
+ */
+static volatile uint8_t LmHandlerPackagesWorkMask = 0;
+
+/*!
+ * Packages with a pending transmission. Bit n is set for the package n.
+ */
+static uint8_t LmHandlerPackagesTxPendingMask = 0;
+
 /*!
  * Notifies the package to process the LoRaMac callbacks.
  *
@@ -240,6 +356,34 @@ static bool LmHandlerPackageIsTxPending( void );
 
 static void LmHandlerPackagesProcess( void );
 
+/*!
+ * Builds the list of packages subscribed to each notification type
+ */
+static void LmHandlerPackagesSubscribe( void );
+
+/*!
+ * Reads the transmission status of a package
+ *
+ * \param [IN] id Package identifier
+ */
+static void LmHandlerPackageUpdateTxPending( uint8_t id );
+
+/*!
+ * Requests the Process function of a package to be called. May be called
+ * from an interrupt context.
+ *
+ * \param [IN] id Package identifier
+ */
+static void LmHandlerPackageProcessRequest( uint8_t id );
+
+/*!
+ * Hands the payload received on a package port over to the package
+ *
+ * \param [IN] id             Package identifier
+ * \param [IN] mcpsIndication MCPS indication primitive data
+ */
+static void LmHandlerPackagePortDataNotify( uint8_t id, McpsIndication_t *mcpsIndication );
+
 LmHandlerErrorStatus_t LmHandlerInit( LmHandlerCallbacks_t *handlerCallbacks,
                                       LmHandlerParams_t *handlerParams )
 {
@@ -261,6 +405,11 @@ LmHandlerErrorStatus_t LmHandlerInit( LmHandlerCallbacks_t *handlerCallbacks,
     IsClassBSwitchPending = false;
     IsUplinkTxPending = false;
 
+    memset1( ( uint8_t* )UplinkQueue, 0, sizeof( UplinkQueue ) );
+    memset1( ( uint8_t* )&UplinkQueueStats, 0, sizeof( UplinkQueueStats ) );
+    IsUplinkQueueDutyCycleRestricted = false;
+    TimerInit( &UplinkQueueTimer, OnUplinkQueueTimerEvent );
+
     if( LoRaMacInitialization( &LoRaMacPrimitives, &LoRaMacCallbacks, LmHandlerParams->Region ) != LORAMAC_STATUS_OK )
     {
         return LORAMAC_HANDLER_ERROR;
@@ -406,6 +555,13 @@ void LmHandlerProcess( void )
         return;
     }
 
+    // Send the queued uplinks. A queued uplink also serves a MAC layer
+    // scheduled uplink.
+    if( LmHandlerUplinkQueueProcess( ) == true )
+    {
+        return;
+    }
+
     // If a MAC layer scheduled uplink is still pending try to send it.
     if( IsUplinkTxPending == true )
     {
@@ -495,10 +651,17 @@ LmHandlerFlagStatus_t LmHandlerJoinStatus( void )
 }
 
 LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed )
+{
+    return LmHandlerSendAtDatarate( appData, isTxConfirmed, LmHandlerParams->TxDatarate );
+}
+
+LmHandlerErrorStatus_t LmHandlerSendAtDatarate( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                                int8_t datarate )
 {
     LoRaMacStatus_t status;
     McpsReq_t mcpsReq;
     LoRaMacTxInfo_t txInfo;
+    MibRequestConfirm_t mibReq;
 
     if( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET )
     {
@@ -507,11 +670,29 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
         return LORAMAC_HANDLER_ERROR;
     }
 
+    if( ( LmHandlerParams->AdrEnable == false ) && ( datarate != LmHandlerGetCurrentDatarate( ) ) )
+    {
+        // Apply the datarate before the payload size check. The MAC layer
+        // applies it anyway when the uplink is accepted.
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        mibReq.Param.ChannelsDatarate = datarate;
+        if( LoRaMacMibSetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK )
+        {
+            return LORAMAC_HANDLER_ERROR;
+        }
+    }
+
     TxParams.MsgType = isTxConfirmed;
     mcpsReq.Type = ( isTxConfirmed == LORAMAC_HANDLER_UNCONFIRMED_MSG ) ? MCPS_UNCONFIRMED : MCPS_CONFIRMED;
-    mcpsReq.Req.Unconfirmed.Datarate = LmHandlerParams->TxDatarate;
+    mcpsReq.Req.Unconfirmed.Datarate = datarate;
     if( LoRaMacQueryTxPossible( appData->BufferSize, &txInfo ) != LORAMAC_STATUS_OK )
     {
+        if( LoRaMacIsAppDataReserved( appData->Buffer ) == true )
+        {
+            // The empty frame would be built over the reserved payload.
+            // Report the failure, the application reserves the buffer again.
+            return LORAMAC_HANDLER_ERROR;
+        }
         // Send empty frame in order to flush MAC commands
         mcpsReq.Type = MCPS_UNCONFIRMED;
         mcpsReq.Req.Unconfirmed.fBuffer = NULL;
@@ -525,7 +706,7 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     }
 
     TxParams.AppData = *appData;
-    TxParams.Datarate = LmHandlerParams->TxDatarate;
+    TxParams.Datarate = datarate;
 
     status = LoRaMacMcpsRequest( &mcpsReq );
     if( LmHandlerCallbacks->OnMacMcpsRequest != NULL )
@@ -545,6 +726,204 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     }
 }
 
+LmHandlerErrorStatus_t LmHandlerSendQueued( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                            LmHandlerUplinkPriorities_t priority )
+{
+    LmHandlerUplinkQueueEntry_t *entry = NULL;
+    LmHandlerUplinkQueueEntry_t *victim = NULL;
+    LoRaMacTxInfo_t txInfo;
+
+    if( ( appData == NULL ) || ( appData->BufferSize > LMHANDLER_UPLINK_QUEUE_BUFFER_SIZE ) ||
+        ( ( appData->BufferSize > 0 ) && ( appData->Buffer == NULL ) ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    // Reject the uplinks which can't be sent at the current datarate
+    txInfo.CurrentPossiblePayloadSize = 0;
+    LoRaMacQueryTxPossible( appData->BufferSize, &txInfo );
+    if( txInfo.CurrentPossiblePayloadSize < appData->BufferSize )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    for( uint8_t i = 0; i < LMHANDLER_UPLINK_QUEUE_SIZE; i++ )
+    {
+        if( ( UplinkQueue[i].IsPending == true ) && ( UplinkQueue[i].Port == appData->Port ) )
+        {
+            // Replace the pending uplink with the fresher data. The uplink
+            // keeps its position and its highest priority.
+            entry = &UplinkQueue[i];
+            priority = MIN( priority, entry->Priority );
+            UplinkQueueStats.NbCoalesced++;
+            break;
+        }
+    }
+
+    if( entry == NULL )
+    {
+        for( uint8_t i = 0; i < LMHANDLER_UPLINK_QUEUE_SIZE; i++ )
+        {
+            if( UplinkQueue[i].IsPending == false )
+            {
+                entry = &UplinkQueue[i];
+                break;
+            }
+            // Keep track of the newest uplink of the lowest priority class
+            if( ( victim == NULL ) || ( UplinkQueue[i].Priority > victim->Priority ) ||
+                ( ( UplinkQueue[i].Priority == victim->Priority ) && ( UplinkQueue[i].EnqueueTime >= victim->EnqueueTime ) ) )
+            {
+                victim = &UplinkQueue[i];
+            }
+        }
+
+        if( entry == NULL )
+        {
+            // The queue is full
+            UplinkQueueStats.NbDropped++;
+            if( victim->Priority <= priority )
+            {
+                return LORAMAC_HANDLER_ERROR;
+            }
+            entry = victim;
+            UplinkQueueStats.Depth--;
+        }
+
+        entry->IsPending = true;
+        entry->EnqueueTime = TimerGetCurrentTime( );
+        UplinkQueueStats.Depth++;
+        UplinkQueueStats.MaxDepth = MAX( UplinkQueueStats.MaxDepth, UplinkQueueStats.Depth );
+    }
+
+    entry->Priority = priority;
+    entry->MsgType = isTxConfirmed;
+    entry->Port = appData->Port;
+    entry->BufferSize = appData->BufferSize;
+    memcpy1( entry->Buffer, appData->Buffer, appData->BufferSize );
+    UplinkQueueStats.NbEnqueued++;
+
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+const LmHandlerUplinkQueueStats_t* LmHandlerGetUplinkQueueStats( void )
+{
+    return &UplinkQueueStats;
+}
+
+static bool LmHandlerUplinkQueueProcess( void )
+{
+    LmHandlerUplinkQueueEntry_t *entry = NULL;
+    LmHandlerAppData_t appData;
+    LoRaMacTxInfo_t txInfo;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    TimerTime_t waitTime = 0;
+
+    if( ( UplinkQueueStats.Depth == 0 ) || ( IsUplinkQueueDutyCycleRestricted == true ) )
+    {
+        return false;
+    }
+    if( ( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET ) || ( LoRaMacIsBusy( ) == true ) )
+    {
+        return false;
+    }
+
+    while( entry == NULL )
+    {
+        if( UplinkQueueStats.Depth == 0 )
+        {
+            return false;
+        }
+        // Highest priority first, then arrival order
+        for( uint8_t i = 0; i < LMHANDLER_UPLINK_QUEUE_SIZE; i++ )
+        {
+            if( ( UplinkQueue[i].IsPending == true ) &&
+                ( ( entry == NULL ) || ( UplinkQueue[i].Priority < entry->Priority ) ||
+                  ( ( UplinkQueue[i].Priority == entry->Priority ) && ( UplinkQueue[i].EnqueueTime < entry->EnqueueTime ) ) ) )
+            {
+                entry = &UplinkQueue[i];
+            }
+        }
+
+        status = LoRaMacQueryTxPossible( entry->BufferSize, &txInfo );
+        if( ( status != LORAMAC_STATUS_OK ) && ( txInfo.CurrentPossiblePayloadSize < entry->BufferSize ) )
+        {
+            // The datarate has been lowered since the uplink has been
+            // queued (e.g. ADR back-off). The uplink can't be sent anymore
+            entry->IsPending = false;
+            entry = NULL;
+            UplinkQueueStats.Depth--;
+            UplinkQueueStats.NbDropped++;
+        }
+    }
+
+    if( status != LORAMAC_STATUS_OK )
+    {
+        // Flush the pending MAC commands first. The uplink stays queued
+        appData.Port = 0;
+        appData.Buffer = NULL;
+        appData.BufferSize = 0;
+    }
+    else
+    {
+        // Copy the uplink straight into the MAC frame buffer
+        if( LmHandlerReserveAppData( &appData ) != LORAMAC_HANDLER_SUCCESS )
+        {
+            return false;
+        }
+        appData.Port = entry->Port;
+        appData.BufferSize = entry->BufferSize;
+        memcpy1( appData.Buffer, entry->Buffer, entry->BufferSize );
+    }
+
+    if( LmHandlerSend( &appData, ( appData.Buffer == NULL ) ? LORAMAC_HANDLER_UNCONFIRMED_MSG : entry->MsgType ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        if( DutyCycleWaitTime > 0 )
+        {
+            // Resume the dispatch once the duty-cycle restriction has elapsed
+            IsUplinkQueueDutyCycleRestricted = true;
+            TimerSetValue( &UplinkQueueTimer, DutyCycleWaitTime );
+            TimerStart( &UplinkQueueTimer );
+        }
+        return false;
+    }
+
+    if( appData.Buffer != NULL )
+    {
+        waitTime = TimerGetElapsedTime( entry->EnqueueTime );
+        UplinkQueueStats.TotalWaitTime += waitTime;
+        UplinkQueueStats.MaxWaitTime = MAX( UplinkQueueStats.MaxWaitTime, waitTime );
+        UplinkQueueStats.NbSent++;
+        UplinkQueueStats.Depth--;
+        entry->IsPending = false;
+    }
+    return true;
+}
+
+static void OnUplinkQueueTimerEvent( void *context )
+{
+    TimerStop( &UplinkQueueTimer );
+    IsUplinkQueueDutyCycleRestricted = false;
+
+    // Wake up the main loop in order to dispatch the queued uplinks
+    if( LmHandlerCallbacks->OnMacProcess != NULL )
+    {
+        LmHandlerCallbacks->OnMacProcess( );
+    }
+}
+
+LmHandlerErrorStatus_t LmHandlerReserveAppData( LmHandlerAppData_t *appData )
+{
+    if( appData == NULL )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    if( LoRaMacReserveAppData( &appData->Buffer, &appData->BufferSize ) != LORAMAC_STATUS_OK )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
 LmHandlerErrorStatus_t LmHandlerDeviceTimeReq( void )
 {
     LoRaMacStatus_t status;
@@ -636,6 +1015,12 @@ LmHandlerErrorStatus_t LmHandlerRequestClass( DeviceClass_t newClass )
     LoRaMacMibGetRequestConfirm( &mibReq );
     currentClass = mibReq.Param.Class;
 
+    if( newClass != CLASS_B )
+    {
+        // Cancel a pending class B switch
+        IsClassBSwitchPending = false;
+    }
+
     // Attempt to switch only if class update
     if( currentClass != newClass )
     {
@@ -720,6 +1105,15 @@ int8_t LmHandlerGetCurrentDatarate( void )
     return mibGet.Param.ChannelsDatarate;
 }
 
+LmHandlerErrorStatus_t LmHandlerGetNextTxOpportunity( uint8_t size, int8_t datarate, LoRaMacTxOpportunity_t* txOpportunity )
+{
+    if( LoRaMacQueryTxOpportunity( size, datarate, txOpportunity ) != LORAMAC_STATUS_OK )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
 LoRaMacRegion_t LmHandlerGetActiveRegion( void )
 {
     return LmHandlerParams->Region;
@@ -738,6 +1132,122 @@ LmHandlerErrorStatus_t LmHandlerSetSystemMaxRxError( uint32_t maxErrorInMs )
     return LORAMAC_HANDLER_SUCCESS;
 }
 
+/*!
+ * Searches the handler of a port
+ *
+ * \param [IN] port Port
+ *
+ * \retval index Index of the handler if found, else index where it would be
+ *               inserted
+ */
+static uint8_t PortHandlerSearch( uint8_t port )
+{
+    uint8_t low = 0;
+    uint8_t high = NbPortHandlers;
+
+    while( low < high )
+    {
+        uint8_t mid = ( low + high ) >> 1;
+
+        if( PortHandlers[mid].Port < port )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*!
+ * Gets the handler of a port
+ *
+ * \param [IN] port Port
+ *
+ * \retval entry Port handler entry or NULL if the port has no handler
+ */
+static LmHandlerPortHandlerEntry_t* PortHandlerGet( uint8_t port )
+{
+    uint8_t index = PortHandlerSearch( port );
+
+    if( ( index < NbPortHandlers ) && ( PortHandlers[index].Port == port ) )
+    {
+        return &PortHandlers[index];
+    }
+    return NULL;
+}
+
+/*!
+ * Adds a port handler
+ *
+ * \param [IN] port      Port
+ * \param [IN] packageId Package consuming the port, PKG_MAX_NUMBER for an
+ *                       application handler
+ * \param [IN] handler   Application handler
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the handler has been
+ *                added else \ref LORAMAC_HANDLER_ERROR
+ */
+static LmHandlerErrorStatus_t PortHandlerAdd( uint8_t port, uint8_t packageId, LmHandlerPortHandler_t handler )
+{
+    uint8_t index = PortHandlerSearch( port );
+
+    if( ( index < NbPortHandlers ) && ( PortHandlers[index].Port == port ) )
+    {
+        if( ( packageId < PKG_MAX_NUMBER ) && ( PortHandlers[index].PackageId == packageId ) )
+        {
+            // The package is registered again
+            return LORAMAC_HANDLER_SUCCESS;
+        }
+        return LORAMAC_HANDLER_ERROR;
+    }
+    // Port 0 only carries MAC commands
+    if( ( port == 0 ) || ( NbPortHandlers >= LMHANDLER_PORT_HANDLERS_MAX ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    for( uint8_t i = NbPortHandlers; i > index; i-- )
+    {
+        PortHandlers[i] = PortHandlers[i - 1];
+    }
+    PortHandlers[index].Port = port;
+    PortHandlers[index].PackageId = packageId;
+    PortHandlers[index].Handler = handler;
+    NbPortHandlers++;
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerErrorStatus_t LmHandlerPortHandlerRegister( uint8_t port, LmHandlerPortHandler_t handler )
+{
+    if( handler == NULL )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    return PortHandlerAdd( port, PKG_MAX_NUMBER, handler );
+}
+
+LmHandlerErrorStatus_t LmHandlerPortHandlerUnregister( uint8_t port )
+{
+    uint8_t index = PortHandlerSearch( port );
+
+    // The package ports cannot be released
+    if( ( index >= NbPortHandlers ) || ( PortHandlers[index].Port != port ) ||
+        ( PortHandlers[index].PackageId < PKG_MAX_NUMBER ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    NbPortHandlers--;
+    for( uint8_t i = index; i < NbPortHandlers; i++ )
+    {
+        PortHandlers[i] = PortHandlers[i + 1];
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
 /*
  *=============================================================================
  * LORAMAC NOTIFICATIONS HANDLING
@@ -765,6 +1275,8 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
 static void McpsIndication( McpsIndication_t *mcpsIndication )
 {
     LmHandlerAppData_t appData;
+    LmHandlerPortHandlerEntry_t *portHandler = NULL;
+    uint8_t portPackageId = PKG_MAX_NUMBER;
 
     RxParams.IsMcpsIndication = 1;
     RxParams.Status = mcpsIndication->Status;
@@ -784,6 +1296,28 @@ static void McpsIndication( McpsIndication_t *mcpsIndication )
     appData.BufferSize = mcpsIndication->BufferSize;
     appData.Buffer = mcpsIndication->Buffer;
 
+    // Hand the payload over to the only consumer of its port. The downlinks
+    // without payload or consumer are notified through OnRxData.
+    if( mcpsIndication->RxData == true )
+    {
+        portHandler = PortHandlerGet( mcpsIndication->Port );
+    }
+    if( portHandler != NULL )
+    {
+        if( portHandler->PackageId < PKG_MAX_NUMBER )
+        {
+            // Processed once the packages have been notified
+            portPackageId = portHandler->PackageId;
+        }
+        else
+        {
+            portHandler->Handler( &appData, &RxParams );
+        }
+        // The upper layer is still notified of the reception, without the
+        // payload
+        appData.BufferSize = 0;
+        appData.Buffer = NULL;
+    }
     if( LmHandlerCallbacks->OnRxData != NULL )
     {
         LmHandlerCallbacks->OnRxData( &appData, &RxParams );
@@ -804,6 +1338,11 @@ static void McpsIndication( McpsIndication_t *mcpsIndication )
     // Call packages RxProcess function
     LmHandlerPackagesNotify( PACKAGE_MCPS_INDICATION, mcpsIndication );
 
+    if( portPackageId < PKG_MAX_NUMBER )
+    {
+        LmHandlerPackagePortDataNotify( portPackageId, mcpsIndication );
+    }
+
     if( mcpsIndication->IsUplinkTxPending != 0 )
     {
         // The server signals that it has pending data to be sent.
@@ -866,6 +1405,11 @@ static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
         break;
     case MLME_BEACON_ACQUISITION:
         {
+            if( IsClassBSwitchPending == false )
+            {
+                // The class B switch has been cancelled
+                break;
+            }
             if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
             {
                 // Beacon has been acquired
@@ -882,6 +1426,11 @@ static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
         break;
     case MLME_PING_SLOT_INFO:
         {
+            if( IsClassBSwitchPending == false )
+            {
+                // The class B switch has been cancelled
+                break;
+            }
             if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
             {
                 MibRequestConfirm_t mibReq;
@@ -998,14 +1547,25 @@ LmHandlerErrorStatus_t LmHandlerPackageRegister( uint8_t id, void *params )
     }
     if( package != NULL )
     {
+        if( ( package->OnPortDataProcess != NULL ) &&
+            ( PortHandlerAdd( package->Port, id, NULL ) != LORAMAC_HANDLER_SUCCESS ) )
+        {
+            // The package port is already used
+            return LORAMAC_HANDLER_ERROR;
+        }
         LmHandlerPackages[id] = package;
         LmHandlerPackages[id]->OnMacMcpsRequest = LmHandlerCallbacks->OnMacMcpsRequest;
         LmHandlerPackages[id]->OnMacMlmeRequest = LmHandlerCallbacks->OnMacMlmeRequest;
         LmHandlerPackages[id]->OnJoinRequest = LmHandlerJoinRequest;
         LmHandlerPackages[id]->OnDeviceTimeRequest = LmHandlerDeviceTimeReq;
+        LmHandlerPackages[id]->OnPackageProcessRequest = LmHandlerPackageProcessRequest;
         LmHandlerPackages[id]->OnSysTimeUpdate = LmHandlerCallbacks->OnSysTimeUpdate;
         LmHandlerPackages[id]->Init( params, LmHandlerParams->DataBuffer, LmHandlerParams->DataBufferMaxSize );
 
+        LmHandlerPackagesSubscribe( );
+        LmHandlerPackageUpdateTxPending( id );
+        LmHandlerPackagesWorkMask |= 1 << id;
+
         return LORAMAC_HANDLER_SUCCESS;
     }
     else
@@ -1026,75 +1586,149 @@ bool LmHandlerPackageIsInitialized( uint8_t id )
     }
 }
 
-static void LmHandlerPackagesNotify( PackageNotifyTypes_t notifyType, void *params )
+static void LmHandlerPackagesSubscribe( void )
 {
-    for( int8_t i = 0; i < PKG_MAX_NUMBER; i++ )
+    for( uint8_t notifyType = 0; notifyType < PACKAGE_NOTIFY_TYPES_NB; notifyType++ )
     {
-        if( LmHandlerPackages[i] != NULL )
+        LmHandlerPackagesNbSubscribers[notifyType] = 0;
+    }
+
+    for( uint8_t id = 0; id < PKG_MAX_NUMBER; id++ )
+    {
+        if( LmHandlerPackages[id] == NULL )
         {
-            switch( notifyType )
-            {
-                case PACKAGE_MCPS_CONFIRM:
-                {
-                    if( LmHandlerPackages[i]->OnMcpsConfirmProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMcpsConfirmProcess( ( McpsConfirm_t* ) params );
-                    }
-                    break;
-                }
-                case PACKAGE_MCPS_INDICATION:
-                {
-                    if( LmHandlerPackages[i]->OnMcpsIndicationProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMcpsIndicationProcess( ( McpsIndication_t* )params );
-                    }
-                    break;
-                }
-                case PACKAGE_MLME_CONFIRM:
-                {
-                    if( LmHandlerPackages[i]->OnMlmeConfirmProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMlmeConfirmProcess( ( MlmeConfirm_t* )params );
-                    }
-                    break;
-                }
-                case PACKAGE_MLME_INDICATION:
-                {
-                    if( LmHandlerPackages[i]->OnMlmeIndicationProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMlmeIndicationProcess( params );
-                    }
-                    break;
-                }
-            }
+            continue;
+        }
+        if( LmHandlerPackages[id]->OnMcpsConfirmProcess != NULL )
+        {
+            LmHandlerPackagesSubscribers[PACKAGE_MCPS_CONFIRM][LmHandlerPackagesNbSubscribers[PACKAGE_MCPS_CONFIRM]++] = id;
+        }
+        if( LmHandlerPackages[id]->OnMcpsIndicationProcess != NULL )
+        {
+            LmHandlerPackagesSubscribers[PACKAGE_MCPS_INDICATION][LmHandlerPackagesNbSubscribers[PACKAGE_MCPS_INDICATION]++] = id;
+        }
+        if( LmHandlerPackages[id]->OnMlmeConfirmProcess != NULL )
+        {
+            LmHandlerPackagesSubscribers[PACKAGE_MLME_CONFIRM][LmHandlerPackagesNbSubscribers[PACKAGE_MLME_CONFIRM]++] = id;
+        }
+        if( LmHandlerPackages[id]->OnMlmeIndicationProcess != NULL )
+        {
+            LmHandlerPackagesSubscribers[PACKAGE_MLME_INDICATION][LmHandlerPackagesNbSubscribers[PACKAGE_MLME_INDICATION]++] = id;
         }
     }
 }
 
-static bool LmHandlerPackageIsTxPending( void )
+static void LmHandlerPackageUpdateTxPending( uint8_t id )
+{
+    if( ( LmHandlerPackages[id]->IsTxPending != NULL ) && ( LmHandlerPackages[id]->IsTxPending( ) == true ) )
+    {
+        LmHandlerPackagesTxPendingMask |= 1 << id;
+    }
+    else
+    {
+        LmHandlerPackagesTxPendingMask &= ~( 1 << id );
+    }
+}
+
+static void LmHandlerPackageProcessRequest( uint8_t id )
+{
+    if( id >= PKG_MAX_NUMBER )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    LmHandlerPackagesWorkMask |= 1 << id;
+    CRITICAL_SECTION_END( );
+
+    // Wake up the main loop in order to process the package
+    if( LmHandlerCallbacks->OnMacProcess != NULL )
+    {
+        LmHandlerCallbacks->OnMacProcess( );
+    }
+}
+
+static void LmHandlerPackagesNotify( PackageNotifyTypes_t notifyType, void *params )
 {
-    for( int8_t i = 0; i < PKG_MAX_NUMBER; i++ )
+    uint8_t workMask = 0;
+
+    for( uint8_t i = 0; i < LmHandlerPackagesNbSubscribers[notifyType]; i++ )
     {
-        if( LmHandlerPackages[i] != NULL )
+        uint8_t id = LmHandlerPackagesSubscribers[notifyType][i];
+
+        switch( notifyType )
         {
-            if( LmHandlerPackages[i]->IsTxPending( ) == true )
+            case PACKAGE_MCPS_CONFIRM:
             {
-                return true;
+                LmHandlerPackages[id]->OnMcpsConfirmProcess( ( McpsConfirm_t* ) params );
+                break;
+            }
+            case PACKAGE_MCPS_INDICATION:
+            {
+                LmHandlerPackages[id]->OnMcpsIndicationProcess( ( McpsIndication_t* )params );
+                break;
+            }
+            case PACKAGE_MLME_CONFIRM:
+            {
+                LmHandlerPackages[id]->OnMlmeConfirmProcess( ( MlmeConfirm_t* )params );
+                break;
+            }
+            case PACKAGE_MLME_INDICATION:
+            {
+                LmHandlerPackages[id]->OnMlmeIndicationProcess( params );
+                break;
+            }
+            default:
+            {
+                break;
             }
         }
+        LmHandlerPackageUpdateTxPending( id );
+        // The package processes the consequences of the event
+        workMask |= 1 << id;
     }
-    return false;
+
+    // The packages waiting to transmit may retry once the MAC layer has
+    // completed an operation
+    workMask |= LmHandlerPackagesTxPendingMask;
+
+    CRITICAL_SECTION_BEGIN( );
+    LmHandlerPackagesWorkMask |= workMask;
+    CRITICAL_SECTION_END( );
+}
+
+static void LmHandlerPackagePortDataNotify( uint8_t id, McpsIndication_t *mcpsIndication )
+{
+    LmHandlerPackages[id]->OnPortDataProcess( mcpsIndication );
+    LmHandlerPackageUpdateTxPending( id );
+
+    CRITICAL_SECTION_BEGIN( );
+    LmHandlerPackagesWorkMask |= ( 1 << id ) | LmHandlerPackagesTxPendingMask;
+    CRITICAL_SECTION_END( );
+}
+
+static bool LmHandlerPackageIsTxPending( void )
+{
+    return LmHandlerPackagesTxPendingMask != 0;
 }
 
 static void LmHandlerPackagesProcess( void )
 {
-    for( int8_t i = 0; i < PKG_MAX_NUMBER; i++ )
+    uint8_t workMask;
+
+    CRITICAL_SECTION_BEGIN( );
+    workMask = LmHandlerPackagesWorkMask;
+    LmHandlerPackagesWorkMask = 0;
+    CRITICAL_SECTION_END( );
+
+    for( uint8_t id = 0; workMask != 0; id++, workMask >>= 1 )
     {
-        if( ( LmHandlerPackages[i] != NULL ) &&
-            ( LmHandlerPackages[i]->Process != NULL ) &&
-            ( LmHandlerPackageIsInitialized( i ) != false ) )
+        if( ( ( workMask & 0x01 ) != 0 ) &&
+            ( LmHandlerPackages[id]->Process != NULL ) &&
+            ( LmHandlerPackageIsInitialized( id ) != false ) )
         {
-            LmHandlerPackages[i]->Process( );
+            LmHandlerPackages[id]->Process( );
+            LmHandlerPackageUpdateTxPending( id );
         }
     }
 }
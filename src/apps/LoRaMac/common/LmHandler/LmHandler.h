@@ -72,6 +72,52 @@ typedef struct LoRaMacHandlerBeaconParams_s
     BeaconInfo_t Info;
 }LoRaMacHandlerBeaconParams_t;
 
+typedef struct LmHandlerUplinkQueueStats_s
+{
+    /*!
+     * Current number of queued uplinks
+     */
+    uint8_t Depth;
+    /*!
+     * Maximum number of queued uplinks observed
+     */
+    uint8_t MaxDepth;
+    /*!
+     * Number of uplinks accepted by the queue
+     */
+    uint32_t NbEnqueued;
+    /*!
+     * Number of uplinks which replaced a pending uplink on the same port
+     */
+    uint32_t NbCoalesced;
+    /*!
+     * Number of uplinks dropped because the queue was full or because the
+     * datarate has been lowered below their size while queued
+     */
+    uint32_t NbDropped;
+    /*!
+     * Number of uplinks handed over to the MAC layer
+     */
+    uint32_t NbSent;
+    /*!
+     * Sum of the queue wait times of the sent uplinks in ms
+     */
+    TimerTime_t TotalWaitTime;
+    /*!
+     * Maximum queue wait time in ms
+     */
+    TimerTime_t MaxWaitTime;
+}LmHandlerUplinkQueueStats_t;
+
+/*!
+ * Downlink port handler
+ *
+ * \param [IN] appData Received application data. The buffer is the payload
+ *                     decrypted by the MAC layer, only valid during the call
+ * \param [IN] params  Reception parameters
+ */
+typedef void ( *LmHandlerPortHandler_t )( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params );
+
 typedef struct LmHandlerParams_s
 {
     /*!
@@ -187,6 +233,11 @@ typedef struct LmHandlerCallbacks_s
     /*!
      * Notifies the upper layer that an applicative frame has been received
      *
+     * \remark The payload of the downlinks received on a port with a
+     *         registered handler is only given to that handler. Their
+     *         reception is notified with a BufferSize of 0 and a NULL
+     *         Buffer.
+     *
      * \param [IN] appData Received applicative data
      * \param [IN] params notification parameters
      */
@@ -263,6 +314,74 @@ TimerTime_t LmHandlerGetDutyCycleWaitTime( void );
  */
 LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed );
 
+/*!
+ * Instructs the MAC layer to send a ClassA uplink at the given datarate
+ *
+ * \Note The datarate is only used when ADR is off. It then becomes the
+ *       current datarate, which \ref LmHandlerReserveAppData relies on.
+ *       The next \ref LmHandlerSend restores the application datarate.
+ *
+ * \param [IN] appData Data to be sent
+ * \param [IN] isTxConfirmed Indicates if the uplink requires an acknowledgement
+ * \param [IN] datarate Datarate of the uplink
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if request has been
+ *                processed else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerSendAtDatarate( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                                int8_t datarate );
+
+/*!
+ * Reserves the application payload area of the next uplink directly inside
+ * the MAC frame buffer.
+ *
+ * \Note The application writes its payload into appData->Buffer and calls
+ *       \ref LmHandlerSend with the same appData. The payload is then sent
+ *       without any intermediate copy.
+ *       When the payload no longer fits, e.g. because of new MAC commands,
+ *       \ref LmHandlerSend fails instead of sending an empty frame over the
+ *       reserved area. The application then reserves the buffer again.
+ *
+ * \param [IN/OUT] appData Application data. Buffer is set to the reserved
+ *                         area and BufferSize to the maximum payload size.
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if request has been
+ *                processed else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerReserveAppData( LmHandlerAppData_t *appData );
+
+/*!
+ * Queues an uplink. The queued uplinks are sent by \ref LmHandlerProcess
+ * as soon as the MAC layer is idle, highest priority first and in arrival
+ * order for a given priority.
+ *
+ * \Note A pending uplink on the same port is replaced by the new data
+ *       (coalescing). When the queue is full the newest uplink of the lowest
+ *       priority class is dropped if it has a lower priority than the new one.
+ *
+ * \Note An uplink larger than the maximum payload of the current datarate is
+ *       rejected. A queued uplink which no longer fits once the datarate has
+ *       been lowered (e.g. ADR back-off) is dropped when it comes up for
+ *       transmission and counted in \ref LmHandlerUplinkQueueStats_t.NbDropped.
+ *       The application has to split or re-queue such data.
+ *
+ * \param [IN] appData Data to be sent. The data is copied into the queue
+ * \param [IN] isTxConfirmed Indicates if the uplink requires an acknowledgement
+ * \param [IN] priority Uplink priority class
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the uplink has been
+ *                queued else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerSendQueued( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                            LmHandlerUplinkPriorities_t priority );
+
+/*!
+ * Gets the uplink queue statistics
+ *
+ * \retval stats Uplink queue statistics
+ */
+const LmHandlerUplinkQueueStats_t* LmHandlerGetUplinkQueueStats( void );
+
 /*!
  * Join a LoRa Network in classA
  *
@@ -295,6 +414,8 @@ LmHandlerErrorStatus_t LmHandlerPingSlotReq( uint8_t periodicity );
  *
  * \Note Callback \ref LmHandlerConfirmClass informs upper layer that the change has occurred
  * \Note Only switch from class A to class B/C OR from class B/C to class A is allowed
+ * \Note The switch to class B completes once the beacon is acquired. Requesting
+ *       another class meanwhile cancels it.
  *
  * \param [IN] newClass New class to be requested
  *
@@ -317,6 +438,21 @@ DeviceClass_t LmHandlerGetCurrentClass( void );
  */
 int8_t LmHandlerGetCurrentDatarate( void );
 
+/*!
+ * Gets the next transmission opportunity of an uplink
+ *
+ * \param [IN]  size          Application data payload size
+ * \param [IN]  datarate      Datarate of the uplink
+ * \param [OUT] txOpportunity Time to wait until the uplink is accepted and
+ *                            maximum application data payload size
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the uplink can be
+ *                sent after \ref LoRaMacTxOpportunity_t.TimeToWait
+ *                else \ref LORAMAC_HANDLER_ERROR, also while the MAC layer
+ *                is busy
+ */
+LmHandlerErrorStatus_t LmHandlerGetNextTxOpportunity( uint8_t size, int8_t datarate, LoRaMacTxOpportunity_t* txOpportunity );
+
 /*!
  * Gets the current active region
  *
@@ -341,6 +477,32 @@ LmHandlerErrorStatus_t LmHandlerSetSystemMaxRxError( uint32_t maxErrorInMs );
  */
 LmHandlerErrorStatus_t LmHandlerDeviceTimeReq( void );
 
+/*!
+ * Registers the handler of the downlinks received on a port. The handler
+ * becomes the only consumer of the port payload, OnRxData only notifies the
+ * receptions on the port, without payload.
+ *
+ * \param [IN] port    Port from 1 to 255
+ * \param [IN] handler Port handler
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the handler has been
+ *                registered else \ref LORAMAC_HANDLER_ERROR when the port is
+ *                invalid or already used, or when the table is full
+ */
+LmHandlerErrorStatus_t LmHandlerPortHandlerRegister( uint8_t port, LmHandlerPortHandler_t handler );
+
+/*!
+ * Unregisters the handler of a port. The port payloads are then given to
+ * OnRxData.
+ *
+ * \param [IN] port Port
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the handler has been
+ *                unregistered else \ref LORAMAC_HANDLER_ERROR when the port
+ *                has no application handler
+ */
+LmHandlerErrorStatus_t LmHandlerPortHandlerUnregister( uint8_t port );
+
 /*
  *=============================================================================
  * PACKAGES HANDLING
@@ -77,6 +77,16 @@ typedef enum
     LORAMAC_HANDLER_TRUE = !LORAMAC_HANDLER_FALSE
 }LmHandlerBoolean_t;
 
+/*!
+ * Uplink queue priority classes. Lower value means higher priority
+ */
+typedef enum
+{
+    LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM = 0,
+    LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY,
+    LORAMAC_HANDLER_UPLINK_PRIORITY_BULK,
+}LmHandlerUplinkPriorities_t;
+
 typedef enum
 {
     LORAMAC_HANDLER_BEACON_ACQUIRING,
@@ -48,6 +48,87 @@
  *=============================================================================
  */
 
+/*!
+ * Word used by the bit array kernels. The bit arrays are stored most
+ * significant bit first in words of FRAG_WORD_BITS bits.
+ */
+#if defined( __LP64__ ) || defined( _WIN64 )
+typedef uint64_t FragWord_t;
+#define FRAG_WORD_BITS                              64
+#else
+typedef uint32_t FragWord_t;
+#define FRAG_WORD_BITS                              32
+#endif
+
+/*!
+ * Most significant bit of a word
+ */
+#define FRAG_WORD_MSB                               ( ( FragWord_t )1 << ( FRAG_WORD_BITS - 1 ) )
+
+/*!
+ * Number of words of a bit array. Includes one extra word read by the
+ * unaligned bit field accesses.
+ */
+#define FRAG_BIT_ARRAY_SIZE( nbBits )               ( ( ( nbBits ) / FRAG_WORD_BITS ) + 2 )
+
+/*!
+ * Size of the file storage accessed through the callbacks
+ */
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 1 )
+#define FRAG_DECODER_STORAGE_SIZE                   ( ( FRAG_MAX_NB * FRAG_MAX_SIZE ) + FRAG_DECODER_MATRIX_SIZE )
+#else
+#define FRAG_DECODER_STORAGE_SIZE                   ( FRAG_MAX_NB * FRAG_MAX_SIZE )
+#endif
+
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+/*!
+ * Write-back cache of one storage page
+ */
+typedef struct
+{
+    /*!
+     * Address of the cached page
+     */
+    uint32_t Addr;
+    /*!
+     * Indicates if the page holds valid data
+     */
+    bool IsValid;
+    /*!
+     * Indicates if the page has to be written back
+     */
+    bool IsDirty;
+    /*!
+     * Page data
+     */
+    uint8_t Data[FRAG_DECODER_CACHE_PAGE_SIZE];
+}FragPageCache_t;
+#endif
+
+/*!
+ * Parity matrix row generator state. Holds the constants replacing the
+ * modulo of the coefficient draws by a multiply-shift, computed once per m.
+ */
+typedef struct
+{
+    /*!
+     * Number of fragments the constants have been computed for
+     */
+    int32_t M;
+    /*!
+     * Modulo of the draws. m + 1 when m is a power of two, m otherwise
+     */
+    uint32_t Modulus;
+    /*!
+     * ceil( 2^Shift / Modulus )
+     */
+    uint32_t Multiplier;
+    /*!
+     * 31 + ceil( log2( Modulus ) )
+     */
+    uint8_t Shift;
+}FragRowGenerator_t;
+
 typedef struct
 {
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
@@ -60,10 +141,19 @@ typedef struct
     uint8_t FragSize;
 
     uint32_t M2BLine;
-    uint8_t MatrixM2B[( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY];
-    uint16_t FragNbMissingIndex[FRAG_MAX_NB];
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 0 )
+    // Upper triangular matrix. Row i holds the bits i to FragNbLost - 1
+    FragWord_t MatrixM2B[FRAG_BIT_ARRAY_SIZE( ( FRAG_MAX_REDUNDANCY * ( FRAG_MAX_REDUNDANCY + 1 ) ) >> 1 )];
+#endif
+    // Indexes of the lost fragments in ascending order
+    uint16_t MissingFrags[FRAG_MAX_REDUNDANCY];
 
-    uint8_t S[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+    FragWord_t S[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY )];
+
+    FragRowGenerator_t RowGenerator;
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+    FragPageCache_t Cache;
+#endif
 
     FragDecoderStatus_t Status;
 }FragDecoder_t;
@@ -118,7 +208,7 @@ static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size );
  *
  * \retval parity         Parity value at the given index
  */
-static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  );
+static uint8_t GetParity( uint16_t index, FragWord_t *matrixRow  );
 
 /*!
  * \brief Sets the parity value on the given row of the parity matrix
@@ -127,7 +217,7 @@ static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  );
  * \param [IN/OUT] matrixRow Pointer to the parity matrix.
  * \param [IN]     parity    The parity value to be set in the parity matrix
  */
-static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity );
+static void SetParity( uint16_t index, FragWord_t *matrixRow, uint8_t parity );
 
 /*!
  * \brief Check if the provided value is a power of 2
@@ -138,6 +228,150 @@ static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity );
  */
 static bool IsPowerOfTwo( uint32_t x );
 
+/*!
+ * \brief Counts the leading zeros of a word
+ *
+ * \param [IN] word Word to scan. Must not be 0
+ *
+ * \retval count  Number of zeros before the most significant bit set
+ */
+static uint8_t CountLeadingZeros( FragWord_t word );
+
+/*!
+ * \brief Reads FRAG_WORD_BITS bits at any bit offset of a bit array
+ *
+ * \param [IN] bitArray Pointer to the bit array
+ * \param [IN] offset   Bit offset of the first bit
+ *
+ * \retval bits         Bits, the first one being the most significant bit
+ */
+static FragWord_t GetBits( FragWord_t *bitArray, uint32_t offset );
+
+/*!
+ * \brief Writes up to FRAG_WORD_BITS bits at any bit offset of a bit array
+ *
+ * \param [IN] bitArray Pointer to the bit array
+ * \param [IN] offset   Bit offset of the first bit
+ * \param [IN] bits     Bits, the first one being the most significant bit
+ * \param [IN] nbBits   Number of bits to be written
+ */
+static void PutBits( FragWord_t *bitArray, uint32_t offset, FragWord_t bits, uint8_t nbBits );
+
+/*!
+ * \brief Copies bits between two bit arrays
+ *
+ * \param [IN] dst       Pointer to the destination bit array
+ * \param [IN] dstOffset Bit offset in the destination bit array
+ * \param [IN] src       Pointer to the source bit array
+ * \param [IN] srcOffset Bit offset in the source bit array
+ * \param [IN] nbBits    Number of bits to be copied
+ */
+static void CopyBits( FragWord_t *dst, uint32_t dstOffset, FragWord_t *src, uint32_t srcOffset, uint32_t nbBits );
+
+/*!
+ * \brief Computes the bit offset of a row of the upper triangular matrix
+ *
+ * \param [IN] rowIndex  Matrix row index
+ * \param [IN] bitsInRow Number of bits in one row
+ *
+ * \retval offset        Bit offset of the first bit of the row
+ */
+static uint32_t GetMatrixRowOffset( uint16_t rowIndex, uint16_t bitsInRow );
+
+/*!
+ * \brief Reads bits of the M2B matrix
+ *
+ * \param [OUT] dst          Pointer to the destination bit array
+ * \param [IN]  dstOffset    Bit offset in the destination bit array
+ * \param [IN]  matrixOffset Bit offset in the matrix
+ * \param [IN]  nbBits       Number of bits to be read
+ */
+static void MatrixReadBits( FragWord_t *dst, uint16_t dstOffset, uint32_t matrixOffset, uint16_t nbBits );
+
+/*!
+ * \brief Writes bits of the M2B matrix
+ *
+ * \param [IN] src          Pointer to the source bit array
+ * \param [IN] srcOffset    Bit offset in the source bit array
+ * \param [IN] matrixOffset Bit offset in the matrix
+ * \param [IN] nbBits       Number of bits to be written
+ */
+static void MatrixWriteBits( FragWord_t *src, uint16_t srcOffset, uint32_t matrixOffset, uint16_t nbBits );
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+/*!
+ * \brief Fills an area of the file storage with 0xFF. The parts already
+ *        erased are not written.
+ *
+ * \param [IN] addr Address of the area
+ * \param [IN] size Size of the area
+ */
+static void FillStorage( uint32_t addr, uint32_t size );
+
+/*!
+ * \brief Writes to the file storage
+ *
+ * \param [IN] addr Storage address
+ * \param [IN] data Data buffer to be written
+ * \param [IN] size Size of the data buffer
+ */
+static void StorageWrite( uint32_t addr, uint8_t *data, uint32_t size );
+
+/*!
+ * \brief Reads from the file storage
+ *
+ * \param [IN] addr Storage address
+ * \param [OUT] data Data buffer
+ * \param [IN] size Number of bytes to be read
+ */
+static void StorageRead( uint32_t addr, uint8_t *data, uint32_t size );
+
+/*!
+ * \brief Writes the cached page back to the file storage
+ */
+static void StorageFlush( void );
+#endif
+
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+/*!
+ * \brief Loads a page in the cache. The previous page is written back first.
+ *
+ * \param [IN] pageAddr      Page address
+ * \param [IN] isOverwritten Set to true when the whole page will be written.
+ *                           The page is then not read from the storage.
+ */
+static void LoadCachePage( uint32_t pageAddr, bool isOverwritten );
+#endif
+
+/*!
+ * \brief Processes a received fragment
+ *
+ * \param [IN] fragCounter Fragment counter
+ * \param [IN] rawData     Pointer to the fragment to be processed
+ * \retval status          Process status, see \ref FragDecoderProcess
+ */
+static int32_t FragDecoderProcessFragment( uint16_t fragCounter, uint8_t *rawData );
+
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 1 )
+/*!
+ * \brief Reads bytes of the M2B matrix from the file storage
+ *
+ * \param [OUT] words Destination bit array. Bytes are stored most significant first
+ * \param [IN]  addr  Byte address in the matrix
+ * \param [IN]  size  Number of bytes to be read
+ */
+static void ReadMatrix( FragWord_t *words, uint32_t addr, uint16_t size );
+
+/*!
+ * \brief Writes bytes of the M2B matrix to the file storage
+ *
+ * \param [IN] words Source bit array. Is modified by the function
+ * \param [IN] addr  Byte address in the matrix
+ * \param [IN] size  Number of bytes to be written
+ */
+static void WriteMatrix( FragWord_t *words, uint32_t addr, uint16_t size );
+#endif
+
 /*!
  * \brief XOrs two data lines
  *
@@ -158,7 +392,7 @@ static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size );
  *
  * \param [OUT] result XOR( line1, line2 ) result stored in line1
  */
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size );
+static void XorParityLine( FragWord_t* line1, FragWord_t* line2, int32_t size );
 
 /*!
  * \brief Generates a pseudo random number : PRBS23
@@ -169,6 +403,14 @@ static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size );
  */
 static int32_t FragPrbs23( int32_t value );
 
+/*!
+ * \brief Computes the range reduction constants of the parity matrix row
+ *        generator
+ *
+ * \param [IN] m Fragment number
+ */
+static void FragUpdateRowGenerator( int32_t m );
+
 /*!
  * \brief Gets and fills the parity matrix
  *
@@ -176,7 +418,7 @@ static int32_t FragPrbs23( int32_t value );
  * \param [IN]  m         Fragment number
  * \param [OUT] matrixRow Parity matrix
  */
-static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow );
+static void FragGetParityMatrixRow( int32_t n, int32_t m, FragWord_t *matrixRow );
 
 /*!
  * \brief Finds the index of the first one in a bit array
@@ -185,7 +427,7 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow );
  * \param [IN] size     Bit array size
  * \retval index        The index of the first 1 in the bit array
  */
-static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size );
+static uint16_t BitArrayFindFirstOne( FragWord_t *bitArray, uint16_t size );
 
 /*!
  * \brief Checks if the provided bit array only contains zeros
@@ -194,13 +436,13 @@ static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size );
  * \param [IN] size     Bit array size
  * \retval isAllZeros   [0: Contains ones, 1: Contains all zeros]
  */
-static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size );
+static uint8_t BitArrayIsAllZeros( FragWord_t *bitArray, uint16_t  size );
 
 /*!
  * \brief Finds & marks missing fragments
  *
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] FragDecoder.MissingFrags[] list is updated in place
  */
 static void FragFindMissingFrags( uint16_t counter );
 
@@ -220,7 +462,7 @@ static uint16_t FragFindMissingIndex( uint16_t x );
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+static void FragExtractLineFromBinaryMatrix( FragWord_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow );
 
 /*!
  * \brief Collapses and Pushs a row of a bit array to the matrix
@@ -229,7 +471,7 @@ static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowInde
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+static void FragPushLineToBinaryMatrix( FragWord_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
 
 /*
  *=============================================================================
@@ -256,37 +498,37 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t
     FragDecoder.Status.FragNbLastRx = 0;
     FragDecoder.Status.FragNbLost = 0;
     FragDecoder.M2BLine = 0;
-
-    // Initialize missing fragments index array
-    for( uint16_t i = 0; i < FRAG_MAX_NB; i++ )
-    {
-        FragDecoder.FragNbMissingIndex[i] = 1;
-    }
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+    // Drop any page left by an aborted session
+    FragDecoder.Cache.IsValid = false;
+    FragDecoder.Cache.IsDirty = false;
+#endif
 
     // Initialize parity matrix
-    for( uint32_t i = 0; i < ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ); i++ )
+    for( uint32_t i = 0; i < FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY ); i++ )
     {
         FragDecoder.S[i] = 0;
     }
 
-    for( uint32_t i = 0; i < ( ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY ); i++ )
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 1 )
+    FillStorage( FRAG_MAX_NB * FRAG_MAX_SIZE, FRAG_DECODER_MATRIX_SIZE );
+#else
+    for( uint32_t i = 0; i < FRAG_BIT_ARRAY_SIZE( ( FRAG_MAX_REDUNDANCY * ( FRAG_MAX_REDUNDANCY + 1 ) ) >> 1 ); i++ )
     {
-       FragDecoder.MatrixM2B[i] = 0xFF;
+       FragDecoder.MatrixM2B[i] = ( FragWord_t )-1;
     }
+#endif
     
     // Initialize final uncoded data buffer ( FRAG_MAX_NB * FRAG_MAX_SIZE )
-    for( uint32_t i = 0; i < ( fragNb * fragSize ); i++ )
-    {
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-        if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
-        {
-            uint8_t buffer[1] = { 0xFF };
-            FragDecoder.Callbacks->FragDecoderWrite( i, buffer, 1 );
-        }
+    FillStorage( 0, fragNb * fragSize );
+    StorageFlush( );
 #else
+    for( uint32_t i = 0; i < ( fragNb * fragSize ); i++ )
+    {
         FragDecoder.File[i] = 0xFF;
-#endif
     }
+#endif
     FragDecoder.Status.FragNbLost = 0;
     FragDecoder.Status.FragNbLastRx = 0;
 }
@@ -299,20 +541,39 @@ uint32_t FragDecoderGetMaxFileSize( void )
 #endif
 
 int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
+{
+    int32_t status = FragDecoderProcessFragment( fragCounter, rawData );
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    if( status != FRAG_SESSION_ONGOING )
+    {
+        // The application reads the file once the session is over
+        StorageFlush( );
+    }
+#endif
+    return status;
+}
+
+static int32_t FragDecoderProcessFragment( uint16_t fragCounter, uint8_t *rawData )
 {
     uint16_t firstOneInRow = 0;
     int32_t first = 0;
     int32_t noInfo = 0;
-
-    uint8_t matrixRow[(FRAG_MAX_NB >> 3 ) + 1];
-    uint8_t matrixDataTemp[FRAG_MAX_SIZE];
-    uint8_t dataTempVector[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
-    uint8_t dataTempVector2[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
-
-    memset1( matrixRow, 0, ( FRAG_MAX_NB >> 3 ) + 1 );
-    memset1( matrixDataTemp, 0, FRAG_MAX_SIZE );
-    memset1( dataTempVector, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
-    memset1( dataTempVector2, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
+    uint16_t missingIndex = 0;
+
+    FragWord_t matrixRow[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_NB )];
+    // Word aligned data lines, for the word wide XOR
+    FragWord_t matrixDataWords[( FRAG_MAX_SIZE + sizeof( FragWord_t ) - 1 ) / sizeof( FragWord_t )];
+    FragWord_t fragDataWords[( FRAG_MAX_SIZE + sizeof( FragWord_t ) - 1 ) / sizeof( FragWord_t )];
+    uint8_t *matrixDataTemp = ( uint8_t* )matrixDataWords;
+    uint8_t *fragData = ( uint8_t* )fragDataWords;
+    FragWord_t dataTempVector[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY )];
+    FragWord_t dataTempVector2[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY )];
+
+    memset1( ( uint8_t* )matrixRow, 0, sizeof( matrixRow ) );
+    memset1( matrixDataTemp, 0, sizeof( matrixDataWords ) );
+    memset1( ( uint8_t* )dataTempVector, 0, sizeof( dataTempVector ) );
+    memset1( ( uint8_t* )dataTempVector2, 0, sizeof( dataTempVector2 ) );
 
     FragDecoder.Status.FragNbRx = fragCounter;
 
@@ -332,9 +593,7 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
         SetRow( FragDecoder.File, rawData, fragCounter - 1, FragDecoder.FragSize );
 #endif
 
-        FragDecoder.FragNbMissingIndex[fragCounter - 1] = 0;
-
-        // Update the FragDecoder.FragNbMissingIndex with the loosing frame
+        // Update the FragDecoder.MissingFrags with the loosing frame
         FragFindMissingFrags( fragCounter );
 
         if( ( FragDecoder.Status.FragNbLost == 0 ) && ( fragCounter == FragDecoder.FragNb ) )
@@ -345,25 +604,36 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
     }
     else
     {
+        // In case of the end of true data is missing
+        FragFindMissingFrags( fragCounter );
+
+        // The lost fragments are all known from here. The missing fragments
+        // list and the M2B matrix only hold FRAG_MAX_REDUNDANCY of them.
         if( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY )
         {
            FragDecoder.Status.MatrixError = 1;
            return FRAG_SESSION_FINISHED;
         }
-        // At this point we receive encoded frames and the number of loosing frames
-        // is well known: FragDecoder.FragNbLost - 1;
 
-        // In case of the end of true data is missing
-        FragFindMissingFrags( fragCounter );
+        // The received frame may not be word aligned
+        memcpy1( fragData, rawData, FragDecoder.FragSize );
 
         // fragCounter - FragDecoder.FragNb
+        missingIndex = 0;
         FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, matrixRow );
 
         for( int32_t i = 0; i < FragDecoder.FragNb; i++ )
         {
             if( GetParity( i , matrixRow ) == 1 )
             {
-                if( FragDecoder.FragNbMissingIndex[i] == 0 )
+                // Both the row and the missing fragments list are in ascending order
+                while( ( missingIndex < FragDecoder.Status.FragNbLost ) &&
+                       ( FragDecoder.MissingFrags[missingIndex] < i ) )
+                {
+                    missingIndex++;
+                }
+                if( ( missingIndex == FragDecoder.Status.FragNbLost ) ||
+                    ( FragDecoder.MissingFrags[missingIndex] != i ) )
                 {
                     // XOR with already receive frag
                     SetParity( i, matrixRow, 0 );
@@ -372,12 +642,12 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
 #else
                     GetRow( matrixDataTemp, FragDecoder.File, i, FragDecoder.FragSize );
 #endif
-                    XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
+                    XorDataLine( fragData, matrixDataTemp, FragDecoder.FragSize );
                 }
                 else
                 {
                     // Fill the "little" boolean matrix m2b
-                    SetParity( FragDecoder.FragNbMissingIndex[i] - 1, dataTempVector, 1 );
+                    SetParity( missingIndex, dataTempVector, 1 );
                     if( first == 0 )
                     {
                         first = 1;
@@ -406,7 +676,7 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
 #else
                 GetRow( matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
 #endif
-                XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
+                XorDataLine( fragData, matrixDataTemp, FragDecoder.FragSize );
                 if( BitArrayIsAllZeros( dataTempVector, FragDecoder.Status.FragNbLost ) )
                 {
                     noInfo = 1;
@@ -420,9 +690,9 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
                 FragPushLineToBinaryMatrix( dataTempVector, firstOneInRow, FragDecoder.Status.FragNbLost );
                 li = FragFindMissingIndex( firstOneInRow );
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                SetRow( rawData, li, FragDecoder.FragSize );
+                SetRow( fragData, li, FragDecoder.FragSize );
 #else
-                SetRow( FragDecoder.File, rawData, li, FragDecoder.FragSize );
+                SetRow( FragDecoder.File, fragData, li, FragDecoder.FragSize );
 #endif
                 SetParity( firstOneInRow, FragDecoder.S, 1 );
                 FragDecoder.M2BLine++;
@@ -454,11 +724,11 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
                                 lj = FragFindMissingIndex( j );
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                                GetRow( rawData, lj, FragDecoder.FragSize );
+                                GetRow( fragData, lj, FragDecoder.FragSize );
 #else
-                                GetRow( rawData, FragDecoder.File, lj, FragDecoder.FragSize );
+                                GetRow( fragData, FragDecoder.File, lj, FragDecoder.FragSize );
 #endif
-                                XorDataLine( matrixDataTemp , rawData , FragDecoder.FragSize );
+                                XorDataLine( matrixDataTemp , fragData , FragDecoder.FragSize );
                             }
                         }
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
@@ -494,18 +764,12 @@ FragDecoderStatus_t FragDecoderGetStatus( void )
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 static void SetRow( uint8_t *src, uint16_t row, uint16_t size )
 {
-    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
-    {
-        FragDecoder.Callbacks->FragDecoderWrite( row * size, src, size );
-    }
+    StorageWrite( ( uint32_t )row * size, src, size );
 }
 
 static void GetRow( uint8_t *dst, uint16_t row, uint16_t size )
 {
-    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
-    {
-        FragDecoder.Callbacks->FragDecoderRead( row * size, dst, size );
-    }
+    StorageRead( ( uint32_t )row * size, dst, size );
 }
 #else
 static void SetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
@@ -519,28 +783,317 @@ static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
 }
 #endif
 
-static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  )
+static uint8_t GetParity( uint16_t index, FragWord_t *matrixRow  )
+{
+    return ( matrixRow[index / FRAG_WORD_BITS] >> ( ( FRAG_WORD_BITS - 1 ) - ( index % FRAG_WORD_BITS ) ) ) & 0x01;
+}
+
+static void SetParity( uint16_t index, FragWord_t *matrixRow, uint8_t parity )
+{
+    FragWord_t mask = FRAG_WORD_MSB >> ( index % FRAG_WORD_BITS );
+
+    if( parity != 0 )
+    {
+        matrixRow[index / FRAG_WORD_BITS] |= mask;
+    }
+    else
+    {
+        matrixRow[index / FRAG_WORD_BITS] &= ~mask;
+    }
+}
+
+static uint8_t CountLeadingZeros( FragWord_t word )
+{
+#if defined( __GNUC__ ) && ( FRAG_WORD_BITS == 64 )
+    return __builtin_clzll( word );
+#elif defined( __GNUC__ )
+    return __builtin_clz( word );
+#else
+    uint8_t count = 0;
+
+    while( ( word & FRAG_WORD_MSB ) == 0 )
+    {
+        word <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+static FragWord_t GetBits( FragWord_t *bitArray, uint32_t offset )
+{
+    uint32_t index = offset / FRAG_WORD_BITS;
+    uint8_t shift = offset % FRAG_WORD_BITS;
+
+    if( shift == 0 )
+    {
+        return bitArray[index];
+    }
+    return ( bitArray[index] << shift ) | ( bitArray[index + 1] >> ( FRAG_WORD_BITS - shift ) );
+}
+
+static void PutBits( FragWord_t *bitArray, uint32_t offset, FragWord_t bits, uint8_t nbBits )
+{
+    uint32_t index = offset / FRAG_WORD_BITS;
+    uint8_t shift = offset % FRAG_WORD_BITS;
+    FragWord_t mask = ( FragWord_t )-1;
+
+    if( nbBits < FRAG_WORD_BITS )
+    {
+        mask = ~( ( FragWord_t )-1 >> nbBits );
+    }
+    bits &= mask;
+
+    bitArray[index] = ( bitArray[index] & ~( mask >> shift ) ) | ( bits >> shift );
+    if( ( shift + nbBits ) > FRAG_WORD_BITS )
+    {
+        bitArray[index + 1] = ( bitArray[index + 1] & ~( mask << ( FRAG_WORD_BITS - shift ) ) ) |
+                              ( bits << ( FRAG_WORD_BITS - shift ) );
+    }
+}
+
+static void CopyBits( FragWord_t *dst, uint32_t dstOffset, FragWord_t *src, uint32_t srcOffset, uint32_t nbBits )
+{
+    for( uint32_t i = 0; i < nbBits; i += FRAG_WORD_BITS )
+    {
+        PutBits( dst, dstOffset + i, GetBits( src, srcOffset + i ), MIN( nbBits - i, FRAG_WORD_BITS ) );
+    }
+}
+
+static uint32_t GetMatrixRowOffset( uint16_t rowIndex, uint16_t bitsInRow )
+{
+    // Row i holds bitsInRow - i bits
+    return ( ( uint32_t )rowIndex * bitsInRow ) - ( ( ( uint32_t )rowIndex * ( rowIndex - 1 ) ) >> 1 );
+}
+
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 1 )
+static void MatrixReadBits( FragWord_t *dst, uint16_t dstOffset, uint32_t matrixOffset, uint16_t nbBits )
+{
+    FragWord_t row[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY + 8 )];
+
+    ReadMatrix( row, matrixOffset >> 3, ( ( matrixOffset & 0x07 ) + nbBits + 7 ) >> 3 );
+    CopyBits( dst, dstOffset, row, matrixOffset & 0x07, nbBits );
+}
+
+static void MatrixWriteBits( FragWord_t *src, uint16_t srcOffset, uint32_t matrixOffset, uint16_t nbBits )
+{
+    FragWord_t row[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_REDUNDANCY + 8 )];
+    uint16_t size = ( ( matrixOffset & 0x07 ) + nbBits + 7 ) >> 3;
+
+    // The first and last bytes are shared with the neighbour rows
+    ReadMatrix( row, matrixOffset >> 3, size );
+    CopyBits( row, matrixOffset & 0x07, src, srcOffset, nbBits );
+    WriteMatrix( row, matrixOffset >> 3, size );
+}
+
+static void ReadMatrix( FragWord_t *words, uint32_t addr, uint16_t size )
+{
+    uint8_t *bytes = ( uint8_t* )words;
+
+    memset1( bytes, 0xFF, ( ( size / sizeof( FragWord_t ) ) + 1 ) * sizeof( FragWord_t ) );
+    StorageRead( ( FRAG_MAX_NB * FRAG_MAX_SIZE ) + addr, bytes, size );
+    // In place conversion, a word only depends on its own bytes
+    for( uint16_t i = 0; i <= ( size / sizeof( FragWord_t ) ); i++ )
+    {
+        FragWord_t word = 0;
+
+        for( uint8_t j = 0; j < sizeof( FragWord_t ); j++ )
+        {
+            word = ( word << 8 ) | bytes[( i * sizeof( FragWord_t ) ) + j];
+        }
+        words[i] = word;
+    }
+}
+
+static void WriteMatrix( FragWord_t *words, uint32_t addr, uint16_t size )
+{
+    uint8_t *bytes = ( uint8_t* )words;
+
+    for( uint16_t i = 0; i <= ( size / sizeof( FragWord_t ) ); i++ )
+    {
+        FragWord_t word = words[i];
+
+        for( uint8_t j = 0; j < sizeof( FragWord_t ); j++ )
+        {
+            bytes[( i * sizeof( FragWord_t ) ) + j] = word >> ( FRAG_WORD_BITS - 8 - ( j * 8 ) );
+        }
+    }
+    StorageWrite( ( FRAG_MAX_NB * FRAG_MAX_SIZE ) + addr, bytes, size );
+}
+#else
+static void MatrixReadBits( FragWord_t *dst, uint16_t dstOffset, uint32_t matrixOffset, uint16_t nbBits )
+{
+    CopyBits( dst, dstOffset, FragDecoder.MatrixM2B, matrixOffset, nbBits );
+}
+
+static void MatrixWriteBits( FragWord_t *src, uint16_t srcOffset, uint32_t matrixOffset, uint16_t nbBits )
+{
+    CopyBits( FragDecoder.MatrixM2B, matrixOffset, src, srcOffset, nbBits );
+}
+#endif
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+/*!
+ * \brief Checks if a buffer only contains erased (0xFF) bytes
+ *
+ * \param [IN] data Data buffer
+ * \param [IN] size Size of the data buffer
+ * \retval isErased [true: all bytes are 0xFF, false: otherwise]
+ */
+static bool IsErased( uint8_t *data, uint32_t size )
 {
-    uint8_t parity;
-    parity = matrixRow[index >> 3];
-    parity = ( parity >> ( 7 - ( index % 8 ) ) ) & 0x01;
-    return parity;
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        if( data[i] != 0xFF )
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
-static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity )
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+static void FillStorage( uint32_t addr, uint32_t size )
 {
-    uint8_t mask = 0xFF - ( 1 << ( 7 - ( index % 8 ) ) );
-    parity = parity << ( 7 - ( index % 8 ) );
-    matrixRow[index >> 3] = ( matrixRow[index >> 3] & mask ) + parity;
+    while( size > 0 )
+    {
+        uint32_t pageAddr = addr - ( addr % FRAG_DECODER_CACHE_PAGE_SIZE );
+        uint32_t offset = addr - pageAddr;
+        uint32_t chunkSize = MIN( size, FRAG_DECODER_CACHE_PAGE_SIZE - offset );
+
+        LoadCachePage( pageAddr, false );
+        if( IsErased( &FragDecoder.Cache.Data[offset], chunkSize ) == false )
+        {
+            memset1( &FragDecoder.Cache.Data[offset], 0xFF, chunkSize );
+            FragDecoder.Cache.IsDirty = true;
+        }
+        addr += chunkSize;
+        size -= chunkSize;
+    }
 }
 
+static void StorageWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    while( size > 0 )
+    {
+        uint32_t pageAddr = addr - ( addr % FRAG_DECODER_CACHE_PAGE_SIZE );
+        uint32_t offset = addr - pageAddr;
+        uint32_t chunkSize = MIN( size, FRAG_DECODER_CACHE_PAGE_SIZE - offset );
+
+        LoadCachePage( pageAddr, chunkSize == FRAG_DECODER_CACHE_PAGE_SIZE );
+        memcpy1( &FragDecoder.Cache.Data[offset], data, chunkSize );
+        FragDecoder.Cache.IsDirty = true;
+        addr += chunkSize;
+        data += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+static void StorageRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    while( size > 0 )
+    {
+        uint32_t pageAddr = addr - ( addr % FRAG_DECODER_CACHE_PAGE_SIZE );
+        uint32_t offset = addr - pageAddr;
+        uint32_t chunkSize = MIN( size, FRAG_DECODER_CACHE_PAGE_SIZE - offset );
+
+        if( ( FragDecoder.Cache.IsValid == true ) && ( FragDecoder.Cache.Addr == pageAddr ) )
+        {
+            memcpy1( data, &FragDecoder.Cache.Data[offset], chunkSize );
+        }
+        else if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
+        {
+            // Misses do not evict the page being written
+            FragDecoder.Callbacks->FragDecoderRead( addr, data, chunkSize );
+        }
+        addr += chunkSize;
+        data += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+static void StorageFlush( void )
+{
+    if( ( FragDecoder.Cache.IsValid == true ) && ( FragDecoder.Cache.IsDirty == true ) &&
+        ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
+    {
+        // The last page may go beyond the end of the storage
+        FragDecoder.Callbacks->FragDecoderWrite( FragDecoder.Cache.Addr, FragDecoder.Cache.Data,
+                                                 MIN( FRAG_DECODER_CACHE_PAGE_SIZE, FRAG_DECODER_STORAGE_SIZE - FragDecoder.Cache.Addr ) );
+    }
+    FragDecoder.Cache.IsDirty = false;
+}
+
+static void LoadCachePage( uint32_t pageAddr, bool isOverwritten )
+{
+    if( ( FragDecoder.Cache.IsValid == true ) && ( FragDecoder.Cache.Addr == pageAddr ) )
+    {
+        return;
+    }
+    StorageFlush( );
+
+    FragDecoder.Cache.Addr = pageAddr;
+    FragDecoder.Cache.IsValid = true;
+    if( isOverwritten == false )
+    {
+        memset1( FragDecoder.Cache.Data, 0, FRAG_DECODER_CACHE_PAGE_SIZE );
+        if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
+        {
+            FragDecoder.Callbacks->FragDecoderRead( pageAddr, FragDecoder.Cache.Data,
+                                                    MIN( FRAG_DECODER_CACHE_PAGE_SIZE, FRAG_DECODER_STORAGE_SIZE - pageAddr ) );
+        }
+    }
+}
+#else
+static void FillStorage( uint32_t addr, uint32_t size )
+{
+    uint8_t buffer[16];
+
+    while( size > 0 )
+    {
+        uint32_t chunkSize = MIN( size, sizeof( buffer ) );
+
+        memset1( buffer, 0, sizeof( buffer ) );
+        StorageRead( addr, buffer, chunkSize );
+        if( IsErased( buffer, chunkSize ) == false )
+        {
+            memset1( buffer, 0xFF, sizeof( buffer ) );
+            StorageWrite( addr, buffer, chunkSize );
+        }
+        addr += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+static void StorageWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
+    {
+        FragDecoder.Callbacks->FragDecoderWrite( addr, data, size );
+    }
+}
+
+static void StorageRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
+    {
+        FragDecoder.Callbacks->FragDecoderRead( addr, data, size );
+    }
+}
+
+static void StorageFlush( void )
+{
+}
+#endif
+#endif
+
 static bool IsPowerOfTwo( uint32_t x )
 {
     uint8_t sumBit = 0;
 
     for( uint8_t i = 0; i < 32; i++ )
     {
-        sumBit += ( x & ( 1 << i ) ) >> i;
+        sumBit += ( x >> i ) & 0x01;
     }
     if( sumBit == 1 )
     {
@@ -551,17 +1104,26 @@ static bool IsPowerOfTwo( uint32_t x )
 
 static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    int32_t i = 0;
+
+    if( ( ( ( uintptr_t )line1 | ( uintptr_t )line2 ) % sizeof( FragWord_t ) ) == 0 )
+    {
+        for( ; i <= ( size - ( int32_t )sizeof( FragWord_t ) ); i += sizeof( FragWord_t ) )
+        {
+            *( FragWord_t* )&line1[i] ^= *( FragWord_t* )&line2[i];
+        }
+    }
+    for( ; i < size; i++ )
     {
         line1[i] = line1[i] ^ line2[i];
     }
 }
 
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
+static void XorParityLine( FragWord_t* line1, FragWord_t* line2, int32_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    for( int32_t i = 0; i < ( ( size + FRAG_WORD_BITS - 1 ) / FRAG_WORD_BITS ); i++ )
     {
-        SetParity( i, line1, ( GetParity( i, line1 ) ^ GetParity( i, line2 ) ) );
+        line1[i] ^= line2[i];
     }
 }
 
@@ -572,57 +1134,87 @@ static int32_t FragPrbs23( int32_t value )
     return ( value >> 1 ) + ( ( b0 ^ b1 ) << 22 );
 }
 
-static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
+static void FragUpdateRowGenerator( int32_t m )
 {
-    int32_t mTemp;
-    int32_t x;
-    int32_t nbCoeff = 0;
-    int32_t r;
+    FragRowGenerator_t *generator = &FragDecoder.RowGenerator;
+    uint8_t log2Modulus = 0;
 
+    generator->M = m;
+    generator->Modulus = m;
     if( IsPowerOfTwo( m ) != false )
     {
-        mTemp = 1;
+        generator->Modulus = m + 1;
     }
-    else 
+    while( ( ( uint32_t )1 << log2Modulus ) < generator->Modulus )
+    {
+        log2Modulus++;
+    }
+    // The PRBS values are below 2^31. With these constants
+    // ( x * Multiplier ) >> Shift equals x / Modulus for all of them.
+    generator->Shift = 31 + log2Modulus;
+    generator->Multiplier = ( ( ( uint64_t )1 << generator->Shift ) + generator->Modulus - 1 ) / generator->Modulus;
+}
+
+static void FragGetParityMatrixRow( int32_t n, int32_t m, FragWord_t *matrixRow )
+{
+    FragRowGenerator_t *generator = &FragDecoder.RowGenerator;
+    uint32_t x;
+    uint32_t r;
+    int32_t nbCoeff = 0;
+
+    if( ( m > 0 ) && ( generator->M != m ) )
     {
-        mTemp = 0;
+        FragUpdateRowGenerator( m );
     }
 
     x = 1 + ( 1001 * n );
-    for( int32_t i = 0; i < ( ( m >> 3 ) + 1 ); i++ )
+    for( int32_t i = 0; i < ( ( m / FRAG_WORD_BITS ) + 1 ); i++ )
     {
         matrixRow[i] = 0;
     }
     while( nbCoeff < ( m >> 1 ) )
     {
-        r = 1 << 16;
-        while( r >= m )
+        do
         {
             x = FragPrbs23( x );
-            r = x % ( m + mTemp );
-        }
-        SetParity( r, matrixRow, 1 );
+            r = x - ( uint32_t )( ( ( uint64_t )x * generator->Multiplier ) >> generator->Shift ) * generator->Modulus;
+        }while( r >= ( uint32_t )m );
+        matrixRow[r / FRAG_WORD_BITS] |= FRAG_WORD_MSB >> ( r % FRAG_WORD_BITS );
         nbCoeff += 1;
     }
 }
 
-static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
+static uint16_t BitArrayFindFirstOne( FragWord_t *bitArray, uint16_t size )
 {
-    for( uint16_t i = 0; i < size; i++)
+    for( uint16_t i = 0; i < size; i += FRAG_WORD_BITS )
     {
-        if ( GetParity( i, bitArray ) == 1 )
+        FragWord_t word = bitArray[i / FRAG_WORD_BITS];
+
+        if( ( size - i ) < FRAG_WORD_BITS )
+        {
+            // Ignore the bits beyond the array size
+            word &= ~( ( FragWord_t )-1 >> ( size - i ) );
+        }
+        if( word != 0 )
         {
-            return i;
+            return i + CountLeadingZeros( word );
         }
     }
     return 0;
 }
 
-static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
+static uint8_t BitArrayIsAllZeros( FragWord_t *bitArray, uint16_t  size )
 {
-    for( uint16_t i = 0; i < size; i++ )
+    for( uint16_t i = 0; i < size; i += FRAG_WORD_BITS )
     {
-        if( GetParity( i, bitArray ) == 1 )
+        FragWord_t word = bitArray[i / FRAG_WORD_BITS];
+
+        if( ( size - i ) < FRAG_WORD_BITS )
+        {
+            // Ignore the bits beyond the array size
+            word &= ~( ( FragWord_t )-1 >> ( size - i ) );
+        }
+        if( word != 0 )
         {
             return 0;
         }
@@ -634,7 +1226,7 @@ static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
  * \brief Finds & marks missing fragments
  *
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] FragDecoder.MissingFrags[] list is updated in place
  */
 static void FragFindMissingFrags( uint16_t counter )
 {
@@ -643,8 +1235,13 @@ static void FragFindMissingFrags( uint16_t counter )
     {
         if( i < FragDecoder.FragNb )
         {
+            // Beyond FRAG_MAX_REDUNDANCY the lost fragments are only counted.
+            // The session then ends with a matrix error on the next coded fragment.
+            if( FragDecoder.Status.FragNbLost < FRAG_MAX_REDUNDANCY )
+            {
+                FragDecoder.MissingFrags[FragDecoder.Status.FragNbLost] = i;
+            }
             FragDecoder.Status.FragNbLost++;
-            FragDecoder.FragNbMissingIndex[i] = FragDecoder.Status.FragNbLost;
         }
     }
     if( i < FragDecoder.FragNb )
@@ -669,12 +1266,9 @@ static void FragFindMissingFrags( uint16_t counter )
  */
 static uint16_t FragFindMissingIndex( uint16_t x )
 {
-    for( uint16_t i = 0; i < FragDecoder.FragNb; i++ )
+    if( x < MIN( FragDecoder.Status.FragNbLost, FRAG_MAX_REDUNDANCY ) )
     {
-        if( FragDecoder.FragNbMissingIndex[i] == ( x + 1 ) )
-        {
-            return i;
-        }
+        return FragDecoder.MissingFrags[x];
     }
     return 0;
 }
@@ -686,36 +1280,13 @@ static uint16_t FragFindMissingIndex( uint16_t x )
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static void FragExtractLineFromBinaryMatrix( FragWord_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
-
-    if( rowIndex > 0 )
+    for( uint16_t i = 0; i < ( ( bitsInRow + FRAG_WORD_BITS - 1 ) / FRAG_WORD_BITS ); i++ )
     {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
-    }
-    if( rowIndex > 0 )
-    {
-        for( uint16_t i = 0; i < rowIndex; i++ )
-        {
-            SetParity( i, bitArray, 0 );
-        }
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
-    {
-        SetParity( i,
-                   bitArray, 
-                   ( FragDecoder.MatrixM2B[findByte] >> ( 7 - findBitInByte ) ) & 0x01 );
-
-        findBitInByte++;
-        if( findBitInByte == 8 )
-        {
-            findBitInByte = 0;
-            findByte++;
-        }
+        bitArray[i] = 0;
     }
+    MatrixReadBits( bitArray, rowIndex, GetMatrixRowOffset( rowIndex, bitsInRow ), bitsInRow - rowIndex );
 }
 
 /*!
@@ -725,27 +1296,7 @@ static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowInde
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static void FragPushLineToBinaryMatrix( FragWord_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
-
-    if ( rowIndex > 0) {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
-
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
-    {
-        if( GetParity( i, bitArray ) == 0 )
-        {
-            FragDecoder.MatrixM2B[findByte] = FragDecoder.MatrixM2B[findByte] & ( 0xFF - ( 1 << ( 7 - findBitInByte ) ) );
-        }
-        findBitInByte++;
-        if( findBitInByte == 8 )
-        {
-            findBitInByte = 0;
-            findByte++;
-        }
-    }
+    MatrixWriteBits( bitArray, rowIndex, GetMatrixRowOffset( rowIndex, bitsInRow ), bitsInRow - rowIndex );
 }
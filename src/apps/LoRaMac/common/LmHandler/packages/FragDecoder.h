@@ -39,22 +39,74 @@ extern "C" {
  * Maximum number of fragment that can be handled.
  *
  * \remark This parameter has an impact on the memory footprint.
+ *         The decoder uses FRAG_MAX_NB / 8 bytes of stack.
  */
+#ifndef FRAG_MAX_NB
 #define FRAG_MAX_NB                                 21
+#endif
 
 /*!
  * Maximum fragment size that can be handled.
  *
  * \remark This parameter has an impact on the memory footprint.
  */
+#ifndef FRAG_MAX_SIZE
 #define FRAG_MAX_SIZE                               50
+#endif
 
 /*!
- * Maximum number of extra frames that can be handled.
+ * Maximum number of extra frames that can be handled. Also limits the
+ * number of lost fragments which can be recovered.
  *
  * \remark This parameter has an impact on the memory footprint.
+ *         The decoder state grows linearly with it, except for the M2B
+ *         matrix which uses \ref FRAG_DECODER_MATRIX_SIZE bytes.
  */
+#ifndef FRAG_MAX_REDUNDANCY
 #define FRAG_MAX_REDUNDANCY                         5
+#endif
+
+/*!
+ * If set to 1 the M2B matrix is stored through the \ref FragDecoderWrite and
+ * \ref FragDecoderRead callbacks instead of RAM. It is located right after
+ * the file, at address FRAG_MAX_NB * FRAG_MAX_SIZE.
+ *
+ * \remark The matrix is initialized to 0xFF and each row is written once,
+ *         only clearing bits. It can be stored in NOR flash without erase.
+ *
+ * \remark Requires FRAG_DECODER_FILE_HANDLING_NEW_API
+ */
+#ifndef FRAG_DECODER_EXTERNAL_MATRIX
+#define FRAG_DECODER_EXTERNAL_MATRIX                0
+#endif
+
+/*!
+ * Size of the upper triangular M2B matrix in bytes
+ */
+#define FRAG_DECODER_MATRIX_SIZE                    ( ( ( ( FRAG_MAX_REDUNDANCY * ( FRAG_MAX_REDUNDANCY + 1 ) ) >> 1 ) + 7 ) >> 3 )
+
+#if( FRAG_DECODER_EXTERNAL_MATRIX == 1 ) && ( FRAG_DECODER_FILE_HANDLING_NEW_API == 0 )
+#error "FRAG_DECODER_EXTERNAL_MATRIX requires FRAG_DECODER_FILE_HANDLING_NEW_API"
+#endif
+
+/*!
+ * Size of the write-back cache placed in front of the \ref FragDecoderWrite
+ * and \ref FragDecoderRead callbacks. 0 disables the cache.
+ *
+ * When set to the flash page size the storage is only written by whole
+ * pages at page aligned addresses. The cache is flushed when
+ * \ref FragDecoderProcess reports the end of the session.
+ *
+ * \remark Requires FRAG_DECODER_FILE_HANDLING_NEW_API. The storage must
+ *         start on a page boundary.
+ */
+#ifndef FRAG_DECODER_CACHE_PAGE_SIZE
+#define FRAG_DECODER_CACHE_PAGE_SIZE                0
+#endif
+
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 ) && ( FRAG_DECODER_FILE_HANDLING_NEW_API == 0 )
+#error "FRAG_DECODER_CACHE_PAGE_SIZE requires FRAG_DECODER_FILE_HANDLING_NEW_API"
+#endif
 
 #define FRAG_SESSION_FINISHED                       ( int32_t )0
 #define FRAG_SESSION_NOT_STARTED                    ( int32_t )-2
@@ -98,6 +150,9 @@ typedef struct sFragDecoderCallbacks
 /*!
  * \brief Initializes the fragmentation decoder
  *
+ * \remark The file storage is filled with 0xFF. The parts already erased
+ *         are not written.
+ *
  * \param [IN] fragNb     Number of expected fragments (without redundancy packets)
  * \param [IN] fragSize   Size of a fragment
  * \param [IN] callbacks  Pointer to the Write/Read functions.
@@ -0,0 +1,472 @@
+/*!
+ * \file      FragPatch.c
+ *
+ * \brief     Applies a delta firmware update received through the
+ *            fragmentation package
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "utilities.h"
+#include "FragPatch.h"
+
+/*!
+ * Patch header magic
+ */
+#define FRAG_PATCH_MAGIC                            0x31504446 // "FDP1"
+
+/*!
+ * Instruction opcodes
+ */
+#define FRAG_PATCH_OP_COPY                          0
+#define FRAG_PATCH_OP_ADD                           1
+#define FRAG_PATCH_OP_RUN                           2
+
+/*!
+ * Instruction length field value announcing a LEB128 length
+ */
+#define FRAG_PATCH_LENGTH_EXTENDED                  0x3F
+
+/*!
+ * Patch header
+ */
+typedef struct FragPatchHeader_s
+{
+    uint32_t Magic;
+    uint32_t SourceSize;
+    uint32_t SourceCrc;
+    uint32_t TargetSize;
+    uint32_t TargetCrc;
+}FragPatchHeader_t;
+
+/*!
+ * Patch application context
+ */
+typedef struct FragPatchCtx_s
+{
+    /*!
+     * Storage access callbacks
+     */
+    FragPatchCallbacks_t *Callbacks;
+    /*!
+     * Patch size
+     */
+    uint32_t PatchSize;
+    /*!
+     * Patch address of the first byte of the patch buffer
+     */
+    uint32_t PatchAddr;
+    /*!
+     * Read index in the patch buffer
+     */
+    uint16_t PatchIndex;
+    /*!
+     * Number of valid bytes in the patch buffer
+     */
+    uint16_t PatchBufferSize;
+    /*!
+     * Target address of the first byte of the target buffer
+     */
+    uint32_t TargetAddr;
+    /*!
+     * Number of bytes in the target buffer
+     */
+    uint16_t TargetBufferSize;
+    /*!
+     * CRC of the flushed target bytes
+     */
+    uint32_t TargetCrc;
+    /*!
+     * Set when a callback fails
+     */
+    bool StorageError;
+    uint8_t PatchBuffer[FRAG_PATCH_BUFFER_SIZE];
+    uint8_t TargetBuffer[FRAG_PATCH_BUFFER_SIZE];
+    uint8_t SourceBuffer[FRAG_PATCH_BUFFER_SIZE];
+}FragPatchCtx_t;
+
+/*!
+ * Patch application context
+ */
+static FragPatchCtx_t FragPatchCtx;
+
+/*!
+ * \brief Reads a little endian 32 bits value
+ *
+ * \param [IN] buffer Pointer to the value
+ * \retval value      Value
+ */
+static uint32_t GetUint32( uint8_t *buffer )
+{
+    return ( ( uint32_t )buffer[0] ) | ( ( uint32_t )buffer[1] << 8 ) |
+           ( ( uint32_t )buffer[2] << 16 ) | ( ( uint32_t )buffer[3] << 24 );
+}
+
+/*!
+ * \brief Reads and decodes the patch header
+ *
+ * \param [IN]  callbacks Storage access callbacks
+ * \param [IN]  patchSize Patch size
+ * \param [OUT] header    Decoded header
+ * \retval isPatch        [true: valid header, false: otherwise]
+ */
+static bool ReadHeader( FragPatchCallbacks_t *callbacks, uint32_t patchSize, FragPatchHeader_t *header )
+{
+    uint8_t buffer[FRAG_PATCH_HEADER_SIZE];
+
+    if( ( callbacks == NULL ) || ( callbacks->PatchRead == NULL ) || ( patchSize < FRAG_PATCH_HEADER_SIZE ) )
+    {
+        return false;
+    }
+    if( callbacks->PatchRead( 0, buffer, FRAG_PATCH_HEADER_SIZE ) != 0 )
+    {
+        return false;
+    }
+    header->Magic = GetUint32( &buffer[0] );
+    header->SourceSize = GetUint32( &buffer[4] );
+    header->SourceCrc = GetUint32( &buffer[8] );
+    header->TargetSize = GetUint32( &buffer[12] );
+    header->TargetCrc = GetUint32( &buffer[16] );
+    return header->Magic == FRAG_PATCH_MAGIC;
+}
+
+/*!
+ * \brief Reads the next byte of the patch
+ *
+ * \param [OUT] value Read byte
+ * \retval status     [true: success, false: end of the patch or read error]
+ */
+static bool ReadPatchByte( uint8_t *value )
+{
+    if( FragPatchCtx.PatchIndex == FragPatchCtx.PatchBufferSize )
+    {
+        uint32_t addr = FragPatchCtx.PatchAddr + FragPatchCtx.PatchBufferSize;
+
+        if( addr >= FragPatchCtx.PatchSize )
+        {
+            return false;
+        }
+        FragPatchCtx.PatchAddr = addr;
+        FragPatchCtx.PatchIndex = 0;
+        FragPatchCtx.PatchBufferSize = MIN( FragPatchCtx.PatchSize - addr, FRAG_PATCH_BUFFER_SIZE );
+        if( FragPatchCtx.Callbacks->PatchRead( addr, FragPatchCtx.PatchBuffer, FragPatchCtx.PatchBufferSize ) != 0 )
+        {
+            FragPatchCtx.StorageError = true;
+            return false;
+        }
+    }
+    *value = FragPatchCtx.PatchBuffer[FragPatchCtx.PatchIndex++];
+    return true;
+}
+
+/*!
+ * \brief Reads an unsigned LEB128 value from the patch
+ *
+ * \param [OUT] value Read value
+ * \retval status     [true: success, false: corrupted patch or read error]
+ */
+static bool ReadVarint( uint32_t *value )
+{
+    uint8_t byte;
+
+    *value = 0;
+    for( uint8_t shift = 0; shift < 35; shift += 7 )
+    {
+        if( ReadPatchByte( &byte ) == false )
+        {
+            return false;
+        }
+        *value |= ( uint32_t )( byte & 0x7F ) << shift;
+        if( ( byte & 0x80 ) == 0 )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Writes the target buffer to the target image
+ *
+ * \retval status [true: success, false: write error]
+ */
+static bool FlushTarget( void )
+{
+    if( FragPatchCtx.TargetBufferSize == 0 )
+    {
+        return true;
+    }
+    if( FragPatchCtx.Callbacks->TargetWrite( FragPatchCtx.TargetAddr, FragPatchCtx.TargetBuffer,
+                                             FragPatchCtx.TargetBufferSize ) != 0 )
+    {
+        FragPatchCtx.StorageError = true;
+        return false;
+    }
+    FragPatchCtx.TargetCrc = Crc32Update( FragPatchCtx.TargetCrc, FragPatchCtx.TargetBuffer, FragPatchCtx.TargetBufferSize );
+    FragPatchCtx.TargetAddr += FragPatchCtx.TargetBufferSize;
+    FragPatchCtx.TargetBufferSize = 0;
+    return true;
+}
+
+/*!
+ * \brief Appends bytes to the target image
+ *
+ * \param [IN] data Data buffer. When NULL the byte value is repeated
+ * \param [IN] value Byte repeated when data is NULL
+ * \param [IN] size Number of bytes
+ * \retval status   [true: success, false: write error]
+ */
+static bool WriteTarget( uint8_t *data, uint8_t value, uint32_t size )
+{
+    while( size > 0 )
+    {
+        uint16_t chunkSize = MIN( size, ( uint32_t )( FRAG_PATCH_BUFFER_SIZE - FragPatchCtx.TargetBufferSize ) );
+
+        if( data != NULL )
+        {
+            memcpy1( &FragPatchCtx.TargetBuffer[FragPatchCtx.TargetBufferSize], data, chunkSize );
+            data += chunkSize;
+        }
+        else
+        {
+            memset1( &FragPatchCtx.TargetBuffer[FragPatchCtx.TargetBufferSize], value, chunkSize );
+        }
+        FragPatchCtx.TargetBufferSize += chunkSize;
+        size -= chunkSize;
+        if( ( FragPatchCtx.TargetBufferSize == FRAG_PATCH_BUFFER_SIZE ) && ( FlushTarget( ) == false ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Computes the CRC of an image area
+ *
+ * \param [IN]  read  Read callback of the image
+ * \param [IN]  size  Size of the area
+ * \param [OUT] crc   Computed CRC
+ * \retval status     [true: success, false: read error]
+ */
+static bool ComputeCrc( int8_t ( *read )( uint32_t addr, uint8_t *data, uint32_t size ), uint32_t size, uint32_t *crc )
+{
+    uint32_t value = Crc32Init( );
+
+    for( uint32_t addr = 0; addr < size; addr += FRAG_PATCH_BUFFER_SIZE )
+    {
+        uint16_t chunkSize = MIN( size - addr, FRAG_PATCH_BUFFER_SIZE );
+
+        if( read( addr, FragPatchCtx.SourceBuffer, chunkSize ) != 0 )
+        {
+            return false;
+        }
+        value = Crc32Update( value, FragPatchCtx.SourceBuffer, chunkSize );
+    }
+    *crc = Crc32Finalize( value );
+    return true;
+}
+
+/*!
+ * \brief Executes the patch instructions
+ *
+ * \param [IN] header Patch header
+ * \retval status     Patch application status
+ */
+static FragPatchStatus_t ApplyInstructions( FragPatchHeader_t *header )
+{
+    uint32_t written = 0;
+    uint32_t cursor = 0;
+
+    while( written < header->TargetSize )
+    {
+        uint8_t op;
+        uint32_t length;
+
+        if( ReadPatchByte( &op ) == false )
+        {
+            break;
+        }
+        length = ( op & FRAG_PATCH_LENGTH_EXTENDED ) + 1;
+        if( ( op & FRAG_PATCH_LENGTH_EXTENDED ) == FRAG_PATCH_LENGTH_EXTENDED )
+        {
+            if( ReadVarint( &length ) == false )
+            {
+                break;
+            }
+            length += FRAG_PATCH_LENGTH_EXTENDED + 1;
+        }
+        if( length > ( header->TargetSize - written ) )
+        {
+            return FRAG_PATCH_STATUS_CORRUPTED;
+        }
+
+        switch( op >> 6 )
+        {
+            case FRAG_PATCH_OP_COPY:
+            {
+                uint32_t zigzag;
+                int64_t start;
+
+                if( ReadVarint( &zigzag ) == false )
+                {
+                    return ( FragPatchCtx.StorageError == true ) ? FRAG_PATCH_STATUS_STORAGE_ERROR : FRAG_PATCH_STATUS_CORRUPTED;
+                }
+                start = ( int64_t )cursor + ( ( int32_t )( zigzag >> 1 ) ^ -( int32_t )( zigzag & 0x01 ) );
+                if( ( start < 0 ) || ( ( start + length ) > header->SourceSize ) )
+                {
+                    return FRAG_PATCH_STATUS_CORRUPTED;
+                }
+                cursor = ( uint32_t )start;
+                for( uint32_t i = 0; i < length; i += FRAG_PATCH_BUFFER_SIZE )
+                {
+                    uint16_t chunkSize = MIN( length - i, FRAG_PATCH_BUFFER_SIZE );
+
+                    if( FragPatchCtx.Callbacks->SourceRead( cursor + i, FragPatchCtx.SourceBuffer, chunkSize ) != 0 )
+                    {
+                        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+                    }
+                    if( WriteTarget( FragPatchCtx.SourceBuffer, 0, chunkSize ) == false )
+                    {
+                        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+                    }
+                }
+                cursor += length;
+                break;
+            }
+            case FRAG_PATCH_OP_ADD:
+            {
+                for( uint32_t i = 0; i < length; i++ )
+                {
+                    uint8_t value;
+
+                    if( ReadPatchByte( &value ) == false )
+                    {
+                        return ( FragPatchCtx.StorageError == true ) ? FRAG_PATCH_STATUS_STORAGE_ERROR : FRAG_PATCH_STATUS_CORRUPTED;
+                    }
+                    if( WriteTarget( &value, 0, 1 ) == false )
+                    {
+                        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+                    }
+                }
+                break;
+            }
+            case FRAG_PATCH_OP_RUN:
+            {
+                uint8_t value;
+
+                if( ReadPatchByte( &value ) == false )
+                {
+                    return ( FragPatchCtx.StorageError == true ) ? FRAG_PATCH_STATUS_STORAGE_ERROR : FRAG_PATCH_STATUS_CORRUPTED;
+                }
+                if( WriteTarget( NULL, value, length ) == false )
+                {
+                    return FRAG_PATCH_STATUS_STORAGE_ERROR;
+                }
+                break;
+            }
+            default:
+            {
+                return FRAG_PATCH_STATUS_CORRUPTED;
+            }
+        }
+        written += length;
+    }
+
+    if( FragPatchCtx.StorageError == true )
+    {
+        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+    }
+    if( written < header->TargetSize )
+    {
+        // The patch ended before the target image was complete
+        return FRAG_PATCH_STATUS_CORRUPTED;
+    }
+    if( FlushTarget( ) == false )
+    {
+        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+    }
+    return FRAG_PATCH_STATUS_OK;
+}
+
+bool FragPatchIsPatch( FragPatchCallbacks_t *callbacks, uint32_t fileSize )
+{
+    FragPatchHeader_t header;
+
+    return ReadHeader( callbacks, fileSize, &header );
+}
+
+FragPatchStatus_t FragPatchApply( FragPatchCallbacks_t *callbacks, uint32_t patchSize,
+                                  uint32_t sourceSize, uint32_t targetMaxSize, uint32_t *targetSize )
+{
+    FragPatchHeader_t header;
+    FragPatchStatus_t status;
+    uint32_t crc;
+
+    *targetSize = 0;
+    if( ( ReadHeader( callbacks, patchSize, &header ) == false ) ||
+        ( callbacks->SourceRead == NULL ) || ( callbacks->TargetWrite == NULL ) )
+    {
+        return FRAG_PATCH_STATUS_NOT_A_PATCH;
+    }
+    if( header.TargetSize > targetMaxSize )
+    {
+        return FRAG_PATCH_STATUS_TARGET_TOO_LARGE;
+    }
+
+    // Only patch the image the patch has been generated for
+    if( header.SourceSize > sourceSize )
+    {
+        return FRAG_PATCH_STATUS_WRONG_SOURCE;
+    }
+    if( ComputeCrc( callbacks->SourceRead, header.SourceSize, &crc ) == false )
+    {
+        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+    }
+    if( crc != header.SourceCrc )
+    {
+        return FRAG_PATCH_STATUS_WRONG_SOURCE;
+    }
+
+    FragPatchCtx.Callbacks = callbacks;
+    FragPatchCtx.PatchSize = patchSize;
+    FragPatchCtx.PatchAddr = 0;
+    FragPatchCtx.PatchIndex = FRAG_PATCH_HEADER_SIZE;
+    FragPatchCtx.PatchBufferSize = FRAG_PATCH_HEADER_SIZE;
+    FragPatchCtx.TargetAddr = 0;
+    FragPatchCtx.TargetBufferSize = 0;
+    FragPatchCtx.TargetCrc = Crc32Init( );
+    FragPatchCtx.StorageError = false;
+
+    status = ApplyInstructions( &header );
+    if( status != FRAG_PATCH_STATUS_OK )
+    {
+        return status;
+    }
+
+    crc = Crc32Finalize( FragPatchCtx.TargetCrc );
+    if( ( callbacks->TargetRead != NULL ) &&
+        ( ComputeCrc( callbacks->TargetRead, header.TargetSize, &crc ) == false ) )
+    {
+        return FRAG_PATCH_STATUS_STORAGE_ERROR;
+    }
+    if( crc != header.TargetCrc )
+    {
+        return FRAG_PATCH_STATUS_TARGET_CRC_ERROR;
+    }
+    *targetSize = header.TargetSize;
+    return FRAG_PATCH_STATUS_OK;
+}
@@ -0,0 +1,181 @@
+/*!
+ * \file      FragPatch.h
+ *
+ * \brief     Applies a delta firmware update received through the
+ *            fragmentation package
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \defgroup  FRAGPATCH Delta firmware update
+ *            Rebuilds a new image from the running image and a patch.
+ *            The patch is the file reassembled by the fragmentation
+ *            decoder. The new image is written sequentially, typically
+ *            to the second flash slot, using a few bytes of RAM.
+ *
+ *            Patch format (multi-byte fields are little endian):
+ *            | Magic "FDP1" (4) | Source size (4) | Source CRC32 (4) |
+ *            | Target size (4) | Target CRC32 (4) | Instructions ... |
+ *
+ *            Each instruction starts with a byte holding the opcode in
+ *            bits 7-6 and the length in bits 5-0. Lengths 1 to 63 are
+ *            stored as length - 1. Value 63 means the length is 64 plus
+ *            the unsigned LEB128 value which follows.
+ *            - COPY (0): followed by the zigzag LEB128 offset of the
+ *              source cursor. Copies length bytes of the source from the
+ *              moved cursor, then advances the cursor by length.
+ *            - ADD  (1): followed by length literal bytes
+ *            - RUN  (2): followed by one byte, repeated length times
+ *
+ *            The fragmentation package applies the received patches when
+ *            built with LMHP_FRAGMENTATION_PATCH_ENABLED, see
+ *            LmhpFragmentation.h.
+ *
+ *            Tools: tools/fragpatch generates patches on a host and
+ *            applies them on Linux with this module.
+ * \{
+ */
+#ifndef __FRAG_PATCH_H__
+#define __FRAG_PATCH_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Patch header size
+ */
+#define FRAG_PATCH_HEADER_SIZE                      20
+
+/*!
+ * Size of the buffers used to read the patch and the source image and to
+ * write the target image.
+ *
+ * \remark The module uses about 3 times this size of RAM.
+ */
+#ifndef FRAG_PATCH_BUFFER_SIZE
+#define FRAG_PATCH_BUFFER_SIZE                      64
+#endif
+
+/*!
+ * Patch application status
+ */
+typedef enum eFragPatchStatus
+{
+    /*!
+     * The target image has been written and its CRC verified
+     */
+    FRAG_PATCH_STATUS_OK = 0,
+    /*!
+     * The file is not a patch
+     */
+    FRAG_PATCH_STATUS_NOT_A_PATCH,
+    /*!
+     * The running image is not the one the patch has been generated for
+     */
+    FRAG_PATCH_STATUS_WRONG_SOURCE,
+    /*!
+     * The target image does not fit into the target slot
+     */
+    FRAG_PATCH_STATUS_TARGET_TOO_LARGE,
+    /*!
+     * Invalid instruction or instruction out of the image bounds
+     */
+    FRAG_PATCH_STATUS_CORRUPTED,
+    /*!
+     * A read or write callback failed
+     */
+    FRAG_PATCH_STATUS_STORAGE_ERROR,
+    /*!
+     * The CRC of the written target image is wrong
+     */
+    FRAG_PATCH_STATUS_TARGET_CRC_ERROR,
+}FragPatchStatus_t;
+
+/*!
+ * Storage access callbacks. All of them return 0 on success and -1 on failure.
+ */
+typedef struct sFragPatchCallbacks
+{
+    /*!
+     * Reads the patch. Usually the FragDecoderRead callback.
+     *
+     * \param [IN]  addr Address in the patch
+     * \param [OUT] data Data buffer
+     * \param [IN]  size Number of bytes to be read
+     */
+    int8_t ( *PatchRead )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Reads the running image
+     *
+     * \param [IN]  addr Address in the running image
+     * \param [OUT] data Data buffer
+     * \param [IN]  size Number of bytes to be read
+     */
+    int8_t ( *SourceRead )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Writes the new image. Addresses are increasing.
+     *
+     * \param [IN] addr Address in the new image
+     * \param [IN] data Data buffer
+     * \param [IN] size Number of bytes to be written
+     */
+    int8_t ( *TargetWrite )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Reads back the new image to verify its CRC. May be NULL, the CRC is
+     * then computed on the written data.
+     *
+     * \param [IN]  addr Address in the new image
+     * \param [OUT] data Data buffer
+     * \param [IN]  size Number of bytes to be read
+     */
+    int8_t ( *TargetRead )( uint32_t addr, uint8_t *data, uint32_t size );
+}FragPatchCallbacks_t;
+
+/*!
+ * \brief Checks if a file received by the fragmentation package is a patch
+ *
+ * \param [IN] callbacks Storage access callbacks
+ * \param [IN] fileSize  Size of the received file
+ *
+ * \retval isPatch [true: the file starts with a patch header, false: otherwise]
+ */
+bool FragPatchIsPatch( FragPatchCallbacks_t *callbacks, uint32_t fileSize );
+
+/*!
+ * \brief Builds the new image from the running image and the patch
+ *
+ * \remark The running image CRC is verified before anything is written.
+ *
+ * \param [IN]  callbacks     Storage access callbacks
+ * \param [IN]  patchSize     Size of the patch
+ * \param [IN]  sourceSize    Size of the running image slot
+ * \param [IN]  targetMaxSize Size of the target image slot
+ * \param [OUT] targetSize    Size of the written image
+ *
+ * \retval status Patch application status
+ */
+FragPatchStatus_t FragPatchApply( FragPatchCallbacks_t *callbacks, uint32_t patchSize,
+                                  uint32_t sourceSize, uint32_t targetMaxSize, uint32_t *targetSize );
+
+/* \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FRAG_PATCH_H__
@@ -61,12 +61,20 @@ typedef struct LmhPackage_s
     /*!
      * Returns if a package transmission is pending or not.
      *
+     * \remark LmHandler only reads the status after calling the package
+     *         callbacks below or Process. A package changing it elsewhere
+     *         must call OnPackageProcessRequest.
+     *
      * \retval status Package transmission status
      *                [true: pending, false: Not pending]
      */
     bool ( *IsTxPending )( void );
     /*!
      * Processes the internal package events.
+     *
+     * \remark Only called after the package has been notified of a MAC
+     *         event, while its transmission is pending or after a call to
+     *         OnPackageProcessRequest.
      */
     void ( *Process )( void );
     /*!
@@ -78,9 +86,19 @@ typedef struct LmhPackage_s
     /*!
      * Processes the MCPS Indication
      *
+     * \remark Called for every downlink. The payload received on the package
+     *         port is handed over to OnPortDataProcess.
+     *
      * \param [IN] mcpsIndication     MCPS indication primitive data
      */
     void ( *OnMcpsIndicationProcess )( McpsIndication_t *mcpsIndication );
+    /*!
+     * Processes the payload received on the package port. LmHandler
+     * registers the package as the only consumer of its port.
+     *
+     * \param [IN] mcpsIndication     MCPS indication primitive data
+     */
+    void ( *OnPortDataProcess )( McpsIndication_t *mcpsIndication );
     /*!
      * Processes the MLME Confirm
      *
@@ -131,6 +149,13 @@ typedef struct LmhPackage_s
     * \retval status Returns \ref LORAMAC_HANDLER_SET if joined else \ref LORAMAC_HANDLER_RESET
     */
     LmHandlerErrorStatus_t ( *OnDeviceTimeRequest )( void );
+    /*!
+     * Requests the package Process function to be called. Must be used by
+     * the package timers. May be called from an interrupt context.
+     *
+     * \param [IN] id Package identifier
+     */
+    void ( *OnPackageProcessRequest )( uint8_t id );
 #if( LMH_SYS_TIME_UPDATE_NEW_API == 1 )
     /*!
      * Notifies the upper layer that the system time has been updated.
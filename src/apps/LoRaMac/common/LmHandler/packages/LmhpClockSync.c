@@ -30,6 +30,125 @@
 #define CLOCK_SYNC_ID                               1
 #define CLOCK_SYNC_VERSION                          1
 
+/*!
+ * Standard deviation of an offset measured with AppTimeAns, in ms.
+ * The network time of the uplink is only known to the second.
+ */
+#define CLOCK_SYNC_APP_TIME_ANS_ERROR               289
+
+/*!
+ * Standard deviation of an offset measured when the system time is set by the
+ * MAC layer (DeviceTimeAns, beacon), in ms
+ */
+#define CLOCK_SYNC_DEVICE_TIME_ANS_ERROR            4
+
+/*!
+ * A sample further than this number of standard deviations from the
+ * prediction is an outlier
+ */
+#define CLOCK_SYNC_OUTLIER_FACTOR                   4
+
+/*!
+ * Number of samples required before outliers are rejected
+ */
+#define CLOCK_SYNC_OUTLIER_MIN_SAMPLES              3
+
+/*!
+ * Number of consecutive outliers after which the history is restarted
+ */
+#define CLOCK_SYNC_OUTLIER_MAX_REJECTED             2
+
+/*!
+ * Scale of the sample weights. A sample weight is this value divided by the
+ * sample variance in us^2.
+ */
+#define CLOCK_SYNC_WEIGHT_SCALE                     ( ( uint64_t )1 << 44 )
+
+/*!
+ * Time unit of the fit second moments, in ms. Keeps them within 64 bits.
+ */
+#define CLOCK_SYNC_FIT_TIME_UNIT                    64
+
+/*!
+ * Weight of the frequency prior, see \ref CLOCK_SYNC_DRIFT_PRIOR
+ */
+#define CLOCK_SYNC_PRIOR_WEIGHT                     ( ( ( CLOCK_SYNC_WEIGHT_SCALE / ( CLOCK_SYNC_FIT_TIME_UNIT * CLOCK_SYNC_FIT_TIME_UNIT ) ) * 1000000 ) / \
+                                                      ( ( uint64_t )CLOCK_SYNC_DRIFT_PRIOR * CLOCK_SYNC_DRIFT_PRIOR ) )
+
+/*
+ * The wander bounds the weight of the old samples, which keeps the fit
+ * within 64 bits, and the sample errors bound the weights.
+ */
+#if ( CLOCK_SYNC_DRIFT_WANDER < 1 ) || ( CLOCK_SYNC_DRIFT_PRIOR < 1 ) || \
+    ( CLOCK_SYNC_APP_TIME_ANS_ERROR < 1 ) || ( CLOCK_SYNC_DEVICE_TIME_ANS_ERROR < 1 )
+#error "The clock fit requires a drift wander, a drift prior and sample errors of at least 1"
+#endif
+
+/*!
+ * Time synchronization sample
+ */
+typedef struct LmhpClockSyncSample_s
+{
+    /*!
+     * MCU time of the measurement in ms
+     */
+    int64_t McuTime;
+    /*!
+     * Network time minus MCU time in ms
+     */
+    int64_t Offset;
+    /*!
+     * Standard deviation of the offset in ms
+     */
+    uint16_t Error;
+}LmhpClockSyncSample_t;
+
+/*!
+ * Clock discipline. Fits the network time against the MCU time from the
+ * samples and steers the system time towards the fit.
+ */
+typedef struct LmhpClockSyncDiscipline_s
+{
+    /*!
+     * Samples history, ordered by MCU time in a ring
+     */
+    LmhpClockSyncSample_t Samples[CLOCK_SYNC_HISTORY_SIZE];
+    uint8_t NbSamples;
+    uint8_t NextSample;
+    /*!
+     * Number of consecutive outliers
+     */
+    uint8_t NbRejected;
+    /*!
+     * Weighted mean MCU time of the samples in ms
+     */
+    int64_t RefMcuTime;
+    /*!
+     * Fitted offset at RefMcuTime in ms
+     */
+    int64_t RefOffset;
+    /*!
+     * Frequency of the network time versus the MCU time, in ppb
+     */
+    int32_t Frequency;
+    /*!
+     * Variance of RefOffset in us^2
+     */
+    uint64_t OffsetVariance;
+    /*!
+     * Standard deviation of Frequency in ppb
+     */
+    uint32_t FrequencyDeviation;
+    /*!
+     * MCU time of the last system time adjustment in ms
+     */
+    int64_t LastAdjustmentTime;
+    /*!
+     * MCU time of the last AppTimeReq in ms
+     */
+    int64_t LastRequestTime;
+}LmhpClockSyncDiscipline_t;
+
 /*!
  * Package current context
  */
@@ -54,6 +173,18 @@ typedef struct LmhpClockSyncState_s
     uint8_t NbTransPrev;
     uint8_t DataratePrev;
     uint8_t NbTransmissions;
+    /*!
+     * System time seconds sent in the last AppTimeReq
+     */
+    uint32_t AppTimeReqDeviceTime;
+    /*!
+     * MCU time when the last AppTimeReq has been built, in ms
+     */
+    int64_t AppTimeReqMcuTime;
+    /*!
+     * Time on air of the last AppTimeReq uplink
+     */
+    TimerTime_t AppTimeReqTimeOnAir;
 }LmhpClockSyncState_t;
 
 typedef enum LmhpClockSyncMoteCmd_e
@@ -116,6 +247,25 @@ static void LmhpClockSyncOnMcpsConfirm( McpsConfirm_t *mcpsConfirm );
  */
 static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
+/*!
+ * Processes the commands received on the package port
+ *
+ * \param [IN] mcpsIndication     MCPS indication primitive data
+ */
+static void LmhpClockSyncOnPortData( McpsIndication_t *mcpsIndication );
+
+/*!
+ * Processes the MLME Indication
+ *
+ * \param [IN] mlmeIndication     MLME indication primitive data
+ */
+static void LmhpClockSyncOnMlmeIndication( MlmeIndication_t *mlmeIndication );
+
+/*!
+ * Steers the system time and requests a new synchronization when needed
+ */
+static void ProcessDiscipline( void );
+
 static LmhpClockSyncState_t LmhpClockSyncState =
 {
     .Initialized = false,
@@ -127,6 +277,18 @@ static LmhpClockSyncState_t LmhpClockSyncState =
     .NbTransmissions = 0,
 };
 
+static LmhpClockSyncDiscipline_t LmhpClockSyncDiscipline;
+
+/*!
+ * Timer used to process the package while nothing else happens
+ */
+static TimerEvent_t LmhpClockSyncProcessTimer;
+
+/*!
+ * \brief Callback function for the package process timer
+ */
+static void OnClockSyncProcessTimer( void *context );
+
 static LmhPackage_t LmhpClockSyncPackage =
 {
     .Port = CLOCK_SYNC_PORT,
@@ -136,12 +298,14 @@ static LmhPackage_t LmhpClockSyncPackage =
     .Process = LmhpClockSyncProcess,
     .OnMcpsConfirmProcess = LmhpClockSyncOnMcpsConfirm,
     .OnMcpsIndicationProcess = LmhpClockSyncOnMcpsIndication,
+    .OnPortDataProcess = LmhpClockSyncOnPortData,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
-    .OnMlmeIndicationProcess = NULL,                           // Not used in this package
+    .OnMlmeIndicationProcess = LmhpClockSyncOnMlmeIndication,
     .OnMacMcpsRequest = NULL,                                  // To be initialized by LmHandler
     .OnMacMlmeRequest = NULL,                                  // To be initialized by LmHandler
     .OnJoinRequest = NULL,                                     // To be initialized by LmHandler
     .OnDeviceTimeRequest = NULL,                               // To be initialized by LmHandler
+    .OnPackageProcessRequest = NULL,                           // To be initialized by LmHandler
     .OnSysTimeUpdate = NULL,                                   // To be initialized by LmHandler
 };
 
@@ -150,6 +314,303 @@ LmhPackage_t *LmphClockSyncPackageFactory( void )
     return &LmhpClockSyncPackage;
 }
 
+static void OnClockSyncProcessTimer( void *context )
+{
+    LmhpClockSyncPackage.OnPackageProcessRequest( PACKAGE_ID_CLOCK_SYNC );
+}
+
+/*!
+ * \brief Converts a system time to ms
+ *
+ * \param [IN] sysTime System time
+ * \retval time        Time in ms
+ */
+static int64_t SysTimeToMs64( SysTime_t sysTime )
+{
+    return ( ( int64_t )sysTime.Seconds * 1000 ) + sysTime.SubSeconds;
+}
+
+/*!
+ * \brief Gets the MCU time, which is not affected by the system time updates
+ *
+ * \retval time MCU time in ms
+ */
+static int64_t GetMcuTime( void )
+{
+    return SysTimeToMs64( SysTimeGetMcuTime( ) );
+}
+
+/*!
+ * \brief Gets the offset between the system time and the MCU time
+ *
+ * \retval offset Offset in ms
+ */
+static int64_t GetSysTimeOffset( void )
+{
+    SysTime_t sysTime = SysTimeGet( );
+
+    return SysTimeToMs64( sysTime ) - GetMcuTime( );
+}
+
+/*!
+ * \brief Sets the offset between the system time and the MCU time
+ *
+ * \param [IN] offset Offset in ms
+ */
+static void SetSysTimeOffset( int64_t offset )
+{
+    int64_t time = GetMcuTime( ) + offset;
+    SysTime_t sysTime = { .Seconds = ( uint32_t )( time / 1000 ), .SubSeconds = ( int16_t )( time % 1000 ) };
+
+    SysTimeSet( sysTime );
+}
+
+/*!
+ * \brief Gets the newest sample
+ *
+ * \retval sample Newest sample
+ */
+static LmhpClockSyncSample_t *GetLastSample( void )
+{
+    return &LmhpClockSyncDiscipline.Samples[( LmhpClockSyncDiscipline.NextSample + CLOCK_SYNC_HISTORY_SIZE - 1 ) % CLOCK_SYNC_HISTORY_SIZE];
+}
+
+/*!
+ * \brief Divides and rounds to the nearest integer
+ *
+ * \param [IN] dividend Dividend
+ * \param [IN] divisor  Divisor, strictly positive
+ * \retval quotient     Rounded quotient
+ */
+static int64_t DivRound( int64_t dividend, int64_t divisor )
+{
+    if( dividend < 0 )
+    {
+        return -( ( -dividend + ( divisor / 2 ) ) / divisor );
+    }
+    return ( dividend + ( divisor / 2 ) ) / divisor;
+}
+
+/*!
+ * \brief Computes the integer square root
+ *
+ * \param [IN] value Value
+ * \retval root      Square root, rounded down
+ */
+static uint32_t SquareRoot( uint64_t value )
+{
+    uint64_t root = 0;
+    uint64_t bit = ( uint64_t )1 << 62;
+
+    while( bit > value )
+    {
+        bit >>= 2;
+    }
+    while( bit != 0 )
+    {
+        if( value >= ( root + bit ) )
+        {
+            value -= root + bit;
+            root = ( root >> 1 ) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return ( uint32_t )root;
+}
+
+/*!
+ * \brief Predicts the network time minus MCU time offset
+ *
+ * \param [IN] mcuTime MCU time in ms
+ * \retval offset      Predicted offset in ms
+ */
+static int64_t PredictOffset( int64_t mcuTime )
+{
+    int64_t elapsed = mcuTime - LmhpClockSyncDiscipline.RefMcuTime;
+
+    return LmhpClockSyncDiscipline.RefOffset + DivRound( LmhpClockSyncDiscipline.Frequency * elapsed, 1000000000 );
+}
+
+/*!
+ * \brief Computes the variance of the predicted offset
+ *
+ * \param [IN] mcuTime MCU time in ms
+ * \retval variance    Variance in us^2
+ */
+static uint64_t GetPredictedVariance( int64_t mcuTime )
+{
+    int64_t elapsed = mcuTime - LmhpClockSyncDiscipline.RefMcuTime;
+    int64_t age = mcuTime - GetLastSample( )->McuTime;
+    // Frequency error and frequency wander after the last measurement, in us
+    uint64_t frequencyError = ( ( uint64_t )( ( elapsed < 0 ) ? -elapsed : elapsed ) * LmhpClockSyncDiscipline.FrequencyDeviation ) / 1000000;
+    uint64_t wander = ( ( uint64_t )( ( age < 0 ) ? -age : age ) * CLOCK_SYNC_DRIFT_WANDER ) / 1000;
+
+    return LmhpClockSyncDiscipline.OffsetVariance + ( frequencyError * frequencyError ) + ( wander * wander );
+}
+
+/*!
+ * \brief Fits the offset and the frequency to the samples
+ *
+ *        Weighted least squares. The weight of a sample is the inverse of its
+ *        variance, increased by the frequency wander since the measurement.
+ *        The frequency is constrained by \ref CLOCK_SYNC_DRIFT_PRIOR.
+ *        Fixed point: the MCU may not have an FPU.
+ */
+static void FitSamples( void )
+{
+    LmhpClockSyncSample_t *last = GetLastSample( );
+    uint64_t weights[CLOCK_SYNC_HISTORY_SIZE];
+    uint64_t sumW = 0;
+    int64_t meanX = 0;
+    int64_t meanY = 0;
+    int64_t sumXX = 0;
+    int64_t sumXY = 0;
+    uint64_t denominator;
+
+    // Coordinates are relative to the newest sample, in ms
+    for( uint8_t i = 0; i < LmhpClockSyncDiscipline.NbSamples; i++ )
+    {
+        LmhpClockSyncSample_t *sample = &LmhpClockSyncDiscipline.Samples[i];
+        int64_t x = sample->McuTime - last->McuTime;
+        uint64_t wander = ( ( uint64_t )( -x ) * CLOCK_SYNC_DRIFT_WANDER ) / 1000;
+
+        weights[i] = CLOCK_SYNC_WEIGHT_SCALE / ( ( ( uint64_t )sample->Error * sample->Error * 1000000 ) + ( wander * wander ) );
+        sumW += weights[i];
+        meanX += ( int64_t )weights[i] * x;
+        meanY += ( int64_t )weights[i] * ( sample->Offset - last->Offset );
+    }
+    meanX = DivRound( meanX, sumW );
+    meanY = DivRound( meanY, sumW );
+    for( uint8_t i = 0; i < LmhpClockSyncDiscipline.NbSamples; i++ )
+    {
+        LmhpClockSyncSample_t *sample = &LmhpClockSyncDiscipline.Samples[i];
+        int64_t x = DivRound( sample->McuTime - last->McuTime - meanX, CLOCK_SYNC_FIT_TIME_UNIT );
+        int64_t y = sample->Offset - last->Offset - meanY;
+
+        sumXX += ( int64_t )weights[i] * x * x;
+        sumXY += ( int64_t )weights[i] * x * y;
+    }
+    denominator = sumXX + CLOCK_SYNC_PRIOR_WEIGHT;
+
+    LmhpClockSyncDiscipline.RefMcuTime = last->McuTime + meanX;
+    LmhpClockSyncDiscipline.RefOffset = last->Offset + meanY;
+    // ms per time unit to ppb
+    LmhpClockSyncDiscipline.Frequency = ( int32_t )( sumXY / ( int64_t )( denominator / ( 1000000000 / CLOCK_SYNC_FIT_TIME_UNIT ) ) );
+    LmhpClockSyncDiscipline.OffsetVariance = CLOCK_SYNC_WEIGHT_SCALE / sumW;
+    // Inverse of the denominator in ppb^2, scaled down to stay within 64 bits
+    LmhpClockSyncDiscipline.FrequencyDeviation = SquareRoot( ( ( ( uint64_t )( 1000000000 / CLOCK_SYNC_FIT_TIME_UNIT ) *
+                                                               ( 1000000000 / CLOCK_SYNC_FIT_TIME_UNIT ) / 1000000 ) << 20 ) /
+                                                             ( denominator >> 24 ) );
+}
+
+/*!
+ * \brief Adds a sample to the history
+ *
+ * \param [IN] mcuTime MCU time of the measurement in ms
+ * \param [IN] offset  Measured network time minus MCU time in ms
+ * \param [IN] error   Standard deviation of the measurement in ms
+ *
+ * \retval status [true: sample added, false: outlier]
+ */
+static bool AddSample( int64_t mcuTime, int64_t offset, uint16_t error )
+{
+    LmhpClockSyncSample_t *sample;
+
+    if( LmhpClockSyncDiscipline.NbSamples >= CLOCK_SYNC_OUTLIER_MIN_SAMPLES )
+    {
+        int64_t residual = offset - PredictOffset( mcuTime );
+        uint32_t deviation = SquareRoot( GetPredictedVariance( mcuTime ) + ( ( uint64_t )error * error * 1000000 ) );
+
+        if( residual < 0 )
+        {
+            residual = -residual;
+        }
+        // The deviation is in us
+        if( ( residual * 1000 ) > ( ( int64_t )CLOCK_SYNC_OUTLIER_FACTOR * deviation ) )
+        {
+            if( LmhpClockSyncDiscipline.NbRejected < CLOCK_SYNC_OUTLIER_MAX_REJECTED )
+            {
+                LmhpClockSyncDiscipline.NbRejected++;
+                return false;
+            }
+            // The measurements agree with each other but not with the
+            // history. The network time or the MCU time has jumped.
+            LmhpClockSyncDiscipline.NbSamples = 0;
+            LmhpClockSyncDiscipline.NextSample = 0;
+        }
+    }
+    LmhpClockSyncDiscipline.NbRejected = 0;
+
+    sample = &LmhpClockSyncDiscipline.Samples[LmhpClockSyncDiscipline.NextSample];
+    sample->McuTime = mcuTime;
+    sample->Offset = offset;
+    sample->Error = error;
+    LmhpClockSyncDiscipline.NextSample = ( LmhpClockSyncDiscipline.NextSample + 1 ) % CLOCK_SYNC_HISTORY_SIZE;
+    if( LmhpClockSyncDiscipline.NbSamples < CLOCK_SYNC_HISTORY_SIZE )
+    {
+        LmhpClockSyncDiscipline.NbSamples++;
+    }
+    FitSamples( );
+    return true;
+}
+
+/*!
+ * \brief Takes the system time just set by the MAC layer, on DeviceTimeAns
+ *        or on beacon reception, as a sample
+ */
+static void AddSysTimeSample( void )
+{
+    AddSample( GetMcuTime( ), GetSysTimeOffset( ), CLOCK_SYNC_DEVICE_TIME_ANS_ERROR );
+}
+
+/*!
+ * \brief Steers the system time towards the fitted network time.
+ *
+ *        Small corrections are slewed at \ref CLOCK_SYNC_SLEW_RATE so that
+ *        the system time never jumps, bigger ones are stepped.
+ */
+static void DisciplineSysTime( void )
+{
+    int64_t now = GetMcuTime( );
+    int64_t offset = GetSysTimeOffset( );
+    int64_t correction = PredictOffset( now ) - offset;
+    int64_t maxSlew = ( ( now - LmhpClockSyncDiscipline.LastAdjustmentTime ) * CLOCK_SYNC_SLEW_RATE ) / 1000000;
+
+    if( ( correction < CLOCK_SYNC_STEP_THRESHOLD ) && ( correction > -CLOCK_SYNC_STEP_THRESHOLD ) )
+    {
+        if( correction > maxSlew )
+        {
+            correction = maxSlew;
+        }
+        else if( correction < -maxSlew )
+        {
+            correction = -maxSlew;
+        }
+        else
+        {
+            LmhpClockSyncDiscipline.LastAdjustmentTime = now;
+        }
+    }
+    if( correction != 0 )
+    {
+        SetSysTimeOffset( offset + correction );
+        LmhpClockSyncDiscipline.LastAdjustmentTime = now;
+    }
+}
+
+uint32_t LmhpClockSyncGetPredictedError( void )
+{
+    if( LmhpClockSyncDiscipline.NbSamples == 0 )
+    {
+        return UINT32_MAX;
+    }
+    return ( 2 * SquareRoot( GetPredictedVariance( GetMcuTime( ) ) ) ) / 1000;
+}
+
 static void LmhpClockSyncInit( void * params, uint8_t *dataBuffer, uint8_t dataBufferMaxSize )
 {
     if( dataBuffer != NULL )
@@ -157,12 +618,15 @@ static void LmhpClockSyncInit( void * params, uint8_t *dataBuffer, uint8_t dataB
         LmhpClockSyncState.DataBuffer = dataBuffer;
         LmhpClockSyncState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpClockSyncState.Initialized = true;
+        TimerInit( &LmhpClockSyncProcessTimer, OnClockSyncProcessTimer );
     }
     else
     {
         LmhpClockSyncState.Initialized = false;
     }
     LmhpClockSyncState.IsTxPending = false;
+
+    memset1( ( uint8_t* )&LmhpClockSyncDiscipline, 0, sizeof( LmhpClockSyncDiscipline ) );
 }
 
 static bool LmhpClockSyncIsInitialized( void )
@@ -177,12 +641,64 @@ static bool LmhpClockSyncIsTxPending( void )
 
 static void LmhpClockSyncProcess( void )
 {
+    // The package is also processed on the MAC layer events. The timer
+    // only covers the periods without any.
+    TimerTime_t nextProcessDelay = 0;
+
     if( LmhpClockSyncState.NbTransmissions > 0 )
     {
         if( LmhpClockSyncAppTimeReq( ) == LORAMAC_HANDLER_SUCCESS )
         {
             LmhpClockSyncState.NbTransmissions--;
         }
+        else
+        {
+            // Retry once the duty cycle allows it. 0 when the MAC layer is busy.
+            nextProcessDelay = LmHandlerGetDutyCycleWaitTime( );
+        }
+    }
+
+    if( LmhpClockSyncDiscipline.NbSamples != 0 )
+    {
+        // The MAC layer relies on the system time of the ongoing uplink
+        if( LmHandlerIsBusy( ) == false )
+        {
+            ProcessDiscipline( );
+        }
+        if( ( nextProcessDelay == 0 ) || ( nextProcessDelay > CLOCK_SYNC_DISCIPLINE_PERIOD ) )
+        {
+            nextProcessDelay = CLOCK_SYNC_DISCIPLINE_PERIOD;
+        }
+    }
+
+    if( nextProcessDelay != 0 )
+    {
+        TimerSetValue( &LmhpClockSyncProcessTimer, nextProcessDelay );
+        TimerStart( &LmhpClockSyncProcessTimer );
+    }
+}
+
+/*!
+ * \brief Steers the system time and requests a new synchronization when
+ *        the predicted error becomes too big
+ *
+ * \remark The MAC layer relies on the system time of the ongoing uplink.
+ *         Must not be called while the MAC layer is busy.
+ */
+static void ProcessDiscipline( void )
+{
+    DisciplineSysTime( );
+
+    // Only synchronize again when the predicted error is too big. When the
+    // measurements are not precise enough to reach the threshold, wait for
+    // the error to have at least doubled since the last measurement.
+    if( ( LmhpClockSyncState.AppTimeReqPending == false ) &&
+        ( LmHandlerJoinStatus( ) == LORAMAC_HANDLER_SET ) &&
+        ( ( GetMcuTime( ) - LmhpClockSyncDiscipline.LastRequestTime ) >= CLOCK_SYNC_MIN_REQUEST_INTERVAL ) &&
+        ( LmhpClockSyncGetPredictedError( ) > CLOCK_SYNC_MAX_PREDICTED_ERROR ) &&
+        ( GetPredictedVariance( GetMcuTime( ) ) > ( 4 * GetPredictedVariance( GetLastSample( )->McuTime ) ) ) )
+    {
+        LmhpClockSyncAppTimeReq( );
     }
 }
 
@@ -192,6 +708,8 @@ static void LmhpClockSyncOnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
 
     if( LmhpClockSyncState.AppTimeReqPending == true )
     {
+        LmhpClockSyncState.AppTimeReqTimeOnAir = mcpsConfirm->TxTimeOnAir;
+
         // Revert ADR setting
         mibReq.Type = MIB_ADR;
         mibReq.Param.AdrEnable = LmhpClockSyncState.AdrEnabledPrev;
@@ -213,13 +731,16 @@ static void LmhpClockSyncOnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
 
 static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
 {
-    uint8_t cmdIndex = 0;
-    uint8_t dataBufferIndex = 0;
-
-    if( mcpsIndication->Port != CLOCK_SYNC_PORT )
+    if( mcpsIndication->DeviceTimeAnsReceived == true )
     {
-        return;
+        AddSysTimeSample( );
     }
+}
+
+static void LmhpClockSyncOnPortData( McpsIndication_t *mcpsIndication )
+{
+    uint8_t cmdIndex = 0;
+    uint8_t dataBufferIndex = 0;
 
     while( cmdIndex < mcpsIndication->BufferSize )
     {
@@ -247,13 +768,16 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                 timeCorrection  = ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                 timeCorrection += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                 timeCorrection += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                timeCorrection += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                timeCorrection += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
                 if( ( mcpsIndication->Buffer[cmdIndex++] & 0x0F ) == LmhpClockSyncState.TimeReqParam.Fields.TokenReq )
                 {
-                    SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
-                    curTime = SysTimeGet( );
-                    curTime.Seconds += timeCorrection;
-                    SysTimeSet( curTime );
+                    // The network time at the end of the uplink is within the
+                    // second starting at DeviceTime + TimeCorrection
+                    int64_t networkTime = ( ( ( int64_t )LmhpClockSyncState.AppTimeReqDeviceTime + timeCorrection ) * 1000 ) + 500;
+                    int64_t mcuTime = LmhpClockSyncState.AppTimeReqMcuTime + LmhpClockSyncState.AppTimeReqTimeOnAir;
+
+                    AddSample( mcuTime, networkTime - mcuTime, CLOCK_SYNC_APP_TIME_ANS_ERROR );
+                    DisciplineSysTime( );
                     LmhpClockSyncState.TimeReqParam.Fields.TokenReq = ( LmhpClockSyncState.TimeReqParam.Fields.TokenReq + 1 ) & 0x0F;
                     if( LmhpClockSyncPackage.OnSysTimeUpdate != NULL )
                     {
@@ -310,6 +834,15 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
     }
 }
 
+static void LmhpClockSyncOnMlmeIndication( MlmeIndication_t *mlmeIndication )
+{
+    if( ( mlmeIndication->MlmeIndication == MLME_BEACON ) &&
+        ( mlmeIndication->Status == LORAMAC_EVENT_INFO_STATUS_BEACON_LOCKED ) )
+    {
+        AddSysTimeSample( );
+    }
+}
+
 LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void )
 {
     if( LmHandlerIsBusy( ) == true )
@@ -350,6 +883,12 @@ LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void )
     SysTime_t curTime = SysTimeGet( );
     uint8_t dataBufferIndex = 0;
 
+    // The uplink is sent right away. Its time on air is added once known.
+    LmhpClockSyncState.AppTimeReqDeviceTime = curTime.Seconds;
+    LmhpClockSyncState.AppTimeReqMcuTime = GetMcuTime( );
+    LmhpClockSyncState.AppTimeReqTimeOnAir = 0;
+    LmhpClockSyncDiscipline.LastRequestTime = LmhpClockSyncState.AppTimeReqMcuTime;
+
     // Substract Unix to Gps epcoh offset. The system time is based on Unix time.
     curTime.Seconds -= UNIX_GPS_EPOCH_OFFSET;
 
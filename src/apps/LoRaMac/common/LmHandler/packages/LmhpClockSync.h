@@ -37,6 +37,70 @@ extern "C" {
  */
 #define PACKAGE_ID_CLOCK_SYNC                       1
 
+/*!
+ * Number of time synchronization samples used to estimate the clock offset
+ * and frequency
+ */
+#ifndef CLOCK_SYNC_HISTORY_SIZE
+#define CLOCK_SYNC_HISTORY_SIZE                     8
+#endif
+
+/*!
+ * A new AppTimeReq is sent when the predicted error of the system time
+ * exceeds this value, in ms
+ *
+ * \remark AppTimeAns only measures the time to the second. Values well below
+ *         1 s are only reached when the network also answers DeviceTimeReq.
+ */
+#ifndef CLOCK_SYNC_MAX_PREDICTED_ERROR
+#define CLOCK_SYNC_MAX_PREDICTED_ERROR              1000
+#endif
+
+/*!
+ * Minimum time between two AppTimeReq sent by the package, in ms
+ */
+#ifndef CLOCK_SYNC_MIN_REQUEST_INTERVAL
+#define CLOCK_SYNC_MIN_REQUEST_INTERVAL             900000
+#endif
+
+/*!
+ * Corrections below this value are slewed, bigger ones are stepped, in ms
+ */
+#ifndef CLOCK_SYNC_STEP_THRESHOLD
+#define CLOCK_SYNC_STEP_THRESHOLD                   1000
+#endif
+
+/*!
+ * Maximum slew rate of the system time, in ppm
+ */
+#ifndef CLOCK_SYNC_SLEW_RATE
+#define CLOCK_SYNC_SLEW_RATE                        500
+#endif
+
+/*!
+ * Period of the system time discipline and of the predicted error check
+ * once the package has samples, in ms
+ */
+#ifndef CLOCK_SYNC_DISCIPLINE_PERIOD
+#define CLOCK_SYNC_DISCIPLINE_PERIOD                60000
+#endif
+
+/*!
+ * Standard deviation of the local clock frequency before it has been
+ * measured, in ppm
+ */
+#ifndef CLOCK_SYNC_DRIFT_PRIOR
+#define CLOCK_SYNC_DRIFT_PRIOR                      30
+#endif
+
+/*!
+ * Standard deviation of the local clock frequency wander, mainly due to the
+ * temperature, in ppm
+ */
+#ifndef CLOCK_SYNC_DRIFT_WANDER
+#define CLOCK_SYNC_DRIFT_WANDER                     1
+#endif
+
 /*!
  * Clock sync package parameters
  *
@@ -50,6 +114,17 @@ LmhPackage_t *LmphClockSyncPackageFactory( void );
 
 LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void );
 
+/*!
+ * \brief Gets the predicted error of the system time
+ *
+ * \remark The package sends an AppTimeReq on its own once the error exceeds
+ *         \ref CLOCK_SYNC_MAX_PREDICTED_ERROR.
+ *
+ * \retval error Predicted error in ms (2 standard deviations).
+ *               UINT32_MAX when the time has never been synchronized.
+ */
+uint32_t LmhpClockSyncGetPredictedError( void );
+
 #ifdef __cplusplus
 }
 #endif
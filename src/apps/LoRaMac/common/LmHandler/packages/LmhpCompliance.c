@@ -123,6 +123,11 @@ static ComplianceTestState_t ComplianceTestState = {
  */
 static LmhpComplianceParams_t* ComplianceParams;
 
+/*!
+ * Timer used to process the pending transmission once the duty cycle allows it
+ */
+static TimerEvent_t ComplianceTxTimer;
+
 /*!
  * Reset Beacon status structure
  */
@@ -169,6 +174,13 @@ static void LmhpComplianceProcess( void );
  */
 static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication );
 
+/*!
+ * Processes the compliance commands received on the package port
+ *
+ * \param [IN] mcpsIndication     MCPS indication primitive data
+ */
+static void LmhpComplianceOnPortData( McpsIndication_t* mcpsIndication );
+
 /*!
  * Processes the MLME Confirm
  *
@@ -190,6 +202,11 @@ static void LmhpComplianceOnMlmeIndication( MlmeIndication_t* mlmeIndication );
  */
 static void SendBeaconRxStatusInd( bool isBeaconRxStatusIndOn );
 
+/*!
+ * \brief Callback function for the pending transmission timer
+ */
+static void OnComplianceTxTimer( void* context );
+
 LmhPackage_t CompliancePackage = {
     .Port                    = COMPLIANCE_PORT,
     .Init                    = LmhpComplianceInit,
@@ -198,12 +215,14 @@ LmhPackage_t CompliancePackage = {
     .Process                 = LmhpComplianceProcess,
     .OnMcpsConfirmProcess    = NULL,  // Not used in this package
     .OnMcpsIndicationProcess = LmhpComplianceOnMcpsIndication,
+    .OnPortDataProcess       = LmhpComplianceOnPortData,
     .OnMlmeConfirmProcess    = LmhpComplianceOnMlmeConfirm,
     .OnMlmeIndicationProcess = LmhpComplianceOnMlmeIndication,
     .OnMacMcpsRequest        = NULL,  // To be initialized by LmHandler
     .OnMacMlmeRequest        = NULL,  // To be initialized by LmHandler
     .OnJoinRequest           = NULL,  // To be initialized by LmHandler
     .OnDeviceTimeRequest     = NULL,  // To be initialized by LmHandler
+    .OnPackageProcessRequest = NULL,  // To be initialized by LmHandler
     .OnSysTimeUpdate         = NULL,  // To be initialized by LmHandler
 };
 
@@ -220,6 +239,7 @@ static void LmhpComplianceInit( void* params, uint8_t* dataBuffer, uint8_t dataB
         ComplianceTestState.DataBuffer        = dataBuffer;
         ComplianceTestState.DataBufferMaxSize = dataBufferMaxSize;
         ComplianceTestState.Initialized       = true;
+        TimerInit( &ComplianceTxTimer, OnComplianceTxTimer );
     }
     else
     {
@@ -268,10 +288,27 @@ static void LmhpComplianceProcess( void )
                 else
                 {
                     ComplianceTestState.IsTxPending = false;
+                    if( ComplianceTestState.IsClassReqCmdPending == true )
+                    {
+                        CompliancePackage.OnPackageProcessRequest( PACKAGE_ID_COMPLIANCE );
+                    }
                 }
                 ComplianceTestState.TxPendingTimestamp = now;
             }
         }
+
+        if( ComplianceTestState.IsTxPending == true )
+        {
+            // Come back once the duty cycle allows the transmission. When the
+            // MAC layer is busy the wait time is 0 and the transmission is
+            // retried on the MAC layer events instead.
+            TimerTime_t dueTime = ComplianceTestState.TxPendingTimestamp + LmHandlerGetDutyCycleWaitTime( );
+            if( dueTime > now )
+            {
+                TimerSetValue( &ComplianceTxTimer, dueTime - now + 1 );
+                TimerStart( &ComplianceTxTimer );
+            }
+        }
     }
     else
     { // If no Tx is pending process other commands
@@ -291,11 +328,13 @@ static void LmhpComplianceProcess( void )
     }
 }
 
-static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
+static void OnComplianceTxTimer( void* context )
 {
-    uint8_t cmdIndex        = 0;
-    MibRequestConfirm_t mibReq;
+    CompliancePackage.OnPackageProcessRequest( PACKAGE_ID_COMPLIANCE );
+}
 
+static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
+{
     if( ComplianceTestState.Initialized == false )
     {
         return;
@@ -307,13 +346,14 @@ static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
     {
         ComplianceTestState.RxAppCnt++;
     }
+}
 
-    if( mcpsIndication->RxData == false )
-    {
-        return;
-    }
+static void LmhpComplianceOnPortData( McpsIndication_t* mcpsIndication )
+{
+    uint8_t cmdIndex        = 0;
+    MibRequestConfirm_t mibReq;
 
-    if( mcpsIndication->Port != COMPLIANCE_PORT )
+    if( ComplianceTestState.Initialized == false )
     {
         return;
     }
@@ -110,11 +110,20 @@ static bool LmhpFragmentationIsTxPending( void );
 static void LmhpFragmentationProcess( void );
 
 /*!
- * Processes the MCPS Indication
+ * Processes the commands received on the package port
  *
  * \param [IN] mcpsIndication     MCPS indication primitive data
  */
-static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication );
+static void LmhpFragmentationOnPortData( McpsIndication_t *mcpsIndication );
+
+#if( LMHP_FRAGMENTATION_PATCH_ENABLED == 1 )
+/*!
+ * Applies the received file when it is a delta firmware update
+ *
+ * \param [IN] fileSize Received file size
+ */
+static void LmhpFragmentationApplyPatch( uint32_t fileSize );
+#endif
 
 static LmhpFragmentationState_t LmhpFragmentationState =
 {
@@ -172,13 +181,15 @@ static LmhPackage_t LmhpFragmentationPackage =
     .IsTxPending =  LmhpFragmentationIsTxPending,
     .Process = LmhpFragmentationProcess,
     .OnMcpsConfirmProcess = NULL,                              // Not used in this package
-    .OnMcpsIndicationProcess = LmhpFragmentationOnMcpsIndication,
+    .OnMcpsIndicationProcess = NULL,                           // Not used in this package
+    .OnPortDataProcess = LmhpFragmentationOnPortData,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
     .OnMlmeIndicationProcess = NULL,                           // Not used in this package
     .OnMacMcpsRequest = NULL,                                  // To be initialized by LmHandler
     .OnMacMlmeRequest = NULL,                                  // To be initialized by LmHandler
     .OnJoinRequest = NULL,                                     // To be initialized by LmHandler
     .OnDeviceTimeRequest = NULL,                               // To be initialized by LmHandler
+    .OnPackageProcessRequest = NULL,                           // To be initialized by LmHandler
     .OnSysTimeUpdate = NULL,                                   // To be initialized by LmHandler
 };
 
@@ -197,6 +208,7 @@ static void OnFragmentTxDelay( void* context )
     TimerStop( &FragmentTxDelayTimer );
     // Set the state.
     LmhpFragmentationState.TxDelayState = FRAGMENTATION_TX_DELAY_STATE_STOP;
+    LmhpFragmentationPackage.OnPackageProcessRequest( PACKAGE_ID_FRAGMENTATION );
 }
 
 LmhPackage_t *LmhpFragmentationPackageFactory( void )
@@ -266,7 +278,7 @@ static void LmhpFragmentationProcess( void )
     }
 }
 
-static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication )
+static void LmhpFragmentationOnPortData( McpsIndication_t *mcpsIndication )
 {
     uint8_t cmdIndex = 0;
     uint8_t dataBufferIndex = 0;
@@ -276,11 +288,6 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
     // Co-efficient used to calculate delay.
     uint8_t blockAckDelay = 0;
 
-    if( mcpsIndication->Port != FRAGMENTATION_PORT )
-    {
-        return;
-    }
-
     while( cmdIndex < mcpsIndication->BufferSize )
     {
         switch( mcpsIndication->Buffer[cmdIndex++] )
@@ -471,6 +478,12 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                 {
                     // Fragmentation successfully done
                     FragSessionData[fragIndex].FragDecoderProcessStatus = FRAG_SESSION_NOT_STARTED;
+#if( LMHP_FRAGMENTATION_PATCH_ENABLED == 1 )
+                    if( FragDecoderGetStatus( ).MatrixError == 0 )
+                    {
+                        LmhpFragmentationApplyPatch( ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
+                    }
+#endif
                     if( LmhpFragmentationParams->OnDone != NULL )
                     {
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
@@ -524,3 +537,25 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
         }
     }
 }
+
+#if( LMHP_FRAGMENTATION_PATCH_ENABLED == 1 )
+static void LmhpFragmentationApplyPatch( uint32_t fileSize )
+{
+    FragPatchCallbacks_t callbacks = LmhpFragmentationParams->PatchCallbacks;
+    FragPatchStatus_t status;
+    uint32_t targetSize = 0;
+
+    // The patch is the file reassembled by the decoder
+    callbacks.PatchRead = LmhpFragmentationParams->DecoderCallbacks.FragDecoderRead;
+    if( FragPatchIsPatch( &callbacks, fileSize ) == false )
+    {
+        return;
+    }
+    status = FragPatchApply( &callbacks, fileSize, LmhpFragmentationParams->PatchSourceSize,
+                             LmhpFragmentationParams->PatchTargetMaxSize, &targetSize );
+    if( LmhpFragmentationParams->OnPatchDone != NULL )
+    {
+        LmhpFragmentationParams->OnPatchDone( status, targetSize );
+    }
+}
+#endif
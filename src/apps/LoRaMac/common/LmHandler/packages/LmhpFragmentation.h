@@ -31,6 +31,24 @@ extern "C" {
 #include "LmhPackage.h"
 #include "FragDecoder.h"
 
+/*!
+ * If set to 1 the package applies the received files which are delta
+ * firmware updates, see FragPatch.h, before notifying OnDone. FragPatch.c
+ * must then be part of the application sources.
+ *
+ * \remark Requires FRAG_DECODER_FILE_HANDLING_NEW_API
+ */
+#ifndef LMHP_FRAGMENTATION_PATCH_ENABLED
+#define LMHP_FRAGMENTATION_PATCH_ENABLED            0
+#endif
+
+#if( LMHP_FRAGMENTATION_PATCH_ENABLED == 1 )
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 0 )
+#error "LMHP_FRAGMENTATION_PATCH_ENABLED requires FRAG_DECODER_FILE_HANDLING_NEW_API"
+#endif
+#include "FragPatch.h"
+#endif
+
 /*!
  * Fragmentation data block transport package identifier.
  *
@@ -89,6 +107,30 @@ typedef struct LmhpFragmentationParams_s
      */
     void ( *OnDone )( int32_t status, uint8_t *file, uint32_t size );
 #endif
+#if( LMHP_FRAGMENTATION_PATCH_ENABLED == 1 )
+    /*!
+     * Running image read and new image write callbacks of the delta
+     * updates. PatchRead is not used, the patch is read through
+     * DecoderCallbacks.FragDecoderRead.
+     */
+    FragPatchCallbacks_t PatchCallbacks;
+    /*!
+     * Size of the running image slot
+     */
+    uint32_t PatchSourceSize;
+    /*!
+     * Size of the new image slot
+     */
+    uint32_t PatchTargetMaxSize;
+    /*!
+     * Notifies that a received delta update has been applied. Called
+     * before OnDone, from the LmHandlerProcess context.
+     *
+     * \param [IN] status     Patch application status
+     * \param [IN] targetSize Size of the written image
+     */
+    void ( *OnPatchDone )( FragPatchStatus_t status, uint32_t targetSize );
+#endif
 }LmhpFragmentationParams_t;
 
 LmhPackage_t *LmhpFragmentationPackageFactory( void );
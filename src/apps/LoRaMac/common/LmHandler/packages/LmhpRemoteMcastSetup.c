@@ -35,35 +35,35 @@
             printf( __VA_ARGS__ );                   \
         }while( 0 )
 
-    #define DBG_SESSION( id, isRxParamsSetup )                                                         \
-        do                                                                                             \
-        {                                                                                              \
-            DBG( "ID          : %d\n", McSessionData[id].McGroupData.IdHeader.Fields.McGroupId );      \
-            DBG( "McAddr      : %08lX\n", McSessionData[id].McGroupData.McAddr );                      \
-            DBG( "McKey       : %02X", McSessionData[id].McGroupData.McKeyEncrypted[0] );              \
-            for( int i = 1; i < 16; i++ )                                                              \
-            {                                                                                          \
-                DBG( "-%02X",  McSessionData[id].McGroupData.McKeyEncrypted[i] );                      \
-            }                                                                                          \
-            DBG( "\n" );                                                                               \
-            DBG( "McFCountMin : %lu\n",  McSessionData[id].McGroupData.McFCountMin );                  \
-            DBG( "McFCountMax : %lu\n",  McSessionData[id].McGroupData.McFCountMax );                  \
-            if( isRxParamsSetup == true )                                                              \
-            {                                                                                          \
-                DBG( "SessionTime : %lu\n",  McSessionData[id].SessionTime );                          \
-                DBG( "SessionTimeT: %d\n",  McSessionData[id].SessionTimeout );                        \
-                if( McSessionData[id].RxParams.Class == CLASS_B )                                      \
-                {                                                                                      \
-                    DBG( "Rx Freq     : %lu\n", McSessionData[id].RxParams.Params.ClassB.Frequency );  \
-                    DBG( "Rx DR       : DR_%d\n", McSessionData[id].RxParams.Params.ClassB.Datarate ); \
-                    DBG( "Periodicity : %u\n", McSessionData[id].RxParams.Params.ClassB.Periodicity ); \
-                }                                                                                      \
-                else                                                                                   \
-                {                                                                                      \
-                    DBG( "Rx Freq     : %lu\n", McSessionData[id].RxParams.Params.ClassC.Frequency );  \
-                    DBG( "Rx DR       : DR_%d\n", McSessionData[id].RxParams.Params.ClassC.Datarate ); \
-                }                                                                                      \
-            }                                                                                          \
+    #define DBG_SESSION( id, isRxParamsSetup )                                                                 \
+        do                                                                                                     \
+        {                                                                                                      \
+            DBG( "ID          : %d\n", McSessionData[id].McGroupData.IdHeader.Fields.McGroupId );              \
+            DBG( "McAddr      : %08lX\n", McSessionData[id].McGroupData.McAddr );                              \
+            DBG( "McKey       : %02X", McSessionData[id].McGroupData.McKeyEncrypted[0] );                      \
+            for( int i = 1; i < 16; i++ )                                                                      \
+            {                                                                                                  \
+                DBG( "-%02X",  McSessionData[id].McGroupData.McKeyEncrypted[i] );                              \
+            }                                                                                                  \
+            DBG( "\n" );                                                                                       \
+            DBG( "McFCountMin : %lu\n",  McSessionData[id].McGroupData.McFCountMin );                          \
+            DBG( "McFCountMax : %lu\n",  McSessionData[id].McGroupData.McFCountMax );                          \
+            if( isRxParamsSetup == true )                                                                      \
+            {                                                                                                  \
+                DBG( "SessionTime : %lu\n",  McSessionData[id].SessionTime );                                  \
+                DBG( "SessionTimeT: %d\n",  McSessionData[id].SessionTimeout );                                \
+                if( McSessionData[id].Channel.RxParams.Class == CLASS_B )                                      \
+                {                                                                                              \
+                    DBG( "Rx Freq     : %lu\n", McSessionData[id].Channel.RxParams.Params.ClassB.Frequency );  \
+                    DBG( "Rx DR       : DR_%d\n", McSessionData[id].Channel.RxParams.Params.ClassB.Datarate ); \
+                    DBG( "Periodicity : %u\n", McSessionData[id].Channel.RxParams.Params.ClassB.Periodicity ); \
+                }                                                                                              \
+                else                                                                                           \
+                {                                                                                              \
+                    DBG( "Rx Freq     : %lu\n", McSessionData[id].Channel.RxParams.Params.ClassC.Frequency );  \
+                    DBG( "Rx DR       : DR_%d\n", McSessionData[id].Channel.RxParams.Params.ClassC.Datarate ); \
+                }                                                                                              \
+            }                                                                                                  \
         } while ( 0 )
 #else
     #define DBG( ... )
@@ -78,11 +78,23 @@
 #define REMOTE_MCAST_SETUP_ID                       2
 #define REMOTE_MCAST_SETUP_VERSION                  1
 
+/*!
+ * Maximum number of RX windows. A window starts now and on every session
+ * start and stop.
+ */
+#define REMOTE_MCAST_SETUP_MAX_RX_WINDOWS           ( ( LORAMAC_MAX_MC_CTX * 2 ) + 1 )
+
 typedef enum LmhpRemoteMcastSetupSessionStates_e
 {
     REMOTE_MCAST_SETUP_SESSION_STATE_IDLE,
-    REMOTE_MCAST_SETUP_SESSION_STATE_START,
-    REMOTE_MCAST_SETUP_SESSION_STATE_STOP,
+    /*!
+     * The next RX window of the schedule is due
+     */
+    REMOTE_MCAST_SETUP_SESSION_STATE_NEXT_WINDOW,
+    /*!
+     * A session or a priority has changed. The schedule must be rebuilt.
+     */
+    REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE,
 }LmhpRemoteMcastSetupSessionStates_t;
 
 /*!
@@ -154,9 +166,40 @@ static void LmhpRemoteMcastSetupProcess( void );
  */
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
-static void OnSessionStartTimer( void *context );
+/*!
+ * Processes the commands received on the package port
+ *
+ * \param [IN] mcpsIndication     MCPS indication primitive data
+ */
+static void LmhpRemoteMcastSetupOnPortData( McpsIndication_t *mcpsIndication );
+
+static void OnSessionTimer( void *context );
+
+/*!
+ * Builds the combined reception schedule of all the sessions, from now up
+ * to the end of the last session.
+ */
+static void BuildRxSchedule( void );
 
-static void OnSessionStopTimer( void *context );
+/*!
+ * Applies the next window of the reception schedule and starts the timer of
+ * the following one.
+ */
+static void StartRxWindow( void );
+
+/*!
+ * Switches the device class for a reception window
+ *
+ * \param [IN] newClass Device class of the window
+ */
+static void SwitchRxClass( DeviceClass_t newClass );
+
+/*!
+ * Updates the statistics of the group a multicast frame has been received on
+ *
+ * \param [IN] mcpsIndication MCPS indication primitive data
+ */
+static void UpdateGroupStats( McpsIndication_t *mcpsIndication );
 
 static LmhpRemoteMcastSetupState_t LmhpRemoteMcastSetupState =
 {
@@ -185,29 +228,92 @@ typedef struct McGroupData_s
 typedef enum eSessionState
 {
     SESSION_STOPED,
+    SESSION_SCHEDULED,
     SESSION_STARTED
 }SessionState_t;
 
 typedef struct McSessionData_s
 {
     McGroupData_t McGroupData;
+    /*!
+     * Multicast channel as set up in the MAC layer
+     */
+    McChannelParams_t Channel;
     SessionState_t SessionState;
     uint32_t SessionTime;
+    /*!
+     * System time of the session end, in seconds
+     */
+    uint32_t SessionStopTime;
     uint8_t SessionTimeout;
-    McRxParams_t RxParams;
+    /*!
+     * FPending bit of the last received frame. A group with a frame pending
+     * has priority.
+     */
+    uint8_t FPendingSet;
+    /*!
+     * Set once a frame has been received on the group
+     */
+    bool IsFCntReceived;
+    /*!
+     * Frame counter of the last received frame
+     */
+    uint32_t LastFCnt;
+    LmhpRemoteMcastSetupGroupStats_t Stats;
 }McSessionData_t;
 
 McSessionData_t McSessionData[LORAMAC_MAX_MC_CTX];
 
 /*!
- * Session start timer
+ * Reception window of the combined sessions schedule
  */
-static TimerEvent_t SessionStartTimer;
+typedef struct McRxWindow_s
+{
+    /*!
+     * System time of the window start, in seconds
+     */
+    uint32_t Start;
+    /*!
+     * Device class during the window
+     */
+    DeviceClass_t Class;
+    /*!
+     * Groups received during the window. Bit n is set for the group n.
+     */
+    uint8_t Groups;
+    /*!
+     * Group providing the class C reception parameters
+     */
+    uint8_t ClassCGroup;
+}McRxWindow_t;
 
 /*!
- * Session start timer
+ * Combined reception schedule of the sessions. Overlapping sessions are
+ * resolved when the schedule is built.
  */
-static TimerEvent_t SessionStopTimer;
+typedef struct McRxSchedule_s
+{
+    McRxWindow_t Windows[REMOTE_MCAST_SETUP_MAX_RX_WINDOWS];
+    uint8_t NbWindows;
+    uint8_t NextWindow;
+    /*!
+     * Device class successfully requested by the schedule. The class B switch
+     * may still be pending.
+     */
+    DeviceClass_t Class;
+}McRxSchedule_t;
+
+static McRxSchedule_t McRxSchedule =
+{
+    .NbWindows = 0,
+    .NextWindow = 0,
+    .Class = CLASS_A,
+};
+
+/*!
+ * Session timer, expires on the next RX window start
+ */
+static TimerEvent_t SessionTimer;
 
 static LmhPackage_t LmhpRemoteMcastSetupPackage =
 {
@@ -218,12 +324,14 @@ static LmhPackage_t LmhpRemoteMcastSetupPackage =
     .Process = LmhpRemoteMcastSetupProcess,
     .OnMcpsConfirmProcess = NULL,                              // Not used in this package
     .OnMcpsIndicationProcess = LmhpRemoteMcastSetupOnMcpsIndication,
+    .OnPortDataProcess = LmhpRemoteMcastSetupOnPortData,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
     .OnMlmeIndicationProcess = NULL,                           // Not used in this package
     .OnMacMcpsRequest = NULL,                                  // To be initialized by LmHandler
     .OnMacMlmeRequest = NULL,                                  // To be initialized by LmHandler
     .OnJoinRequest = NULL,                                     // To be initialized by LmHandler
     .OnDeviceTimeRequest = NULL,                               // To be initialized by LmHandler
+    .OnPackageProcessRequest = NULL,                           // To be initialized by LmHandler
     .OnSysTimeUpdate = NULL,                                   // To be initialized by LmHandler
 };
 
@@ -239,8 +347,7 @@ static void LmhpRemoteMcastSetupInit( void * params, uint8_t *dataBuffer, uint8_
         LmhpRemoteMcastSetupState.DataBuffer = dataBuffer;
         LmhpRemoteMcastSetupState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpRemoteMcastSetupState.Initialized = true;
-        TimerInit( &SessionStartTimer, OnSessionStartTimer );
-        TimerInit( &SessionStopTimer, OnSessionStopTimer );
+        TimerInit( &SessionTimer, OnSessionTimer );
     }
     else
     {
@@ -270,16 +377,16 @@ static void LmhpRemoteMcastSetupProcess( void )
 
     switch( state )
     {
-        case REMOTE_MCAST_SETUP_SESSION_STATE_START:
-            // Switch to Class C
-            LmHandlerRequestClass( CLASS_C );
-
-            TimerSetValue( &SessionStopTimer, ( 1 << McSessionData[0].SessionTimeout ) * 1000 );
-            TimerStart( &SessionStopTimer );
+        case REMOTE_MCAST_SETUP_SESSION_STATE_NEXT_WINDOW:
+            if( ( McRxSchedule.NextWindow + 1 ) < McRxSchedule.NbWindows )
+            {
+                McRxSchedule.NextWindow++;
+            }
+            StartRxWindow( );
             break;
-        case REMOTE_MCAST_SETUP_SESSION_STATE_STOP:
-            // Switch back to Class A
-            LmHandlerRequestClass( CLASS_A );
+        case REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE:
+            BuildRxSchedule( );
+            StartRxWindow( );
             break;
         case REMOTE_MCAST_SETUP_SESSION_STATE_IDLE:
         // Intentional fall through
@@ -290,15 +397,15 @@ static void LmhpRemoteMcastSetupProcess( void )
 }
 
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication )
+{
+    UpdateGroupStats( mcpsIndication );
+}
+
+static void LmhpRemoteMcastSetupOnPortData( McpsIndication_t *mcpsIndication )
 {
     uint8_t cmdIndex = 0;
     uint8_t dataBufferIndex = 0;
 
-    if( mcpsIndication->Port != REMOTE_MCAST_SETUP_PORT )
-    {
-        return;
-    }
-
     while( cmdIndex < mcpsIndication->BufferSize )
     {
         switch( mcpsIndication->Buffer[cmdIndex++] )
@@ -318,7 +425,7 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
             case REMOTE_MCAST_SETUP_MC_GROUP_SETUP_REQ:
             {
                 uint8_t idError = 0x01; // One bit value
-                uint8_t id = mcpsIndication->Buffer[cmdIndex++];
+                uint8_t id = mcpsIndication->Buffer[cmdIndex++] & 0x03;
 
                 McSessionData[id].McGroupData.IdHeader.Value = id;
 
@@ -327,7 +434,7 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                     McSessionData[id].McGroupData.McAddr =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                     McSessionData[id].McGroupData.McAddr += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                     McSessionData[id].McGroupData.McAddr += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].McGroupData.McAddr += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                    McSessionData[id].McGroupData.McAddr += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
                     for( int8_t i = 0; i < 16; i++ )
                     {
@@ -337,12 +444,12 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                     McSessionData[id].McGroupData.McFCountMin =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                     McSessionData[id].McGroupData.McFCountMin += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                     McSessionData[id].McGroupData.McFCountMin += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].McGroupData.McFCountMin += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                    McSessionData[id].McGroupData.McFCountMin += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
                     McSessionData[id].McGroupData.McFCountMax =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                     McSessionData[id].McGroupData.McFCountMax += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                     McSessionData[id].McGroupData.McFCountMax += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].McGroupData.McFCountMax += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                    McSessionData[id].McGroupData.McFCountMax += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
                     McChannelParams_t channel = 
                     {
@@ -364,6 +471,13 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                     {
                         idError = 0x00;
 
+                        // A new group cancels the session of the previous one
+                        McSessionData[id].Channel = channel;
+                        McSessionData[id].SessionState = SESSION_STOPED;
+                        McSessionData[id].FPendingSet = 0;
+                        McSessionData[id].IsFCntReceived = false;
+                        memset1( ( uint8_t* )&McSessionData[id].Stats, 0, sizeof( LmhpRemoteMcastSetupGroupStats_t ) );
+                        LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE;
                     }
                 }
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_SETUP_ANS;
@@ -384,6 +498,12 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 {
                     status |= 0x04; // McGroupUndefined bit set
                 }
+                else
+                {
+                    McSessionData[id].Channel.IsEnabled = false;
+                    McSessionData[id].SessionState = SESSION_STOPED;
+                    LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE;
+                }
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = status;
                 break;
             }
@@ -396,25 +516,25 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
 
                 if( id < LORAMAC_MAX_MC_CTX )
                 {
-                    McSessionData[id].RxParams.Class = CLASS_C;
+                    McSessionData[id].Channel.RxParams.Class = CLASS_C;
 
                     McSessionData[id].SessionTime =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                     McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                     McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                    McSessionData[id].SessionTime += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
                     // Add Unix to Gps epoch offset. The system time is based on Unix time.
                     McSessionData[id].SessionTime += UNIX_GPS_EPOCH_OFFSET;
 
                     McSessionData[id].SessionTimeout =  mcpsIndication->Buffer[cmdIndex++] & 0x0F;
 
-                    McSessionData[id].RxParams.Params.ClassC.Frequency =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
-                    McSessionData[id].RxParams.Params.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
-                    McSessionData[id].RxParams.Params.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].RxParams.Params.ClassC.Frequency *= 100;
-                    McSessionData[id].RxParams.Params.ClassC.Datarate = mcpsIndication->Buffer[cmdIndex++];
+                    McSessionData[id].Channel.RxParams.Params.ClassC.Frequency =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
+                    McSessionData[id].Channel.RxParams.Params.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
+                    McSessionData[id].Channel.RxParams.Params.ClassC.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
+                    McSessionData[id].Channel.RxParams.Params.ClassC.Frequency *= 100;
+                    McSessionData[id].Channel.RxParams.Params.ClassC.Datarate = mcpsIndication->Buffer[cmdIndex++];
 
-                    if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].RxParams, &status ) == LORAMAC_STATUS_OK )
+                    if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].Channel.RxParams, &status ) == LORAMAC_STATUS_OK )
                     {
                         SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
                         curTime = SysTimeGet( );
@@ -422,9 +542,10 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                         timeToSessionStart = McSessionData[id].SessionTime - curTime.Seconds;
                         if( timeToSessionStart > 0 )
                         {
-                            // Start session start timer
-                            TimerSetValue( &SessionStartTimer, timeToSessionStart * 1000 );
-                            TimerStart( &SessionStartTimer );
+                            // Add the session to the schedule
+                            McSessionData[id].SessionStopTime = McSessionData[id].SessionTime + ( 1 << McSessionData[id].SessionTimeout );
+                            McSessionData[id].SessionState = SESSION_SCHEDULED;
+                            LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE;
 
                             isTimerSet = true;
 
@@ -462,26 +583,26 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
 
                 if( id < LORAMAC_MAX_MC_CTX )
                 {
-                    McSessionData[id].RxParams.Class = CLASS_B;
+                    McSessionData[id].Channel.RxParams.Class = CLASS_B;
 
                     McSessionData[id].SessionTime =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
                     McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
                     McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].SessionTime += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
+                    McSessionData[id].SessionTime += ( ( uint32_t )mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
                     // Add Unix to Gps epoch offset. The system time is based on Unix time.
                     McSessionData[id].SessionTime += UNIX_GPS_EPOCH_OFFSET;
 
-                    McSessionData[id].RxParams.Params.ClassB.Periodicity = ( mcpsIndication->Buffer[cmdIndex] >> 4 ) & 0x07;
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Periodicity = ( mcpsIndication->Buffer[cmdIndex] >> 4 ) & 0x07;
                     McSessionData[id].SessionTimeout =  mcpsIndication->Buffer[cmdIndex++] & 0x0F;
 
-                    McSessionData[id].RxParams.Params.ClassB.Frequency =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
-                    McSessionData[id].RxParams.Params.ClassB.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
-                    McSessionData[id].RxParams.Params.ClassB.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
-                    McSessionData[id].RxParams.Params.ClassB.Frequency *= 100;
-                    McSessionData[id].RxParams.Params.ClassB.Datarate = mcpsIndication->Buffer[cmdIndex++];
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Frequency =  ( mcpsIndication->Buffer[cmdIndex++] << 0  ) & 0x000000FF;
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 8  ) & 0x0000FF00;
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Frequency |= ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Frequency *= 100;
+                    McSessionData[id].Channel.RxParams.Params.ClassB.Datarate = mcpsIndication->Buffer[cmdIndex++];
 
-                    if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].RxParams, &status ) == LORAMAC_STATUS_OK )
+                    if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].Channel.RxParams, &status ) == LORAMAC_STATUS_OK )
                     {
                         SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
                         curTime = SysTimeGet( );
@@ -489,9 +610,10 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                         timeToSessionStart = McSessionData[id].SessionTime - curTime.Seconds;
                         if( timeToSessionStart > 0 )
                         {
-                            // Start session start timer
-                            TimerSetValue( &SessionStartTimer, timeToSessionStart * 1000 );
-                            TimerStart( &SessionStartTimer );
+                            // Add the session to the schedule
+                            McSessionData[id].SessionStopTime = McSessionData[id].SessionTime + ( 1 << McSessionData[id].SessionTimeout );
+                            McSessionData[id].SessionState = SESSION_SCHEDULED;
+                            LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE;
 
                             isTimerSet = true;
 
@@ -540,16 +662,299 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
     }
 }
 
-static void OnSessionStartTimer( void *context )
+LmHandlerErrorStatus_t LmhpRemoteMcastSetupGetGroupStats( uint8_t id, LmhpRemoteMcastSetupGroupStats_t *stats )
 {
-    TimerStop( &SessionStartTimer );
+    if( ( id >= LORAMAC_MAX_MC_CTX ) || ( stats == NULL ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    *stats = McSessionData[id].Stats;
+    return LORAMAC_HANDLER_SUCCESS;
+}
 
-    LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_START;
+/*!
+ * Checks if a session is running at the given time
+ *
+ * \param [IN] id   Multicast group identifier
+ * \param [IN] time System time in seconds
+ *
+ * \retval isActive [true: the session is running, false: otherwise]
+ */
+static bool IsSessionActive( uint8_t id, uint32_t time )
+{
+    return ( McSessionData[id].SessionState != SESSION_STOPED ) &&
+           ( McSessionData[id].Channel.IsEnabled == true ) &&
+           ( McSessionData[id].SessionTime <= time ) && ( time < McSessionData[id].SessionStopTime );
 }
 
-static void OnSessionStopTimer( void *context )
+/*!
+ * Checks if a session has priority over another one. Uses the same rules as
+ * the class B slots arbitration of the MAC layer: a group with a frame
+ * pending first, then the highest address.
+ *
+ * \param [IN] currentId Group currently selected
+ * \param [IN] id        Candidate group
+ *
+ * \retval hasPriority [true: the candidate has priority, false: otherwise]
+ */
+static bool HasSessionPriority( uint8_t currentId, uint8_t id )
 {
-    TimerStop( &SessionStopTimer );
+    if( McSessionData[currentId].FPendingSet != McSessionData[id].FPendingSet )
+    {
+        return McSessionData[currentId].FPendingSet < McSessionData[id].FPendingSet;
+    }
+    return McSessionData[currentId].Channel.Address < McSessionData[id].Channel.Address;
+}
 
-    LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_STOP;
+/*!
+ * Resolves which sessions are received during a window.
+ *
+ * The device runs a single class at a time and listens to a single class C
+ * channel. The session with priority sets the class. All class B sessions
+ * are received together, the MAC layer arbitrates their overlapping slots.
+ * Class C sessions are received only if they share the channel of the
+ * session with priority.
+ *
+ * \param [IN/OUT] window Window to be resolved. Start must be set.
+ */
+static void ResolveRxWindow( McRxWindow_t *window )
+{
+    uint8_t winner = LORAMAC_MAX_MC_CTX;
+    McRxParams_t *winnerRxParams;
+    McRxParams_t *rxParams;
+
+    window->Class = CLASS_A;
+    window->Groups = 0;
+    window->ClassCGroup = LORAMAC_MAX_MC_CTX;
+
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        if( ( IsSessionActive( id, window->Start ) == true ) &&
+            ( ( winner == LORAMAC_MAX_MC_CTX ) || ( HasSessionPriority( winner, id ) == true ) ) )
+        {
+            winner = id;
+        }
+    }
+    if( winner == LORAMAC_MAX_MC_CTX )
+    {
+        return;
+    }
+
+    winnerRxParams = &McSessionData[winner].Channel.RxParams;
+    window->Class = winnerRxParams->Class;
+    if( window->Class == CLASS_C )
+    {
+        window->ClassCGroup = winner;
+    }
+
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        rxParams = &McSessionData[id].Channel.RxParams;
+        if( ( IsSessionActive( id, window->Start ) == false ) || ( rxParams->Class != window->Class ) )
+        {
+            continue;
+        }
+        if( ( window->Class == CLASS_B ) ||
+            ( ( rxParams->Params.ClassC.Frequency == winnerRxParams->Params.ClassC.Frequency ) &&
+              ( rxParams->Params.ClassC.Datarate == winnerRxParams->Params.ClassC.Datarate ) ) )
+        {
+            window->Groups |= 1 << id;
+        }
+    }
+}
+
+/*!
+ * Adds a window starting at the given time to the schedule, keeping the
+ * windows sorted by start time.
+ *
+ * \param [IN] start System time of the window start, in seconds
+ */
+static void AddRxWindow( uint32_t start )
+{
+    uint8_t index = McRxSchedule.NbWindows;
+
+    while( ( index > 0 ) && ( McRxSchedule.Windows[index - 1].Start > start ) )
+    {
+        index--;
+    }
+    if( ( index > 0 ) && ( McRxSchedule.Windows[index - 1].Start == start ) )
+    {
+        return;
+    }
+    for( uint8_t i = McRxSchedule.NbWindows; i > index; i-- )
+    {
+        McRxSchedule.Windows[i] = McRxSchedule.Windows[i - 1];
+    }
+    McRxSchedule.Windows[index].Start = start;
+    McRxSchedule.NbWindows++;
+}
+
+static void BuildRxSchedule( void )
+{
+    uint32_t now = SysTimeGet( ).Seconds;
+
+    McRxSchedule.NbWindows = 0;
+    McRxSchedule.NextWindow = 0;
+    AddRxWindow( now );
+
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        if( ( McSessionData[id].SessionState == SESSION_STOPED ) || ( McSessionData[id].Channel.IsEnabled == false ) )
+        {
+            continue;
+        }
+        if( McSessionData[id].SessionStopTime <= now )
+        {
+            McSessionData[id].SessionState = SESSION_STOPED;
+            continue;
+        }
+        if( McSessionData[id].SessionTime > now )
+        {
+            AddRxWindow( McSessionData[id].SessionTime );
+        }
+        AddRxWindow( McSessionData[id].SessionStopTime );
+    }
+
+    for( uint8_t i = 0; i < McRxSchedule.NbWindows; i++ )
+    {
+        ResolveRxWindow( &McRxSchedule.Windows[i] );
+    }
+}
+
+static void StartRxWindow( void )
+{
+    McRxWindow_t *window = &McRxSchedule.Windows[McRxSchedule.NextWindow];
+    uint32_t now = SysTimeGet( ).Seconds;
+
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        if( McSessionData[id].SessionState == SESSION_STOPED )
+        {
+            continue;
+        }
+        if( McSessionData[id].SessionStopTime <= now )
+        {
+            McSessionData[id].SessionState = SESSION_STOPED;
+            DBG( "Session %d stop: received %lu, missed %lu, late %lu\n", id, McSessionData[id].Stats.Received,
+                 McSessionData[id].Stats.Missed, McSessionData[id].Stats.Late );
+        }
+        else if( McSessionData[id].SessionTime <= now )
+        {
+            McSessionData[id].SessionState = SESSION_STARTED;
+        }
+    }
+
+    SwitchRxClass( window->Class );
+
+    if( window->ClassCGroup < LORAMAC_MAX_MC_CTX )
+    {
+        MibRequestConfirm_t mibReq;
+
+        // Listen to the channel of the class C session with priority
+        mibReq.Type = MIB_RXC_CHANNEL;
+        mibReq.Param.RxCChannel.Frequency = McSessionData[window->ClassCGroup].Channel.RxParams.Params.ClassC.Frequency;
+        mibReq.Param.RxCChannel.Datarate = McSessionData[window->ClassCGroup].Channel.RxParams.Params.ClassC.Datarate;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+
+    TimerStop( &SessionTimer );
+    if( ( McRxSchedule.NextWindow + 1 ) < McRxSchedule.NbWindows )
+    {
+        TimerSetValue( &SessionTimer, ( McRxSchedule.Windows[McRxSchedule.NextWindow + 1].Start - now ) * 1000 );
+        TimerStart( &SessionTimer );
+    }
+}
+
+static void SwitchRxClass( DeviceClass_t newClass )
+{
+    DeviceClass_t currentClass = LmHandlerGetCurrentClass( );
+
+    // Only switch the class the schedule has set, the application may run
+    // another class outside of the sessions.
+    if( ( newClass == McRxSchedule.Class ) && ( ( newClass == CLASS_A ) || ( newClass == currentClass ) ) )
+    {
+        return;
+    }
+
+    // Leave the class set by the schedule, which also cancels a pending
+    // class B switch, or go through class A from another class
+    if( ( ( McRxSchedule.Class != CLASS_A ) && ( McRxSchedule.Class != newClass ) ) ||
+        ( ( currentClass != CLASS_A ) && ( currentClass != newClass ) ) )
+    {
+        if( LmHandlerRequestClass( CLASS_A ) != LORAMAC_HANDLER_SUCCESS )
+        {
+            return;
+        }
+        McRxSchedule.Class = CLASS_A;
+    }
+
+    // The class B switch completes once the beacon is acquired, requesting
+    // it again meanwhile has no effect. A failed switch, or a class B lost
+    // with the beacon, is requested again on the next window.
+    if( ( newClass != CLASS_A ) && ( LmHandlerRequestClass( newClass ) == LORAMAC_HANDLER_SUCCESS ) )
+    {
+        McRxSchedule.Class = newClass;
+    }
+}
+
+static void UpdateGroupStats( McpsIndication_t *mcpsIndication )
+{
+    McSessionData_t *session = NULL;
+
+    if( ( mcpsIndication->Multicast == 0 ) || ( mcpsIndication->Status != LORAMAC_EVENT_INFO_STATUS_OK ) )
+    {
+        return;
+    }
+
+    for( uint8_t id = 0; id < LORAMAC_MAX_MC_CTX; id++ )
+    {
+        if( ( McSessionData[id].Channel.IsEnabled == true ) &&
+            ( McSessionData[id].Channel.Address == mcpsIndication->DevAddress ) )
+        {
+            session = &McSessionData[id];
+            break;
+        }
+    }
+    if( session == NULL )
+    {
+        return;
+    }
+
+    session->Stats.Received++;
+    if( session->SessionState != SESSION_STARTED )
+    {
+        session->Stats.Late++;
+    }
+    // Frames are lost when the frame counter jumps
+    if( session->IsFCntReceived == true )
+    {
+        if( mcpsIndication->DownLinkCounter > ( session->LastFCnt + 1 ) )
+        {
+            session->Stats.Missed += mcpsIndication->DownLinkCounter - session->LastFCnt - 1;
+        }
+    }
+    session->IsFCntReceived = true;
+    session->LastFCnt = mcpsIndication->DownLinkCounter;
+
+    if( session->FPendingSet != mcpsIndication->FramePending )
+    {
+        session->FPendingSet = mcpsIndication->FramePending;
+        if( session->SessionState != SESSION_STOPED )
+        {
+            // The priorities between the sessions have changed
+            LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_UPDATE;
+        }
+    }
+}
+
+static void OnSessionTimer( void *context )
+{
+    TimerStop( &SessionTimer );
+
+    // A pending update rebuilds the schedule from the current time anyway
+    if( LmhpRemoteMcastSetupState.SessionState == REMOTE_MCAST_SETUP_SESSION_STATE_IDLE )
+    {
+        LmhpRemoteMcastSetupState.SessionState = REMOTE_MCAST_SETUP_SESSION_STATE_NEXT_WINDOW;
+    }
+    LmhpRemoteMcastSetupPackage.OnPackageProcessRequest( PACKAGE_ID_REMOTE_MCAST_SETUP );
 }
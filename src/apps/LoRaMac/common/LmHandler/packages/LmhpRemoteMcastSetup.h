@@ -46,8 +46,40 @@ extern "C" {
 //{
 //}LmhpRemoteMcastSetupParams_t;
 
+/*!
+ * Multicast group statistics
+ */
+typedef struct LmhpRemoteMcastSetupGroupStats_s
+{
+    /*!
+     * Frames received on the group address
+     */
+    uint32_t Received;
+    /*!
+     * Frames lost, counted from the gaps of the received frame counters
+     */
+    uint32_t Missed;
+    /*!
+     * Frames received while the group session was not running. Part of
+     * Received.
+     */
+    uint32_t Late;
+}LmhpRemoteMcastSetupGroupStats_t;
+
 LmhPackage_t *LmhpRemoteMcastSetupPackageFactory( void );
 
+/*!
+ * Gets the statistics of a multicast group. They are reset when the group
+ * is set up.
+ *
+ * \param [IN]  id    Multicast group identifier
+ * \param [OUT] stats Group statistics
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the identifier is
+ *                valid else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmhpRemoteMcastSetupGetGroupStats( uint8_t id, LmhpRemoteMcastSetupGroupStats_t *stats );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,490 @@
+/*!
+ * \file      TelemetryStore.c
+ *
+ * \brief     Store-and-forward telemetry queue
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "utilities.h"
+#include "nvmm.h"
+#include "systime.h"
+#include "timer.h"
+#include "LoRaMac.h"
+#include "LoRaMacAdr.h"
+#include "LmHandler.h"
+#include "TelemetryStore.h"
+
+/*!
+ * Backfill frame header size. Base timestamp
+ */
+#define TELEMETRY_STORE_FRAME_HEADER_SIZE           4
+
+/*!
+ * Per record overhead inside a backfill frame. Time offset + size
+ */
+#define TELEMETRY_STORE_RECORD_OVERHEAD             3
+
+/*!
+ * Persistent record
+ */
+typedef struct TelemetryRecord_s
+{
+    /*!
+     * Record sequence number. The record is stored in the ring slot
+     * Sequence % TELEMETRY_STORE_NB_RECORDS
+     */
+    uint32_t Sequence;
+    /*!
+     * System time seconds at which the record has been pushed
+     */
+    uint32_t Timestamp;
+    /*!
+     * Record data size
+     */
+    uint8_t Size;
+    /*!
+     * Record data
+     */
+    uint8_t Data[TELEMETRY_STORE_RECORD_MAX_SIZE];
+    /*!
+     * CRC32 value of the record
+     */
+    uint32_t Crc32;
+}TelemetryRecord_t;
+
+/*!
+ * Persistent ring header
+ */
+typedef struct TelemetryRingHeader_s
+{
+    /*!
+     * Sequence number of the oldest record not sent yet
+     */
+    uint32_t HeadSequence;
+    /*!
+     * CRC32 value of the header
+     */
+    uint32_t Crc32;
+}TelemetryRingHeader_t;
+
+/*!
+ * NVM offset of the first ring record
+ */
+#define TELEMETRY_STORE_RECORDS_OFFSET              ( TELEMETRY_STORE_NVM_OFFSET + sizeof( TelemetryRingHeader_t ) )
+
+/*!
+ * Telemetry store context
+ */
+typedef struct TelemetryStoreCtx_s
+{
+    /*!
+     * Ring header as stored in NVM
+     */
+    TelemetryRingHeader_t Ring;
+    /*!
+     * Sequence number of the oldest record stored in NVM
+     */
+    uint32_t HeadSequence;
+    /*!
+     * Sequence number of the next record written to NVM
+     */
+    uint32_t NextSequence;
+    /*!
+     * Sequence number following the last record sent
+     */
+    uint32_t ReleasedSequence;
+    /*!
+     * Records waiting to be written to NVM
+     */
+    TelemetryRecord_t Staging[TELEMETRY_STORE_BATCH_SIZE];
+    /*!
+     * Number of staged records
+     */
+    uint8_t StagingCount;
+    /*!
+     * Indicates that the MAC has reported a duty-cycle restriction
+     */
+    bool IsDutyCycleRestricted;
+    /*!
+     * Time at which the duty-cycle restriction has been reported
+     */
+    TimerTime_t DutyCycleRestrictionTime;
+    /*!
+     * Time to wait before the next backfill attempt
+     */
+    TimerTime_t DutyCycleWaitTime;
+    /*!
+     * Statistics
+     */
+    TelemetryStoreStats_t Stats;
+}TelemetryStoreCtx_t;
+
+static TelemetryStoreCtx_t Ctx;
+
+static uint16_t GetRecordNvmOffset( uint32_t sequence )
+{
+    return TELEMETRY_STORE_RECORDS_OFFSET + ( ( sequence % TELEMETRY_STORE_NB_RECORDS ) * sizeof( TelemetryRecord_t ) );
+}
+
+static uint16_t GetPersistedCount( void )
+{
+    return ( uint16_t )( Ctx.NextSequence - Ctx.HeadSequence );
+}
+
+static void WriteRingHeader( void )
+{
+    Ctx.Ring.HeadSequence = Ctx.HeadSequence;
+    Ctx.Ring.Crc32 = Crc32( ( uint8_t* )&Ctx.Ring, sizeof( TelemetryRingHeader_t ) - sizeof( uint32_t ) );
+    NvmmWrite( ( uint8_t* )&Ctx.Ring, sizeof( TelemetryRingHeader_t ), TELEMETRY_STORE_NVM_OFFSET );
+    Ctx.Stats.NbNvmWrites++;
+}
+
+/*!
+ * \brief Reads a ring slot from NVM
+ *
+ * \param [IN]  slot   Ring slot
+ * \param [OUT] record Record
+ *
+ * \retval status [true: valid record, false: never written or interrupted write]
+ */
+static bool ReadSlot( uint16_t slot, TelemetryRecord_t *record )
+{
+    NvmmRead( ( uint8_t* )record, sizeof( TelemetryRecord_t ), GetRecordNvmOffset( slot ) );
+
+    return ( record->Crc32 == Crc32( ( uint8_t* )record, sizeof( TelemetryRecord_t ) - sizeof( uint32_t ) ) ) &&
+           ( ( record->Sequence % TELEMETRY_STORE_NB_RECORDS ) == slot );
+}
+
+/*!
+ * \brief Gets the record at the given position. Position 0 is the oldest record
+ *
+ * \param [IN]  position Record position
+ * \param [OUT] record   Record
+ */
+static void GetRecord( uint16_t position, TelemetryRecord_t *record )
+{
+    if( position < GetPersistedCount( ) )
+    {
+        NvmmRead( ( uint8_t* )record, sizeof( TelemetryRecord_t ), GetRecordNvmOffset( Ctx.HeadSequence + position ) );
+    }
+    else
+    {
+        *record = Ctx.Staging[position - GetPersistedCount( )];
+    }
+}
+
+void TelemetryStoreInit( void )
+{
+    TelemetryRecord_t record;
+
+    memset1( ( uint8_t* )&Ctx, 0, sizeof( TelemetryStoreCtx_t ) );
+
+    NvmmRead( ( uint8_t* )&Ctx.Ring, sizeof( TelemetryRingHeader_t ), TELEMETRY_STORE_NVM_OFFSET );
+    // The CRC32 of an erased header is valid
+    if( ( Ctx.Ring.Crc32 != Crc32( ( uint8_t* )&Ctx.Ring, sizeof( TelemetryRingHeader_t ) - sizeof( uint32_t ) ) ) ||
+        ( Ctx.Ring.HeadSequence == UINT32_MAX ) )
+    {
+        // Never initialized ring
+        Ctx.Ring.HeadSequence = 0;
+    }
+    Ctx.NextSequence = Ctx.Ring.HeadSequence;
+
+    Ctx.ReleasedSequence = Ctx.Ring.HeadSequence;
+
+    // The newest valid record gives the next sequence number
+    for( uint16_t i = 0; i < TELEMETRY_STORE_NB_RECORDS; i++ )
+    {
+        if( ( ReadSlot( i, &record ) == true ) && ( record.Sequence >= Ctx.NextSequence ) )
+        {
+            Ctx.NextSequence = record.Sequence + 1;
+        }
+    }
+
+    // The records not sent yet are the valid ones preceding it. A batch
+    // interrupted by a power failure ends the sequence.
+    Ctx.HeadSequence = Ctx.NextSequence;
+    while( ( Ctx.HeadSequence > Ctx.Ring.HeadSequence ) && ( GetPersistedCount( ) < TELEMETRY_STORE_NB_RECORDS ) &&
+           ( ReadSlot( ( Ctx.HeadSequence - 1 ) % TELEMETRY_STORE_NB_RECORDS, &record ) == true ) &&
+           ( record.Sequence == ( Ctx.HeadSequence - 1 ) ) )
+    {
+        Ctx.HeadSequence--;
+    }
+}
+
+bool TelemetryStorePush( const uint8_t *data, uint8_t size )
+{
+    TelemetryRecord_t *record;
+
+    if( ( data == NULL ) || ( size == 0 ) || ( size > TELEMETRY_STORE_RECORD_MAX_SIZE ) )
+    {
+        return false;
+    }
+
+    record = &Ctx.Staging[Ctx.StagingCount++];
+    memset1( ( uint8_t* )record, 0, sizeof( TelemetryRecord_t ) );
+    record->Timestamp = SysTimeGet( ).Seconds;
+    record->Size = size;
+    memcpy1( record->Data, data, size );
+    Ctx.Stats.NbRecordsPushed++;
+
+    if( Ctx.StagingCount >= TELEMETRY_STORE_BATCH_SIZE )
+    {
+        TelemetryStoreFlush( );
+    }
+    return true;
+}
+
+void TelemetryStoreFlush( void )
+{
+    uint16_t tail;
+    uint16_t chunk;
+    uint16_t overflow;
+
+    if( Ctx.ReleasedSequence > Ctx.Ring.HeadSequence )
+    {
+        WriteRingHeader( );
+    }
+
+    if( Ctx.StagingCount == 0 )
+    {
+        return;
+    }
+
+    // Overwrite the oldest records when the ring is full. The ring header
+    // needs no update, Init never restores more than a full ring.
+    if( ( GetPersistedCount( ) + Ctx.StagingCount ) > TELEMETRY_STORE_NB_RECORDS )
+    {
+        overflow = GetPersistedCount( ) + Ctx.StagingCount - TELEMETRY_STORE_NB_RECORDS;
+        Ctx.HeadSequence += overflow;
+        Ctx.Stats.NbRecordsDropped += overflow;
+    }
+
+    for( uint8_t i = 0; i < Ctx.StagingCount; i++ )
+    {
+        Ctx.Staging[i].Sequence = Ctx.NextSequence + i;
+        Ctx.Staging[i].Crc32 = Crc32( ( uint8_t* )&Ctx.Staging[i], sizeof( TelemetryRecord_t ) - sizeof( uint32_t ) );
+    }
+
+    // Write the batch with at most two contiguous writes
+    tail = Ctx.NextSequence % TELEMETRY_STORE_NB_RECORDS;
+    chunk = MIN( Ctx.StagingCount, TELEMETRY_STORE_NB_RECORDS - tail );
+    NvmmWrite( ( uint8_t* )&Ctx.Staging[0], chunk * sizeof( TelemetryRecord_t ), GetRecordNvmOffset( Ctx.NextSequence ) );
+    Ctx.Stats.NbNvmWrites++;
+    if( chunk < Ctx.StagingCount )
+    {
+        NvmmWrite( ( uint8_t* )&Ctx.Staging[chunk], ( Ctx.StagingCount - chunk ) * sizeof( TelemetryRecord_t ),
+                   GetRecordNvmOffset( 0 ) );
+        Ctx.Stats.NbNvmWrites++;
+    }
+
+    Ctx.NextSequence += Ctx.StagingCount;
+    Ctx.StagingCount = 0;
+}
+
+uint16_t TelemetryStoreGetCount( void )
+{
+    return GetPersistedCount( ) + Ctx.StagingCount;
+}
+
+uint8_t TelemetryStorePack( uint8_t *buffer, uint8_t maxSize, uint16_t *nbRecords )
+{
+    TelemetryRecord_t record;
+    uint32_t baseTimestamp = 0;
+    uint32_t timeOffset = 0;
+    uint16_t count = TelemetryStoreGetCount( );
+    uint8_t size = TELEMETRY_STORE_FRAME_HEADER_SIZE;
+    uint16_t i = 0;
+
+    *nbRecords = 0;
+
+    if( ( buffer == NULL ) || ( count == 0 ) || ( maxSize <= TELEMETRY_STORE_FRAME_HEADER_SIZE ) )
+    {
+        return 0;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        GetRecord( i, &record );
+
+        if( i == 0 )
+        {
+            baseTimestamp = record.Timestamp;
+            buffer[0] = ( baseTimestamp >> 24 ) & 0xFF;
+            buffer[1] = ( baseTimestamp >> 16 ) & 0xFF;
+            buffer[2] = ( baseTimestamp >> 8 ) & 0xFF;
+            buffer[3] = baseTimestamp & 0xFF;
+        }
+
+        if( record.Timestamp < baseTimestamp )
+        {
+            // System time has been set backwards. Start a new frame.
+            break;
+        }
+        timeOffset = record.Timestamp - baseTimestamp;
+        if( timeOffset > 0xFFFF )
+        {
+            // Out of the frame time offset range. Start a new frame.
+            break;
+        }
+        if( ( size + TELEMETRY_STORE_RECORD_OVERHEAD + record.Size ) > maxSize )
+        {
+            break;
+        }
+
+        buffer[size++] = ( timeOffset >> 8 ) & 0xFF;
+        buffer[size++] = timeOffset & 0xFF;
+        buffer[size++] = record.Size;
+        memcpy1( buffer + size, record.Data, record.Size );
+        size += record.Size;
+    }
+
+    *nbRecords = i;
+    if( i == 0 )
+    {
+        return 0;
+    }
+    return size;
+}
+
+void TelemetryStoreRelease( uint16_t nbRecords )
+{
+    uint16_t nbPersisted;
+
+    nbRecords = MIN( nbRecords, TelemetryStoreGetCount( ) );
+
+    // Release the persisted records first as these are the oldest
+    nbPersisted = MIN( nbRecords, GetPersistedCount( ) );
+    if( nbPersisted > 0 )
+    {
+        Ctx.HeadSequence += nbPersisted;
+        Ctx.ReleasedSequence = Ctx.HeadSequence;
+        if( ( GetPersistedCount( ) == 0 ) ||
+            ( ( Ctx.ReleasedSequence - Ctx.Ring.HeadSequence ) >= TELEMETRY_STORE_RELEASE_BATCH_SIZE ) )
+        {
+            WriteRingHeader( );
+        }
+    }
+    nbRecords -= nbPersisted;
+
+    if( nbRecords > 0 )
+    {
+        Ctx.StagingCount -= nbRecords;
+        for( uint8_t i = 0; i < Ctx.StagingCount; i++ )
+        {
+            Ctx.Staging[i] = Ctx.Staging[i + nbRecords];
+        }
+    }
+}
+
+/*!
+ * \brief Gets the datarate of the next backfill frame
+ *
+ * \retval datarate Datarate
+ */
+static int8_t GetBackfillDatarate( void )
+{
+    MibRequestConfirm_t mibGet;
+    int8_t datarate = LmHandlerGetCurrentDatarate( );
+
+    mibGet.Type = MIB_ADR;
+    LoRaMacMibGetRequestConfirm( &mibGet );
+    if( mibGet.Param.AdrEnable == true )
+    {
+        // The network manages the datarate
+        return datarate;
+    }
+
+    mibGet.Type = MIB_CHANNELS_TX_POWER;
+    LoRaMacMibGetRequestConfirm( &mibGet );
+    return MAX( datarate, LoRaMacAdrLinkMarginGetMaxDatarate( LmHandlerGetActiveRegion( ), mibGet.Param.ChannelsTxPower ) );
+}
+
+bool TelemetryStoreProcess( LmHandlerMsgTypes_t isTxConfirmed )
+{
+    LmHandlerAppData_t appData;
+    MibRequestConfirm_t mibSet;
+    uint16_t nbRecords = 0;
+    int8_t datarate;
+
+    if( TelemetryStoreGetCount( ) == 0 )
+    {
+        return false;
+    }
+
+    if( Ctx.IsDutyCycleRestricted == true )
+    {
+        if( TimerGetElapsedTime( Ctx.DutyCycleRestrictionTime ) < Ctx.DutyCycleWaitTime )
+        {
+            // Respect the duty-cycle budget
+            return false;
+        }
+        Ctx.IsDutyCycleRestricted = false;
+    }
+
+    // Check the join status first as LmHandlerIsBusy triggers a new join
+    // request when the network isn't joined.
+    if( ( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET ) || ( LmHandlerIsBusy( ) == true ) )
+    {
+        return false;
+    }
+
+    // Switch to the backfill datarate first. The reserved size is the maximum
+    // application payload available at the current datarate.
+    datarate = GetBackfillDatarate( );
+    if( datarate != LmHandlerGetCurrentDatarate( ) )
+    {
+        mibSet.Type = MIB_CHANNELS_DATARATE;
+        mibSet.Param.ChannelsDatarate = datarate;
+        if( LoRaMacMibSetRequestConfirm( &mibSet ) != LORAMAC_STATUS_OK )
+        {
+            datarate = LmHandlerGetCurrentDatarate( );
+        }
+    }
+
+    // Pack the records straight into the MAC frame buffer, taking into
+    // account the pending MAC commands.
+    if( LmHandlerReserveAppData( &appData ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return false;
+    }
+    appData.Port = TELEMETRY_STORE_BACKFILL_PORT;
+    appData.BufferSize = TelemetryStorePack( appData.Buffer, appData.BufferSize, &nbRecords );
+    if( appData.BufferSize == 0 )
+    {
+        return false;
+    }
+
+    if( LmHandlerSendAtDatarate( &appData, isTxConfirmed, datarate ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        if( LmHandlerGetDutyCycleWaitTime( ) > 0 )
+        {
+            Ctx.IsDutyCycleRestricted = true;
+            Ctx.DutyCycleRestrictionTime = TimerGetCurrentTime( );
+            Ctx.DutyCycleWaitTime = LmHandlerGetDutyCycleWaitTime( );
+        }
+        return false;
+    }
+
+    TelemetryStoreRelease( nbRecords );
+    Ctx.Stats.NbRecordsSent += nbRecords;
+    Ctx.Stats.NbFramesSent++;
+    return true;
+}
+
+const TelemetryStoreStats_t* TelemetryStoreGetStats( void )
+{
+    return &Ctx.Stats;
+}
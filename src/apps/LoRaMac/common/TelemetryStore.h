@@ -0,0 +1,206 @@
+/*!
+ * \file      TelemetryStore.h
+ *
+ * \brief     Store-and-forward telemetry queue
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \defgroup  TELEMETRYSTORE Store-and-forward telemetry queue
+ *            Keeps the measurements which could not be sent in a persistent
+ *            ring of timestamped records and sends them back packed into
+ *            as few uplinks as possible once the network is available again.
+ * \{
+ */
+#ifndef __TELEMETRY_STORE_H__
+#define __TELEMETRY_STORE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "LmHandlerTypes.h"
+
+/*!
+ * Maximum size of the data held by a single record
+ */
+#ifndef TELEMETRY_STORE_RECORD_MAX_SIZE
+#define TELEMETRY_STORE_RECORD_MAX_SIZE             16
+#endif
+
+/*!
+ * Number of records held by the persistent ring.
+ * When the ring is full the oldest record is overwritten.
+ */
+#ifndef TELEMETRY_STORE_NB_RECORDS
+#define TELEMETRY_STORE_NB_RECORDS                  128
+#endif
+
+/*!
+ * Number of records staged in RAM before being written to NVM in one go.
+ *
+ * \remark Bigger batches reduce the EEPROM wear but more records are lost
+ *         on a power failure.
+ */
+#ifndef TELEMETRY_STORE_BATCH_SIZE
+#define TELEMETRY_STORE_BATCH_SIZE                  8
+#endif
+
+/*!
+ * Number of released records after which the ring header is written to NVM.
+ * The header is also written when the backlog has been fully sent.
+ *
+ * \remark On a power failure at most this number of records, already sent,
+ *         are sent again.
+ */
+#ifndef TELEMETRY_STORE_RELEASE_BATCH_SIZE
+#define TELEMETRY_STORE_RELEASE_BATCH_SIZE          ( TELEMETRY_STORE_NB_RECORDS / 4 )
+#endif
+
+/*!
+ * NVM offset of the ring. Defaults to the first byte after the LoRaMac
+ * context stored by \ref NvmDataMgmtStore
+ */
+#ifndef TELEMETRY_STORE_NVM_OFFSET
+#define TELEMETRY_STORE_NVM_OFFSET                  ( sizeof( LoRaMacNvmData_t ) )
+#endif
+
+/*!
+ * Application port used to send the backlog frames
+ */
+#ifndef TELEMETRY_STORE_BACKFILL_PORT
+#define TELEMETRY_STORE_BACKFILL_PORT               3
+#endif
+
+/*!
+ * Telemetry store statistics
+ */
+typedef struct TelemetryStoreStats_s
+{
+    /*!
+     * Number of records pushed to the store
+     */
+    uint32_t NbRecordsPushed;
+    /*!
+     * Number of records sent as part of a backfill frame
+     */
+    uint32_t NbRecordsSent;
+    /*!
+     * Number of records overwritten because the ring was full
+     */
+    uint32_t NbRecordsDropped;
+    /*!
+     * Number of backfill frames sent
+     */
+    uint32_t NbFramesSent;
+    /*!
+     * Number of NVM write operations
+     */
+    uint32_t NbNvmWrites;
+}TelemetryStoreStats_t;
+
+/*!
+ * \brief Initializes the store and restores the ring state from NVM
+ *
+ * \remark The newest record is found from the record sequence numbers.
+ *         The ring header only holds the oldest record not sent yet.
+ */
+void TelemetryStoreInit( void );
+
+/*!
+ * \brief Pushes a new timestamped record to the store.
+ *
+ * \remark The record is timestamped with the current system time seconds.
+ *
+ * \param [IN] data Record data
+ * \param [IN] size Record data size. Maximum \ref TELEMETRY_STORE_RECORD_MAX_SIZE
+ *
+ * \retval status [true: record stored, false: invalid size]
+ */
+bool TelemetryStorePush( const uint8_t *data, uint8_t size );
+
+/*!
+ * \brief Writes the records staged in RAM and the released records to NVM.
+ *
+ * \remark Is called automatically when a batch is complete. May be called
+ *         by the application before going into a deep sleep mode.
+ */
+void TelemetryStoreFlush( void );
+
+/*!
+ * \brief Gets the number of records waiting to be sent
+ *
+ * \retval count Number of records
+ */
+uint16_t TelemetryStoreGetCount( void );
+
+/*!
+ * \brief Packs the oldest records into a backfill frame.
+ *
+ *        Frame format:
+ *        | Base timestamp (4 bytes) | Offset (2 bytes) | Size (1 byte) | Data | ... |
+ *        The offset is the number of seconds elapsed since the base timestamp.
+ *
+ * \param [OUT] buffer     Frame buffer
+ * \param [IN]  maxSize    Maximum frame size
+ * \param [OUT] nbRecords  Number of records packed into the frame
+ *
+ * \retval size Frame size. 0 when no record fits.
+ */
+uint8_t TelemetryStorePack( uint8_t *buffer, uint8_t maxSize, uint16_t *nbRecords );
+
+/*!
+ * \brief Removes the given number of oldest records from the store.
+ *
+ * \remark The ring header is only written every
+ *         \ref TELEMETRY_STORE_RELEASE_BATCH_SIZE records and when the
+ *         store becomes empty.
+ *
+ * \param [IN] nbRecords Number of records to be released
+ */
+void TelemetryStoreRelease( uint16_t nbRecords );
+
+/*!
+ * \brief Sends the backlog when the network is available.
+ *
+ *        Sends one maximally packed frame at a time. When ADR is on the
+ *        network manages the datarate. Otherwise the frames are sent at the
+ *        highest datarate the link margin estimate supports, and never below
+ *        the current datarate. When the MAC reports a duty-cycle restriction
+ *        no new attempt is made before the requested wait time has elapsed.
+ *
+ * \remark This function must be called in the main loop.
+ *
+ * \param [IN] isTxConfirmed Indicates if the backfill uplinks require an acknowledgement
+ *
+ * \retval status [true: a backfill frame has been scheduled, false: nothing sent]
+ */
+bool TelemetryStoreProcess( LmHandlerMsgTypes_t isTxConfirmed );
+
+/*!
+ * \brief Gets the store statistics
+ *
+ * \retval stats Pointer to the statistics
+ */
+const TelemetryStoreStats_t* TelemetryStoreGetStats( void );
+
+/* \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TELEMETRY_STORE_H__
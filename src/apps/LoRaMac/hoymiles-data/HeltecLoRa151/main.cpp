@@ -14,6 +14,7 @@
 #include "LmhpCompliance.h"
 #include "CayenneLpp.h"
 #include "NvmDataMgmt.h"
+#include "TelemetryStore.h"
 
 
 #define ACTIVE_REGION                               LORAMAC_REGION_EU868
@@ -195,7 +196,9 @@ static void OnRxData (LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
     switch (appData->Port) {
         case 1: // The application LED can be controlled on port 1 or 2
         case LORAWAN_APP_PORT: {
-                AppLedStateOn = appData->Buffer[0] & 0x01;
+                if (appData->BufferSize > 0) {
+                    AppLedStateOn = appData->Buffer[0] & 0x01;
+                }
             }
             break;
         default:
@@ -246,10 +249,6 @@ static void OnSysTimeUpdate (bool isSynchronized, int32_t timeCorrection)
 
 static void PrepareTxFrame (void)
 {
-    if (LmHandlerIsBusy() == true) {
-        return;
-    }
-
     uint8_t channel = 0;
 
     AppData.Port = LORAWAN_APP_PORT;
@@ -262,11 +261,20 @@ static void PrepareTxFrame (void)
     CayenneLppCopy(AppData.Buffer);
     AppData.BufferSize = CayenneLppGetSize();
 
-    if (LmHandlerSend(&AppData, LmHandlerParams.IsTxConfirmed) == LORAMAC_HANDLER_SUCCESS) {
-        // Switch LED 1 ON
-        GpioWrite(&Led1, 1);
-        TimerStart(&Led1Timer);
+    // Send live data only when no backlog is pending in order to keep the records ordering.
+    // The LmHandler uplink queue sends it as soon as the MAC is idle and replaces
+    // a not yet sent measurement with this fresher one.
+    if ((TelemetryStoreGetCount() == 0) && (LmHandlerJoinStatus() == LORAMAC_HANDLER_SET)) {
+        if (LmHandlerSendQueued(&AppData, LmHandlerParams.IsTxConfirmed, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY) == LORAMAC_HANDLER_SUCCESS) {
+            // Switch LED 1 ON
+            GpioWrite(&Led1, 1);
+            TimerStart(&Led1Timer);
+            return;
+        }
     }
+
+    // Network not available. Keep the measurement, it is sent back by TelemetryStoreProcess
+    TelemetryStorePush(AppData.Buffer, AppData.BufferSize);
 }
 
 static void StartTxProcess (LmHandlerTxEvents_t txEvent)
@@ -299,6 +307,13 @@ static void UplinkProcess (void)
     if (isPending == 1) {
         PrepareTxFrame();
     }
+
+    // Send the backlog accumulated during a coverage loss
+    if (TelemetryStoreProcess(LmHandlerParams.IsTxConfirmed) == true) {
+        // Switch LED 1 ON
+        GpioWrite(&Led1, 1);
+        TimerStart(&Led1Timer);
+    }
 }
 
 static void OnTxPeriodicityChanged (uint32_t periodicity)
@@ -388,6 +403,9 @@ int main (void)
     // Set system maximum tolerated rx error in milliseconds
     LmHandlerSetSystemMaxRxError(20);
 
+    // Restore the telemetry backlog from NVM
+    TelemetryStoreInit();
+
     {
 #ifdef __cplusplus
         LmhpComplianceParams.FwVersion.Value                = FIRMWARE_VERSION,
@@ -378,6 +378,7 @@ static void OnRxData( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params )
     {
     case 1: // The application LED can be controlled on port 1 or 2
     case LORAWAN_APP_PORT:
+        if( appData->BufferSize > 0 )
         {
             AppLedStateOn = appData->Buffer[0] & 0x01;
         }
@@ -415,6 +415,30 @@ static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate );
  */
 static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen );
 
+/*!
+ * \brief Computes the room left in the FOpts field once the application
+ *        payload has been placed into the frame.
+ *
+ * \param appDataSize Length of the application payload
+ *
+ * \param datarate Current datarate
+ *
+ * \param capacity [OUT] Available size for the MAC commands in the FOpts field
+ *
+ * \retval [false: the sticky MAC commands do not fit into the FOpts field,
+ *          true: the MAC commands can be piggybacked with the application payload]
+ */
+static bool GetFOptsCapacity( uint8_t appDataSize, int8_t datarate, uint8_t* capacity );
+
+/*!
+ * \brief Computes the FRMPayload offset inside the frame buffer
+ *
+ * \param [IN] fOptsLen Length of the FOpts field.
+ *
+ * \retval Offset of the FRMPayload field.
+ */
+static uint8_t GetFrmPayloadOffset( uint8_t fOptsLen );
+
 /*!
  * \brief Decodes MAC commands in the fOpts field and in the payload
  *
@@ -897,6 +921,7 @@ static void ProcessRadioRxDone( void )
     MacCtx.McpsIndication.Port = 0;
     MacCtx.McpsIndication.Multicast = 0;
     MacCtx.McpsIndication.IsUplinkTxPending = 0;
+    MacCtx.McpsIndication.FramePending = 0;
     MacCtx.McpsIndication.Buffer = NULL;
     MacCtx.McpsIndication.BufferSize = 0;
     MacCtx.McpsIndication.RxData = false;
@@ -915,7 +940,7 @@ static void ProcessRadioRxDone( void )
     }
 
     // This function must be called even if we are not in class b mode yet.
-    if( LoRaMacClassBRxBeacon( payload, size ) == true )
+    if( LoRaMacClassBRxBeacon( payload, size, RxDoneParams.LastRxDone ) == true )
     {
         MacCtx.MlmeIndication.BeaconInfo.Rssi = rssi;
         MacCtx.MlmeIndication.BeaconInfo.Snr = snr;
@@ -1154,8 +1179,9 @@ static void ProcessRadioRxDone( void )
                 }
             }
 
-            // Store device address
+            // Store device address and frame pending bit
             MacCtx.McpsIndication.DevAddress = macMsgData.FHDR.DevAddr;
+            MacCtx.McpsIndication.FramePending = macMsgData.FHDR.FCtrl.Bits.FPending;
 
             FType_t fType;
             if( LORAMAC_STATUS_OK != DetermineFrameType( &macMsgData, &fType ) )
@@ -1261,6 +1287,8 @@ static void ProcessRadioRxDone( void )
             {
                 Nvm.MacGroup1.AdrAckCounter = 0;
                 Nvm.MacGroup2.DownlinkReceived = true;
+
+                LoRaMacAdrLinkMarginAddRxMetrics( rssi, snr );
             }
 
             // MCPS Indication and ack requested handling
@@ -2135,16 +2163,14 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass )
 
 static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
+    // Called for every uplink, read the region table directly
+    const RegionPhyParams_t* phy = RegionGetPhyParams( Nvm.MacGroup2.Region );
 
-    // Setup PHY request
-    getPhy.UplinkDwellTime = Nvm.MacGroup2.MacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
-    phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
-
-    return phyParam.Value;
+    if( phy == NULL )
+    {
+        return 0;
+    }
+    return phy->MaxPayload[( Nvm.MacGroup2.MacParams.UplinkDwellTime == 0 ) ? 0 : 1][datarate];
 }
 
 static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
@@ -2165,6 +2191,31 @@ static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsL
     return false;
 }
 
+static bool GetFOptsCapacity( uint8_t appDataSize, int8_t datarate, uint8_t* capacity )
+{
+    uint8_t maxN = GetMaxAppPayloadWithoutFOptsLength( datarate );
+    size_t stickyCmdsSize = 0;
+
+    *capacity = 0;
+    if( appDataSize < maxN )
+    {
+        *capacity = MIN( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH, maxN - appDataSize );
+    }
+
+    if( LoRaMacCommandsGetSizeStickyCmds( &stickyCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return false;
+    }
+    // The sticky MAC commands must not be dropped
+    return ( stickyCmdsSize <= *capacity );
+}
+
+static uint8_t GetFrmPayloadOffset( uint8_t fOptsLen )
+{
+    return LORAMAC_MHDR_FIELD_SIZE + LORAMAC_FHDR_DEV_ADDR_FIELD_SIZE + LORAMAC_FHDR_F_CTRL_FIELD_SIZE +
+           LORAMAC_FHDR_F_CNT_FIELD_SIZE + fOptsLen + LORAMAC_F_PORT_FIELD_SIZE;
+}
+
 static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t commandsSize, int8_t snr, LoRaMacRxSlot_t rxSlot )
 {
     uint8_t status = 0;
@@ -2206,11 +2257,19 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
             }
             case SRV_MAC_LINK_CHECK_ANS:
             {
+                GetPhyParams_t getPhy;
+                PhyParam_t phyParam;
+
                 if( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == true )
                 {
                     LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
                     MacCtx.MlmeConfirm.DemodMargin = payload[macIndex++];
                     MacCtx.MlmeConfirm.NbGateways = payload[macIndex++];
+
+                    getPhy.Attribute = PHY_MIN_TX_DR;
+                    getPhy.UplinkDwellTime = Nvm.MacGroup2.MacParams.UplinkDwellTime;
+                    phyParam = RegionGetPhyParam( Nvm.MacGroup2.Region, &getPhy );
+                    LoRaMacAdrLinkMarginAddDemodMargin( MacCtx.MlmeConfirm.DemodMargin, Nvm.MacGroup1.ChannelsDatarate, phyParam.Value );
                 }
                 break;
             }
@@ -2906,16 +2965,13 @@ static void ComputeRxWindowParameters( void )
 
 static LoRaMacStatus_t VerifyTxFrame( void )
 {
-    size_t macCmdsSize = 0;
-
-    if( Nvm.MacGroup2.NetworkActivation != ACTIVATION_TYPE_NONE )
+    if( ( Nvm.MacGroup2.NetworkActivation != ACTIVATION_TYPE_NONE ) &&
+        ( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_DATA ) )
     {
-        if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
-        {
-            return LORAMAC_STATUS_MAC_COMMAD_ERROR;
-        }
-
-        if( ValidatePayloadLength( MacCtx.AppDataSize, Nvm.MacGroup1.ChannelsDatarate, macCmdsSize ) == false )
+        // Only the MAC commands serialized into the frame are accounted,
+        // the remaining ones stay queued for the next frames.
+        if( ValidatePayloadLength( MacCtx.TxMsg.Message.Data.FRMPayloadSize, Nvm.MacGroup1.ChannelsDatarate,
+                                   MacCtx.TxMsg.Message.Data.FHDR.FCtrl.Bits.FOptsLen ) == false )
         {
             return LORAMAC_STATUS_LENGTH_ERROR;
         }
@@ -3123,6 +3179,10 @@ static void RemoveMacCommands( LoRaMacRxSlot_t rxSlot, LoRaMacFrameCtrl_t fCtrl,
 {
     if( rxSlot == RX_SLOT_WIN_1 || rxSlot == RX_SLOT_WIN_2  )
     {
+        // Remove the none sticky answers which did not fit into the previous
+        // frames. The answers of the new downlink replace them.
+        LoRaMacCommandsRemoveNoneStickyAnsCmds( );
+
         // Remove all sticky MAC commands answers since we can assume
         // that they have been received by the server.
         if( request == MCPS_CONFIRMED )
@@ -3298,13 +3358,24 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
     uint32_t fCntUp = 0;
     size_t macCmdsSize = 0;
     uint8_t availableSize = 0;
+    uint8_t fOptsCapacity = 0;
+    uint8_t* frmPayload = NULL;
+    bool isAppDataReserved = false;
 
     if( fBuffer == NULL )
     {
         fBufferSize = 0;
     }
 
-    memcpy1( MacCtx.AppData, ( uint8_t* ) fBuffer, fBufferSize );
+    // Check if the payload has been written in place. Refer to LoRaMacReserveAppData
+    if( LoRaMacIsAppDataReserved( ( uint8_t* ) fBuffer ) == true )
+    {
+        isAppDataReserved = true;
+    }
+    else
+    {
+        memcpy1( MacCtx.AppData, ( uint8_t* ) fBuffer, fBufferSize );
+    }
     MacCtx.AppDataSize = fBufferSize;
     MacCtx.PktBuffer[0] = macHdr->Value;
 
@@ -3345,10 +3416,12 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
             {
                 availableSize = GetMaxAppPayloadWithoutFOptsLength( Nvm.MacGroup1.ChannelsDatarate );
 
-                // There is application payload available and the MAC commands fit into FOpts field.
-                if( ( MacCtx.AppDataSize > 0 ) && ( macCmdsSize <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH ) )
+                // There is application payload available and the MAC commands, at least the sticky ones, fit
+                // into the room left in the FOpts field. The remaining MAC commands are sent with the next frames.
+                if( ( MacCtx.AppDataSize > 0 ) &&
+                    ( GetFOptsCapacity( MacCtx.AppDataSize, Nvm.MacGroup1.ChannelsDatarate, &fOptsCapacity ) == true ) )
                 {
-                    if( LoRaMacCommandsSerializeCmds( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH, &macCmdsSize, MacCtx.TxMsg.Message.Data.FHDR.FOpts ) != LORAMAC_COMMANDS_SUCCESS )
+                    if( LoRaMacCommandsSerializeCmds( fOptsCapacity, &macCmdsSize, MacCtx.TxMsg.Message.Data.FHDR.FOpts ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
@@ -3356,14 +3429,19 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
                     // Update FCtrl field with new value of FOptionsLength
                     MacCtx.TxMsg.Message.Data.FHDR.FCtrl.Value = fCtrl->Value;
                 }
-                // There is application payload available but the MAC commands does NOT fit into FOpts field.
-                else if( ( MacCtx.AppDataSize > 0 ) && ( macCmdsSize > LORA_MAC_COMMAND_MAX_FOPTS_LENGTH ) )
+                // There is application payload available but the sticky MAC commands do NOT fit into FOpts field.
+                else if( MacCtx.AppDataSize > 0 )
                 {
-
                     if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.MacCommandsBuffer ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
+                    // Send the MAC commands instead of the application payload
+                    MacCtx.AppDataSize = 0;
+                    MacCtx.TxMsg.Message.Data.FPort = 0;
+
+                    MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.MacCommandsBuffer;
+                    MacCtx.TxMsg.Message.Data.FRMPayloadSize = macCmdsSize;
                     return LORAMAC_STATUS_SKIPPED_APP_DATA;
                 }
                 // No application payload available therefore add all mac commands to the FRMPayload.
@@ -3381,6 +3459,20 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
                 }
             }
 
+            if( ( isAppDataReserved == true ) && ( MacCtx.TxMsg.Message.Data.FRMPayload == MacCtx.AppData ) )
+            {
+                frmPayload = MacCtx.PktBuffer + GetFrmPayloadOffset( fCtrl->Bits.FOptsLen );
+                if( ( uint8_t* ) fBuffer == frmPayload )
+                {
+                    // The payload is already at its final location
+                    MacCtx.TxMsg.Message.Data.FRMPayload = frmPayload;
+                }
+                else
+                {
+                    // The FOpts length has changed since the reservation
+                    memcpy1( MacCtx.AppData, ( uint8_t* ) fBuffer, fBufferSize );
+                }
+            }
             break;
         case FRAME_TYPE_PROPRIETARY:
             if( ( fBuffer != NULL ) && ( MacCtx.AppDataSize > 0 ) )
@@ -3520,6 +3612,14 @@ LoRaMacStatus_t RestoreNvmData( LoRaMacNvmData_t* nvm )
         MacCtx.RxWindowCConfig.RxContinuous = true;
         MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
 
+        // The restored contexts hold the region
+        if( RegionSelect( Nvm.MacGroup2.Region ) == false )
+        {
+            return LORAMAC_STATUS_REGION_NOT_SUPPORTED;
+        }
+        // The bands credit model depends on the restored join and duty cycle states
+        RegionResetBandsCtx( );
+
         // The public/private network flag may change upon reloading MacGroup2
         // from NVM and we thus need to synchronize the radio. The same function
         // is invoked in LoRaMacInitialization.
@@ -3768,8 +3868,8 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     {
         return LORAMAC_STATUS_PARAMETER_INVALID;
     }
-    // Verify if the region is supported
-    if( RegionIsActive( region ) == false )
+    // Verify if the region is supported and select it
+    if( RegionSelect( region ) == false )
     {
         return LORAMAC_STATUS_REGION_NOT_SUPPORTED;
     }
@@ -3794,6 +3894,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     params.NvmGroup2 = &Nvm.RegionGroup2;
     params.Bands = &RegionBands;
     RegionInitDefaults( Nvm.MacGroup2.Region, &params );
+    RegionResetBandsCtx( );
 
     // Reset to defaults
     getPhy.Attribute = PHY_DUTY_CYCLE;
@@ -3937,6 +4038,8 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
     }
 
+    LoRaMacAdrLinkMarginReset( );
+
     // Set multicast downlink counter reference
     if( LoRaMacCryptoSetMulticastReference( Nvm.MacGroup2.MulticastChannelList ) != LORAMAC_CRYPTO_SUCCESS )
     {
@@ -3987,6 +4090,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     int8_t txPower = Nvm.MacGroup2.ChannelsTxPowerDefault;
     uint8_t nbTrans = MacCtx.ChannelsNbTransCounter;
     size_t macCmdsSize = 0;
+    size_t stickyCmdsSize = 0;
 
     if( txInfo == NULL )
     {
@@ -4011,7 +4115,8 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
 
     txInfo->CurrentPossiblePayloadSize = GetMaxAppPayloadWithoutFOptsLength( datarate );
 
-    if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    if( ( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS ) ||
+        ( LoRaMacCommandsGetSizeStickyCmds( &stickyCmdsSize ) != LORAMAC_COMMANDS_SUCCESS ) )
     {
         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
     }
@@ -4020,22 +4125,175 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     if( ( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH >= macCmdsSize ) && ( txInfo->CurrentPossiblePayloadSize >= macCmdsSize ) )
     {
         txInfo->MaxPossibleApplicationDataSize = txInfo->CurrentPossiblePayloadSize - macCmdsSize;
-
-        // Verify if the application data together with MAC command fit into the maximum payload.
-        if( txInfo->CurrentPossiblePayloadSize >= ( macCmdsSize + size ) )
-        {
-            return LORAMAC_STATUS_OK;
-        }
-        else
-        {
-           return LORAMAC_STATUS_LENGTH_ERROR;
-        }
+    }
+    // Otherwise verify if at least the sticky MAC commands can be piggybacked. Refer to PrepareFrame.
+    else if( ( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH >= stickyCmdsSize ) && ( txInfo->CurrentPossiblePayloadSize >= stickyCmdsSize ) )
+    {
+        txInfo->MaxPossibleApplicationDataSize = txInfo->CurrentPossiblePayloadSize - stickyCmdsSize;
     }
     else
     {
         txInfo->MaxPossibleApplicationDataSize = 0;
         return LORAMAC_STATUS_LENGTH_ERROR;
     }
+
+    // Verify if the application data together with the sticky MAC commands fit into the maximum payload.
+    if( txInfo->CurrentPossiblePayloadSize >= ( stickyCmdsSize + size ) )
+    {
+        return LORAMAC_STATUS_OK;
+    }
+    else
+    {
+       return LORAMAC_STATUS_LENGTH_ERROR;
+    }
+}
+
+LoRaMacStatus_t LoRaMacQueryTxOpportunity( uint8_t size, int8_t datarate, LoRaMacTxOpportunity_t* txOpportunity )
+{
+    NextChanParams_t nextChan;
+    VerifyParams_t verify;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    TimerTime_t timeToWait = 0;
+    TimerTime_t txTimeOnAir = 0;
+    size_t macCmdsSize = 0;
+    size_t stickyCmdsSize = 0;
+    size_t fOptsLen = 0;
+    uint8_t maxPayload = 0;
+
+    if( txOpportunity == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( LoRaMacIsBusy( ) == true )
+    {
+        // A transmission or its reception windows are ongoing
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    verify.DatarateParams.Datarate = datarate;
+    verify.DatarateParams.UplinkDwellTime = Nvm.MacGroup2.MacParams.UplinkDwellTime;
+    if( RegionVerify( Nvm.MacGroup2.Region, &verify, PHY_TX_DR ) == false )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    if( ( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS ) ||
+        ( LoRaMacCommandsGetSizeStickyCmds( &stickyCmdsSize ) != LORAMAC_COMMANDS_SUCCESS ) )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+
+    // Same MAC commands handling as LoRaMacQueryTxPossible
+    maxPayload = GetMaxAppPayloadWithoutFOptsLength( datarate );
+    if( ( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH >= macCmdsSize ) && ( maxPayload >= macCmdsSize ) )
+    {
+        fOptsLen = macCmdsSize;
+    }
+    else if( ( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH >= stickyCmdsSize ) && ( maxPayload >= stickyCmdsSize ) )
+    {
+        fOptsLen = stickyCmdsSize;
+    }
+    else
+    {
+        txOpportunity->MaxPossibleApplicationDataSize = 0;
+        return LORAMAC_STATUS_LENGTH_ERROR;
+    }
+    txOpportunity->MaxPossibleApplicationDataSize = maxPayload - fOptsLen;
+
+    if( maxPayload < ( stickyCmdsSize + size ) )
+    {
+        return LORAMAC_STATUS_LENGTH_ERROR;
+    }
+    if( maxPayload < ( fOptsLen + size ) )
+    {
+        // Only the sticky MAC commands are piggybacked. Refer to PrepareFrame.
+        fOptsLen = stickyCmdsSize;
+    }
+
+    // Same parameters as ScheduleTx
+    nextChan.AggrTimeOff = Nvm.MacGroup1.AggregatedTimeOff;
+    if( nextChan.AggrTimeOff == 0 )
+    {
+        // Refer to CalculateBackOff
+        nextChan.AggrTimeOff = MacCtx.TxTimeOnAir * Nvm.MacGroup2.AggregatedDCycle - MacCtx.TxTimeOnAir;
+    }
+    nextChan.Datarate = datarate;
+    nextChan.DutyCycleEnabled = Nvm.MacGroup2.DutyCycleOn;
+    nextChan.ElapsedTimeSinceStartUp = SysTimeSub( SysTimeGetMcuTime( ), Nvm.MacGroup2.InitializationTime );
+    nextChan.LastAggrTx = Nvm.MacGroup1.LastTxDoneTime;
+    nextChan.LastTxIsJoinRequest = false;
+    nextChan.Joined = true;
+    nextChan.PktLen = LORAMAC_FRAME_PAYLOAD_MIN_SIZE + fOptsLen;
+    if( size > 0 )
+    {
+        nextChan.PktLen += LORAMAC_F_PORT_FIELD_SIZE + size;
+    }
+
+    if( Nvm.MacGroup2.NetworkActivation == ACTIVATION_TYPE_NONE )
+    {
+        nextChan.LastTxIsJoinRequest = true;
+        nextChan.Joined = false;
+    }
+
+    status = RegionQueryNextChannel( Nvm.MacGroup2.Region, &nextChan, &timeToWait, &txTimeOnAir );
+    if( ( status != LORAMAC_STATUS_OK ) && ( status != LORAMAC_STATUS_DUTYCYCLE_RESTRICTED ) )
+    {
+        return status;
+    }
+    if( timeToWait == TIMERTIME_T_MAX )
+    {
+        return LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
+    }
+
+    if( LoRaMacClassBIsBeaconModeActive( ) == true )
+    {
+        timeToWait += LoRaMacClassBGetUplinkCollisionDelay( timeToWait, txTimeOnAir );
+    }
+
+    txOpportunity->TimeToWait = timeToWait;
+    txOpportunity->TxTimeOnAir = txTimeOnAir;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacReserveAppData( uint8_t** buffer, uint8_t* maxSize )
+{
+    LoRaMacTxInfo_t txInfo;
+    size_t macCmdsSize = 0;
+    uint8_t fOptsLen = 0;
+
+    if( ( buffer == NULL ) || ( maxSize == NULL ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( LoRaMacIsBusy( ) == true )
+    {
+        // The frame buffer holds the frame being processed
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    // Same FOpts placement rule as PrepareFrame. When the MAC commands
+    // end up truncated differently PrepareFrame falls back to a copy.
+    if( LoRaMacCommandsGetSizePackedCmds( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH, &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+    fOptsLen = macCmdsSize;
+
+    LoRaMacQueryTxPossible( 0, &txInfo );
+
+    *buffer = MacCtx.PktBuffer + GetFrmPayloadOffset( fOptsLen );
+    *maxSize = txInfo.MaxPossibleApplicationDataSize;
+    return LORAMAC_STATUS_OK;
+}
+
+bool LoRaMacIsAppDataReserved( const uint8_t* buffer )
+{
+    if( ( buffer > MacCtx.PktBuffer ) &&
+        ( buffer < ( MacCtx.PktBuffer + LORAMAC_PHY_MAXPAYLOAD ) ) )
+    {
+        return true;
+    }
+    return false;
 }
 
 LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
@@ -1032,6 +1032,11 @@ typedef struct sMcpsIndication
      * Frame pending status
      */
     uint8_t IsUplinkTxPending;
+    /*!
+     * Set if the FPending bit of the received frame is set. For a multicast
+     * frame, the network has more data to send to the group.
+     */
+    uint8_t FramePending;
     /*!
      * Pointer to the received data stream
      */
@@ -2423,6 +2428,27 @@ typedef struct sLoRaMacTxInfo
     uint8_t CurrentPossiblePayloadSize;
 }LoRaMacTxInfo_t;
 
+/*!
+ * LoRaMAC next transmission opportunity
+ */
+typedef struct sLoRaMacTxOpportunity
+{
+    /*!
+     * Time to wait until the transmission is accepted [ms].
+     * 0 if the transmission is accepted now.
+     */
+    TimerTime_t TimeToWait;
+    /*!
+     * Time on air of the transmission [ms].
+     */
+    TimerTime_t TxTimeOnAir;
+    /*!
+     * Size of the application data payload which can be transmitted,
+     * taking the MAC commands into account.
+     */
+    uint8_t MaxPossibleApplicationDataSize;
+}LoRaMacTxOpportunity_t;
+
 /*!
  * LoRaMAC Status
  */
@@ -2690,11 +2716,100 @@ void LoRaMacProcess( void );
  *          if needed it will skip the application data. Please note that if MAC commands do
  *          not fit at all into the payload size on the related datarate, the LoRaMAC will
  *          automatically clip the MAC commands.
+ *          The application data is piggybacked with the MAC commands as long as the
+ *          sticky MAC commands fit into the FOpts field. The other MAC commands which
+ *          do not fit are sent with the next frames, by order of priority. The none
+ *          sticky answers still pending are dropped when a new downlink is received,
+ *          the requests initiated by the end-device are kept.
  *          In case the query is valid, and the LoRaMAC is able to send the frame,
  *          the function returns \ref LORAMAC_STATUS_OK.
  */
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo );
 
+/*!
+ * \brief   Queries the LoRaMAC when a frame with a given application data
+ *          payload size could be sent on a given datarate. The duty cycle,
+ *          the aggregated time-off and the class B beacon reserved time are
+ *          taken into account. The state of the LoRaMAC is not modified.
+ *
+ * \param   [IN] size - Size of application data payload to be send
+ *
+ * \param   [IN] datarate - Datarate of the transmission
+ *
+ * \param   [OUT] txOpportunity - The structure \ref LoRaMacTxOpportunity_t contains
+ *                                the time to wait until the transmission is accepted
+ *                                and the maximum application data payload size.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. When the parameters are
+ *          not valid, the function returns \ref LORAMAC_STATUS_PARAMETER_INVALID.
+ *          When the LoRaMAC is busy, refer to \ref LoRaMacIsBusy, no
+ *          transmission is accepted and the function returns
+ *          \ref LORAMAC_STATUS_BUSY.
+ *          When the application data payload does not fit together with the
+ *          MAC commands, the function returns \ref LORAMAC_STATUS_LENGTH_ERROR.
+ *          When no channel supports the datarate, the function returns
+ *          \ref LORAMAC_STATUS_NO_CHANNEL_FOUND. When the duty cycle never
+ *          allows the transmission, the function returns
+ *          \ref LORAMAC_STATUS_DUTYCYCLE_RESTRICTED. Otherwise the function
+ *          returns \ref LORAMAC_STATUS_OK.
+ */
+LoRaMacStatus_t LoRaMacQueryTxOpportunity( uint8_t size, int8_t datarate, LoRaMacTxOpportunity_t* txOpportunity );
+
+/*!
+ * \brief   Reserves the application payload area of the next uplink inside
+ *          the LoRaMAC frame buffer.
+ *
+ * \details The application writes its payload directly at the FRMPayload
+ *          offset of the frame to be sent and provides the returned pointer
+ *          as fBuffer of the \ref LoRaMacMcpsRequest. The payload is then
+ *          neither copied by the LoRaMAC nor by the serializer and it is
+ *          encrypted in place.
+ *
+ * \code
+ * uint8_t* buffer;
+ * uint8_t maxSize;
+ *
+ * if( LoRaMacReserveAppData( &buffer, &maxSize ) == LORAMAC_STATUS_OK )
+ * {
+ *     buffer[0] = 0x01;
+ *
+ *     mcpsReq.Req.Unconfirmed.fBuffer = buffer;
+ *     mcpsReq.Req.Unconfirmed.fBufferSize = 1;
+ *     LoRaMacMcpsRequest( &mcpsReq );
+ * }
+ * \endcode
+ *
+ * \remark  The reservation is valid until the next MCPS or MLME request.
+ *          Once the frame has been sent the reserved area holds the encrypted
+ *          payload. When the MAC commands to be sent have changed in between
+ *          the payload is copied as for a regular request.
+ *
+ * \param   [OUT] buffer - Pointer to the reserved application payload area.
+ *
+ * \param   [OUT] maxSize - Maximum application payload size, taking the
+ *                          scheduled MAC commands into account.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+ *          \ref LORAMAC_STATUS_MAC_COMMAD_ERROR.
+ */
+LoRaMacStatus_t LoRaMacReserveAppData( uint8_t** buffer, uint8_t* maxSize );
+
+/*!
+ * \brief   Checks if the buffer points into the application payload area
+ *          reserved by \ref LoRaMacReserveAppData.
+ *
+ * \remark  Any request building a frame, an empty one included, overwrites
+ *          the reserved area.
+ *
+ * \param   [IN] buffer - Buffer to be checked.
+ *
+ * \retval  [true: reserved area, false: other buffer]
+ */
+bool LoRaMacIsAppDataReserved( const uint8_t* buffer );
+
 /*!
  * \brief   LoRaMAC channel add service
  *
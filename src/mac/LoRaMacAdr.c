@@ -34,8 +34,85 @@
 #include "region/Region.h"
 #include "LoRaMacAdr.h"
 
+/*!
+ * ADR policy in use
+ */
+static LoRaMacAdrPolicy_t AdrPolicy = LoRaMacAdrDefaultPolicy;
+
+/*!
+ * Link margin estimate
+ */
+static LoRaMacAdrLinkMargin_t LinkMargin;
+
+/*!
+ * \brief Computes the demodulation SNR floor of a datarate
+ *
+ * \param [IN] datarate Datarate
+ *
+ * \param [IN] minTxDatarate Minimum TX datarate of the region
+ *
+ * \retval SNR floor in 1/4 dB
+ */
+static int32_t GetSnrFloor( int8_t datarate, int8_t minTxDatarate )
+{
+    return LORAMAC_ADR_SNR_FLOOR_MIN_DR + ( ( datarate - minTxDatarate ) * LORAMAC_ADR_SNR_FLOOR_DR_STEP );
+}
+
+/*!
+ * \brief Feeds an exponentially weighted moving average
+ *
+ * \param [IN] average Average in 1/256 units
+ *
+ * \param [IN] sample New sample in 1/256 units
+ *
+ * \param [IN] isFirstSample Set to true to initialize the average
+ *
+ * \retval Updated average
+ */
+static int32_t UpdateEwma( int32_t average, int32_t sample, bool isFirstSample )
+{
+    if( isFirstSample == true )
+    {
+        return sample;
+    }
+    return average + ( ( sample - average ) / ( 1 << LORAMAC_ADR_LINK_MARGIN_EWMA_SHIFT ) );
+}
+
+/*!
+ * \brief Verifies if the region allows the given TX datarate
+ *
+ * \param [IN] adrNext ADR parameters
+ *
+ * \param [IN] datarate Datarate to be verified
+ *
+ * \retval Returns true, if the datarate is valid
+ */
+static bool IsTxDatarateValid( CalcNextAdrParams_t* adrNext, int8_t datarate )
+{
+    VerifyParams_t verify;
+
+    verify.DatarateParams.Datarate = datarate;
+    verify.DatarateParams.UplinkDwellTime = adrNext->UplinkDwellTime;
+    return RegionVerify( adrNext->Region, &verify, PHY_TX_DR );
+}
+
+void LoRaMacAdrSetPolicy( LoRaMacAdrPolicy_t policy )
+{
+    if( policy == NULL )
+    {
+        policy = LoRaMacAdrDefaultPolicy;
+    }
+    AdrPolicy = policy;
+}
+
 bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
                          uint8_t* nbTransOut, uint32_t* adrAckCounter )
+{
+    return AdrPolicy( adrNext, drOut, txPowOut, nbTransOut, adrAckCounter );
+}
+
+bool LoRaMacAdrDefaultPolicy( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
+                              uint8_t* nbTransOut, uint32_t* adrAckCounter )
 {
     bool adrAckReq = false;
     int8_t datarate = adrNext->Datarate;
@@ -44,17 +121,15 @@ bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* tx
     int8_t minTxDatarate;
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
+    const RegionPhyParams_t* phy = RegionGetPhyParams( adrNext->Region );
 
     // Report back the adr ack counter
     *adrAckCounter = adrNext->AdrAckCounter;
 
-    if( adrNext->AdrEnabled == true )
+    if( ( adrNext->AdrEnabled == true ) && ( phy != NULL ) )
     {
-        // Query minimum TX Datarate
-        getPhy.Attribute = PHY_MIN_TX_DR;
-        getPhy.UplinkDwellTime = adrNext->UplinkDwellTime;
-        phyParam = RegionGetPhyParam( adrNext->Region, &getPhy );
-        minTxDatarate = phyParam.Value;
+        // Minimum TX Datarate
+        minTxDatarate = phy->MinTxDr[( adrNext->UplinkDwellTime == 0 ) ? 0 : 1];
         datarate = MAX( datarate, minTxDatarate );
 
         // Verify if ADR ack req bit needs to be set.
@@ -67,9 +142,7 @@ bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* tx
         if( adrNext->AdrAckCounter >= ( adrNext->AdrAckLimit + adrNext->AdrAckDelay ) )
         {
             // Set TX Power to default
-            getPhy.Attribute = PHY_DEF_TX_POWER;
-            phyParam = RegionGetPhyParam( adrNext->Region, &getPhy );
-            txPower = phyParam.Value;
+            txPower = phy->DefTxPower;
         }
 
         // Verify, if we need to decrease the data rate
@@ -107,3 +180,128 @@ bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* tx
     *nbTransOut = nbTrans;
     return adrAckReq;
 }
+
+bool LoRaMacAdrLinkMarginPolicy( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
+                                 uint8_t* nbTransOut, uint32_t* adrAckCounter )
+{
+    bool adrAckReq = LoRaMacAdrDefaultPolicy( adrNext, drOut, txPowOut, nbTransOut, adrAckCounter );
+    int8_t datarate = *drOut;
+    int8_t txPower = *txPowOut;
+    int8_t minTxDatarate;
+    int8_t maxTxDatarate;
+    int32_t margin;
+    const RegionPhyParams_t* phy = RegionGetPhyParams( adrNext->Region );
+
+    // Let the stock policy recover the link when the network does not answer anymore
+    if( ( adrNext->AdrEnabled == false ) || ( adrAckReq == true ) || ( phy == NULL ) ||
+        ( LinkMargin.NbSamples < LORAMAC_ADR_LINK_MARGIN_MIN_SAMPLES ) )
+    {
+        return adrAckReq;
+    }
+
+    minTxDatarate = phy->MinTxDr[( adrNext->UplinkDwellTime == 0 ) ? 0 : 1];
+    maxTxDatarate = MIN( phy->MaxTxDr, LORAMAC_ADR_LINK_MARGIN_MAX_DR );
+
+    if( datarate > maxTxDatarate )
+    {
+        // Out of the model range. Keep the settings of the network server
+        return adrAckReq;
+    }
+
+    // Margin left on top of the demodulation floor, the installation margin
+    // and the current TX power reduction. Units are 1/4 dB.
+    margin = ( LinkMargin.Snr / 64 ) - GetSnrFloor( datarate, minTxDatarate ) -
+             ( LORAMAC_ADR_INSTALLATION_MARGIN * 4 ) - ( txPower * LORAMAC_ADR_TX_POWER_STEP );
+
+    // Spend the margin on a faster datarate first, then on a lower TX power
+    while( ( datarate < maxTxDatarate ) && ( margin >= LORAMAC_ADR_SNR_FLOOR_DR_STEP ) &&
+           ( IsTxDatarateValid( adrNext, datarate + 1 ) == true ) )
+    {
+        datarate++;
+        margin -= LORAMAC_ADR_SNR_FLOOR_DR_STEP;
+    }
+    while( ( txPower < phy->MinTxPower ) && ( margin >= LORAMAC_ADR_TX_POWER_STEP ) )
+    {
+        txPower++;
+        margin -= LORAMAC_ADR_TX_POWER_STEP;
+    }
+
+    // Recover a negative margin by restoring the TX power first, then by
+    // lowering the datarate
+    while( ( txPower > phy->MaxTxPower ) && ( margin < 0 ) )
+    {
+        txPower--;
+        margin += LORAMAC_ADR_TX_POWER_STEP;
+    }
+    while( ( datarate > minTxDatarate ) && ( margin < 0 ) &&
+           ( IsTxDatarateValid( adrNext, datarate - 1 ) == true ) )
+    {
+        datarate--;
+        margin += LORAMAC_ADR_SNR_FLOOR_DR_STEP;
+    }
+
+    *drOut = datarate;
+    *txPowOut = txPower;
+    return adrAckReq;
+}
+
+void LoRaMacAdrLinkMarginReset( void )
+{
+    LinkMargin.Snr = 0;
+    LinkMargin.Rssi = 0;
+    LinkMargin.NbSamples = 0;
+}
+
+void LoRaMacAdrLinkMarginAddRxMetrics( int16_t rssi, int8_t snr )
+{
+    LinkMargin.Snr = UpdateEwma( LinkMargin.Snr, ( int32_t )snr * 256, LinkMargin.NbSamples == 0 );
+    // A measured RSSI is always negative
+    LinkMargin.Rssi = UpdateEwma( LinkMargin.Rssi, ( int32_t )rssi * 256, LinkMargin.Rssi == 0 );
+    if( LinkMargin.NbSamples < UINT16_MAX )
+    {
+        LinkMargin.NbSamples++;
+    }
+}
+
+void LoRaMacAdrLinkMarginAddDemodMargin( uint8_t demodMargin, int8_t datarate, int8_t minTxDatarate )
+{
+    // The demodulation margin is relative to the floor of the uplink datarate
+    int32_t snr = ( ( int32_t )demodMargin * 256 ) + ( GetSnrFloor( datarate, minTxDatarate ) * 64 );
+
+    LinkMargin.Snr = UpdateEwma( LinkMargin.Snr, snr, LinkMargin.NbSamples == 0 );
+    if( LinkMargin.NbSamples < UINT16_MAX )
+    {
+        LinkMargin.NbSamples++;
+    }
+}
+
+const LoRaMacAdrLinkMargin_t* LoRaMacAdrGetLinkMargin( void )
+{
+    return &LinkMargin;
+}
+
+int8_t LoRaMacAdrLinkMarginGetMaxDatarate( LoRaMacRegion_t region, int8_t txPower )
+{
+    const RegionPhyParams_t* phy = RegionGetPhyParams( region );
+    int8_t datarate;
+    int8_t maxTxDatarate;
+    int32_t margin;
+
+    if( ( phy == NULL ) || ( LinkMargin.NbSamples < LORAMAC_ADR_LINK_MARGIN_MIN_SAMPLES ) )
+    {
+        return -1;
+    }
+
+    datarate = phy->MinTxDr[0];
+    maxTxDatarate = MIN( phy->MaxTxDr, LORAMAC_ADR_LINK_MARGIN_MAX_DR );
+
+    // Same margin as LoRaMacAdrLinkMarginPolicy, from the minimum datarate up
+    margin = ( LinkMargin.Snr / 64 ) - GetSnrFloor( datarate, datarate ) -
+             ( LORAMAC_ADR_INSTALLATION_MARGIN * 4 ) - ( txPower * LORAMAC_ADR_TX_POWER_STEP );
+    while( ( datarate < maxTxDatarate ) && ( margin >= LORAMAC_ADR_SNR_FLOOR_DR_STEP ) )
+    {
+        datarate++;
+        margin -= LORAMAC_ADR_SNR_FLOOR_DR_STEP;
+    }
+    return datarate;
+}
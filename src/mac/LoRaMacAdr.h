@@ -119,6 +119,161 @@ typedef struct sCalcNextAdrParams
 bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
                          uint8_t* nbTransOut, uint32_t* adrAckCounter );
 
+/*!
+ * Weight of a new sample in the link margin estimator, as a power of 2.
+ * The estimate moves by 1 / 2^LORAMAC_ADR_LINK_MARGIN_EWMA_SHIFT of the error.
+ */
+#ifndef LORAMAC_ADR_LINK_MARGIN_EWMA_SHIFT
+#define LORAMAC_ADR_LINK_MARGIN_EWMA_SHIFT          2
+#endif
+
+/*!
+ * Minimum number of samples before the link margin estimate is used
+ */
+#ifndef LORAMAC_ADR_LINK_MARGIN_MIN_SAMPLES
+#define LORAMAC_ADR_LINK_MARGIN_MIN_SAMPLES         4
+#endif
+
+/*!
+ * Margin in dB kept on top of the demodulation floor by the link margin policy
+ */
+#ifndef LORAMAC_ADR_INSTALLATION_MARGIN
+#define LORAMAC_ADR_INSTALLATION_MARGIN             10
+#endif
+
+/*!
+ * Demodulation SNR floor, in 1/4 dB, at the minimum TX datarate.
+ * Default is SF12. Plans where the minimum TX datarate is SF10 (US915, AU915)
+ * shall use -60.
+ */
+#ifndef LORAMAC_ADR_SNR_FLOOR_MIN_DR
+#define LORAMAC_ADR_SNR_FLOOR_MIN_DR                -80
+#endif
+
+/*!
+ * Demodulation SNR floor increase, in 1/4 dB, per datarate step
+ */
+#ifndef LORAMAC_ADR_SNR_FLOOR_DR_STEP
+#define LORAMAC_ADR_SNR_FLOOR_DR_STEP               10
+#endif
+
+/*!
+ * TX power reduction, in 1/4 dB, per TX power step
+ */
+#ifndef LORAMAC_ADR_TX_POWER_STEP
+#define LORAMAC_ADR_TX_POWER_STEP                   8
+#endif
+
+/*!
+ * Highest datarate the link margin policy may select. The policy is limited to
+ * the LoRa 125 kHz datarates the SNR floor model applies to.
+ */
+#ifndef LORAMAC_ADR_LINK_MARGIN_MAX_DR
+#define LORAMAC_ADR_LINK_MARGIN_MAX_DR              DR_5
+#endif
+
+/*!
+ * ADR policy. Computes the datarate, TX power and NbTrans of the next uplink.
+ * Refer to \ref LoRaMacAdrCalcNext for the parameters.
+ */
+typedef bool ( *LoRaMacAdrPolicy_t )( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
+                                      uint8_t* nbTransOut, uint32_t* adrAckCounter );
+
+/*!
+ * Link margin estimate
+ */
+typedef struct sLoRaMacAdrLinkMargin
+{
+    /*!
+     * Estimated channel SNR in 1/256 dB
+     */
+    int32_t Snr;
+    /*!
+     * Estimated RSSI in 1/256 dBm
+     */
+    int32_t Rssi;
+    /*!
+     * Number of samples fed to the estimator
+     */
+    uint16_t NbSamples;
+}LoRaMacAdrLinkMargin_t;
+
+/*!
+ * \brief Selects the ADR policy used by \ref LoRaMacAdrCalcNext
+ *
+ * \param [IN] policy ADR policy. NULL restores \ref LoRaMacAdrDefaultPolicy
+ */
+void LoRaMacAdrSetPolicy( LoRaMacAdrPolicy_t policy );
+
+/*!
+ * \brief Stock ADR policy. Only backs off the datarate and TX power as the
+ *        ADR ack counter grows. The network server drives the link otherwise.
+ */
+bool LoRaMacAdrDefaultPolicy( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
+                              uint8_t* nbTransOut, uint32_t* adrAckCounter );
+
+/*!
+ * \brief Device side ADR policy. Runs the stock policy and, while the link is
+ *        healthy, spends the estimated link margin above
+ *        \ref LORAMAC_ADR_INSTALLATION_MARGIN on a faster datarate first and a
+ *        lower TX power next. Restores TX power, then lowers the datarate,
+ *        when the margin becomes negative.
+ *
+ * \remark The network server commands given by LinkADRReq are overridden at
+ *         the next uplink. Only use it with network servers not running ADR.
+ */
+bool LoRaMacAdrLinkMarginPolicy( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut,
+                                 uint8_t* nbTransOut, uint32_t* adrAckCounter );
+
+/*!
+ * \brief Resets the link margin estimator
+ */
+void LoRaMacAdrLinkMarginReset( void );
+
+/*!
+ * \brief Feeds the link margin estimator with the radio metrics of a downlink
+ *
+ * \param [IN] rssi Downlink RSSI in dBm
+ *
+ * \param [IN] snr Downlink SNR in dB
+ */
+void LoRaMacAdrLinkMarginAddRxMetrics( int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Feeds the link margin estimator with the uplink demodulation margin
+ *        reported by a LinkCheckAns.
+ *
+ * \param [IN] demodMargin Demodulation margin in dB
+ *
+ * \param [IN] datarate Datarate of the uplink the margin applies to
+ *
+ * \param [IN] minTxDatarate Minimum TX datarate of the region
+ */
+void LoRaMacAdrLinkMarginAddDemodMargin( uint8_t demodMargin, int8_t datarate, int8_t minTxDatarate );
+
+/*!
+ * \brief Gets the link margin estimate
+ *
+ * \retval Pointer to the estimate
+ */
+const LoRaMacAdrLinkMargin_t* LoRaMacAdrGetLinkMargin( void );
+
+/*!
+ * \brief Gets the highest datarate the link margin estimate supports while
+ *        keeping \ref LORAMAC_ADR_INSTALLATION_MARGIN.
+ *
+ * \remark The datarate is limited to \ref LORAMAC_ADR_LINK_MARGIN_MAX_DR. The
+ *         uplink dwell time restrictions are not taken into account.
+ *
+ * \param [IN] region LoRaWAN region
+ *
+ * \param [IN] txPower TX power of the uplink
+ *
+ * \retval Datarate. -1 while the estimate has less than
+ *         \ref LORAMAC_ADR_LINK_MARGIN_MIN_SAMPLES samples.
+ */
+int8_t LoRaMacAdrLinkMarginGetMaxDatarate( LoRaMacRegion_t region, int8_t txPower );
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,224 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 
 #ifdef LORAMAC_CLASSB_ENABLED
 
+/*!
+ * Number of ping offsets computed in one pass. The unicast and all
+ * multicast addresses.
+ */
+#define CLASSB_NB_PING_OFFSETS                      ( 1 + LORAMAC_MAX_MC_CTX )
+
+/*!
+ * Maximum number of entries of the slot schedule.
+ *
+ * \remark The schedule holds the merged slot pattern of the unicast and
+ *         multicast slot sequences. The pattern repeats with the longest
+ *         ping period of the sequences. When it does not fit, the slot times
+ *         are computed on every slot.
+ */
+#ifndef CLASSB_SLOT_SCHEDULE_SIZE
+#define CLASSB_SLOT_SCHEDULE_SIZE                   32
+#endif
+
+/*
+ * Ping offset cache entry
+ */
+typedef struct sPingOffsetCacheEntry
+{
+    /*!
+    * Frame address
+    */
+    uint32_t Address;
+    /*!
+    * Pseudo random value of the ping offset, before the ping period is applied
+    */
+    uint16_t Rand;
+}PingOffsetCacheEntry_t;
+
+/*
+ * Ping offsets of a beacon period
+ */
+typedef struct sPingOffsetCache
+{
+    /*!
+    * Beacon time, GPS time in seconds modulo 2^32
+    */
+    uint32_t BeaconTime;
+    /*!
+    * Number of valid entries
+    */
+    uint8_t NbEntries;
+    /*!
+    * Cache entries
+    */
+    PingOffsetCacheEntry_t Entries[CLASSB_NB_PING_OFFSETS];
+}PingOffsetCache_t;
+
+/*
+ * Slot schedule cursors
+ */
+typedef enum eSlotScheduleCursor
+{
+    /*!
+    * Cursor of the unicast ping slot state machine
+    */
+    SLOT_SCHEDULE_CURSOR_UNICAST,
+    /*!
+    * Cursor of the multicast slot state machine
+    */
+    SLOT_SCHEDULE_CURSOR_MULTICAST,
+    /*!
+    * Number of cursors
+    */
+    SLOT_SCHEDULE_NB_CURSORS,
+}SlotScheduleCursorId_t;
+
+/*
+ * Slot schedule lookup status
+ */
+typedef enum eSlotScheduleStatus
+{
+    /*!
+    * A slot has been found
+    */
+    SLOT_SCHEDULE_FOUND,
+    /*!
+    * No slot left in the current beacon period
+    */
+    SLOT_SCHEDULE_NOT_FOUND,
+    /*!
+    * The slot pattern does not fit into the schedule
+    */
+    SLOT_SCHEDULE_UNAVAILABLE,
+}SlotScheduleStatus_t;
+
+/*
+ * Slot sequence of the unicast or of a multicast address
+ */
+typedef struct sSlotSequence
+{
+    /*!
+    * Frame address
+    */
+    uint32_t Address;
+    /*!
+    * Ping period in slots. 0 if the sequence is not active
+    */
+    uint16_t PingPeriod;
+    /*!
+    * Ping offset in slots
+    */
+    uint16_t PingOffset;
+    /*!
+    * Set to 1, if the FPending bit is set
+    */
+    uint8_t FPendingSet;
+}SlotSequence_t;
+
+/*
+ * Slot schedule entry
+ */
+typedef struct sSlotScheduleEntry
+{
+    /*!
+    * Slot index within the pattern
+    */
+    uint16_t Slot;
+    /*!
+    * Sequence owning the slot. 0 for the unicast, 1 + n for the multicast
+    * channel n
+    */
+    uint8_t Sequence;
+}SlotScheduleEntry_t;
+
+/*
+ * Position of a state machine in the slot schedule
+ */
+typedef struct sSlotScheduleCursor
+{
+    /*!
+    * Pattern repetition within the beacon period
+    */
+    uint16_t Window;
+    /*!
+    * Entry index within the pattern
+    */
+    uint8_t Index;
+}SlotScheduleCursor_t;
+
+/*
+ * Merged slot schedule of a beacon period
+ */
+typedef struct sSlotSchedule
+{
+    /*!
+    * Set to true, once the schedule has been built
+    */
+    bool IsValid;
+    /*!
+    * Beacon time, GPS time in seconds modulo 2^32
+    */
+    uint32_t BeaconTime;
+    /*!
+    * Time of the last beacon reception the schedule is based on
+    */
+    TimerTime_t LastBeaconRx;
+    /*!
+    * Start of the beacon period
+    */
+    TimerTime_t PeriodStart;
+    /*!
+    * Pattern length in slots. 0 if the pattern does not fit
+    */
+    uint16_t PatternLength;
+    /*!
+    * Number of valid entries
+    */
+    uint8_t NbEntries;
+    /*!
+    * Slot sequences. The unicast first, followed by the multicast channels
+    */
+    SlotSequence_t Sequences[CLASSB_NB_PING_OFFSETS];
+    /*!
+    * Slot pattern sorted by slot index. Slots shared by several sequences
+    * are assigned to the sequence with priority
+    */
+    SlotScheduleEntry_t Entries[CLASSB_SLOT_SCHEDULE_SIZE];
+    /*!
+    * Position of the state machines
+    */
+    SlotScheduleCursor_t Cursors[SLOT_SCHEDULE_NB_CURSORS];
+}SlotSchedule_t;
+
+/*
+ * Clock drift estimator fitted from the beacon receptions
+ */
+typedef struct sClockDriftEstimator
+{
+    /*!
+    * Local time of the last beacon reception
+    */
+    TimerTime_t LastRxTime;
+    /*!
+    * Beacon time of the last beacon reception, GPS time in seconds modulo 2^32
+    */
+    uint32_t LastBeaconTime;
+    /*!
+    * Set to 1, if LastRxTime and LastBeaconTime are valid
+    */
+    uint8_t HasReference;
+    /*!
+    * Number of drift measurements
+    */
+    uint8_t NbSamples;
+    /*!
+    * Drift of the local clock in 1/256 ppm. Positive, if the local clock is fast
+    */
+    int32_t Drift;
+    /*!
+    * Mean absolute deviation of the drift measurements in 1/256 ppm
+    */
+    int32_t Deviation;
+}ClockDriftEstimator_t;
 
 /*
  * LoRaMac Class B Context structure
@@ -78,6 +296,19 @@ typedef struct sLoRaMacClassBCtx
     * in class b operation.
     */
     LoRaMacClassBParams_t LoRaMacClassBParams;
+    /*!
+    * Ping offsets of the current beacon period
+    */
+    PingOffsetCache_t PingOffsetCache;
+    /*!
+    * Slot schedule of the current beacon period
+    */
+    SlotSchedule_t SlotSchedule;
+    /*!
+    * Clock drift estimator. Kept when the beacon is lost, as the drift is a
+    * property of the local clock
+    */
+    ClockDriftEstimator_t ClockDrift;
 } LoRaMacClassBCtx_t;
 
 /*!
@@ -115,6 +346,132 @@ static const uint8_t BeaconPrecTimeValue[4] = { 0, 1, 1, 1 };
  */
 static LoRaMacClassBNvmData_t* ClassBNvm;
 
+/*!
+ * Adds an address to the ping offset cache, if it is not yet part of it
+ *
+ * \param [IN]  address         - Frame address
+ */
+static void AddPingOffsetCacheAddress( uint32_t address )
+{
+    for( uint8_t i = 0; i < Ctx.PingOffsetCache.NbEntries; i++ )
+    {
+        if( Ctx.PingOffsetCache.Entries[i].Address == address )
+        {
+            return;
+        }
+    }
+    if( Ctx.PingOffsetCache.NbEntries < CLASSB_NB_PING_OFFSETS )
+    {
+        Ctx.PingOffsetCache.Entries[Ctx.PingOffsetCache.NbEntries++].Address = address;
+    }
+}
+
+/*!
+ * Computes the ping offsets of the given address, of the unicast address
+ * and of all enabled multicast addresses. All the AES blocks are encrypted
+ * in one pass, thus the key is expanded only once per beacon period.
+ *
+ * \param [IN]  beaconTime      - GPS time in seconds modulo 2^32 of the beacon
+ * \param [IN]  address         - Frame address which must be part of the cache
+ */
+static void UpdatePingOffsetCache( uint32_t beaconTime, uint32_t address )
+{
+    uint8_t buffer[CLASSB_NB_PING_OFFSETS * 16];
+    uint8_t cipher[CLASSB_NB_PING_OFFSETS * 16];
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+
+    Ctx.PingOffsetCache.BeaconTime = beaconTime;
+    Ctx.PingOffsetCache.NbEntries = 0;
+
+    AddPingOffsetCacheAddress( address );
+    AddPingOffsetCacheAddress( *Ctx.LoRaMacClassBParams.LoRaMacDevAddr );
+    for( uint8_t i = 0; ( cur != NULL ) && ( i < LORAMAC_MAX_MC_CTX ); i++ )
+    {
+        if( cur[i].ChannelParams.IsEnabled )
+        {
+            AddPingOffsetCacheAddress( cur[i].ChannelParams.Address );
+        }
+    }
+
+    memset1( buffer, 0, sizeof( buffer ) );
+    memset1( cipher, 0, sizeof( cipher ) );
+
+    for( uint8_t i = 0; i < Ctx.PingOffsetCache.NbEntries; i++ )
+    {
+        uint8_t *block = &buffer[i * 16];
+        uint32_t blockAddress = Ctx.PingOffsetCache.Entries[i].Address;
+
+        /* Refer to chapter 15.2 of the LoRaWAN specification v1.1. The beacon time
+         * GPS time in seconds modulo 2^32
+         */
+        block[0] = ( beaconTime ) & 0xFF;
+        block[1] = ( beaconTime >> 8 ) & 0xFF;
+        block[2] = ( beaconTime >> 16 ) & 0xFF;
+        block[3] = ( beaconTime >> 24 ) & 0xFF;
+
+        block[4] = ( blockAddress ) & 0xFF;
+        block[5] = ( blockAddress >> 8 ) & 0xFF;
+        block[6] = ( blockAddress >> 16 ) & 0xFF;
+        block[7] = ( blockAddress >> 24 ) & 0xFF;
+    }
+
+    SecureElementAesEncrypt( buffer, Ctx.PingOffsetCache.NbEntries * 16, SLOT_RAND_ZERO_KEY, cipher );
+
+    for( uint8_t i = 0; i < Ctx.PingOffsetCache.NbEntries; i++ )
+    {
+        Ctx.PingOffsetCache.Entries[i].Rand = ( ( uint16_t ) cipher[i * 16] ) + ( ( ( uint16_t ) cipher[( i * 16 ) + 1] ) * 256 );
+    }
+}
+
+/*!
+ * Computes the ping offsets of the beacon period when the unicast ping slots
+ * are assigned or when multicast groups are enabled
+ */
+static void PreparePingOffsetCache( void )
+{
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+    bool isNeeded = ( ClassBNvm->PingSlotCtx.Ctrl.Assigned == 1 );
+
+    for( uint8_t i = 0; ( cur != NULL ) && ( i < LORAMAC_MAX_MC_CTX ); i++ )
+    {
+        if( cur[i].ChannelParams.IsEnabled )
+        {
+            isNeeded = true;
+        }
+    }
+
+    if( isNeeded == true )
+    {
+        UpdatePingOffsetCache( Ctx.BeaconCtx.BeaconTime.Seconds, *Ctx.LoRaMacClassBParams.LoRaMacDevAddr );
+    }
+}
+
+/*!
+ * Searches the ping offset of an address in the cache
+ *
+ * \param [IN]  beaconTime      - GPS time in seconds modulo 2^32 of the beacon
+ * \param [IN]  address         - Frame address
+ * \param [OUT] rand            - Pseudo random value of the ping offset
+ *
+ * \retval [true: found, false: not found]
+ */
+static bool FindPingOffsetCacheEntry( uint32_t beaconTime, uint32_t address, uint16_t *rand )
+{
+    if( Ctx.PingOffsetCache.BeaconTime != beaconTime )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < Ctx.PingOffsetCache.NbEntries; i++ )
+    {
+        if( Ctx.PingOffsetCache.Entries[i].Address == address )
+        {
+            *rand = Ctx.PingOffsetCache.Entries[i].Rand;
+            return true;
+        }
+    }
+    return false;
+}
+
 /*!
  * Computes the Ping Offset
  *
@@ -125,32 +482,17 @@ static LoRaMacClassBNvmData_t* ClassBNvm;
  */
 static void ComputePingOffset( uint64_t beaconTime, uint32_t address, uint16_t pingPeriod, uint16_t *pingOffset )
 {
-    uint8_t buffer[16];
-    uint8_t cipher[16];
-    uint32_t result = 0;
-    /* Refer to chapter 15.2 of the LoRaWAN specification v1.1. The beacon time
-     * GPS time in seconds modulo 2^32
-     */
     uint32_t time = ( beaconTime % ( ( ( uint64_t ) 1 ) << 32 ) );
+    uint16_t rand = 0;
 
-    memset1( buffer, 0, 16 );
-    memset1( cipher, 0, 16 );
-
-    buffer[0] = ( time ) & 0xFF;
-    buffer[1] = ( time >> 8 ) & 0xFF;
-    buffer[2] = ( time >> 16 ) & 0xFF;
-    buffer[3] = ( time >> 24 ) & 0xFF;
-
-    buffer[4] = ( address ) & 0xFF;
-    buffer[5] = ( address >> 8 ) & 0xFF;
-    buffer[6] = ( address >> 16 ) & 0xFF;
-    buffer[7] = ( address >> 24 ) & 0xFF;
-
-    SecureElementAesEncrypt( buffer, 16, SLOT_RAND_ZERO_KEY, cipher );
-
-    result = ( ( ( uint32_t ) cipher[0] ) + ( ( ( uint32_t ) cipher[1] ) * 256 ) );
+    // The ping offsets only change with the beacon time
+    if( FindPingOffsetCacheEntry( time, address, &rand ) == false )
+    {
+        UpdatePingOffsetCache( time, address );
+        FindPingOffsetCacheEntry( time, address, &rand );
+    }
 
-    *pingOffset = ( uint16_t )( result % pingPeriod );
+    *pingOffset = ( uint16_t )( rand % pingPeriod );
 }
 
 /*!
@@ -234,6 +576,134 @@ static uint32_t CalcDownlinkChannelAndFrequency( uint32_t devAddr, TimerTime_t b
     return CalcDownlinkFrequency( channel, isBeacon );
 }
 
+/*!
+ * \brief Feeds the clock drift estimator with a beacon reception
+ *
+ * \param [IN] estimator Clock drift estimator
+ * \param [IN] rxTime Local time of the beacon reception
+ * \param [IN] beaconTime Beacon time, GPS time in seconds
+ */
+static void UpdateClockDrift( ClockDriftEstimator_t* estimator, TimerTime_t rxTime, uint32_t beaconTime )
+{
+    uint32_t period = beaconTime - estimator->LastBeaconTime;
+
+    if( ( estimator->HasReference == 1 ) && ( period > 0 ) && ( period <= ( CLASSB_MAX_BEACON_LESS_PERIOD / 1000 ) ) )
+    {
+        // Local time error over the elapsed network time, in 1/256 ppm
+        int32_t error = ( int32_t )( rxTime - estimator->LastRxTime ) - ( int32_t )( period * 1000 );
+        int32_t drift = ( int32_t )( ( ( int64_t )error * 256000 ) / ( int64_t )period );
+
+        if( ( drift <= ( CLASSB_DRIFT_MAX_PPM * 256 ) ) && ( drift >= -( CLASSB_DRIFT_MAX_PPM * 256 ) ) )
+        {
+            if( estimator->NbSamples == 0 )
+            {
+                estimator->Drift = drift;
+                // Start with the resolution of a single measurement
+                estimator->Deviation = ( int32_t )( ( 2 * CLASSB_DRIFT_TIMESTAMP_ERROR * 256000 ) / period );
+            }
+            else
+            {
+                int32_t residual = drift - estimator->Drift;
+
+                estimator->Drift += residual / ( 1 << CLASSB_DRIFT_FILTER_SHIFT );
+                estimator->Deviation += ( ( ( residual < 0 ) ? -residual : residual ) - estimator->Deviation ) / ( 1 << CLASSB_DRIFT_FILTER_SHIFT );
+            }
+            if( estimator->NbSamples < UINT8_MAX )
+            {
+                estimator->NbSamples++;
+            }
+        }
+    }
+    estimator->LastRxTime = rxTime;
+    estimator->LastBeaconTime = beaconTime;
+    estimator->HasReference = 1;
+}
+
+/*!
+ * \brief Verifies if the clock drift estimate may be applied at a given time
+ *
+ * \param [IN] estimator Clock drift estimator
+ * \param [IN] time Local time
+ *
+ * \retval [true: estimate is valid, false: estimate is not valid]
+ */
+static bool IsClockDriftValid( ClockDriftEstimator_t* estimator, TimerTime_t time )
+{
+    return ( estimator->NbSamples >= CLASSB_DRIFT_MIN_SAMPLES ) &&
+           ( ( time - estimator->LastRxTime ) <= CLASSB_MAX_BEACON_LESS_PERIOD );
+}
+
+/*!
+ * \brief Applies the clock drift accumulated since the last beacon reception
+ *
+ * \param [IN] estimator Clock drift estimator
+ * \param [IN] time Local time of an event, based on the network time
+ *
+ * \retval Local time of the event, based on the local clock
+ */
+static TimerTime_t ApplyClockDrift( ClockDriftEstimator_t* estimator, TimerTime_t time )
+{
+    int64_t elapsed = ( int32_t )( time - estimator->LastRxTime );
+
+    return time + ( TimerTime_t )( int32_t )( ( elapsed * estimator->Drift ) / 256000000 );
+}
+
+/*!
+ * \brief Computes the timing error expected for a reception
+ *
+ * \param [IN] estimator Clock drift estimator
+ * \param [IN] time Local time of the reception
+ *
+ * \retval Timing error in ms
+ */
+static uint32_t GetClockDriftError( ClockDriftEstimator_t* estimator, TimerTime_t time )
+{
+    uint64_t elapsed = time - estimator->LastRxTime;
+    uint64_t deviation = ( uint64_t )estimator->Deviation * CLASSB_DRIFT_DEVIATION_FACTOR;
+
+    return CLASSB_DRIFT_TIMESTAMP_ERROR + ( uint32_t )( ( ( elapsed * deviation ) + 255999999 ) / 256000000 );
+}
+
+/*!
+ * \brief Gets the maximum timing error of a reception window
+ *
+ * \param [IN] rxTime Local time of the reception
+ *
+ * \retval Maximum timing error in ms
+ */
+static uint32_t GetMaxRxError( TimerTime_t rxTime )
+{
+    uint32_t maxRxError = Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError;
+
+    if( IsClockDriftValid( &Ctx.ClockDrift, rxTime ) == true )
+    {
+        // The error of the drift estimate replaces the fixed system error
+        maxRxError = GetClockDriftError( &Ctx.ClockDrift, rxTime );
+    }
+
+    // Compare and assign the maximum between the rx error window time
+    // and time precision received from beacon frame format.
+    return MAX( maxRxError, ( uint32_t ) Ctx.BeaconCtx.BeaconTimePrecision.SubSeconds );
+}
+
+/*!
+ * \brief Computes the time offset of an event, compensating the clock
+ *        drift or the temperature
+ *
+ * \param [IN] eventTime Local time of the event, based on the network time
+ * \param [IN] currentTime Current time
+ *
+ * \retval Time offset of the event, based on current time
+ */
+static TimerTime_t CalcCompensatedTimeOffset( TimerTime_t eventTime, TimerTime_t currentTime )
+{
+    if( IsClockDriftValid( &Ctx.ClockDrift, eventTime ) == true )
+    {
+        return ApplyClockDrift( &Ctx.ClockDrift, eventTime ) - currentTime;
+    }
+    return TimerTempCompensation( eventTime - currentTime, Ctx.BeaconCtx.Temperature );
+}
+
 /*!
  * \brief Calculates the correct frequency and opens up the beacon reception window. Please
  *        note that the variable WindowTimeout and WindowOffset will be updated according
@@ -250,22 +720,21 @@ static void CalculateBeaconRxWindowConfig( RxConfigParams_t* rxConfig, uint16_t
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     uint32_t maxRxError = 0;
+    TimerTime_t rxTime = SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx );
 
     rxConfig->WindowTimeout = currentSymbolTimeout;
     rxConfig->WindowOffset = 0;
 
-    if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) || ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 ) )
+    if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) || ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 ) ||
+        ( ( Ctx.BeaconCtx.Ctrl.BeaconMode == 1 ) && ( IsClockDriftValid( &Ctx.ClockDrift, rxTime ) == true ) ) )
     {
-        // Apply the symbol timeout only if we have acquired the beacon
-        // Otherwise, take the window enlargement into account
+        // Apply the symbol timeout only if we have acquired the beacon or if
+        // the clock drift is known. Otherwise, take the window enlargement into account
         // Read beacon datarate
         getPhy.Attribute = PHY_BEACON_CHANNEL_DR;
         phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
 
-        // Compare and assign the maximum between the region specific rx error window time
-        // and time precision received from beacon frame format.
-        maxRxError = MAX( Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
-                          ( uint32_t ) Ctx.BeaconCtx.BeaconTimePrecision.SubSeconds );
+        maxRxError = GetMaxRxError( rxTime );
 
         // Calculate downlink symbols
         RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
@@ -273,6 +742,7 @@ static void CalculateBeaconRxWindowConfig( RxConfigParams_t* rxConfig, uint16_t
                                         Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
                                         maxRxError,
                                         rxConfig );
+        rxConfig->WindowTimeout = MIN( rxConfig->WindowTimeout, CLASSB_BEACON_SYMBOL_TO_EXPANSION_MAX );
     }
 }
 
@@ -362,9 +832,8 @@ static bool CalcNextSlotTime( uint16_t slotOffset, uint16_t pingPeriod, uint16_t
         if( slotTime <= ( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - CLASSB_BEACON_GUARD - CLASSB_PING_SLOT_WINDOW ) )
         {
             // Calculate the relative ping slot time
-            slotTime -= currentTime;
             slotTime -= Radio.GetWakeupTime( );
-            slotTime = TimerTempCompensation( slotTime, Ctx.BeaconCtx.Temperature );
+            slotTime = CalcCompensatedTimeOffset( slotTime, currentTime );
             *timeOffset = slotTime;
             return true;
         }
@@ -382,8 +851,13 @@ static bool CalcNextSlotTime( uint16_t slotOffset, uint16_t pingPeriod, uint16_t
  */
 static uint16_t BeaconCrc( uint8_t *buffer, uint16_t length )
 {
-    // The CRC calculation follows CCITT
-    const uint16_t polynom = 0x1021;
+    // The CRC calculation follows CCITT, polynomial 0x1021, processed one
+    // nibble at a time. Table entry n holds the CRC of the nibble n.
+    static const uint16_t crcTable[16] =
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
     // CRC initial value
     uint16_t crc = 0x0000;
 
@@ -394,11 +868,8 @@ static uint16_t BeaconCrc( uint8_t *buffer, uint16_t length )
 
     for( uint16_t i = 0; i < length; ++i )
     {
-        crc ^= ( uint16_t ) buffer[i] << 8;
-        for( uint16_t j = 0; j < 8; ++j )
-        {
-            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ polynom : ( crc << 1 );
-        }
+        crc = ( crc << 4 ) ^ crcTable[( crc >> 12 ) ^ ( buffer[i] >> 4 )];
+        crc = ( crc << 4 ) ^ crcTable[( crc >> 12 ) ^ ( buffer[i] & 0x0F )];
     }
 
     return crc;
@@ -542,8 +1013,8 @@ static TimerTime_t UpdateBeaconState( LoRaMacEventInfoStatus_t status,
     beaconEventTime = CalcDelayForNextBeacon( currentTime, SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx ) );
     Ctx.BeaconCtx.NextBeaconRx = SysTimeFromMs( currentTime + beaconEventTime );
 
-    // Take temperature compensation into account
-    beaconEventTime = TimerTempCompensation( beaconEventTime, Ctx.BeaconCtx.Temperature );
+    // Take the clock drift or the temperature compensation into account
+    beaconEventTime = CalcCompensatedTimeOffset( currentTime + beaconEventTime, currentTime );
 
     // Move the window
     if( beaconEventTime > windowMovement )
@@ -614,6 +1085,242 @@ static bool CheckSlotPriority( uint32_t currentAddress, uint8_t currentFPendingS
     return false;
 }
 
+/*!
+ * \brief Gets the current parameters of a slot sequence
+ *
+ * \param [IN] sequence Sequence. 0 for the unicast, 1 + n for the multicast channel n
+ * \param [OUT] params Sequence parameters. The ping offset is not set
+ */
+static void GetSlotSequence( uint8_t sequence, SlotSequence_t* params )
+{
+    params->Address = 0;
+    params->PingPeriod = 0;
+    params->PingOffset = 0;
+    params->FPendingSet = 0;
+
+    if( sequence == 0 )
+    {
+        if( ClassBNvm->PingSlotCtx.Ctrl.Assigned == 1 )
+        {
+            params->Address = *Ctx.LoRaMacClassBParams.LoRaMacDevAddr;
+            params->PingPeriod = ClassBNvm->PingSlotCtx.PingPeriod;
+            params->FPendingSet = ClassBNvm->PingSlotCtx.FPendingSet;
+        }
+    }
+    else if( Ctx.LoRaMacClassBParams.MulticastChannels != NULL )
+    {
+        MulticastCtx_t *cur = &Ctx.LoRaMacClassBParams.MulticastChannels[sequence - 1];
+
+        if( cur->ChannelParams.IsEnabled )
+        {
+            params->Address = cur->ChannelParams.Address;
+            params->PingPeriod = cur->PingPeriod;
+            params->FPendingSet = cur->FPendingSet;
+        }
+    }
+}
+
+/*!
+ * \brief Verifies if the slot schedule matches the current beacon period
+ *        and the current slot sequences
+ *
+ * \param [IN] currentTime Current time
+ *
+ * \retval [true: schedule is up to date, false: schedule must be rebuilt]
+ */
+static bool IsSlotScheduleValid( TimerTime_t currentTime )
+{
+    SlotSchedule_t *schedule = &Ctx.SlotSchedule;
+    SlotSequence_t sequence;
+
+    if( ( schedule->IsValid == false ) ||
+        ( schedule->BeaconTime != Ctx.BeaconCtx.BeaconTime.Seconds ) ||
+        ( schedule->LastBeaconRx != SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx ) ) ||
+        ( ( currentTime - schedule->PeriodStart ) >= CLASSB_BEACON_INTERVAL ) )
+    {
+        return false;
+    }
+
+    for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+    {
+        GetSlotSequence( i, &sequence );
+        if( ( sequence.Address != schedule->Sequences[i].Address ) ||
+            ( sequence.PingPeriod != schedule->Sequences[i].PingPeriod ) ||
+            ( sequence.FPendingSet != schedule->Sequences[i].FPendingSet ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Adds a slot to the schedule, keeping it sorted. A slot which is
+ *        already scheduled is assigned to the sequence with priority.
+ *
+ * \param [IN] slot Slot index within the pattern
+ * \param [IN] sequence Sequence owning the slot
+ */
+static void AddSlotScheduleEntry( uint16_t slot, uint8_t sequence )
+{
+    SlotSchedule_t *schedule = &Ctx.SlotSchedule;
+    uint8_t index = schedule->NbEntries;
+
+    while( ( index > 0 ) && ( schedule->Entries[index - 1].Slot > slot ) )
+    {
+        index--;
+    }
+
+    if( ( index > 0 ) && ( schedule->Entries[index - 1].Slot == slot ) )
+    {
+        SlotSequence_t *current = &schedule->Sequences[schedule->Entries[index - 1].Sequence];
+        SlotSequence_t *candidate = &schedule->Sequences[sequence];
+
+        if( CheckSlotPriority( current->Address, current->FPendingSet, ( schedule->Entries[index - 1].Sequence != 0 ) ? 1 : 0,
+                               candidate->Address, candidate->FPendingSet, ( sequence != 0 ) ? 1 : 0 ) == true )
+        {
+            schedule->Entries[index - 1].Sequence = sequence;
+        }
+        return;
+    }
+
+    for( uint8_t i = schedule->NbEntries; i > index; i-- )
+    {
+        schedule->Entries[i] = schedule->Entries[i - 1];
+    }
+    schedule->Entries[index].Slot = slot;
+    schedule->Entries[index].Sequence = sequence;
+    schedule->NbEntries++;
+}
+
+/*!
+ * \brief Builds the slot schedule of the current beacon period
+ *
+ * \param [IN] currentTime Current time
+ */
+static void BuildSlotSchedule( TimerTime_t currentTime )
+{
+    SlotSchedule_t *schedule = &Ctx.SlotSchedule;
+    uint16_t nbSlots = 0;
+    uint16_t slot = 0;
+
+    schedule->IsValid = true;
+    schedule->BeaconTime = Ctx.BeaconCtx.BeaconTime.Seconds;
+    schedule->LastBeaconRx = SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx );
+    // Calculate the point in time of the last beacon even if we missed it
+    schedule->PeriodStart = currentTime - ( ( currentTime - schedule->LastBeaconRx ) % CLASSB_BEACON_INTERVAL );
+    schedule->PatternLength = 0;
+    schedule->NbEntries = 0;
+
+    // The ping periods are powers of two. The merged pattern repeats with the longest one
+    for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+    {
+        GetSlotSequence( i, &schedule->Sequences[i] );
+        if( schedule->Sequences[i].PingPeriod != 0 )
+        {
+            ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds, schedule->Sequences[i].Address,
+                               schedule->Sequences[i].PingPeriod, &schedule->Sequences[i].PingOffset );
+            schedule->PatternLength = MAX( schedule->PatternLength, schedule->Sequences[i].PingPeriod );
+        }
+    }
+
+    for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+    {
+        if( schedule->Sequences[i].PingPeriod != 0 )
+        {
+            nbSlots += schedule->PatternLength / schedule->Sequences[i].PingPeriod;
+        }
+    }
+    if( ( nbSlots == 0 ) || ( nbSlots > CLASSB_SLOT_SCHEDULE_SIZE ) )
+    {
+        schedule->PatternLength = 0;
+        return;
+    }
+
+    for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+    {
+        if( schedule->Sequences[i].PingPeriod != 0 )
+        {
+            for( slot = schedule->Sequences[i].PingOffset; slot < schedule->PatternLength; slot += schedule->Sequences[i].PingPeriod )
+            {
+                AddSlotScheduleEntry( slot, i );
+            }
+        }
+    }
+
+    // Position the cursors at the beginning of the current pattern repetition
+    slot = 0;
+    if( ( currentTime - schedule->PeriodStart ) > CLASSB_BEACON_RESERVED )
+    {
+        slot = ( currentTime - schedule->PeriodStart - CLASSB_BEACON_RESERVED ) / CLASSB_PING_SLOT_WINDOW;
+    }
+    for( uint8_t i = 0; i < SLOT_SCHEDULE_NB_CURSORS; i++ )
+    {
+        schedule->Cursors[i].Window = slot / schedule->PatternLength;
+        schedule->Cursors[i].Index = 0;
+    }
+}
+
+/*!
+ * \brief Gets the next slot of a state machine from the slot schedule.
+ *        The schedule is rebuilt once per beacon period or when a slot
+ *        sequence changes. Otherwise only the cursor is advanced.
+ *
+ * \param [IN] cursorId State machine
+ * \param [OUT] sequence Sequence owning the slot
+ * \param [OUT] timeOffset Time offset of the next slot, based on current time
+ *
+ * \retval Lookup status
+ */
+static SlotScheduleStatus_t GetNextScheduledSlot( SlotScheduleCursorId_t cursorId, uint8_t* sequence, TimerTime_t* timeOffset )
+{
+    SlotSchedule_t *schedule = &Ctx.SlotSchedule;
+    SlotScheduleCursor_t *cursor = &schedule->Cursors[cursorId];
+    SlotScheduleEntry_t *entry = NULL;
+    TimerTime_t slotTime = 0;
+    TimerTime_t currentTime = TimerGetCurrentTime( );
+    bool isUnicast = ( cursorId == SLOT_SCHEDULE_CURSOR_UNICAST );
+
+    if( IsSlotScheduleValid( currentTime ) == false )
+    {
+        BuildSlotSchedule( currentTime );
+    }
+
+    if( schedule->PatternLength == 0 )
+    {
+        return SLOT_SCHEDULE_UNAVAILABLE;
+    }
+
+    while( ( ( uint32_t )cursor->Window * schedule->PatternLength ) < CLASSB_BEACON_WINDOW_SLOTS )
+    {
+        entry = &schedule->Entries[cursor->Index];
+        slotTime = schedule->PeriodStart + CLASSB_BEACON_RESERVED +
+                   ( ( ( TimerTime_t )cursor->Window * schedule->PatternLength ) + entry->Slot ) * CLASSB_PING_SLOT_WINDOW;
+
+        if( ( ( entry->Sequence == 0 ) == isUnicast ) && ( slotTime >= currentTime ) )
+        {
+            if( slotTime > ( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - CLASSB_BEACON_GUARD - CLASSB_PING_SLOT_WINDOW ) )
+            {
+                return SLOT_SCHEDULE_NOT_FOUND;
+            }
+            // Calculate the relative ping slot time
+            slotTime -= Radio.GetWakeupTime( );
+            slotTime = CalcCompensatedTimeOffset( slotTime, currentTime );
+            *timeOffset = slotTime;
+            *sequence = entry->Sequence;
+            return SLOT_SCHEDULE_FOUND;
+        }
+
+        cursor->Index++;
+        if( cursor->Index >= schedule->NbEntries )
+        {
+            cursor->Index = 0;
+            cursor->Window++;
+        }
+    }
+    return SLOT_SCHEDULE_NOT_FOUND;
+}
+
 #endif // LORAMAC_CLASSB_ENABLED
 
 void LoRaMacClassBInit( LoRaMacClassBParams_t *classBParams, LoRaMacClassBCallback_t *callbacks, LoRaMacClassBNvmData_t* nvm )
@@ -755,7 +1462,7 @@ static void LoRaMacClassBProcessBeacon( void )
                         if( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) > now )
                         {
                             // Calculate the time when we expect the next beacon
-                            beaconEventTime = TimerTempCompensation( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - now, Ctx.BeaconCtx.Temperature );
+                            beaconEventTime = CalcCompensatedTimeOffset( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ), now );
 
                             if( ( int32_t ) beaconEventTime > beaconRxConfig.WindowOffset )
                             {
@@ -853,9 +1560,11 @@ static void LoRaMacClassBProcessBeacon( void )
             }
             else
             {
-                // Handle beacon miss
+                // Handle beacon miss. With a valid clock drift estimate, the window
+                // is centered on the predicted beacon and needs no movement.
                 beaconEventTime = UpdateBeaconState( LORAMAC_EVENT_INFO_STATUS_BEACON_LOST,
-                                                     Ctx.BeaconCtx.BeaconWindowMovement, beaconTimestamp );
+                                                     ( IsClockDriftValid( &Ctx.ClockDrift, beaconTimestamp ) == true ) ? 0 : Ctx.BeaconCtx.BeaconWindowMovement,
+                                                     beaconTimestamp );
 
                 // Setup next state
                 Ctx.BeaconState = BEACON_STATE_IDLE;
@@ -901,7 +1610,11 @@ static void LoRaMacClassBProcessBeacon( void )
             {
                 Ctx.BeaconState = BEACON_STATE_GUARD;
                 beaconEventTime -= now;
-                beaconEventTime = TimerTempCompensation( beaconEventTime, Ctx.BeaconCtx.Temperature );
+                if( IsClockDriftValid( &Ctx.ClockDrift, Ctx.BeaconCtx.NextBeaconRxAdjusted ) == false )
+                {
+                    // Otherwise, NextBeaconRxAdjusted includes the clock drift already
+                    beaconEventTime = TimerTempCompensation( beaconEventTime, Ctx.BeaconCtx.Temperature );
+                }
 
                 if( ( int32_t ) beaconEventTime > beaconRxConfig.WindowOffset )
                 {
@@ -986,6 +1699,9 @@ static void LoRaMacClassBProcessPingSlot( void )
     TimerTime_t pingSlotTime = 0;
     uint32_t maxRxError = 0;
     bool slotHasPriority = false;
+    bool slotFound = false;
+    uint8_t sequence = 0;
+    SlotScheduleStatus_t scheduleStatus;
 
     switch( Ctx.PingSlotState )
     {
@@ -1000,16 +1716,25 @@ static void LoRaMacClassBProcessPingSlot( void )
             // Intentional fall through
         case PINGSLOT_STATE_SET_TIMER:
         {
-            if( CalcNextSlotTime( Ctx.PingSlotCtx.PingOffset, ClassBNvm->PingSlotCtx.PingPeriod, ClassBNvm->PingSlotCtx.PingNb, &pingSlotTime ) == true )
+            scheduleStatus = GetNextScheduledSlot( SLOT_SCHEDULE_CURSOR_UNICAST, &sequence, &pingSlotTime );
+            if( scheduleStatus == SLOT_SCHEDULE_UNAVAILABLE )
+            {
+                slotFound = CalcNextSlotTime( Ctx.PingSlotCtx.PingOffset, ClassBNvm->PingSlotCtx.PingPeriod, ClassBNvm->PingSlotCtx.PingNb, &pingSlotTime );
+            }
+            else
+            {
+                slotFound = ( scheduleStatus == SLOT_SCHEDULE_FOUND );
+            }
+
+            if( slotFound == true )
             {
-                if( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 )
+                if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) ||
+                    ( IsClockDriftValid( &Ctx.ClockDrift, TimerGetCurrentTime( ) + pingSlotTime ) == true ) )
                 {
-                    // Compare and assign the maximum between the region specific rx error window time
-                    // and time precision received from beacon frame format.
-                    maxRxError = MAX( Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError ,
-                                      ( uint32_t ) Ctx.BeaconCtx.BeaconTimePrecision.SubSeconds );
+                    maxRxError = GetMaxRxError( TimerGetCurrentTime( ) + pingSlotTime );
 
                     // Compute the symbol timeout. Apply it only, if the beacon is acquired
+                    // or if the clock drift is known.
                     // Otherwise, take the enlargement of the symbols into account.
                     RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
                                                      ClassBNvm->PingSlotCtx.Datarate,
@@ -1127,6 +1852,8 @@ static void LoRaMacClassBProcessMulticastSlot( void )
     uint32_t maxRxError = 0;
     MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
     bool slotHasPriority = false;
+    uint8_t sequence = 0;
+    SlotScheduleStatus_t scheduleStatus;
 
     if( cur == NULL )
     {
@@ -1163,7 +1890,13 @@ static void LoRaMacClassBProcessMulticastSlot( void )
             cur = Ctx.LoRaMacClassBParams.MulticastChannels;
             Ctx.PingSlotCtx.NextMulticastChannel = NULL;
 
-            for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+            scheduleStatus = GetNextScheduledSlot( SLOT_SCHEDULE_CURSOR_MULTICAST, &sequence, &multicastSlotTime );
+            if( scheduleStatus == SLOT_SCHEDULE_FOUND )
+            {
+                Ctx.PingSlotCtx.NextMulticastChannel = &cur[sequence - 1];
+            }
+
+            for( uint8_t i = 0; ( i < LORAMAC_MAX_MC_CTX ) && ( scheduleStatus == SLOT_SCHEDULE_UNAVAILABLE ); i++ )
             {
                 if( cur->ChannelParams.IsEnabled )
                 {
@@ -1184,13 +1917,10 @@ static void LoRaMacClassBProcessMulticastSlot( void )
             // Schedule the next multicast slot
             if( Ctx.PingSlotCtx.NextMulticastChannel != NULL )
             {
-                if( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 )
+                if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) ||
+                    ( IsClockDriftValid( &Ctx.ClockDrift, TimerGetCurrentTime( ) + multicastSlotTime ) == true ) )
                 {
-
-                    // Compare and assign the maximum between the region specific rx error window time
-                    // and time precision received from beacon frame format.
-                    maxRxError = MAX( Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError ,
-                                      ( uint32_t ) Ctx.BeaconCtx.BeaconTimePrecision.SubSeconds );
+                    maxRxError = GetMaxRxError( TimerGetCurrentTime( ) + multicastSlotTime );
 
                     RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
                                                     Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.Params.ClassB.Datarate,
@@ -1299,7 +2029,7 @@ static void LoRaMacClassBProcessMulticastSlot( void )
 }
 #endif // LORAMAC_CLASSB_ENABLED
 
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     GetPhyParams_t getPhy;
@@ -1388,6 +2118,9 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 Ctx.BeaconCtx.LastBeaconRx = Ctx.BeaconCtx.BeaconTime;
                 Ctx.BeaconCtx.LastBeaconRx.Seconds += UNIX_GPS_EPOCH_OFFSET;
 
+                // Measure the local clock drift against the beacon time
+                UpdateClockDrift( &Ctx.ClockDrift, lastRxDone, Ctx.BeaconCtx.BeaconTime.Seconds );
+
                 // Update system time.
                 SysTimeSet( SysTimeAdd( Ctx.BeaconCtx.LastBeaconRx, timeOnAir ) );
 
@@ -1396,6 +2129,9 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 ResetWindowTimeout( );
                 Ctx.BeaconState = BEACON_STATE_LOCKED;
 
+                // Compute the ping offsets of the beacon period before the first slot
+                PreparePingOffsetCache( );
+
                 LoRaMacClassBBeaconTimerEvent( NULL );
             }
         }
@@ -1790,6 +2526,37 @@ TimerTime_t LoRaMacClassBIsUplinkCollision( TimerTime_t txTimeOnAir )
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
+TimerTime_t LoRaMacClassBGetUplinkCollisionDelay( TimerTime_t txDelay, TimerTime_t txTimeOnAir )
+{
+#ifdef LORAMAC_CLASSB_ENABLED
+    TimerTime_t txTime = TimerGetCurrentTime( ) + txDelay;
+    TimerTime_t nextBeacon = SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx );
+    TimerTime_t beaconReserved = 0;
+
+    // Move to the beacon period of the uplink
+    if( txTime >= ( nextBeacon + CLASSB_BEACON_RESERVED ) )
+    {
+        nextBeacon += ( ( ( txTime - nextBeacon - CLASSB_BEACON_RESERVED ) / CLASSB_BEACON_INTERVAL ) + 1 ) * CLASSB_BEACON_INTERVAL;
+    }
+
+    // Same reserved time as LoRaMacClassBIsUplinkCollision
+    beaconReserved = nextBeacon -
+                     CLASSB_BEACON_GUARD -
+                     Ctx.LoRaMacClassBParams.LoRaMacParams->ReceiveDelay1 -
+                     Ctx.LoRaMacClassBParams.LoRaMacParams->ReceiveDelay2 -
+                     txTimeOnAir;
+
+    if( txTime >= beaconReserved )
+    {
+        // Delay the uplink to the end of the beacon reserved time
+        return nextBeacon + CLASSB_BEACON_RESERVED - txTime;
+    }
+    return 0;
+#else
+    return 0;
+#endif // LORAMAC_CLASSB_ENABLED
+}
+
 void LoRaMacClassBStopRxSlots( void )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
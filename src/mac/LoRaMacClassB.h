@@ -354,9 +354,10 @@ void LoRaMacClassBMulticastSlotTimerEvent( void* context );
  *
  * \param [IN] payload Pointer to the payload
  * \param [IN] size Size of the payload
+ * \param [IN] lastRxDone The time of the frame reception
  * \retval [true, if the node has received a beacon; false, if not]
  */
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size );
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone );
 
 /*!
  * \brief The function validates, if the node expects a beacon
@@ -500,6 +501,18 @@ bool LoRaMacClassBBeaconFreqReq( uint32_t frequency );
  */
 TimerTime_t LoRaMacClassBIsUplinkCollision( TimerTime_t txTimeOnAir );
 
+/*!
+ * \brief Computes the delay to add to an uplink in order to avoid the
+ *        beacon reserved time. The class B state is not modified.
+ *
+ * \param [IN] txDelay Time from now to the start of the uplink
+ *
+ * \param [IN] txTimeOnAir TX time on air of the uplink
+ *
+ * \retval Returns the time the uplink has to be delayed additionally
+ */
+TimerTime_t LoRaMacClassBGetUplinkCollisionDelay( TimerTime_t txDelay, TimerTime_t txTimeOnAir );
+
 /*!
  * \brief Stops the timers for the RX slots. This includes the
  *        timers for ping and multicast slots.
@@ -117,6 +117,33 @@ extern "C"
  */
 #define CLASSB_WINDOW_MOVE_EXPANSION_FACTOR         2
 
+/*!
+ * Number of clock drift measurements required before the drift estimate
+ * replaces the temperature compensation and the fixed window enlargements
+ */
+#define CLASSB_DRIFT_MIN_SAMPLES                    3
+
+/*!
+ * Clock drift filter coefficient. Each measurement updates the estimate by
+ * 1 / 2^CLASSB_DRIFT_FILTER_SHIFT of its deviation
+ */
+#define CLASSB_DRIFT_FILTER_SHIFT                   2
+
+/*!
+ * Maximum clock drift in ppm. Larger measurements are discarded
+ */
+#define CLASSB_DRIFT_MAX_PPM                        200
+
+/*!
+ * Timing error of a beacon reception timestamp in ms
+ */
+#define CLASSB_DRIFT_TIMESTAMP_ERROR                2
+
+/*!
+ * Multiple of the mean drift deviation taken as the residual drift error
+ */
+#define CLASSB_DRIFT_DEVIATION_FACTOR               2
+
 #ifdef __cplusplus
 }
 #endif
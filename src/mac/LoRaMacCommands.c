@@ -35,6 +35,16 @@ Maintainer: Miguel Luis ( Semtech ), Daniel Jaeckle ( STACKFORCE ), Johannes Bru
  */
 #define CID_FIELD_SIZE 1
 
+/*!
+ * Number of MAC command serialization priority levels. Refer to GetCmdPriority
+ */
+#define NUM_OF_CMD_PRIORITIES 4
+
+/*!
+ * Number of 32 bits words of the MAC command slots bitmaps
+ */
+#define CMD_SLOTS_BITMAP_SIZE ( ( NUM_OF_MAC_COMMANDS + 31 ) / 32 )
+
 /*!
  *  Mac Commands list structure
  */
@@ -63,6 +73,14 @@ typedef struct sLoRaMacCommandsCtx
      * Buffer to store MAC command elements
      */
     MacCommand_t MacCommandSlots[NUM_OF_MAC_COMMANDS];
+    /*
+     * Bitmap of the allocated MAC command slots
+     */
+    uint32_t UsedSlots[CMD_SLOTS_BITMAP_SIZE];
+    /*
+     * Bitmap of the MAC command slots serialized into the last frame
+     */
+    uint32_t SerializedSlots[CMD_SLOTS_BITMAP_SIZE];
     /*
      * Size of all MAC commands serialized as buffer
      */
@@ -77,23 +95,43 @@ static LoRaMacCommandsCtx_t CommandsCtx;
 /* Memory management functions */
 
 /*!
- * \brief Determines if a MAC command slot is free
+ * \brief Finds the first bit set in a word
+ *
+ * \param[IN]     word           - Word to scan. Must not be 0
+ * \retval                       - Index of the least significant bit set
+ */
+static uint8_t FindFirstSet( uint32_t word )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( word );
+#else
+    uint8_t bit = 0;
+
+    while( ( word & 0x01 ) == 0 )
+    {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/*!
+ * \brief Determines if a MAC command slot is allocated
  *
  * \param[IN]     slot           - Slot to check
  * \retval                       - Status of the operation
  */
-static bool IsSlotFree( const MacCommand_t* slot )
+static bool IsSlotUsed( const MacCommand_t* slot )
 {
-    uint8_t* mem = ( uint8_t* )slot;
+    size_t index = 0;
 
-    for( uint16_t size = 0; size < sizeof( MacCommand_t ); size++ )
+    if( ( slot < CommandsCtx.MacCommandSlots ) || ( slot >= &CommandsCtx.MacCommandSlots[NUM_OF_MAC_COMMANDS] ) )
     {
-        if( mem[size] != 0x00 )
-        {
-            return false;
-        }
+        return false;
     }
-    return true;
+    index = slot - CommandsCtx.MacCommandSlots;
+    return ( CommandsCtx.UsedSlots[index / 32] & ( 1UL << ( index % 32 ) ) ) != 0;
 }
 
 /*!
@@ -103,18 +141,23 @@ static bool IsSlotFree( const MacCommand_t* slot )
  */
 static MacCommand_t* MallocNewMacCommandSlot( void )
 {
-    uint8_t itr = 0;
+    size_t index = 0;
 
-    while( IsSlotFree( ( const MacCommand_t* )&CommandsCtx.MacCommandSlots[itr] ) == false )
+    for( uint8_t word = 0; word < CMD_SLOTS_BITMAP_SIZE; word++ )
     {
-        itr++;
-        if( itr == NUM_OF_MAC_COMMANDS )
+        if( CommandsCtx.UsedSlots[word] != 0xFFFFFFFF )
         {
-            return NULL;
+            index = ( word * 32 ) + FindFirstSet( ~CommandsCtx.UsedSlots[word] );
+            if( index >= NUM_OF_MAC_COMMANDS )
+            {
+                // Unused bits of the last word
+                return NULL;
+            }
+            CommandsCtx.UsedSlots[word] |= 1UL << ( index % 32 );
+            return &CommandsCtx.MacCommandSlots[index];
         }
     }
-
-    return &CommandsCtx.MacCommandSlots[itr];
+    return NULL;
 }
 
 /*!
@@ -126,11 +169,16 @@ static MacCommand_t* MallocNewMacCommandSlot( void )
  */
 static bool FreeMacCommandSlot( MacCommand_t* slot )
 {
-    if( slot == NULL )
+    size_t index = 0;
+
+    if( ( slot == NULL ) || ( IsSlotUsed( slot ) == false ) )
     {
         return false;
     }
 
+    index = slot - CommandsCtx.MacCommandSlots;
+    CommandsCtx.UsedSlots[index / 32] &= ~( 1UL << ( index % 32 ) );
+    CommandsCtx.SerializedSlots[index / 32] &= ~( 1UL << ( index % 32 ) );
     memset1( ( uint8_t* )slot, 0x00, sizeof( MacCommand_t ) );
 
     return true;
@@ -183,8 +231,9 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
         list->Last->Next = element;
     }
 
-    // Update the next point of this entry.
+    // Update the next and previous points of this entry.
     element->Next = NULL;
+    element->Prev = list->Last;
 
     // Update the last entry of the list.
     list->Last = element;
@@ -192,42 +241,6 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
     return true;
 }
 
-/*!
- * \brief Return the previous element in the list.
- *
- * \param[IN]     list           - List
- * \param[IN]     element        - Element where the previous element shall be searched
- * \retval                       - Status of the operation
- */
-static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_t* element )
-{
-    if( ( list == NULL ) || ( element == NULL ) )
-    {
-        return NULL;
-    }
-
-    MacCommand_t* curElement;
-
-    // Start at the head of the list
-    curElement = list->First;
-
-    // When current element is the first of the list, there's no previous element so we can return NULL immediately.
-    if( element != curElement )
-    {
-        // Loop through all elements until the end is reached or the next of current is the current element.
-        while( ( curElement != NULL ) && ( curElement->Next != element ) )
-        {
-            curElement = curElement->Next;
-        }
-    }
-    else
-    {
-        curElement = NULL;
-    }
-
-    return curElement;
-}
-
 /*!
  * \brief Remove an element from the list
  *
@@ -242,8 +255,6 @@ static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
         return false;
     }
 
-    MacCommand_t* PrevElement = LinkedListGetPrevious( list, element );
-
     if( list->First == element )
     {
         list->First = element->Next;
@@ -251,15 +262,21 @@ static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
 
     if( list->Last == element )
     {
-        list->Last = PrevElement;
+        list->Last = element->Prev;
     }
 
-    if( PrevElement != NULL )
+    if( element->Prev != NULL )
     {
-        PrevElement->Next = element->Next;
+        element->Prev->Next = element->Next;
+    }
+
+    if( element->Next != NULL )
+    {
+        element->Next->Prev = element->Prev;
     }
 
     element->Next = NULL;
+    element->Prev = NULL;
 
     return true;
 }
@@ -309,6 +326,186 @@ static bool IsConfirmationRequired( uint8_t cid )
     }
 }
 
+/*
+ * \brief Determines if a MAC command is a request initiated by the end-device
+ *
+ * \param[IN]   cid            - MAC command identifier
+ *
+ * \retval                     - Status of the operation
+ */
+static bool IsDeviceInitiatedReq( uint8_t cid )
+{
+    switch( cid )
+    {
+        case MOTE_MAC_LINK_CHECK_REQ:
+        case MOTE_MAC_DEVICE_TIME_REQ:
+        case MOTE_MAC_PING_SLOT_INFO_REQ:
+        case MOTE_MAC_BEACON_TIMING_REQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * \brief Gets the serialization priority of a MAC command
+ *
+ * \remark Commands requiring a confirmation and sticky answers are repeated
+ *         until a downlink is received. They are serialized first so that they
+ *         are never dropped in favour of a command which can be lost.
+ *
+ * \param[IN]   macCmd         - MAC command
+ *
+ * \retval                     - Priority [0: highest, NUM_OF_CMD_PRIORITIES - 1: lowest]
+ */
+static uint8_t GetCmdPriority( const MacCommand_t* macCmd )
+{
+    if( macCmd->IsConfirmationRequired == true )
+    {
+        return 0;
+    }
+    if( macCmd->IsSticky == true )
+    {
+        return 1;
+    }
+    if( IsDeviceInitiatedReq( macCmd->CID ) == true )
+    {
+        // End-device initiated requests may be issued again by the application
+        return 3;
+    }
+    return 2;
+}
+
+/*
+ * \brief Packs as many MAC commands as possible by order of priority
+ *
+ *        The commands are selected by order of priority. A command which
+ *        doesn't fit doesn't prevent smaller commands from being packed.
+ *        The selected commands are serialized in list order, the answers
+ *        keep the order of the requests.
+ *
+ * \param[IN]   availableSize  - Available size of memory for MAC commands
+ * \param[OUT]  buffer         - Destination data buffer. May be NULL to only compute the size.
+ * \param[OUT]  packedSlots    - Bitmap of the packed MAC command slots. May be NULL.
+ *
+ * \retval                     - Size of the packed MAC commands
+ */
+static size_t PackCmds( size_t availableSize, uint8_t* buffer, uint32_t* packedSlots )
+{
+    MacCommand_t* curElement;
+    uint32_t selectedSlots[CMD_SLOTS_BITMAP_SIZE];
+    size_t size = 0;
+    size_t itr = 0;
+    size_t slot = 0;
+
+    memset1( ( uint8_t* )selectedSlots, 0x00, sizeof( selectedSlots ) );
+
+    for( uint8_t priority = 0; priority < NUM_OF_CMD_PRIORITIES; priority++ )
+    {
+        curElement = CommandsCtx.MacCommandList.First;
+
+        while( curElement != NULL )
+        {
+            if( ( GetCmdPriority( curElement ) == priority ) &&
+                ( ( availableSize - size ) >= ( CID_FIELD_SIZE + curElement->PayloadSize ) ) )
+            {
+                size += CID_FIELD_SIZE + curElement->PayloadSize;
+                slot = curElement - CommandsCtx.MacCommandSlots;
+                selectedSlots[slot / 32] |= 1UL << ( slot % 32 );
+            }
+            curElement = curElement->Next;
+        }
+    }
+
+    if( buffer != NULL )
+    {
+        curElement = CommandsCtx.MacCommandList.First;
+
+        while( curElement != NULL )
+        {
+            slot = curElement - CommandsCtx.MacCommandSlots;
+            if( ( selectedSlots[slot / 32] & ( 1UL << ( slot % 32 ) ) ) != 0 )
+            {
+                buffer[itr] = curElement->CID;
+                memcpy1( &buffer[itr + CID_FIELD_SIZE], curElement->Payload, curElement->PayloadSize );
+                itr += CID_FIELD_SIZE + curElement->PayloadSize;
+            }
+            curElement = curElement->Next;
+        }
+    }
+
+    if( packedSlots != NULL )
+    {
+        memcpy1( ( uint8_t* )packedSlots, ( uint8_t* )selectedSlots, sizeof( selectedSlots ) );
+    }
+    return size;
+}
+
+/*
+ * \brief Determines if a MAC command is none sticky and has been serialized
+ *        into the last frame
+ *
+ * \param[IN]   macCmd         - MAC command
+ *
+ * \retval                     - Status of the operation
+ */
+static bool IsSerializedNoneStickyCmd( const MacCommand_t* macCmd )
+{
+    size_t slot = macCmd - CommandsCtx.MacCommandSlots;
+
+    return ( macCmd->IsSticky == false ) &&
+           ( ( CommandsCtx.SerializedSlots[slot / 32] & ( 1UL << ( slot % 32 ) ) ) != 0 );
+}
+
+/*
+ * \brief Determines if a MAC command is a none sticky answer. The requests
+ *        initiated by the end-device are kept.
+ *
+ * \param[IN]   macCmd         - MAC command
+ *
+ * \retval                     - Status of the operation
+ */
+static bool IsNoneStickyAnsCmd( const MacCommand_t* macCmd )
+{
+    return ( macCmd->IsSticky == false ) && ( IsDeviceInitiatedReq( macCmd->CID ) == false );
+}
+
+/*
+ * \brief Determines if a MAC command is a sticky answer
+ *
+ * \param[IN]   macCmd         - MAC command
+ *
+ * \retval                     - Status of the operation
+ */
+static bool IsStickyAnsCmd( const MacCommand_t* macCmd )
+{
+    return ( macCmd->IsSticky == true ) && ( macCmd->IsConfirmationRequired == false );
+}
+
+/*
+ * \brief Removes all MAC commands matching the given filter in a single pass
+ *
+ * \param[IN]   isToRemove     - Filter returning true for the commands to be removed
+ */
+static void RemoveCmds( bool ( *isToRemove )( const MacCommand_t* macCmd ) )
+{
+    MacCommand_t* curElement = CommandsCtx.MacCommandList.First;
+    MacCommand_t* nextElement;
+
+    while( curElement != NULL )
+    {
+        // Store the next element before removing the current one
+        nextElement = curElement->Next;
+        if( isToRemove( curElement ) == true )
+        {
+            LinkedListRemove( &CommandsCtx.MacCommandList, curElement );
+            CommandsCtx.SerializedCmdsSize -= ( CID_FIELD_SIZE + curElement->PayloadSize );
+            FreeMacCommandSlot( curElement );
+        }
+        curElement = nextElement;
+    }
+}
+
 LoRaMacCommandStatus_t LoRaMacCommandsInit( void )
 {
     // Initialize with default
@@ -360,6 +557,11 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd )
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
 
+    if( IsSlotUsed( macCmd ) == false )
+    {
+        return LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND;
+    }
+
     // Remove the Mac command element from MacCommandList
     if( LinkedListRemove( &CommandsCtx.MacCommandList, macCmd ) == false )
     {
@@ -403,49 +605,21 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetCmd( uint8_t cid, MacCommand_t** macCmd
 
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void )
 {
-    MacCommand_t* curElement;
-    MacCommand_t* nexElement;
+    RemoveCmds( IsSerializedNoneStickyCmd );
 
-    // Start at the head of the list
-    curElement = CommandsCtx.MacCommandList.First;
+    return LORAMAC_COMMANDS_SUCCESS;
+}
 
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        if( curElement->IsSticky == false )
-        {
-            nexElement = curElement->Next;
-            LoRaMacCommandsRemoveCmd( curElement );
-            curElement = nexElement;
-        }
-        else
-        {
-            curElement = curElement->Next;
-        }
-    }
+LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyAnsCmds( void )
+{
+    RemoveCmds( IsNoneStickyAnsCmd );
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
 
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveStickyAnsCmds( void )
 {
-    MacCommand_t* curElement;
-    MacCommand_t* nexElement;
-
-    // Start at the head of the list
-    curElement = CommandsCtx.MacCommandList.First;
-
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        nexElement = curElement->Next;
-        if( ( IsSticky( curElement->CID ) == true ) &&
-            ( IsConfirmationRequired( curElement->CID ) == false ) )
-        {
-            LoRaMacCommandsRemoveCmd( curElement );
-        }
-        curElement = nexElement;
-    }
+    RemoveCmds( IsStickyAnsCmd );
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
@@ -460,45 +634,47 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size )
     return LORAMAC_COMMANDS_SUCCESS;
 }
 
-LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer )
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizeStickyCmds( size_t* size )
 {
     MacCommand_t* curElement = CommandsCtx.MacCommandList.First;
-    MacCommand_t* nextElement;
-    uint8_t itr = 0;
 
-    if( ( buffer == NULL ) || ( effectiveSize == NULL ) )
+    if( size == NULL )
     {
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
 
-    // Loop through all elements which fits into the buffer
+    *size = 0;
     while( curElement != NULL )
     {
-        // If the next MAC command still fits into the buffer, add it.
-        if( ( availableSize - itr ) >= ( CID_FIELD_SIZE + curElement->PayloadSize ) )
+        if( curElement->IsSticky == true )
         {
-            buffer[itr++] = curElement->CID;
-            memcpy1( &buffer[itr], curElement->Payload, curElement->PayloadSize );
-            itr += curElement->PayloadSize;
-        }
-        else
-        {
-            break;
+            *size += CID_FIELD_SIZE + curElement->PayloadSize;
         }
         curElement = curElement->Next;
     }
+    return LORAMAC_COMMANDS_SUCCESS;
+}
 
-    // Remove all commands which do not fit into the buffer
-    while( curElement != NULL )
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizePackedCmds( size_t availableSize, size_t* size )
+{
+    if( size == NULL )
     {
-        // Store the next element before removing the current one
-        nextElement = curElement->Next;
-        LoRaMacCommandsRemoveCmd( curElement );
-        curElement = nextElement;
+        return LORAMAC_COMMANDS_ERROR_NPE;
+    }
+    *size = PackCmds( availableSize, NULL, NULL );
+    return LORAMAC_COMMANDS_SUCCESS;
+}
+
+LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer )
+{
+    if( ( buffer == NULL ) || ( effectiveSize == NULL ) )
+    {
+        return LORAMAC_COMMANDS_ERROR_NPE;
     }
 
-    // Fetch the effective size of the mac commands
-    LoRaMacCommandsGetSizeSerializedCmds( effectiveSize );
+    // Serialize the elements which fit into the buffer by order of priority.
+    // The other ones stay in the list for the next frame.
+    *effectiveSize = PackCmds( availableSize, buffer, CommandsCtx.SerializedSlots );
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
@@ -61,6 +61,10 @@ struct sMacCommand
      *  The pointer to the next MAC Command element in the list
      */
     MacCommand_t* Next;
+    /*!
+     *  The pointer to the previous MAC Command element in the list
+     */
+    MacCommand_t* Prev;
     /*!
      * MAC command identifier
      */
@@ -158,12 +162,24 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd );
 LoRaMacCommandStatus_t LoRaMacCommandsGetCmd( uint8_t cid, MacCommand_t** macCmd );
 
 /*!
- * \brief Remove all none sticky MAC commands.
+ * \brief Remove the none sticky MAC commands serialized by the last call to
+ *        \ref LoRaMacCommandsSerializeCmds. The MAC commands which did not fit
+ *        stay in the list.
  *
  * \retval                     - Status of the operation
  */
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void );
 
+/*!
+ * \brief Remove all none sticky answer MAC commands, serialized or not. To be
+ *        called when a new downlink is processed, the network server repeats
+ *        the requests whose answers have not been received. The requests
+ *        initiated by the end-device are kept.
+ *
+ * \retval                     - Status of the operation
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyAnsCmds( void );
+
 /*!
  * \brief Remove all sticky answer MAC commands.
  *
@@ -180,9 +196,36 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveStickyAnsCmds( void );
  */
 LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size );
 
+/*!
+ * \brief Get size of the sticky MAC commands serialized as buffer.
+ *        These commands are never dropped by \ref LoRaMacCommandsSerializeCmds
+ *        as long as the available size is big enough to hold them.
+ *
+ * \param[out]   size               - Size of the sticky MAC commands
+ *
+ * \retval                     - Status of the operation
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizeStickyCmds( size_t* size );
+
+/*!
+ * \brief Get size of the MAC commands \ref LoRaMacCommandsSerializeCmds
+ *        would serialize into the given available size.
+ *
+ * \param[IN]   availableSize      - Available size of memory for MAC commands
+ * \param[out]  size               - Size of the MAC commands which fit
+ *
+ * \retval                     - Status of the operation
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizePackedCmds( size_t availableSize, size_t* size );
+
 /*!
  * \brief Get as many as possible MAC commands serialized
  *
+ *        The commands are serialized by order of priority: commands requiring
+ *        a confirmation, sticky answers, answers and finally end-device requests.
+ *        The commands which do not fit into the buffer stay in the list and
+ *        are serialized into one of the next frames.
+ *
  * \param[IN]   availableSize      - Available size of memory for MAC commands
  * \param[out]  effectiveSize      - Size of memory which was effectively used for serializing.
  * \param[out]  buffer             - Destination data buffer
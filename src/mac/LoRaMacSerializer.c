@@ -181,7 +181,11 @@ LoRaMacSerializerStatus_t LoRaMacSerializerData( LoRaMacMessageData_t* macMsg )
         macMsg->Buffer[bufItr++] = macMsg->FPort;
     }
 
-    memcpy1( &macMsg->Buffer[bufItr], macMsg->FRMPayload, macMsg->FRMPayloadSize );
+    // Nothing to copy when the payload has been written in place
+    if( macMsg->FRMPayload != &macMsg->Buffer[bufItr] )
+    {
+        memcpy1( &macMsg->Buffer[bufItr], macMsg->FRMPayload, macMsg->FRMPayloadSize );
+    }
     bufItr = bufItr + macMsg->FRMPayloadSize;
 
     macMsg->Buffer[bufItr++] = macMsg->MIC & 0xFF;
@@ -767,8 +767,9 @@ typedef enum eAlternateDrType
 
 /*!
  * Parameter structure for the function RegionNextChannel.
+ * NextChanParams_t is declared in RegionCommon.h.
  */
-typedef struct sNextChanParams
+struct sNextChanParams
 {
     /*!
      * Aggregated time-off time.
@@ -802,7 +803,7 @@ typedef struct sNextChanParams
      * Payload length of the next frame
      */
     uint16_t PktLen;
-}NextChanParams_t;
+};
 
 /*!
  * Parameter structure for the function RegionChannelsAdd.
@@ -849,6 +850,39 @@ typedef struct sRxBeaconSetupParams
     uint32_t Frequency;
 }RxBeaconSetup_t;
 
+/*!
+ * Constant PHY parameters of a region. Gives a direct access to the
+ * attributes queried for every frame instead of \ref RegionGetPhyParam.
+ * The arrays are indexed by the uplink dwell time setting [0: disabled, 1: enabled].
+ */
+typedef struct sRegionPhyParams
+{
+    /*!
+     * Minimum TX datarate.
+     */
+    int8_t MinTxDr[2];
+    /*!
+     * Maximum TX datarate.
+     */
+    int8_t MaxTxDr;
+    /*!
+     * Maximum TX power. Corresponds to the lowest TX power index.
+     */
+    int8_t MaxTxPower;
+    /*!
+     * Minimum TX power. Corresponds to the highest TX power index.
+     */
+    int8_t MinTxPower;
+    /*!
+     * Default TX power.
+     */
+    int8_t DefTxPower;
+    /*!
+     * Maximum payload size per datarate.
+     */
+    const uint8_t* MaxPayload[2];
+}RegionPhyParams_t;
+
 
 
 /*!
@@ -861,6 +895,17 @@ typedef struct sRxBeaconSetupParams
  */
 bool RegionIsActive( LoRaMacRegion_t region );
 
+/*!
+ * \brief Selects the region used by the MAC layer. The functions of the
+ *        selected region are resolved once, the calls for this region are
+ *        dispatched without looking up the region table.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \retval Return true, if the region is supported.
+ */
+bool RegionSelect( LoRaMacRegion_t region );
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -872,6 +917,15 @@ bool RegionIsActive( LoRaMacRegion_t region );
  */
 PhyParam_t RegionGetPhyParam( LoRaMacRegion_t region, GetPhyParams_t* getPhy );
 
+/*!
+ * \brief The function gets the constant PHY parameters of a region.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \retval Returns a pointer to the PHY parameters. NULL, if the region is not active.
+ */
+const RegionPhyParams_t* RegionGetPhyParams( LoRaMacRegion_t region );
+
 /*!
  * \brief Updates the last TX done parameters of the current channel.
  *
@@ -1101,6 +1155,21 @@ int8_t RegionAlternateDr( LoRaMacRegion_t region, int8_t currentDr, AlternateDrT
  */
 LoRaMacStatus_t RegionNextChannel( LoRaMacRegion_t region, NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionQueryNextChannel( LoRaMacRegion_t region, NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
@@ -1152,6 +1221,17 @@ void RegionRxBeaconSetup( LoRaMacRegion_t region, RxBeaconSetup_t* rxBeaconSetup
  */
 Version_t RegionGetVersion( void );
 
+/*!
+ * \brief Resets the credit model context of the bands. The bands are
+ *        synchronized again by the next time-off computation.
+ *        To be called on region initialization and on contexts restore.
+ */
+void RegionResetBandsCtx( void );
+
+#if defined( LORAMAC_SINGLE_REGION )
+#include "RegionSingle.h"
+#endif
+
 /*! \} defgroup REGION */
 
 #ifdef __cplusplus
@@ -208,6 +208,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionAS923PhyParams =
+{
+    .MinTxDr = { AS923_TX_MIN_DATARATE, AS923_DWELL_LIMIT_DATARATE },
+    .MaxTxDr = AS923_TX_MAX_DATARATE,
+    .MaxTxPower = AS923_MAX_TX_POWER,
+    .MinTxPower = AS923_MIN_TX_POWER,
+    .DefTxPower = AS923_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateDwell0AS923, MaxPayloadOfDatarateDwell1AS923 },
+};
+
 // Static functions
 static bool VerifyRfFreq( uint32_t freq )
 {
@@ -271,6 +284,11 @@ PhyParam_t RegionAS923GetPhyParam( GetPhyParams_t* getPhy )
             }
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = AS923_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = AS923_DEFAULT_DATARATE;
@@ -1007,6 +1025,7 @@ LoRaMacStatus_t RegionAS923NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = AS923_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -1059,6 +1078,23 @@ LoRaMacStatus_t RegionAS923NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionAS923QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannels = AS923_JOIN_CHANNELS;
+
+    // Same channels as RegionAS923NextChannel
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = AS923_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, AS923_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionAS923ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     bool drInvalid = false;
@@ -320,6 +320,11 @@ static const int8_t EffectiveRx1DrOffsetDownlinkDwell1AS923[8][8] =
         { DR_7 , DR_6 , DR_5 , DR_4 , DR_3 , DR_2 , DR_7 , DR_7  }, // DR_7
     };
 
+/*!
+ * Constant PHY parameters of the region. Refer to \ref RegionGetPhyParams
+ */
+extern const RegionPhyParams_t RegionAS923PhyParams;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -480,6 +485,19 @@ int8_t RegionAS923AlternateDr( int8_t currentDr, AlternateDrType_t type );
  */
 LoRaMacStatus_t RegionAS923NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionAS923QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
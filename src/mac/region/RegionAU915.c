@@ -46,6 +46,35 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionAU915PhyParams =
+{
+    .MinTxDr = { AU915_TX_MIN_DATARATE, AU915_DWELL_LIMIT_DATARATE },
+    .MaxTxDr = AU915_TX_MAX_DATARATE,
+    .MaxTxPower = AU915_MAX_TX_POWER,
+    .MinTxPower = AU915_MIN_TX_POWER,
+    .DefTxPower = AU915_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateDwell0AU915, MaxPayloadOfDatarateDwell1AU915 },
+};
+
+/*
+ * Channels supporting each datarate. The datarate ranges of the channels are
+ * fixed by the channel plan: 125 kHz channels DR_0 to DR_5, 500 kHz channels DR_6.
+ * No channel supports the remaining datarates.
+ */
+static const uint16_t DrChannelsMaskAU915[AU915_TX_MAX_DATARATE + 1][CHANNELS_MASK_SIZE] =
+{
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_0
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_1
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_2
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_3
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_4
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_5
+    { 0x0000, 0x0000, 0x0000, 0x0000, 0x00FF, 0x0000 }, // DR_6
+};
+
 static bool VerifyRfFreq( uint32_t freq )
 {
     // Check radio driver support
@@ -109,6 +138,11 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
             }
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = AU915_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = AU915_DEFAULT_DATARATE;
@@ -835,6 +869,7 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = AU915_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = ( nextChanParams->Datarate <= AU915_TX_MAX_DATARATE ) ? DrChannelsMaskAU915[nextChanParams->Datarate] : NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -877,12 +912,7 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
             else
             {
                 // Choose the next available channel
-                uint8_t i = 0;
-                while( ( ( RegionNvmGroup1->ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK ) & ( 1 << i ) ) == 0 )
-                {
-                    i++;
-                }
-                *channel = 64 + i;
+                *channel = 64 + RegionCommonFindFirstSetBit( RegionNvmGroup1->ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK );
             }
         }
 
@@ -892,6 +922,23 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionAU915QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+
+    // Same channels as RegionAU915NextChannel. All enabled channels are taken into
+    // account, the remaining channels mask is refilled before it runs empty.
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = AU915_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = ( nextChanParams->Datarate <= AU915_TX_MAX_DATARATE ) ? DrChannelsMaskAU915[nextChanParams->Datarate] : NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, AU915_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionAU915ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     return LORAMAC_STATUS_PARAMETER_INVALID;
@@ -255,6 +255,11 @@ static const uint8_t MaxPayloadOfDatarateDwell0AU915[] = { 51, 51, 51, 115, 242,
  */
 static const uint8_t MaxPayloadOfDatarateDwell1AU915[] = { 0, 0, 11, 53, 125, 242, 242, 0, 53, 129, 242, 242, 242, 242 };
 
+/*!
+ * Constant PHY parameters of the region. Refer to \ref RegionGetPhyParams
+ */
+extern const RegionPhyParams_t RegionAU915PhyParams;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -415,6 +420,19 @@ int8_t RegionAU915AlternateDr( int8_t currentDr, AlternateDrType_t type );
  */
 LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionAU915QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
@@ -35,49 +35,11 @@
 #include "RegionBaseUS.h"
 
 
-/*!
- * \brief Searches for available 125 kHz channels in the given channel mask.
- *
- * \param [IN] currentChannelMaskLeft The remaining channel mask.
- *
- * \param [OUT] findAvailableChannelsIndex List containing the indexes of all available 125 kHz channels.
- *
- * \param [OUT] availableChannels Number of available 125 kHz channels.
- *
- * \retval Status
- */
-static LoRaMacStatus_t FindAvailable125kHzChannels( uint16_t currentChannelMaskLeft,
-                                                    uint8_t* findAvailableChannelsIndex, uint8_t* availableChannels )
-{
-    // Nullpointer check
-    if( findAvailableChannelsIndex == NULL || availableChannels == NULL )
-    {
-        return LORAMAC_STATUS_PARAMETER_INVALID;
-    }
-
-    // Initialize counter
-    *availableChannels = 0;
-    for( uint8_t i = 0; i < 8; i++ )
-    {
-        // Find available channels
-        if( ( currentChannelMaskLeft & ( 1 << i ) ) != 0 )
-        {
-            // Save available channel index
-            findAvailableChannelsIndex[*availableChannels] = i;
-            // Increment counter of available channels if the current channel is available
-            ( *availableChannels )++;
-        }
-    }
-
-    return LORAMAC_STATUS_OK;
-}
-
 LoRaMacStatus_t RegionBaseUSComputeNext125kHzJoinChannel( uint16_t* channelsMaskRemaining,
                                                           uint8_t* groupsCurrentIndex, uint8_t* newChannelIndex )
 {
     uint8_t currentChannelMaskLeftIndex;
     uint16_t currentChannelMaskLeft;
-    uint8_t findAvailableChannelsIndex[8] = { 0 };
     uint8_t availableChannels = 0;
     uint8_t startIndex;
 
@@ -106,15 +68,13 @@ LoRaMacStatus_t RegionBaseUSComputeNext125kHzJoinChannel( uint16_t* channelsMask
         }
 
 
-        if( FindAvailable125kHzChannels( currentChannelMaskLeft, findAvailableChannelsIndex, &availableChannels ) == LORAMAC_STATUS_PARAMETER_INVALID )
-        {
-            return LORAMAC_STATUS_PARAMETER_INVALID;
-        }
+        // Number of available 125 kHz channels of the group
+        availableChannels = RegionCommonCountBits( currentChannelMaskLeft );
 
         if ( availableChannels > 0 )
         {
             // Choose randomly a free channel 125kHz
-            *newChannelIndex = ( startIndex * 8 ) + findAvailableChannelsIndex[randr( 0, ( availableChannels - 1 ) )];
+            *newChannelIndex = ( startIndex * 8 ) + RegionCommonSelectNthSetBit( &currentChannelMaskLeft, 1, randr( 0, ( availableChannels - 1 ) ) );
         }
 
         // Increment start index
@@ -155,6 +155,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionCN470PhyParams =
+{
+    .MinTxDr = { CN470_TX_MIN_DATARATE, CN470_TX_MIN_DATARATE },
+    .MaxTxDr = CN470_TX_MAX_DATARATE,
+    .MaxTxPower = CN470_MAX_TX_POWER,
+    .MinTxPower = CN470_MIN_TX_POWER,
+    .DefTxPower = CN470_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateCN470, MaxPayloadOfDatarateCN470 },
+};
+
 /*
  * Context for the current channel plan.
  */
@@ -307,6 +320,11 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = CN470_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = CN470_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = CN470_DEFAULT_DATARATE;
@@ -960,6 +978,7 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = CN470_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = NULL;
 
     // Apply a different channel selection if the device is not joined yet
     // In this case the device shall not follow the individual channel plans for the
@@ -997,6 +1016,35 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionCN470QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannelsMask[2] = CN470_JOIN_CHANNELS;
+
+    // Same channels as RegionCN470NextChannel. All enabled channels are taken into
+    // account, the remaining channels mask is refilled before it runs empty.
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = CN470_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    // Apply a different channel selection if the device is not joined yet
+    // In this case the device shall not follow the individual channel plans for the
+    // different type, but instead shall follow the common join channel plan.
+    if( nextChanParams->Joined == false )
+    {
+        countChannelsParams.ChannelsMask = joinChannelsMask;
+        countChannelsParams.Channels = CommonJoinChannels;
+        countChannelsParams.MaxNbChannels = CN470_COMMON_JOIN_CHANNELS_SIZE;
+        countChannelsParams.JoinChannels = joinChannelsMask;
+    }
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, CN470_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionCN470ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     return LORAMAC_STATUS_PARAMETER_INVALID;
@@ -252,6 +252,11 @@ static const int8_t DatarateOffsetsCN470[8][6] =
  */
 static const uint8_t MaxPayloadOfDatarateCN470[] = { 0, 23, 86, 184, 242, 242, 242, 242 };
 
+/*!
+ * Constant PHY parameters of the region. Refer to \ref RegionGetPhyParams
+ */
+extern const RegionPhyParams_t RegionCN470PhyParams;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -412,6 +417,19 @@ int8_t RegionCN470AlternateDr( int8_t currentDr, AlternateDrType_t type );
  */
 LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionCN470QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
@@ -42,6 +42,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionCN779PhyParams =
+{
+    .MinTxDr = { CN779_TX_MIN_DATARATE, CN779_TX_MIN_DATARATE },
+    .MaxTxDr = CN779_TX_MAX_DATARATE,
+    .MaxTxPower = CN779_MAX_TX_POWER,
+    .MinTxPower = CN779_MIN_TX_POWER,
+    .DefTxPower = CN779_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateCN779, MaxPayloadOfDatarateCN779 },
+};
+
 // Static functions
 static bool VerifyRfFreq( uint32_t freq )
 {
@@ -91,6 +104,11 @@ PhyParam_t RegionCN779GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = CN779_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = CN779_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = CN779_DEFAULT_DATARATE;
@@ -797,6 +815,7 @@ LoRaMacStatus_t RegionCN779NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = CN779_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -825,6 +844,23 @@ LoRaMacStatus_t RegionCN779NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionCN779QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannels = CN779_JOIN_CHANNELS;
+
+    // Same channels as RegionCN779NextChannel
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = CN779_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, CN779_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionCN779ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     bool drInvalid = false;
@@ -73,6 +73,56 @@
         ( ( N ) / ( D ) )                                                      \
     )
 
+/*!
+ * Credit model context of the bands. The credits of a band only change at
+ * TX done, refer to \ref RegionCommonSetBandTxDone, and when the observation
+ * period elapses. In between, the bands are not synchronized again.
+ */
+typedef struct sRegionCommonBandsCtx
+{
+    /*!
+     * Bands synchronized last
+     */
+    Band_t* Bands;
+    /*!
+     * Number of bands synchronized last
+     */
+    uint8_t NbBands;
+    /*!
+     * Joined state used for the last synchronization
+     */
+    bool Joined;
+    /*!
+     * Duty cycle state used for the last synchronization
+     */
+    bool DutyCycleEnabled;
+    /*!
+     * Observation period used for the last synchronization
+     */
+    TimerTime_t Observation;
+    /*!
+     * Maximum time credits used for the last synchronization
+     */
+    TimerTime_t MaxCredits;
+    /*!
+     * Time of the last synchronization
+     */
+    TimerTime_t SyncTime;
+    /*!
+     * Delay from the last synchronization to the credits refill of each band
+     */
+    TimerTime_t RefillDelay[REGION_NVM_MAX_NB_BANDS];
+    /*!
+     * Delay from the last synchronization to the earliest credits refill
+     */
+    TimerTime_t NextRefillDelay;
+}RegionCommonBandsCtx_t;
+
+/*!
+ * Credit model context of the bands
+ */
+static RegionCommonBandsCtx_t BandsCtx;
+
 static uint16_t GetDutyCycle( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup )
 {
     uint16_t dutyCycle = band->DCycle;
@@ -94,95 +144,147 @@ static uint16_t GetDutyCycle( Band_t* band, bool joined, SysTime_t elapsedTimeSi
     return dutyCycle;
 }
 
-static uint16_t SetMaxTimeCredits( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup,
-                                   bool dutyCycleEnabled, bool lastTxIsJoinRequest )
+static void GetCreditPeriod( bool joined, SysTime_t elapsedTimeSinceStartup,
+                             TimerTime_t* observation, TimerTime_t* maxCredits )
 {
-    uint16_t dutyCycle = band->DCycle;
-    TimerTime_t maxCredits = DUTY_CYCLE_TIME_PERIOD;
-
-    // Get the band duty cycle. If not joined, the function either returns the join duty cycle
-    // or the band duty cycle, whichever is more restrictive.
-    dutyCycle = GetDutyCycle( band, joined, elapsedTimeSinceStartup );
+    *observation = DUTY_CYCLE_TIME_PERIOD;
+    *maxCredits = DUTY_CYCLE_TIME_PERIOD;
 
     if( joined == false )
     {
         if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_1_HOUR_IN_S )
         {
-            maxCredits = DUTY_CYCLE_TIME_PERIOD;
+            *observation = BACKOFF_DUTY_CYCLE_1_HOUR_IN_S * 1000;
         }
         else if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_10_HOURS_IN_S )
         {
-            maxCredits = DUTY_CYCLE_TIME_PERIOD;
+            *observation = ( BACKOFF_DUTY_CYCLE_10_HOURS_IN_S * 1000 );
         }
         else
         {
-            maxCredits = DUTY_CYCLE_TIME_PERIOD_JOIN_BACKOFF_24H;
+            *observation = ( BACKOFF_DUTY_CYCLE_24_HOURS_IN_S * 1000 );
+            *maxCredits = DUTY_CYCLE_TIME_PERIOD_JOIN_BACKOFF_24H;
         }
     }
-    else
+}
+
+static TimerTime_t GetTimeToNextCreditPeriod( bool joined, SysTime_t elapsedTimeSinceStartup )
+{
+    uint32_t periodEnd = 0;
+
+    if( joined == true )
     {
-        if( dutyCycleEnabled == false )
-        {
-            // Assign max credits when the duty cycle is disabled.
-            band->TimeCredits = maxCredits;
-        }
+        return TIMERTIME_T_MAX;
     }
 
-    // Setup the maximum allowed credits. We can assign them
-    // safely all the time.
-    band->MaxTimeCredits = maxCredits;
-
-    return dutyCycle;
+    // Refer to GetCreditPeriod
+    if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_1_HOUR_IN_S )
+    {
+        periodEnd = BACKOFF_DUTY_CYCLE_1_HOUR_IN_S;
+    }
+    else if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_10_HOURS_IN_S )
+    {
+        periodEnd = BACKOFF_DUTY_CYCLE_10_HOURS_IN_S;
+    }
+    else
+    {
+        return TIMERTIME_T_MAX;
+    }
+    return ( ( TimerTime_t )( periodEnd - elapsedTimeSinceStartup.Seconds ) * 1000 ) - elapsedTimeSinceStartup.SubSeconds;
 }
 
-static uint16_t UpdateTimeCredits( Band_t* band, bool joined, bool dutyCycleEnabled,
-                                   bool lastTxIsJoinRequest, SysTime_t elapsedTimeSinceStartup,
-                                   TimerTime_t currentTime, TimerTime_t lastBandUpdateTime )
+static bool IsBandsSyncValid( Band_t* bands, uint8_t nbBands, bool joined, bool dutyCycleEnabled,
+                              TimerTime_t observation, TimerTime_t maxCredits )
 {
-    uint16_t dutyCycle = SetMaxTimeCredits( band, joined, elapsedTimeSinceStartup,
-                                            dutyCycleEnabled, lastTxIsJoinRequest );
-    TimerTime_t observation = DUTY_CYCLE_TIME_PERIOD;
+    if( ( BandsCtx.Bands != bands ) || ( BandsCtx.NbBands != nbBands ) ||
+        ( BandsCtx.Joined != joined ) || ( BandsCtx.DutyCycleEnabled != dutyCycleEnabled ) ||
+        ( BandsCtx.Observation != observation ) || ( BandsCtx.MaxCredits != maxCredits ) ||
+        ( BandsCtx.SyncTime == 0 ) )
+    {
+        return false;
+    }
 
-    if( joined == false )
+    for( uint8_t i = 0; i < nbBands; i++ )
     {
-        if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_1_HOUR_IN_S )
+        if( bands[i].LastBandUpdateTime == 0 )
         {
-            observation = BACKOFF_DUTY_CYCLE_1_HOUR_IN_S * 1000;
+            // The bands have been initialized again
+            return false;
         }
-        else if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_10_HOURS_IN_S )
-        {
-            observation = ( BACKOFF_DUTY_CYCLE_10_HOURS_IN_S * 1000 );
-        }
-        else
+    }
+    return true;
+}
+
+static void SyncBands( Band_t* bands, uint8_t nbBands, bool joined, bool dutyCycleEnabled,
+                       TimerTime_t observation, TimerTime_t maxCredits )
+{
+    TimerTime_t currentTime = TimerGetCurrentTime( );
+
+    BandsCtx.Bands = bands;
+    BandsCtx.NbBands = nbBands;
+    BandsCtx.Joined = joined;
+    BandsCtx.DutyCycleEnabled = dutyCycleEnabled;
+    BandsCtx.Observation = observation;
+    BandsCtx.MaxCredits = maxCredits;
+    BandsCtx.SyncTime = currentTime;
+    BandsCtx.NextRefillDelay = TIMERTIME_T_MAX;
+
+    for( uint8_t i = 0; i < nbBands; i++ )
+    {
+        TimerTime_t elapsedTime = TimerGetElapsedTime( bands[i].LastBandUpdateTime );
+
+        // Setup the maximum allowed credits. We can assign them
+        // safely all the time.
+        bands[i].MaxTimeCredits = maxCredits;
+
+        // Apply new credits only if the observation period has been elapsed.
+        if( ( observation <= elapsedTime ) ||
+            ( bands[i].LastMaxCreditAssignTime != observation ) ||
+            ( bands[i].LastBandUpdateTime == 0 ) )
         {
-            observation = ( BACKOFF_DUTY_CYCLE_24_HOURS_IN_S * 1000 );
+            bands[i].TimeCredits = bands[i].MaxTimeCredits;
+            bands[i].LastBandUpdateTime = currentTime;
+            bands[i].LastMaxCreditAssignTime = observation;
+            elapsedTime = 0;
         }
+        BandsCtx.RefillDelay[i] = observation - elapsedTime;
+        BandsCtx.NextRefillDelay = MIN( BandsCtx.NextRefillDelay, BandsCtx.RefillDelay[i] );
+    }
+}
+
+static TimerTime_t GetBandTimeOff( Band_t* band, bool joined, bool dutyCycleEnabled,
+                                   SysTime_t elapsedTimeSinceStartup, TimerTime_t observation,
+                                   TimerTime_t maxCredits, TimerTime_t expectedTimeOnAir )
+{
+    TimerTime_t creditCosts = expectedTimeOnAir * GetDutyCycle( band, joined, elapsedTimeSinceStartup );
+    TimerTime_t timeCredits = band->TimeCredits;
+    TimerTime_t elapsedTime = TimerGetElapsedTime( band->LastBandUpdateTime );
+
+    if( ( joined == true ) && ( dutyCycleEnabled == false ) )
+    {
+        return 0;
     }
 
-    // Apply new credits only if the observation period has been elapsed.
-    if( ( observation <= lastBandUpdateTime ) ||
+    // Same refill condition as SyncBands. The credits are only evaluated,
+    // they are assigned by the next synchronization.
+    if( ( observation <= elapsedTime ) ||
         ( band->LastMaxCreditAssignTime != observation ) ||
         ( band->LastBandUpdateTime == 0 ) )
     {
-        band->TimeCredits = band->MaxTimeCredits;
-        band->LastBandUpdateTime = currentTime;
-        band->LastMaxCreditAssignTime = observation;
+        timeCredits = maxCredits;
+        elapsedTime = 0;
     }
-    return dutyCycle;
-}
-
-static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
-{
-    uint8_t nbActiveBits = 0;
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+    if( timeCredits > creditCosts )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
-        {
-            nbActiveBits++;
-        }
+        return 0;
+    }
+    if( maxCredits > creditCosts )
+    {
+        // The band is ready again at its next credits refill
+        return observation - elapsedTime;
     }
-    return nbActiveBits;
+    return TIMERTIME_T_MAX;
 }
 
 bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr, int8_t minDr, int8_t maxDr, ChannelParams_t* channels )
@@ -194,16 +296,20 @@ bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_
 
     for( uint8_t i = 0, k = 0; i < nbChannels; i += 16, k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        uint16_t mask = channelsMask[k];
+
+        // Visit the enabled channels only
+        while( mask != 0 )
         {
-            if( ( ( channelsMask[k] & ( 1 << j ) ) != 0 ) )
-            {// Check datarate validity for enabled channels
-                if( RegionCommonValueInRange( dr, ( channels[i + j].DrRange.Fields.Min & 0x0F ),
-                                                  ( channels[i + j].DrRange.Fields.Max & 0x0F ) ) == 1 )
-                {
-                    // At least 1 channel has been found we can return OK.
-                    return true;
-                }
+            uint8_t j = RegionCommonFindFirstSetBit( mask );
+
+            mask &= mask - 1;
+            // Check datarate validity for enabled channels
+            if( RegionCommonValueInRange( dr, ( channels[i + j].DrRange.Fields.Min & 0x0F ),
+                                              ( channels[i + j].DrRange.Fields.Max & 0x0F ) ) == 1 )
+            {
+                // At least 1 channel has been found we can return OK.
+                return true;
             }
         }
     }
@@ -245,12 +351,65 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
 
     for( uint8_t i = startIdx; i < stopIdx; i++ )
     {
-        nbChannels += CountChannels( channelsMask[i], 16 );
+        nbChannels += RegionCommonCountBits( channelsMask[i] );
     }
 
     return nbChannels;
 }
 
+uint8_t RegionCommonCountBits( uint16_t mask )
+{
+    uint32_t bits = mask;
+
+    // Parallel bit count: 2, 4, 8 and 16 bit wide partial sums
+    bits = bits - ( ( bits >> 1 ) & 0x5555 );
+    bits = ( bits & 0x3333 ) + ( ( bits >> 2 ) & 0x3333 );
+    bits = ( bits + ( bits >> 4 ) ) & 0x0F0F;
+    return ( uint8_t )( ( bits + ( bits >> 8 ) ) & 0x1F );
+}
+
+uint8_t RegionCommonFindFirstSetBit( uint16_t mask )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctz( mask );
+#else
+    uint8_t bit = 0;
+
+    while( ( mask & 0x0001 ) == 0 )
+    {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+int16_t RegionCommonSelectNthSetBit( uint16_t* channelsMask, uint8_t nbWords, uint8_t n )
+{
+    if( channelsMask == NULL )
+    {
+        return -1;
+    }
+
+    for( uint8_t k = 0; k < nbWords; k++ )
+    {
+        uint16_t mask = channelsMask[k];
+        uint8_t nbBits = RegionCommonCountBits( mask );
+
+        if( n < nbBits )
+        {
+            // Clear the n lowest bits set, the searched bit becomes the lowest one
+            for( ; n > 0; n-- )
+            {
+                mask &= mask - 1;
+            }
+            return ( k * 16 ) + RegionCommonFindFirstSetBit( mask );
+        }
+        n -= nbBits;
+    }
+    return -1;
+}
+
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len )
 {
     if( ( channelsMaskDest != NULL ) && ( channelsMaskSrc != NULL ) )
@@ -286,19 +445,42 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
                                            TimerTime_t expectedTimeOnAir )
 {
     TimerTime_t minTimeToWait = TIMERTIME_T_MAX;
-    TimerTime_t currentTime = TimerGetCurrentTime( );
     TimerTime_t creditCosts = 0;
+    TimerTime_t observation = 0;
+    TimerTime_t maxCredits = 0;
+    TimerTime_t sinceSync = 0;
     uint16_t dutyCycle = 1;
     uint8_t validBands = 0;
 
+    GetCreditPeriod( joined, elapsedTimeSinceStartup, &observation, &maxCredits );
+
+    // Synchronize the bands only when a credits refill is due or when the
+    // credit period changed. Otherwise the credits are still up to date.
+    if( IsBandsSyncValid( bands, nbBands, joined, dutyCycleEnabled, observation, maxCredits ) == true )
+    {
+        sinceSync = TimerGetElapsedTime( BandsCtx.SyncTime );
+    }
+    else
+    {
+        sinceSync = TIMERTIME_T_MAX;
+    }
+    if( sinceSync >= BandsCtx.NextRefillDelay )
+    {
+        SyncBands( bands, nbBands, joined, dutyCycleEnabled, observation, maxCredits );
+        sinceSync = 0;
+    }
+
     for( uint8_t i = 0; i < nbBands; i++ )
     {
-        TimerTime_t elapsedTime = TimerGetElapsedTime( bands[i].LastBandUpdateTime );
+        // Get the band duty cycle. If not joined, the function either returns the join duty cycle
+        // or the band duty cycle, whichever is more restrictive.
+        dutyCycle = GetDutyCycle( &bands[i], joined, elapsedTimeSinceStartup );
 
-        // Synchronization of bands and credits
-        dutyCycle = UpdateTimeCredits( &bands[i], joined, dutyCycleEnabled,
-                                       lastTxIsJoinRequest, elapsedTimeSinceStartup,
-                                       currentTime, elapsedTime );
+        if( ( joined == true ) && ( dutyCycleEnabled == false ) )
+        {
+            // Assign max credits when the duty cycle is disabled.
+            bands[i].TimeCredits = bands[i].MaxTimeCredits;
+        }
 
         // Calculate the credit costs for the next transmission
         // with the duty cycle and the expected time on air
@@ -325,15 +507,8 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
             {
                 // The band can only be taken into account, if the maximum credits
                 // of the band are higher than the credit costs.
-                // We calculate the minTimeToWait among the bands which are not
-                // ready for transmission and which are potentially available
-                // for a transmission in the future.
-                TimerTime_t observationTimeDiff = 0;
-                if( bands[i].LastMaxCreditAssignTime >= elapsedTime )
-                {
-                    observationTimeDiff = bands[i].LastMaxCreditAssignTime - elapsedTime;
-                }
-                minTimeToWait = MIN( minTimeToWait, observationTimeDiff );
+                // The band is ready again at its next credits refill.
+                minTimeToWait = MIN( minTimeToWait, BandsCtx.RefillDelay[i] - sinceSync );
                 // This band is a potential candidate for an
                 // upcoming transmission (even if its time credits are not enough
                 // at the moment), so increase the counter.
@@ -352,6 +527,26 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
     return minTimeToWait;
 }
 
+uint32_t RegionCommonGetBandTxCapacity( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup,
+                                        TimerTime_t timeOnAir, TimerTime_t* refillDelay )
+{
+    // Same credit costs as RegionCommonUpdateBandTimeOff, including the join duty cycle
+    TimerTime_t creditCosts = MAX( timeOnAir, 1 ) * GetDutyCycle( band, joined, elapsedTimeSinceStartup );
+    TimerTime_t elapsedTime = TimerGetElapsedTime( band->LastBandUpdateTime );
+
+    *refillDelay = 0;
+    if( band->LastMaxCreditAssignTime > elapsedTime )
+    {
+        *refillDelay = band->LastMaxCreditAssignTime - elapsedTime;
+    }
+    return band->TimeCredits / creditCosts;
+}
+
+void RegionCommonResetBandsCtx( void )
+{
+    memset1( ( uint8_t* )&BandsCtx, 0, sizeof( RegionCommonBandsCtx_t ) );
+}
+
 uint8_t RegionCommonParseLinkAdrReq( uint8_t* payload, RegionCommonLinkAdrParams_t* linkAdrParams )
 {
     uint8_t retIndex = 0;
@@ -504,35 +699,41 @@ void RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsP
 
     for( uint8_t i = 0, k = 0; i < countNbOfEnabledChannelsParams->MaxNbChannels; i += 16, k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        uint16_t mask = countNbOfEnabledChannelsParams->ChannelsMask[k];
+
+        // Intersect the masks word by word, then visit the remaining channels only
+        if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
+            ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
         {
-            if( ( countNbOfEnabledChannelsParams->ChannelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( countNbOfEnabledChannelsParams->Channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
-                    ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
-                {
-                    if( ( countNbOfEnabledChannelsParams->JoinChannels[k] & ( 1 << j ) ) == 0 )
-                    {
-                        continue;
-                    }
-                }
-                if( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Min,
-                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[i + j].Band].ReadyForTransmission == false )
-                { // Check if the band is available for transmission
-                    nbRestrictedChannelsCount++;
-                    continue;
-                }
-                enabledChannels[nbChannelCount++] = i + j;
+            mask &= countNbOfEnabledChannelsParams->JoinChannels[k];
+        }
+        if( countNbOfEnabledChannelsParams->DrChannelsMask != NULL )
+        {
+            mask &= countNbOfEnabledChannelsParams->DrChannelsMask[k];
+        }
+
+        while( mask != 0 )
+        {
+            uint8_t j = RegionCommonFindFirstSetBit( mask );
+
+            mask &= mask - 1;
+            if( countNbOfEnabledChannelsParams->Channels[i + j].Frequency == 0 )
+            { // Check if the channel is enabled
+                continue;
             }
+            if( ( countNbOfEnabledChannelsParams->DrChannelsMask == NULL ) &&
+                ( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
+                                            countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Min,
+                                            countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Max ) == false ) )
+            { // Check if the current channel selection supports the given datarate
+                continue;
+            }
+            if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[i + j].Band].ReadyForTransmission == false )
+            { // Check if the band is available for transmission
+                nbRestrictedChannelsCount++;
+                continue;
+            }
+            enabledChannels[nbChannelCount++] = i + j;
         }
     }
     *nbEnabledChannels = nbChannelCount;
@@ -583,6 +784,144 @@ LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_
     }
 }
 
+LoRaMacStatus_t RegionCommonQueryChannels( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                           TimerTime_t* nextTxDelay )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t* countParams = identifyChannelsParam->CountNbOfEnabledChannelsParam;
+    TimerTime_t bandTimeOff[REGION_NVM_MAX_NB_BANDS];
+    TimerTime_t aggrTimeToWait = 0;
+    TimerTime_t bandsTimeToWait = TIMERTIME_T_MAX;
+    TimerTime_t observation = 0;
+    TimerTime_t maxCredits = 0;
+    TimerTime_t nextObservation = 0;
+    TimerTime_t nextMaxCredits = 0;
+    TimerTime_t timeToNextPeriod = TIMERTIME_T_MAX;
+    bool channelFound = false;
+
+    if( identifyChannelsParam->LastAggrTx != 0 )
+    {
+        TimerTime_t elapsed = TimerGetElapsedTime( identifyChannelsParam->LastAggrTx );
+
+        if( identifyChannelsParam->AggrTimeOff > elapsed )
+        {
+            aggrTimeToWait = identifyChannelsParam->AggrTimeOff - elapsed;
+        }
+    }
+
+    // Before joining, all the bands are refilled as well when the next credit period starts
+    timeToNextPeriod = GetTimeToNextCreditPeriod( countParams->Joined, identifyChannelsParam->ElapsedTimeSinceStartUp );
+    if( timeToNextPeriod != TIMERTIME_T_MAX )
+    {
+        SysTime_t nextPeriodStart = SysTimeAdd( identifyChannelsParam->ElapsedTimeSinceStartUp,
+                                                SysTimeFromMs( timeToNextPeriod ) );
+
+        GetCreditPeriod( countParams->Joined, nextPeriodStart, &nextObservation, &nextMaxCredits );
+    }
+
+    // Evaluate each band once
+    GetCreditPeriod( countParams->Joined, identifyChannelsParam->ElapsedTimeSinceStartUp, &observation, &maxCredits );
+    for( uint8_t i = 0; ( i < identifyChannelsParam->MaxBands ) && ( i < REGION_NVM_MAX_NB_BANDS ); i++ )
+    {
+        bandTimeOff[i] = GetBandTimeOff( &countParams->Bands[i], countParams->Joined,
+                                         identifyChannelsParam->DutyCycleEnabled,
+                                         identifyChannelsParam->ElapsedTimeSinceStartUp, observation, maxCredits,
+                                         identifyChannelsParam->ExpectedTimeOnAir );
+
+        if( bandTimeOff[i] > timeToNextPeriod )
+        {
+            // The maximum credits never increase with the next credit period
+            if( nextMaxCredits > ( identifyChannelsParam->ExpectedTimeOnAir *
+                                   GetDutyCycle( &countParams->Bands[i], countParams->Joined,
+                                                 identifyChannelsParam->ElapsedTimeSinceStartUp ) ) )
+            {
+                bandTimeOff[i] = timeToNextPeriod;
+            }
+            else
+            {
+                bandTimeOff[i] = TIMERTIME_T_MAX;
+            }
+        }
+    }
+
+    // Same channel filter as RegionCommonCountNbOfEnabledChannels
+    for( uint8_t i = 0, k = 0; i < countParams->MaxNbChannels; i += 16, k++ )
+    {
+        uint16_t mask = countParams->ChannelsMask[k];
+
+        if( ( countParams->Joined == false ) && ( countParams->JoinChannels != NULL ) )
+        {
+            mask &= countParams->JoinChannels[k];
+        }
+        if( countParams->DrChannelsMask != NULL )
+        {
+            mask &= countParams->DrChannelsMask[k];
+        }
+
+        while( mask != 0 )
+        {
+            ChannelParams_t* channel = &countParams->Channels[i + RegionCommonFindFirstSetBit( mask )];
+
+            mask &= mask - 1;
+            if( ( channel->Frequency == 0 ) || ( channel->Band >= identifyChannelsParam->MaxBands ) ||
+                ( channel->Band >= REGION_NVM_MAX_NB_BANDS ) )
+            {
+                continue;
+            }
+            if( ( countParams->DrChannelsMask == NULL ) &&
+                ( RegionCommonValueInRange( countParams->Datarate, channel->DrRange.Fields.Min,
+                                            channel->DrRange.Fields.Max ) == false ) )
+            {
+                continue;
+            }
+            channelFound = true;
+            bandsTimeToWait = MIN( bandsTimeToWait, bandTimeOff[channel->Band] );
+        }
+    }
+
+    if( channelFound == false )
+    {
+        *nextTxDelay = 0;
+        return LORAMAC_STATUS_NO_CHANNEL_FOUND;
+    }
+    if( bandsTimeToWait == TIMERTIME_T_MAX )
+    {
+        // No band is able to handle the transmission in the observation period
+        *nextTxDelay = TIMERTIME_T_MAX;
+        return LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
+    }
+
+    // The credits of a band which is ready do not decrease without a transmission
+    *nextTxDelay = MAX( aggrTimeToWait, bandsTimeToWait );
+    if( *nextTxDelay > 0 )
+    {
+        return LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t RegionCommonQueryNextChannel( NextChanParams_t* nextChanParams,
+                                              RegionCommonCountNbOfEnabledChannelsParams_t* countChannelsParams,
+                                              uint8_t maxBands, TimerTime_t txTimeOnAir, TimerTime_t* nextTxDelay )
+{
+    RegionCommonIdentifyChannelsParam_t identifyChannelsParam;
+
+    countChannelsParams->Joined = nextChanParams->Joined;
+    countChannelsParams->Datarate = nextChanParams->Datarate;
+
+    identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
+    identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
+    identifyChannelsParam.DutyCycleEnabled = nextChanParams->DutyCycleEnabled;
+    identifyChannelsParam.MaxBands = maxBands;
+
+    identifyChannelsParam.ElapsedTimeSinceStartUp = nextChanParams->ElapsedTimeSinceStartUp;
+    identifyChannelsParam.LastTxIsJoinRequest = nextChanParams->LastTxIsJoinRequest;
+    identifyChannelsParam.ExpectedTimeOnAir = txTimeOnAir;
+
+    identifyChannelsParam.CountNbOfEnabledChannelsParam = countChannelsParams;
+
+    return RegionCommonQueryChannels( &identifyChannelsParam, nextTxDelay );
+}
+
 int8_t RegionCommonGetNextLowerTxDr( RegionCommonGetNextLowerTxDrParams_t *params )
 {
     int8_t drLocal = params->CurrentDr;
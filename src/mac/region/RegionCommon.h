@@ -44,6 +44,13 @@ extern "C"
 
 #include "LoRaMacTypes.h"
 #include "LoRaMacHeaderTypes.h"
+
+/*!
+ * Parameter structure for the function RegionNextChannel, refer to Region.h.
+ * Declared ahead of Region.h, which includes this file.
+ */
+typedef struct sNextChanParams NextChanParams_t;
+
 #include "region/Region.h"
 
 // Constants that are common to all the regions.
@@ -273,6 +280,12 @@ typedef struct sRegionCommonCountNbOfEnabledChannelsParams
      * ChannelsMask with a number of MaxNbChannels channels.
      */
     uint16_t* JoinChannels;
+    /*!
+     * A pointer to the precomputed bitmask of the channels supporting
+     * the datarate. Shall have the same dimension as the ChannelsMask.
+     * Set to NULL to verify the datarate range of every enabled channel.
+     */
+    const uint16_t* DrChannelsMask;
 }RegionCommonCountNbOfEnabledChannelsParams_t;
 
 typedef struct sRegionCommonIdentifyChannelsParam
@@ -400,6 +413,38 @@ bool RegionCommonChanDisable( uint16_t* channelsMask, uint8_t id, uint8_t maxCha
  */
 uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uint8_t stopIdx );
 
+/*!
+ * \brief Counts the number of bits set in a channels mask word.
+ *
+ * \param [IN] mask The channels mask word.
+ *
+ * \retval Returns the number of bits set.
+ */
+uint8_t RegionCommonCountBits( uint16_t mask );
+
+/*!
+ * \brief Gets the index of the lowest bit set in a channels mask word.
+ *
+ * \param [IN] mask The channels mask word. Shall not be 0.
+ *
+ * \retval Returns the index of the lowest bit set.
+ */
+uint8_t RegionCommonFindFirstSetBit( uint16_t mask );
+
+/*!
+ * \brief Gets the index of the n-th channel enabled in a given channels mask.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] channelsMask The channels mask.
+ *
+ * \param [IN] nbWords Number of words of the channels mask.
+ *
+ * \param [IN] n Rank of the channel to find, 0 for the first enabled channel.
+ *
+ * \retval Returns the channel index, -1 if less than n + 1 channels are enabled.
+ */
+int16_t RegionCommonSelectNthSetBit( uint16_t* channelsMask, uint8_t nbWords, uint8_t n );
+
 /*!
  * \brief Copy a channels mask.
  *        This is a generic function and valid for all regions.
@@ -451,6 +496,35 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, Band_t* bands,
                                            bool lastTxIsJoinRequest, SysTime_t elapsedTimeSinceStartup,
                                            TimerTime_t expectedTimeOnAir );
 
+/*!
+ * \brief Computes how many transmissions of the given time on air the band
+ *        still allows until its next credits refill.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] band The band to evaluate.
+ *
+ * \param [IN] joined Set to true if the device has joined.
+ *
+ * \param [IN] elapsedTimeSinceStartup Elapsed time since initialization.
+ *
+ * \param [IN] timeOnAir Time on air of the transmissions.
+ *
+ * \param [OUT] refillDelay Delay until the next credits refill of the band.
+ *
+ * \retval Number of transmissions.
+ */
+uint32_t RegionCommonGetBandTxCapacity( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup,
+                                        TimerTime_t timeOnAir, TimerTime_t* refillDelay );
+
+/*!
+ * \brief Resets the credit model context of the bands. The next call to
+ *        \ref RegionCommonUpdateBandTimeOff synchronizes all the bands again.
+ *        To be called when the bands or the MAC contexts are initialized or
+ *        restored.
+ *        This is a generic function and valid for all regions.
+ */
+void RegionCommonResetBandsCtx( void );
+
 /*!
  * \brief Parses the parameter of an LinkAdrRequest.
  *        This is a generic function and valid for all regions.
@@ -585,6 +659,45 @@ LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_
                                               uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
                                               TimerTime_t* nextTxDelay );
 
+/*!
+ * \brief Computes the time to wait until a transmission is possible on
+ *        at least one of the enabled channels. In contrast to
+ *        \ref RegionCommonIdentifyChannels, neither the bands nor the
+ *        aggregated time-off are updated.
+ *
+ * \param [IN] identifyChannelsParam A pointer to the input parameters.
+ *
+ * \param [OUT] nextTxDelay Holds the time which has to be waited for the next possible
+ *                          uplink transmission. 0 if the transmission is possible now.
+ *
+ *\retval Status of the operation.
+ */
+LoRaMacStatus_t RegionCommonQueryChannels( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                           TimerTime_t* nextTxDelay );
+
+/*!
+ * \brief Computes the time to wait until the uplink is possible. Common part
+ *        of the RegionXXQueryNextChannel functions, refer to
+ *        \ref RegionCommonQueryChannels.
+ *
+ * \param [IN] nextChanParams Parameters of the uplink.
+ *
+ * \param [IN] countChannelsParams Channels the region selects from. The Joined
+ *                                 and Datarate fields are set by the function.
+ *
+ * \param [IN] maxBands Number of bands of the region.
+ *
+ * \param [IN] txTimeOnAir Time on air of the uplink.
+ *
+ * \param [OUT] nextTxDelay Holds the time which has to be waited for the next possible
+ *                          uplink transmission. 0 if the transmission is possible now.
+ *
+ *\retval Status of the operation.
+ */
+LoRaMacStatus_t RegionCommonQueryNextChannel( NextChanParams_t* nextChanParams,
+                                              RegionCommonCountNbOfEnabledChannelsParams_t* countChannelsParams,
+                                              uint8_t maxBands, TimerTime_t txTimeOnAir, TimerTime_t* nextTxDelay );
+
 /*!
  * \brief Selects the next lower datarate.
  *
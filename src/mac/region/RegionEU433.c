@@ -42,6 +42,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionEU433PhyParams =
+{
+    .MinTxDr = { EU433_TX_MIN_DATARATE, EU433_TX_MIN_DATARATE },
+    .MaxTxDr = EU433_TX_MAX_DATARATE,
+    .MaxTxPower = EU433_MAX_TX_POWER,
+    .MinTxPower = EU433_MIN_TX_POWER,
+    .DefTxPower = EU433_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateEU433, MaxPayloadOfDatarateEU433 },
+};
+
 // Static functions
 static bool VerifyRfFreq( uint32_t freq )
 {
@@ -91,6 +104,11 @@ PhyParam_t RegionEU433GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = EU433_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = EU433_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = EU433_DEFAULT_DATARATE;
@@ -797,6 +815,7 @@ LoRaMacStatus_t RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = EU433_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -825,6 +844,23 @@ LoRaMacStatus_t RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionEU433QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannels = EU433_JOIN_CHANNELS;
+
+    // Same channels as RegionEU433NextChannel
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = EU433_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, EU433_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionEU433ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     bool drInvalid = false;
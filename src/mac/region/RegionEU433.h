@@ -243,6 +243,11 @@ static const uint32_t BandwidthsEU433[] = { 125000, 125000, 125000, 125000, 1250
  */
 static const uint8_t MaxPayloadOfDatarateEU433[] = { 51, 51, 51, 115, 242, 242, 242, 242 };
 
+/*!
+ * Constant PHY parameters of the region. Refer to \ref RegionGetPhyParams
+ */
+extern const RegionPhyParams_t RegionEU433PhyParams;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -403,6 +408,19 @@ int8_t RegionEU433AlternateDr( int8_t currentDr, AlternateDrType_t type );
  */
 LoRaMacStatus_t RegionEU433NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionEU433QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
@@ -42,6 +42,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionEU868PhyParams =
+{
+    .MinTxDr = { EU868_TX_MIN_DATARATE, EU868_TX_MIN_DATARATE },
+    .MaxTxDr = EU868_TX_MAX_DATARATE,
+    .MaxTxPower = EU868_MAX_TX_POWER,
+    .MinTxPower = EU868_MIN_TX_POWER,
+    .DefTxPower = EU868_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateEU868, MaxPayloadOfDatarateEU868 },
+};
+
 // Static functions
 static bool VerifyRfFreq( uint32_t freq, uint8_t *band )
 {
@@ -83,6 +96,62 @@ static bool VerifyRfFreq( uint32_t freq, uint8_t *band )
     return true;
 }
 
+#if ( EU868_CREDIT_AWARE_CHANNEL_SELECTION == 1 )
+/*!
+ * \brief Selects a channel among the channels of the bands which allow the
+ *        most transmissions of the pending frame until their credits refill.
+ *        Among those, the bands refilled first, which are the next
+ *        opportunities once exhausted, are used first. Ties are broken
+ *        randomly.
+ *
+ * \param [IN] nextChanParams Parameters of the pending transmission.
+ *
+ * \param [IN] timeOnAir Time on air of the pending frame.
+ *
+ * \param [IN] enabledChannels Channels ready for transmission.
+ *
+ * \param [IN] nbEnabledChannels Number of channels ready for transmission.
+ *
+ * \retval Selected channel.
+ */
+static uint8_t SelectChannelByCredits( NextChanParams_t* nextChanParams, TimerTime_t timeOnAir,
+                                       uint8_t* enabledChannels, uint8_t nbEnabledChannels )
+{
+    uint8_t candidates[EU868_MAX_NB_CHANNELS];
+    uint8_t nbCandidates = 0;
+    uint32_t maxCapacity = 0;
+    TimerTime_t minRefillDelay = 0;
+
+    if( ( nextChanParams->Joined == true ) && ( nextChanParams->DutyCycleEnabled == false ) )
+    {
+        // The credits are not used
+        return enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+    }
+
+    for( uint8_t i = 0; i < nbEnabledChannels; i++ )
+    {
+        Band_t* band = &RegionBands[RegionNvmGroup2->Channels[enabledChannels[i]].Band];
+        TimerTime_t refillDelay = 0;
+        uint32_t capacity = RegionCommonGetBandTxCapacity( band, nextChanParams->Joined,
+                                                           nextChanParams->ElapsedTimeSinceStartUp,
+                                                           timeOnAir, &refillDelay );
+
+        if( ( nbCandidates == 0 ) || ( capacity > maxCapacity ) ||
+            ( ( capacity == maxCapacity ) && ( refillDelay < minRefillDelay ) ) )
+        {
+            maxCapacity = capacity;
+            minRefillDelay = refillDelay;
+            nbCandidates = 0;
+        }
+        if( ( capacity == maxCapacity ) && ( refillDelay == minRefillDelay ) )
+        {
+            candidates[nbCandidates++] = enabledChannels[i];
+        }
+    }
+    return candidates[randr( 0, nbCandidates - 1 )];
+}
+#endif
+
 static TimerTime_t GetTimeOnAir( int8_t datarate, uint16_t pktLen )
 {
     int8_t phyDr = DataratesEU868[datarate];
@@ -116,6 +185,11 @@ PhyParam_t RegionEU868GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = EU868_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = EU868_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = EU868_DEFAULT_DATARATE;
@@ -830,6 +904,7 @@ LoRaMacStatus_t RegionEU868NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = EU868_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -848,7 +923,12 @@ LoRaMacStatus_t RegionEU868NextChannel( NextChanParams_t* nextChanParams, uint8_
     if( status == LORAMAC_STATUS_OK )
     {
         // We found a valid channel
+#if ( EU868_CREDIT_AWARE_CHANNEL_SELECTION == 1 )
+        *channel = SelectChannelByCredits( nextChanParams, identifyChannelsParam.ExpectedTimeOnAir,
+                                           enabledChannels, nbEnabledChannels );
+#else
         *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+#endif
     }
     else if( status == LORAMAC_STATUS_NO_CHANNEL_FOUND )
     {
@@ -858,6 +938,23 @@ LoRaMacStatus_t RegionEU868NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionEU868QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannels = EU868_JOIN_CHANNELS;
+
+    // Same channels as RegionEU868NextChannel
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = EU868_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, EU868_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionEU868ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     uint8_t band = 0;
@@ -256,6 +256,24 @@ extern "C"
  */
 #define EU868_JOIN_CHANNELS                         ( uint16_t )( LC( 1 ) | LC( 2 ) | LC( 3 ) )
 
+/*!
+ * Channel selection mode
+ * 0: random channel among the channels of the bands ready for transmission
+ * 1: random channel among the channels of the ready bands which allow the
+ *    most transmissions of the pending frame, join duty cycle included,
+ *    until their credits refill. The bands refilled first win the ties.
+ *
+ * \remark Both modes only use the bands ready for transmission, so the sum of
+ *         the band budgets bounds the uplinks per hour of both. Mode 1 does
+ *         not send more uplinks per hour for frames of a fixed size, and
+ *         changes them by less than 1% for mixed frame sizes, refer to the
+ *         channel-selection host test. It only changes which band is
+ *         drained first.
+ */
+#ifndef EU868_CREDIT_AWARE_CHANNEL_SELECTION
+#define EU868_CREDIT_AWARE_CHANNEL_SELECTION        0
+#endif
+
 /*!
  * Data rates table definition
  */
@@ -271,6 +289,11 @@ static const uint32_t BandwidthsEU868[] = { 125000, 125000, 125000, 125000, 1250
  */
 static const uint8_t MaxPayloadOfDatarateEU868[] = { 51, 51, 51, 115, 242, 242, 242, 242 };
 
+/*!
+ * Constant PHY parameters of the region. Refer to \ref RegionGetPhyParams
+ */
+extern const RegionPhyParams_t RegionEU868PhyParams;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -431,6 +454,19 @@ int8_t RegionEU868AlternateDr( int8_t currentDr, AlternateDrType_t type );
  */
 LoRaMacStatus_t RegionEU868NextChannel( NextChanParams_t* nextChanParams, uint8_t* channel, TimerTime_t* time, TimerTime_t* aggregatedTimeOff );
 
+/*!
+ * \brief Computes the time to wait until the next transmission is possible.
+ *        The channels, the bands and the aggregated time-off are not modified.
+ *
+ * \param [OUT] time Time to wait for the next transmission according to the duty
+ *              cycle. 0 if the transmission is possible now.
+ *
+ * \param [OUT] txTimeOnAir Time on air of the transmission.
+ *
+ * \retval Function status. Refer to \ref RegionCommonQueryChannels.
+ */
+LoRaMacStatus_t RegionEU868QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir );
+
 /*!
  * \brief Adds a channel.
  *
@@ -42,6 +42,19 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionIN865PhyParams =
+{
+    .MinTxDr = { IN865_TX_MIN_DATARATE, IN865_TX_MIN_DATARATE },
+    .MaxTxDr = IN865_TX_MAX_DATARATE,
+    .MaxTxPower = IN865_MAX_TX_POWER,
+    .MinTxPower = IN865_MIN_TX_POWER,
+    .DefTxPower = IN865_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateIN865, MaxPayloadOfDatarateIN865 },
+};
+
 
 static bool VerifyRfFreq( uint32_t freq )
 {
@@ -91,6 +104,11 @@ PhyParam_t RegionIN865GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = IN865_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = IN865_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = IN865_DEFAULT_DATARATE;
@@ -820,6 +838,7 @@ LoRaMacStatus_t RegionIN865NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = IN865_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -848,6 +867,23 @@ LoRaMacStatus_t RegionIN865NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionIN865QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+    uint16_t joinChannels = IN865_JOIN_CHANNELS;
+
+    // Same channels as RegionIN865NextChannel
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = IN865_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = &joinChannels;
+    countChannelsParams.DrChannelsMask = NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, IN865_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionIN865ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     bool drInvalid = false;
@@ -0,0 +1,117 @@
+/*!
+ * \file      RegionSingle.h
+ *
+ * \brief     Single region build. Resolves the region API at compile time.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \addtogroup REGION
+ *
+ *            When LORAMAC_SINGLE_REGION is defined exactly one region must be
+ *            enabled. The region API functions then are replaced by direct calls
+ *            to the enabled region implementation and the region argument is
+ *            only used by \ref RegionIsActive. The dispatch of Region.c is not
+ *            built.
+ *
+ * \{
+ */
+#ifndef __REGION_SINGLE_H__
+#define __REGION_SINGLE_H__
+
+#if ( defined( REGION_AS923 ) + defined( REGION_AU915 ) + defined( REGION_CN470 ) + \
+      defined( REGION_CN779 ) + defined( REGION_EU433 ) + defined( REGION_EU868 ) + \
+      defined( REGION_KR920 ) + defined( REGION_IN865 ) + defined( REGION_US915 ) + \
+      defined( REGION_RU864 ) ) != 1
+#error "LORAMAC_SINGLE_REGION requires exactly one region to be enabled"
+#endif
+
+#if defined( REGION_AS923 )
+#include "RegionAS923.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_AS923
+#define REGION_SINGLE_API( NAME )                   RegionAS923##NAME
+#elif defined( REGION_AU915 )
+#include "RegionAU915.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_AU915
+#define REGION_SINGLE_API( NAME )                   RegionAU915##NAME
+#elif defined( REGION_CN470 )
+#include "RegionCN470.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_CN470
+#define REGION_SINGLE_API( NAME )                   RegionCN470##NAME
+#elif defined( REGION_CN779 )
+#include "RegionCN779.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_CN779
+#define REGION_SINGLE_API( NAME )                   RegionCN779##NAME
+#elif defined( REGION_EU433 )
+#include "RegionEU433.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_EU433
+#define REGION_SINGLE_API( NAME )                   RegionEU433##NAME
+#elif defined( REGION_EU868 )
+#include "RegionEU868.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_EU868
+#define REGION_SINGLE_API( NAME )                   RegionEU868##NAME
+#elif defined( REGION_KR920 )
+#include "RegionKR920.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_KR920
+#define REGION_SINGLE_API( NAME )                   RegionKR920##NAME
+#elif defined( REGION_IN865 )
+#include "RegionIN865.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_IN865
+#define REGION_SINGLE_API( NAME )                   RegionIN865##NAME
+#elif defined( REGION_US915 )
+#include "RegionUS915.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_US915
+#define REGION_SINGLE_API( NAME )                   RegionUS915##NAME
+#elif defined( REGION_RU864 )
+#include "RegionRU864.h"
+#define REGION_SINGLE_ID                            LORAMAC_REGION_RU864
+#define REGION_SINGLE_API( NAME )                   RegionRU864##NAME
+#endif
+
+/*!
+ * Region API, refer to Region.h for the description of the functions
+ */
+#define RegionIsActive( region )                    ( ( region ) == REGION_SINGLE_ID )
+#define RegionSelect( region )                      RegionIsActive( region )
+#define RegionGetPhyParam( region, getPhy )         REGION_SINGLE_API( GetPhyParam )( getPhy )
+#define RegionGetPhyParams( region )                ( &REGION_SINGLE_API( PhyParams ) )
+#define RegionSetBandTxDone( region, txDone )       REGION_SINGLE_API( SetBandTxDone )( txDone )
+#define RegionInitDefaults( region, params )        REGION_SINGLE_API( InitDefaults )( params )
+#define RegionVerify( region, verify, phyAttribute ) REGION_SINGLE_API( Verify )( verify, phyAttribute )
+#define RegionApplyCFList( region, applyCFList )    REGION_SINGLE_API( ApplyCFList )( applyCFList )
+#define RegionChanMaskSet( region, chanMaskSet )    REGION_SINGLE_API( ChanMaskSet )( chanMaskSet )
+#define RegionRxConfig( region, rxConfig, datarate ) REGION_SINGLE_API( RxConfig )( rxConfig, datarate )
+#define RegionComputeRxWindowParameters( region, datarate, minRxSymbols, rxError, rxConfigParams ) \
+                                                    REGION_SINGLE_API( ComputeRxWindowParameters )( datarate, minRxSymbols, rxError, rxConfigParams )
+#define RegionTxConfig( region, txConfig, txPower, txTimeOnAir ) \
+                                                    REGION_SINGLE_API( TxConfig )( txConfig, txPower, txTimeOnAir )
+#define RegionLinkAdrReq( region, linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ) \
+                                                    REGION_SINGLE_API( LinkAdrReq )( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed )
+#define RegionRxParamSetupReq( region, rxParamSetupReq ) REGION_SINGLE_API( RxParamSetupReq )( rxParamSetupReq )
+#define RegionNewChannelReq( region, newChannelReq ) REGION_SINGLE_API( NewChannelReq )( newChannelReq )
+#define RegionTxParamSetupReq( region, txParamSetupReq ) REGION_SINGLE_API( TxParamSetupReq )( txParamSetupReq )
+#define RegionDlChannelReq( region, dlChannelReq )  REGION_SINGLE_API( DlChannelReq )( dlChannelReq )
+#define RegionAlternateDr( region, currentDr, type ) REGION_SINGLE_API( AlternateDr )( currentDr, type )
+#define RegionNextChannel( region, nextChanParams, channel, time, aggregatedTimeOff ) \
+                                                    REGION_SINGLE_API( NextChannel )( nextChanParams, channel, time, aggregatedTimeOff )
+#define RegionQueryNextChannel( region, nextChanParams, time, txTimeOnAir ) \
+                                                    REGION_SINGLE_API( QueryNextChannel )( nextChanParams, time, txTimeOnAir )
+#define RegionChannelAdd( region, channelAdd )      REGION_SINGLE_API( ChannelAdd )( channelAdd )
+#define RegionChannelsRemove( region, channelRemove ) REGION_SINGLE_API( ChannelsRemove )( channelRemove )
+#define RegionApplyDrOffset( region, downlinkDwellTime, dr, drOffset ) \
+                                                    REGION_SINGLE_API( ApplyDrOffset )( downlinkDwellTime, dr, drOffset )
+#define RegionRxBeaconSetup( region, rxBeaconSetup, outDr ) REGION_SINGLE_API( RxBeaconSetup )( rxBeaconSetup, outDr )
+
+/*! \} addtogroup REGION */
+
+#endif // __REGION_SINGLE_H__
@@ -46,6 +46,32 @@ static RegionNvmDataGroup1_t* RegionNvmGroup1;
 static RegionNvmDataGroup2_t* RegionNvmGroup2;
 static Band_t* RegionBands;
 
+/*
+ * Constant PHY parameters
+ */
+const RegionPhyParams_t RegionUS915PhyParams =
+{
+    .MinTxDr = { US915_TX_MIN_DATARATE, US915_TX_MIN_DATARATE },
+    .MaxTxDr = US915_TX_MAX_DATARATE,
+    .MaxTxPower = US915_MAX_TX_POWER,
+    .MinTxPower = US915_MIN_TX_POWER,
+    .DefTxPower = US915_DEFAULT_TX_POWER,
+    .MaxPayload = { MaxPayloadOfDatarateUS915, MaxPayloadOfDatarateUS915 },
+};
+
+/*
+ * Channels supporting each datarate. The datarate ranges of the channels are
+ * fixed by the channel plan: 125 kHz channels DR_0 to DR_3, 500 kHz channels DR_4.
+ */
+static const uint16_t DrChannelsMaskUS915[US915_TX_MAX_DATARATE + 1][CHANNELS_MASK_SIZE] =
+{
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_0
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_1
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_2
+    { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0000, 0x0000 }, // DR_3
+    { 0x0000, 0x0000, 0x0000, 0x0000, 0x00FF, 0x0000 }, // DR_4
+};
+
 static int8_t LimitTxPower( int8_t txPower, int8_t maxBandTxPower, int8_t datarate, uint16_t* channelsMask )
 {
     int8_t txPowerResult = txPower;
@@ -115,6 +141,11 @@ PhyParam_t RegionUS915GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = US915_TX_MIN_DATARATE;
             break;
         }
+        case PHY_MAX_TX_DR:
+        {
+            phyParam.Value = US915_TX_MAX_DATARATE;
+            break;
+        }
         case PHY_DEF_TX_DR:
         {
             phyParam.Value = US915_DEFAULT_DATARATE;
@@ -833,6 +864,7 @@ LoRaMacStatus_t RegionUS915NextChannel( NextChanParams_t* nextChanParams, uint8_
     countChannelsParams.Bands = RegionBands;
     countChannelsParams.MaxNbChannels = US915_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = ( nextChanParams->Datarate <= US915_TX_MAX_DATARATE ) ? DrChannelsMaskUS915[nextChanParams->Datarate] : NULL;
 
     identifyChannelsParam.AggrTimeOff = nextChanParams->AggrTimeOff;
     identifyChannelsParam.LastAggrTx = nextChanParams->LastAggrTx;
@@ -875,12 +907,7 @@ LoRaMacStatus_t RegionUS915NextChannel( NextChanParams_t* nextChanParams, uint8_
             else
             {
                 // Choose the next available channel
-                uint8_t i = 0;
-                while( ( ( RegionNvmGroup1->ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK ) & ( 1 << i ) ) == 0 )
-                {
-                    i++;
-                }
-                *channel = 64 + i;
+                *channel = 64 + RegionCommonFindFirstSetBit( RegionNvmGroup1->ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK );
             }
         }
 
@@ -890,6 +917,23 @@ LoRaMacStatus_t RegionUS915NextChannel( NextChanParams_t* nextChanParams, uint8_
     return status;
 }
 
+LoRaMacStatus_t RegionUS915QueryNextChannel( NextChanParams_t* nextChanParams, TimerTime_t* time, TimerTime_t* txTimeOnAir )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
+
+    // Same channels as RegionUS915NextChannel. All enabled channels are taken into
+    // account, the remaining channels mask is refilled before it runs empty.
+    countChannelsParams.ChannelsMask = RegionNvmGroup2->ChannelsMask;
+    countChannelsParams.Channels = RegionNvmGroup2->Channels;
+    countChannelsParams.Bands = RegionBands;
+    countChannelsParams.MaxNbChannels = US915_MAX_NB_CHANNELS;
+    countChannelsParams.JoinChannels = NULL;
+    countChannelsParams.DrChannelsMask = ( nextChanParams->Datarate <= US915_TX_MAX_DATARATE ) ? DrChannelsMaskUS915[nextChanParams->Datarate] : NULL;
+
+    *txTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    return RegionCommonQueryNextChannel( nextChanParams, &countChannelsParams, US915_MAX_NB_BANDS, *txTimeOnAir, time );
+}
+
 LoRaMacStatus_t RegionUS915ChannelAdd( ChannelAddParams_t* channelAdd )
 {
     return LORAMAC_STATUS_PARAMETER_INVALID;
@@ -23,53 +23,107 @@
  * \author    MCD Application Team ( STMicroelectronics International )
  */
 #include <stdio.h>
+#include "utilities.h"
 #include "rtc-board.h"
 #include "systime.h"
 
-#define END_OF_FEBRUARY_LEAP                         60 //31+29
-#define END_OF_JULY_LEAP                            213 //31+29+...
-
-#define END_OF_FEBRUARY_NORM                         59 //31+28
-#define END_OF_JULY_NORM                            212 //31+28+...
-
 #define UNIX_YEAR                                    68 //1968 is leap year
 
-//UNIX time 0 = start at 01:00:00, 01/01/1970
-#define UNIX_HOUR_OFFSET                            ( ( TM_DAYS_IN_LEAP_YEAR + TM_DAYS_IN_YEAR ) * TM_SECONDS_IN_1DAY )
-
 /*!
- * \brief Correction factors
+ * Days from the 1st of March 1968 to the 1st of January 1970.
+ *
+ * The calendar computations count days from the 1st of March 1968 so that
+ * the leap day is the last day of every 4 years cycle.
  */
-#define  DAYS_IN_MONTH_CORRECTION_NORM              ( (uint32_t )0x99AAA0 )
-#define  DAYS_IN_MONTH_CORRECTION_LEAP              ( (uint32_t )0x445550 )
+#define CALENDAR_DAYS_TO_UNIX_EPOCH                 671
 
+/*!
+ * Days from the 1st of March 1968 to the 1st of March 2100. 2100 is the only
+ * year of the uint32_t UNIX time range that is not a leap year although it
+ * is a multiple of 4.
+ */
+#define CALENDAR_DAYS_TO_MARCH_2100                 48212
 
-/* 365.25 = (366 + 365 + 365 + 365)/4 */
-#define DIV_365_25( X )                             ( ( ( X ) * 91867 + 22750 ) >> 25 )
-
-#define DIV_APPROX_86400( X )                       ( ( ( X ) >> 18 ) + ( ( X ) >> 17 ) )
-
-#define DIV_APPROX_1000( X )                        ( ( ( X ) >> 10 ) +( ( X ) >> 16 ) + ( ( X ) >> 17 ) )
+/*!
+ * Days in a 4 years cycle
+ */
+#define CALENDAR_DAYS_IN_4_YEARS                    ( TM_DAYS_IN_YEAR * 3 + TM_DAYS_IN_LEAP_YEAR )
 
-#define DIV_APPROX_60( X )                          ( ( ( X ) * 17476 ) >> 20 )
+/*!
+ * Days from the 1st of March to the 1st of January
+ */
+#define CALENDAR_DAYS_MARCH_TO_JANUARY              306
 
-#define DIV_APPROX_61( X )                          ( ( ( X ) * 68759 ) >> 22 )
+/*!
+ * Days of January and February of a non leap year
+ */
+#define CALENDAR_DAYS_JANUARY_TO_MARCH              59
 
-#define MODULO_7( X )                               ( ( X ) -( ( ( ( ( X ) + 1 ) * 299593 ) >> 21 ) * 7 ) )
+/*!
+ * Invalid day, used to flag an empty calendar cache
+ */
+#define CALENDAR_DAY_INVALID                        UINT32_MAX
 
 /*!
- * \brief Calculates ceiling( X / N )
+ * \brief Exact divisions by multiplication and shift. Each one is exact for
+ *        the given input range, which has been verified exhaustively.
  */
-#define DIVC( X, N )                                ( ( ( X ) + ( N ) -1 ) / ( N ) )
+// X < 2^32
+#define DIV_86400( X )                              ( ( uint32_t )( ( ( uint64_t )( X ) * 3257812231U ) >> 48 ) )
+// X < 86400
+#define DIV_3600( X )                               ( ( ( X ) * 37283U ) >> 27 )
+// X < 3600
+#define DIV_60( X )                                 ( ( ( X ) * 2185U ) >> 17 )
+// X < 50400
+#define DIV_1461( X )                               ( ( ( X ) * 22967U ) >> 25 )
+// X < 5844
+#define DIV_1461_SMALL( X )                         ( ( ( X ) * 2871U ) >> 22 )
+// X < 1832
+#define DIV_153( X )                                ( ( ( X ) * 857U ) >> 17 )
+// X < 1688
+#define DIV_5( X )                                  ( ( ( X ) * 1639U ) >> 13 )
+// X < 49716
+#define DIV_7( X )                                  ( ( ( X ) * 74899U ) >> 19 )
 
-#define DIVC_BY_4( X )                              ( ( ( X ) + 3 ) >>2 )
+/*!
+ * Calendar date of a day
+ */
+typedef struct sCalendarDate
+{
+    /*!
+     * Days since the 1st of January 1970
+     */
+    uint32_t Days;
+    /*!
+     * Years since 1900
+     */
+    uint16_t Year;
+    /*!
+     * Day of the year [0..365]
+     */
+    uint16_t YearDay;
+    /*!
+     * Month [0..11]
+     */
+    uint8_t Month;
+    /*!
+     * Day of the month [1..31]
+     */
+    uint8_t MonthDay;
+    /*!
+     * Day of the week [0..6], 0 is Sunday
+     */
+    uint8_t WeekDay;
+}CalendarDate_t;
 
-#define DIVC_BY_2( X )                              ( ( ( X ) + 1 ) >> 1 )
+/*!
+ * Date of the last converted day. Consecutive conversions usually fall on
+ * the same day.
+ */
+static CalendarDate_t CalendarCache = { .Days = CALENDAR_DAY_INVALID };
 
-static uint32_t CalendarGetMonth( uint32_t days, uint32_t year );
-static void CalendarDiv86400( uint32_t in, uint32_t* out, uint32_t* remainder );
-static uint32_t CalendarDiv61( uint32_t in );
-static void CalendarDiv60( uint32_t in, uint32_t* out, uint32_t* remainder );
+static void CalendarFromDays( uint32_t days, CalendarDate_t* date );
+static uint32_t CalendarToDays( uint32_t year, uint32_t month, uint32_t monthDay );
 
 const char *WeekDayString[]={ "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
 
@@ -171,193 +225,131 @@ SysTime_t SysTimeFromMs( TimerTime_t timeMs )
 
 uint32_t SysTimeMkTime( const struct tm* localtime )
 {
-    uint32_t nbdays;
-    uint32_t nbsecs;
-    uint32_t year = localtime->tm_year - UNIX_YEAR;
-    uint32_t correctionMonth[4] =
-    {
-        DAYS_IN_MONTH_CORRECTION_LEAP,
-        DAYS_IN_MONTH_CORRECTION_NORM,
-        DAYS_IN_MONTH_CORRECTION_NORM,
-        DAYS_IN_MONTH_CORRECTION_NORM
-    };
+    uint32_t nbdays = CalendarToDays( localtime->tm_year, localtime->tm_mon, localtime->tm_mday );
 
-    nbdays = DIVC( ( TM_DAYS_IN_YEAR * 3 + TM_DAYS_IN_LEAP_YEAR ) * year, 4 );
-
-    nbdays += ( DIVC_BY_2( ( localtime->tm_mon ) * ( 30 + 31 ) ) -
-                ( ( ( correctionMonth[year % 4] >> ( ( localtime->tm_mon ) * 2 ) ) & 0x03 ) ) );
-
-    nbdays += ( localtime->tm_mday - 1 );
-
-    // Convert from days to seconds
-    nbsecs = nbdays * TM_SECONDS_IN_1DAY;
-
-    nbsecs += ( ( uint32_t )localtime->tm_sec + 
-                ( ( uint32_t )localtime->tm_min * TM_SECONDS_IN_1MINUTE ) +
-                ( ( uint32_t )localtime->tm_hour * TM_SECONDS_IN_1HOUR ) );
-    return nbsecs - UNIX_HOUR_OFFSET;
+    return ( nbdays * TM_SECONDS_IN_1DAY ) +
+           ( ( uint32_t )localtime->tm_sec +
+             ( ( uint32_t )localtime->tm_min * TM_SECONDS_IN_1MINUTE ) +
+             ( ( uint32_t )localtime->tm_hour * TM_SECONDS_IN_1HOUR ) );
 }
 
-
-
 void SysTimeLocalTime( const uint32_t timestamp, struct tm *localtime )
 {
-    uint32_t correctionMonth[4] =
-    {
-        DAYS_IN_MONTH_CORRECTION_LEAP,
-        DAYS_IN_MONTH_CORRECTION_NORM,
-        DAYS_IN_MONTH_CORRECTION_NORM,
-        DAYS_IN_MONTH_CORRECTION_NORM
-    };
-    uint32_t weekDays = 1; // Monday 1st January 1968
-    uint32_t seconds;
+    CalendarDate_t date;
+    uint32_t days = DIV_86400( timestamp );
+    uint32_t seconds = timestamp - ( days * TM_SECONDS_IN_1DAY );
+    uint32_t hours = DIV_3600( seconds );
     uint32_t minutes;
-    uint32_t days;
-    uint32_t divOut;
-    uint32_t divReminder;
-
-    CalendarDiv86400( timestamp + UNIX_HOUR_OFFSET, &days, &seconds );
-
-    // Calculates seconds
-    CalendarDiv60( seconds, &minutes, &divReminder );
-    localtime->tm_sec = ( uint8_t )divReminder;
-
-    // Calculates minutes and hours
-    CalendarDiv60( minutes, &divOut, &divReminder);
-    localtime->tm_min = ( uint8_t )divReminder;
-    localtime->tm_hour = ( uint8_t )divOut;
 
-    // Calculates year
-    localtime->tm_year = DIV_365_25( days );
-    days-= DIVC_BY_4( ( TM_DAYS_IN_YEAR * 3 + TM_DAYS_IN_LEAP_YEAR ) * localtime->tm_year );
+    seconds -= hours * TM_SECONDS_IN_1HOUR;
+    minutes = DIV_60( seconds );
+    seconds -= minutes * TM_SECONDS_IN_1MINUTE;
 
-    localtime->tm_yday = days;
+    localtime->tm_sec = seconds;
+    localtime->tm_min = minutes;
+    localtime->tm_hour = hours;
 
-    // Calculates month
-    localtime->tm_mon = CalendarGetMonth( days, localtime->tm_year );
+    CRITICAL_SECTION_BEGIN( );
+    date = CalendarCache;
+    CRITICAL_SECTION_END( );
 
-    // calculates weekdays
-    weekDays += DIVC_BY_4( ( localtime->tm_year * 5 ) );
-    weekDays += days;
-    localtime->tm_wday = MODULO_7( weekDays );
-
-    days -= ( DIVC_BY_2( ( localtime->tm_mon ) * ( 30 + 31 ) ) -
-              ( ( ( correctionMonth[localtime->tm_year % 4] >> ( ( localtime->tm_mon ) * 2 ) ) & 0x03 ) ) );
+    if( date.Days != days )
+    {
+        CalendarFromDays( days, &date );
 
-    // Convert 0 to 1 indexed.
-    localtime->tm_mday = days + 1;
+        CRITICAL_SECTION_BEGIN( );
+        CalendarCache = date;
+        CRITICAL_SECTION_END( );
+    }
 
-    localtime->tm_year += UNIX_YEAR;
+    localtime->tm_year = date.Year;
+    localtime->tm_yday = date.YearDay;
+    localtime->tm_mon = date.Month;
+    localtime->tm_wday = date.WeekDay;
+    localtime->tm_mday = date.MonthDay;
 
     localtime->tm_isdst = -1;
 }
 
-static uint32_t CalendarGetMonth( uint32_t days, uint32_t year )
+/*!
+ * \brief Converts a number of days since UNIX epoch into a calendar date.
+ *        Constant time, valid for the whole uint32_t UNIX time range.
+ *
+ * \param [IN]  days Days since the 1st of January 1970
+ * \param [OUT] date Calendar date
+ */
+static void CalendarFromDays( uint32_t days, CalendarDate_t* date )
 {
-    uint32_t month;
-    if( ( year % 4 ) == 0 )
-    {   /*leap year*/
-        if( days < END_OF_FEBRUARY_LEAP )
-        {   // January or February
-            // month =  days * 2 / ( 30 + 31 );
-            month = CalendarDiv61( days * 2 );
-        }
-        else if( days < END_OF_JULY_LEAP )
-        {
-            month = CalendarDiv61( ( days - END_OF_FEBRUARY_LEAP ) * 2 ) + 2;
-        }
-        else
-        {
-            month = CalendarDiv61( ( days - END_OF_JULY_LEAP ) * 2 ) + 7;
-        }
+    // Days since the 1st of March 1968, counting a 29th of February 2100
+    uint32_t dayNumber = days + CALENDAR_DAYS_TO_UNIX_EPOCH;
+    uint32_t cycles;
+    uint32_t years;
+    uint32_t months;
+    uint32_t isJanuaryOrFebruary;
+    uint32_t isLeapYear;
+
+    dayNumber += ( dayNumber >= CALENDAR_DAYS_TO_MARCH_2100 ) ? 1 : 0;
+
+    // Years starting on the 1st of March
+    cycles = DIV_1461( dayNumber );
+    dayNumber -= cycles * CALENDAR_DAYS_IN_4_YEARS;
+    years = DIV_1461_SMALL( ( dayNumber * 4 ) + 3 );
+    dayNumber -= ( years * CALENDAR_DAYS_IN_4_YEARS ) >> 2;
+    years += cycles * 4;
+
+    // Months starting in March. 153 days every 5 months.
+    months = DIV_153( ( dayNumber * 5 ) + 2 );
+    isJanuaryOrFebruary = ( months >= 10 ) ? 1 : 0;
+
+    date->Days = days;
+    date->Year = UNIX_YEAR + years + isJanuaryOrFebruary;
+    isLeapYear = ( ( ( date->Year & 0x03 ) == 0 ) && ( date->Year != 200 ) ) ? 1 : 0;
+    date->MonthDay = dayNumber - DIV_5( ( months * 153 ) + 2 ) + 1;
+    if( isJanuaryOrFebruary == 1 )
+    {
+        date->Month = months - 10;
+        date->YearDay = dayNumber - CALENDAR_DAYS_MARCH_TO_JANUARY;
     }
     else
     {
-        if( days < END_OF_FEBRUARY_NORM )
-        {   // January or February
-            month = CalendarDiv61( days * 2 );
-        }
-        else if( days < END_OF_JULY_NORM )
-        {
-            month = CalendarDiv61( ( days - END_OF_FEBRUARY_NORM ) * 2 ) + 2;
-        }
-        else
-        {
-            month = CalendarDiv61( ( days - END_OF_JULY_NORM ) * 2 ) + 7;
-        }
+        date->Month = months + 2;
+        date->YearDay = dayNumber + CALENDAR_DAYS_JANUARY_TO_MARCH + isLeapYear;
     }
-    return month;
+    // The 1st of January 1970 is a Thursday
+    date->WeekDay = ( days + TM_WEEKDAY_THURSDAY ) - ( DIV_7( days + TM_WEEKDAY_THURSDAY ) * 7 );
 }
 
-static void CalendarDiv86400( uint32_t in, uint32_t* out, uint32_t* remainder )
+/*!
+ * \brief Converts a calendar date into a number of days since UNIX epoch.
+ *        Constant time, valid from March 1968 to 2106. Dates before 1970
+ *        wrap around.
+ *
+ * \param [IN] year     Years since 1900
+ * \param [IN] month    Month [0..11]
+ * \param [IN] monthDay Day of the month [1..31]
+ *
+ * \retval days Days since the 1st of January 1970
+ */
+static uint32_t CalendarToDays( uint32_t year, uint32_t month, uint32_t monthDay )
 {
-#if 0
-    *remainder = in % SECONDS_IN_1DAY;
-    *out       = in / SECONDS_IN_1DAY;
-#else
-    uint32_t outTemp = 0;
-    uint32_t divResult = DIV_APPROX_86400( in );
-
-    while( divResult >=1 )
+    uint32_t dayNumber;
+
+    // Years and months starting on the 1st of March 1968
+    year -= UNIX_YEAR;
+    if( month < TM_MONTH_MARCH )
     {
-        outTemp += divResult;
-        in -= divResult * 86400;
-        divResult= DIV_APPROX_86400( in );
+        year -= 1;
+        month += 10;
     }
-    if( in >= 86400 )
+    else
     {
-        outTemp += 1;
-        in -= 86400;
+        month -= 2;
     }
 
-    *remainder = in;
-    *out = outTemp;
-#endif
-}
+    dayNumber = ( ( year * CALENDAR_DAYS_IN_4_YEARS ) >> 2 ) + DIV_5( ( month * 153 ) + 2 ) + monthDay - 1;
 
-static uint32_t CalendarDiv61( uint32_t in )
-{
-#if 0
-    return( in / 61 );
-#else
-    uint32_t outTemp = 0;
-    uint32_t divResult = DIV_APPROX_61( in );
-    while( divResult >=1 )
-    {
-        outTemp += divResult;
-        in -= divResult * 61;
-        divResult = DIV_APPROX_61( in );
-    }
-    if( in >= 61 )
-    {
-        outTemp += 1;
-        in -= 61;
-    }
-    return outTemp;
-#endif
-}
+    // Remove the 29th of February 2100
+    dayNumber -= ( dayNumber > CALENDAR_DAYS_TO_MARCH_2100 ) ? 1 : 0;
 
-static void CalendarDiv60( uint32_t in, uint32_t* out, uint32_t* remainder )
-{
-#if 0
-    *remainder = in % 60;
-    *out       = in / 60;
-#else
-    uint32_t outTemp = 0;
-    uint32_t divResult = DIV_APPROX_60( in );
-
-    while( divResult >=1 )
-    {
-        outTemp += divResult;
-        in -= divResult * 60;
-        divResult = DIV_APPROX_60( in );
-    }
-    if( in >= 60 )
-    {
-        outTemp += 1;
-        in -= 60;
-    }
-    *remainder = in;
-    *out = outTemp;
-#endif
+    return dayNumber - CALENDAR_DAYS_TO_UNIX_EPOCH;
 }
@@ -0,0 +1,310 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     ADR policies host test. Runs the stock and the link margin ADR
+ *            policies on a channel model and reports the energy spent per
+ *            delivered byte.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <math.h>
+#include <stdlib.h>
+#include "test.h"
+#include "utilities.h"
+#include "radio.h"
+#include "lmhandler-host.h"
+#include "region/Region.h"
+#include "LoRaMacAdr.h"
+
+/*!
+ * Number of uplinks per simulation
+ */
+#define NB_UPLINKS                                  4000
+
+/*!
+ * Application payload size
+ */
+#define APP_PAYLOAD_SIZE                            20
+
+/*!
+ * LoRaWAN frame overhead, MHDR, FHDR, FPort and MIC
+ */
+#define FRAME_OVERHEAD_SIZE                         13
+
+/*!
+ * The network sends a downlink, DevStatusReq for instance, every
+ * DOWNLINK_PERIOD uplinks
+ */
+#define DOWNLINK_PERIOD                             8
+
+/*!
+ * Standard deviation of the channel SNR around its mean, in dB
+ */
+#define SHADOWING_STD_DEV                           3.0
+
+/*!
+ * Supply voltage in V
+ */
+#define SUPPLY_VOLTAGE                              3.3
+
+/*!
+ * Number of uplinks the network server ADR is based on
+ */
+#define NS_ADR_HISTORY_SIZE                         20
+
+/*!
+ * Network server ADR installation margin in dB
+ */
+#define NS_ADR_INSTALLATION_MARGIN                  10.0
+
+/*!
+ * Approximate SX1276 supply current in mA per EU868 TX power index,
+ * 16 dBm EIRP down to 2 dBm EIRP by 2 dB steps
+ */
+static const double TxCurrent[] = { 90.0, 44.0, 38.0, 32.0, 29.0, 26.0, 23.0, 20.0 };
+
+typedef enum eAdrMode
+{
+    /*!
+     * Stock policy, the network server doesn't run ADR
+     */
+    ADR_MODE_STOCK,
+    /*!
+     * Stock policy, the network server runs ADR and sends LinkADRReq
+     */
+    ADR_MODE_STOCK_NS_ADR,
+    /*!
+     * Link margin policy, the network server doesn't run ADR
+     */
+    ADR_MODE_LINK_MARGIN,
+}AdrMode_t;
+
+static const char* AdrModeNames[] = { "stock", "stock + NS ADR", "link margin" };
+
+/*!
+ * Channel scenario. The mean channel SNR at the maximum TX power moves
+ * linearly from SnrStart to SnrEnd.
+ */
+typedef struct sScenario
+{
+    const char* Name;
+    double SnrStart;
+    double SnrEnd;
+}Scenario_t;
+
+static const Scenario_t Scenarios[] =
+{
+    { "near",      5.0,   5.0 },
+    { "mid",      -5.0,  -5.0 },
+    { "far",     -14.0, -14.0 },
+    { "drifting",  5.0, -14.0 },
+};
+
+typedef struct sSimResult
+{
+    uint32_t NbDelivered;
+    double Energy;
+    double DrSum;
+    /*!
+     * Link margin SNR estimate minus the channel SNR at the end of the run
+     */
+    double SnrError;
+}SimResult_t;
+
+/*!
+ * Random generator state
+ */
+static uint32_t RandomState;
+
+static double Uniform( void )
+{
+    RandomState = RandomState * 1103515245 + 12345;
+    return ( ( RandomState >> 8 ) + 1.0 ) / 16777218.0;
+}
+
+static double Gaussian( void )
+{
+    return sqrt( -2.0 * log( Uniform( ) ) ) * cos( 2.0 * M_PI * Uniform( ) );
+}
+
+/*!
+ * Demodulation SNR floor of the EU868 LoRa 125 kHz datarates
+ */
+static double SnrFloor( int8_t datarate )
+{
+    return -20.0 + ( 2.5 * datarate );
+}
+
+/*!
+ * Semtech reference network server ADR. Spends the margin above the best
+ * recent SNR by 3 dB steps. Only the delivered uplinks are seen, which biases
+ * the best SNR upwards when the fading is fast.
+ */
+static void NsAdr( double maxSnr, int8_t* datarate, int8_t* txPower )
+{
+    int32_t nbSteps = ( int32_t )floor( ( maxSnr - SnrFloor( *datarate ) - NS_ADR_INSTALLATION_MARGIN ) / 3.0 );
+
+    while( ( nbSteps > 0 ) && ( *datarate < DR_5 ) )
+    {
+        ( *datarate )++;
+        nbSteps--;
+    }
+    while( ( nbSteps > 0 ) && ( *txPower < TX_POWER_7 ) )
+    {
+        ( *txPower )++;
+        nbSteps--;
+    }
+    while( ( nbSteps < 0 ) && ( *txPower > TX_POWER_0 ) )
+    {
+        ( *txPower )--;
+        nbSteps++;
+    }
+}
+
+static void Simulate( const Scenario_t* scenario, AdrMode_t mode, SimResult_t* result )
+{
+    CalcNextAdrParams_t adrNext;
+    const RegionPhyParams_t* phy = RegionGetPhyParams( LORAMAC_REGION_EU868 );
+    double nsSnrHistory[NS_ADR_HISTORY_SIZE];
+    uint32_t nbNsSnr = 0;
+    int8_t datarate = DR_0;
+    int8_t txPower = TX_POWER_0;
+    uint8_t nbTrans = 1;
+    uint32_t adrAckCounter = 0;
+    double channelSnr = scenario->SnrStart;
+
+    RandomState = 1;
+    LoRaMacAdrLinkMarginReset( );
+    LoRaMacAdrSetPolicy( ( mode == ADR_MODE_LINK_MARGIN ) ? LoRaMacAdrLinkMarginPolicy : NULL );
+    result->NbDelivered = 0;
+    result->Energy = 0;
+    result->DrSum = 0;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        channelSnr = scenario->SnrStart + ( ( scenario->SnrEnd - scenario->SnrStart ) * i ) / NB_UPLINKS;
+        double snr;
+        uint32_t timeOnAir;
+
+        adrNext.UpdateChanMask = false;
+        adrNext.AdrEnabled = true;
+        adrNext.AdrAckCounter = adrAckCounter;
+        adrNext.AdrAckLimit = 64;
+        adrNext.AdrAckDelay = 32;
+        adrNext.Datarate = datarate;
+        adrNext.TxPower = txPower;
+        adrNext.NbTrans = nbTrans;
+        adrNext.UplinkDwellTime = 0;
+        adrNext.Region = LORAMAC_REGION_EU868;
+        LoRaMacAdrCalcNext( &adrNext, &datarate, &txPower, &nbTrans, &adrAckCounter );
+        adrAckCounter++;
+
+        TEST_CHECK( ( datarate >= phy->MinTxDr[0] ) && ( datarate <= MIN( phy->MaxTxDr, DR_5 ) ) );
+        TEST_CHECK( ( txPower >= phy->MaxTxPower ) && ( txPower <= phy->MinTxPower ) );
+
+        timeOnAir = Radio.TimeOnAir( MODEM_LORA, 0, 12 - datarate, 1, 8, false,
+                                     FRAME_OVERHEAD_SIZE + APP_PAYLOAD_SIZE, true );
+        result->Energy += SUPPLY_VOLTAGE * TxCurrent[txPower] * timeOnAir;
+        result->DrSum += datarate;
+
+        // Each TX power step is 2 dB lower
+        snr = channelSnr - ( 2.0 * txPower ) + ( SHADOWING_STD_DEV * Gaussian( ) );
+        if( snr < SnrFloor( datarate ) )
+        {
+            continue;
+        }
+        result->NbDelivered++;
+
+        if( mode == ADR_MODE_STOCK_NS_ADR )
+        {
+            nsSnrHistory[nbNsSnr % NS_ADR_HISTORY_SIZE] = snr;
+            nbNsSnr++;
+        }
+
+        if( ( ( i % DOWNLINK_PERIOD ) != 0 ) && ( adrAckCounter < adrNext.AdrAckLimit ) )
+        {
+            continue;
+        }
+
+        // Downlink in RX1, the gateway transmits at the maximum power
+        snr = channelSnr + ( SHADOWING_STD_DEV * Gaussian( ) );
+        if( snr < SnrFloor( datarate ) )
+        {
+            continue;
+        }
+        adrAckCounter = 0;
+        LoRaMacAdrLinkMarginAddRxMetrics( ( int16_t )lround( snr - 110.0 ), ( int8_t )lround( snr ) );
+
+        if( ( mode == ADR_MODE_STOCK_NS_ADR ) && ( nbNsSnr >= NS_ADR_HISTORY_SIZE ) )
+        {
+            double maxSnr = nsSnrHistory[0];
+
+            for( uint8_t j = 1; j < NS_ADR_HISTORY_SIZE; j++ )
+            {
+                maxSnr = MAX( maxSnr, nsSnrHistory[j] );
+            }
+            // LinkADRReq carried by this downlink
+            NsAdr( maxSnr, &datarate, &txPower );
+            nbNsSnr = 0;
+        }
+    }
+    result->SnrError = ( LoRaMacAdrGetLinkMargin( )->Snr / 256.0 ) - channelSnr;
+    LoRaMacAdrSetPolicy( NULL );
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = true,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+
+    // The region channels are used by the stock policy back off
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    printf( "%-9s %-15s %6s %7s %10s %8s\n", "channel", "ADR", "PDR %", "mean DR", "uJ / byte", "vs stock" );
+    for( uint8_t i = 0; i < ( sizeof( Scenarios ) / sizeof( Scenarios[0] ) ); i++ )
+    {
+        SimResult_t results[3];
+
+        for( AdrMode_t mode = ADR_MODE_STOCK; mode <= ADR_MODE_LINK_MARGIN; mode++ )
+        {
+            SimResult_t* result = &results[mode];
+
+            Simulate( &Scenarios[i], mode, result );
+            result->Energy /= ( double )result->NbDelivered * APP_PAYLOAD_SIZE;
+            printf( "%-9s %-15s %6.1f %7.2f %10.1f %7.1f%%\n", Scenarios[i].Name, AdrModeNames[mode],
+                    ( 100.0 * result->NbDelivered ) / NB_UPLINKS, result->DrSum / NB_UPLINKS, result->Energy,
+                    ( 100.0 * result->Energy ) / results[ADR_MODE_STOCK].Energy );
+        }
+
+        // The estimator tracks the channel. The link margin policy keeps the
+        // link and never spends more energy per delivered byte than the stock
+        // policy.
+        TEST_CHECK( fabs( results[ADR_MODE_LINK_MARGIN].SnrError ) < 3.0 );
+        TEST_CHECK( results[ADR_MODE_LINK_MARGIN].NbDelivered >= ( ( NB_UPLINKS * 95 ) / 100 ) );
+        TEST_CHECK( results[ADR_MODE_LINK_MARGIN].Energy <= ( results[ADR_MODE_STOCK].Energy * 1.001 ) );
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
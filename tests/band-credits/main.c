@@ -0,0 +1,422 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Band credits host test. Runs the bands time-off computation
+ *            next to the former per call credits update over random
+ *            transmission, join, duty cycle and restore histories.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "timer.h"
+#include "RegionNvm.h"
+#include "rtc-board-host.h"
+
+/*
+ * Credit model under test, including its private constants
+ */
+#include "RegionCommon.c"
+
+/*!
+ * Number of random histories
+ */
+#define NB_HISTORIES                                200
+
+/*!
+ * Number of steps per history
+ */
+#define NB_STEPS                                    3000
+
+/*!
+ * Duty cycles the bands are drawn from
+ */
+static const uint16_t DutyCycles[] = { 0, 1, 10, 100, 1000 };
+
+/*!
+ * History state. One instance per credit model
+ */
+typedef struct sHistoryState
+{
+    Band_t Bands[REGION_NVM_MAX_NB_BANDS];
+    bool Joined;
+    bool DutyCycleEnabled;
+}HistoryState_t;
+
+/*!
+ * Bands handled by the credit model under test
+ */
+static HistoryState_t State;
+
+/*!
+ * Bands handled by the reference credit model
+ */
+static HistoryState_t StateRef;
+
+/*!
+ * Default bands, refer to INIT_TYPE_DEFAULTS
+ */
+static Band_t DefaultBands[REGION_NVM_MAX_NB_BANDS];
+
+/*!
+ * Number of bands of the current history
+ */
+static uint8_t NbBands;
+
+/*!
+ * Time of the last initialization
+ */
+static uint32_t StartupTime;
+
+/*!
+ * Cycles spent in the time-off computation per credit model
+ */
+static uint64_t Cycles;
+static uint64_t CyclesRef;
+static uint32_t NbUpdates;
+
+/*
+ * Former credits update, synchronizing the bands on every call
+ */
+static uint16_t GetDutyCycleRef( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup )
+{
+    uint16_t dutyCycle = band->DCycle;
+
+    if( joined == false )
+    {
+        uint16_t joinDutyCycle = BACKOFF_DC_1_HOUR;
+
+        // Take the most restrictive duty cycle
+        dutyCycle = MAX( dutyCycle, joinDutyCycle );
+    }
+
+    // Prevent value of 0
+    if( dutyCycle == 0 )
+    {
+        dutyCycle = 1;
+    }
+
+    return dutyCycle;
+}
+
+static uint16_t SetMaxTimeCreditsRef( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup,
+                                      bool dutyCycleEnabled, bool lastTxIsJoinRequest )
+{
+    uint16_t dutyCycle = band->DCycle;
+    TimerTime_t maxCredits = DUTY_CYCLE_TIME_PERIOD;
+
+    dutyCycle = GetDutyCycleRef( band, joined, elapsedTimeSinceStartup );
+
+    if( joined == false )
+    {
+        if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_1_HOUR_IN_S )
+        {
+            maxCredits = DUTY_CYCLE_TIME_PERIOD;
+        }
+        else if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_10_HOURS_IN_S )
+        {
+            maxCredits = DUTY_CYCLE_TIME_PERIOD;
+        }
+        else
+        {
+            maxCredits = DUTY_CYCLE_TIME_PERIOD_JOIN_BACKOFF_24H;
+        }
+    }
+    else
+    {
+        if( dutyCycleEnabled == false )
+        {
+            // Assign max credits when the duty cycle is disabled.
+            band->TimeCredits = maxCredits;
+        }
+    }
+
+    band->MaxTimeCredits = maxCredits;
+
+    return dutyCycle;
+}
+
+static uint16_t UpdateTimeCreditsRef( Band_t* band, bool joined, bool dutyCycleEnabled,
+                                      bool lastTxIsJoinRequest, SysTime_t elapsedTimeSinceStartup,
+                                      TimerTime_t currentTime, TimerTime_t lastBandUpdateTime )
+{
+    uint16_t dutyCycle = SetMaxTimeCreditsRef( band, joined, elapsedTimeSinceStartup,
+                                               dutyCycleEnabled, lastTxIsJoinRequest );
+    TimerTime_t observation = DUTY_CYCLE_TIME_PERIOD;
+
+    if( joined == false )
+    {
+        if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_1_HOUR_IN_S )
+        {
+            observation = BACKOFF_DUTY_CYCLE_1_HOUR_IN_S * 1000;
+        }
+        else if( elapsedTimeSinceStartup.Seconds < BACKOFF_DUTY_CYCLE_10_HOURS_IN_S )
+        {
+            observation = ( BACKOFF_DUTY_CYCLE_10_HOURS_IN_S * 1000 );
+        }
+        else
+        {
+            observation = ( BACKOFF_DUTY_CYCLE_24_HOURS_IN_S * 1000 );
+        }
+    }
+
+    // Apply new credits only if the observation period has been elapsed.
+    if( ( observation <= lastBandUpdateTime ) ||
+        ( band->LastMaxCreditAssignTime != observation ) ||
+        ( band->LastBandUpdateTime == 0 ) )
+    {
+        band->TimeCredits = band->MaxTimeCredits;
+        band->LastBandUpdateTime = currentTime;
+        band->LastMaxCreditAssignTime = observation;
+    }
+    return dutyCycle;
+}
+
+static void SetBandTxDoneRef( Band_t* band, TimerTime_t lastTxAirTime, bool joined, SysTime_t elapsedTimeSinceStartup )
+{
+    uint16_t dutyCycle = GetDutyCycleRef( band, joined, elapsedTimeSinceStartup );
+
+    if( band->TimeCredits > ( lastTxAirTime * dutyCycle ) )
+    {
+        band->TimeCredits -= ( lastTxAirTime * dutyCycle );
+    }
+    else
+    {
+        band->TimeCredits = 0;
+    }
+}
+
+static TimerTime_t UpdateBandTimeOffRef( bool joined, Band_t* bands,
+                                         uint8_t nbBands, bool dutyCycleEnabled,
+                                         bool lastTxIsJoinRequest, SysTime_t elapsedTimeSinceStartup,
+                                         TimerTime_t expectedTimeOnAir )
+{
+    TimerTime_t minTimeToWait = TIMERTIME_T_MAX;
+    TimerTime_t currentTime = TimerGetCurrentTime( );
+    TimerTime_t creditCosts = 0;
+    uint16_t dutyCycle = 1;
+    uint8_t validBands = 0;
+
+    for( uint8_t i = 0; i < nbBands; i++ )
+    {
+        TimerTime_t elapsedTime = TimerGetElapsedTime( bands[i].LastBandUpdateTime );
+
+        dutyCycle = UpdateTimeCreditsRef( &bands[i], joined, dutyCycleEnabled,
+                                          lastTxIsJoinRequest, elapsedTimeSinceStartup,
+                                          currentTime, elapsedTime );
+
+        creditCosts = expectedTimeOnAir * dutyCycle;
+
+        if( ( bands[i].TimeCredits > creditCosts ) ||
+            ( ( dutyCycleEnabled == false ) && ( joined == true ) ) )
+        {
+            bands[i].ReadyForTransmission = true;
+            validBands++;
+        }
+        else
+        {
+            bands[i].ReadyForTransmission = false;
+
+            if( bands[i].MaxTimeCredits > creditCosts )
+            {
+                TimerTime_t observationTimeDiff = 0;
+                if( bands[i].LastMaxCreditAssignTime >= elapsedTime )
+                {
+                    observationTimeDiff = bands[i].LastMaxCreditAssignTime - elapsedTime;
+                }
+                minTimeToWait = MIN( minTimeToWait, observationTimeDiff );
+                validBands++;
+            }
+        }
+    }
+
+    if( validBands == 0 )
+    {
+        return TIMERTIME_T_MAX;
+    }
+    return minTimeToWait;
+}
+
+/*
+ * History steps
+ */
+static uint32_t Random( uint32_t max )
+{
+    return ( ( ( uint32_t )rand( ) << 16 ) ^ ( uint32_t )rand( ) ) % ( max + 1 );
+}
+
+static SysTime_t GetElapsedTimeSinceStartup( void )
+{
+    uint32_t elapsed = RtcHostGetTime( ) - StartupTime;
+    SysTime_t sysTime = { .Seconds = elapsed / 1000, .SubSeconds = elapsed % 1000 };
+
+    return sysTime;
+}
+
+static void AdvanceTime( void )
+{
+    uint32_t draw = Random( 99 );
+
+    if( draw < 60 )
+    {
+        RtcHostAdvance( Random( 5000 ) );
+    }
+    else if( draw < 90 )
+    {
+        RtcHostAdvance( Random( 600000 ) );
+    }
+    else
+    {
+        RtcHostAdvance( Random( 7200000 ) );
+    }
+}
+
+static void CheckBands( void )
+{
+    for( uint8_t i = 0; i < NbBands; i++ )
+    {
+        TEST_CHECK( State.Bands[i].TimeCredits == StateRef.Bands[i].TimeCredits );
+        TEST_CHECK( State.Bands[i].MaxTimeCredits == StateRef.Bands[i].MaxTimeCredits );
+        TEST_CHECK( State.Bands[i].LastBandUpdateTime == StateRef.Bands[i].LastBandUpdateTime );
+        TEST_CHECK( State.Bands[i].LastMaxCreditAssignTime == StateRef.Bands[i].LastMaxCreditAssignTime );
+        TEST_CHECK( State.Bands[i].ReadyForTransmission == StateRef.Bands[i].ReadyForTransmission );
+    }
+}
+
+static void InitBands( void )
+{
+    // Refer to LoRaMacInitialization
+    StartupTime = RtcHostGetTime( );
+    memcpy1( ( uint8_t* )State.Bands, ( uint8_t* )DefaultBands, sizeof( DefaultBands ) );
+    memcpy1( ( uint8_t* )StateRef.Bands, ( uint8_t* )DefaultBands, sizeof( DefaultBands ) );
+    State.Joined = StateRef.Joined = false;
+    State.DutyCycleEnabled = StateRef.DutyCycleEnabled = true;
+    RegionCommonResetBandsCtx( );
+}
+
+static void UpdateBandTimeOff( void )
+{
+    SysTime_t elapsedTimeSinceStartup = GetElapsedTimeSinceStartup( );
+    TimerTime_t expectedTimeOnAir = Random( 3000 );
+    bool lastTxIsJoinRequest = ( Random( 1 ) == 1 );
+    TimerTime_t timeOff = 0;
+    TimerTime_t timeOffRef = 0;
+    uint64_t start = 0;
+
+    start = TestGetCycles( );
+    timeOff = RegionCommonUpdateBandTimeOff( State.Joined, State.Bands, NbBands, State.DutyCycleEnabled,
+                                             lastTxIsJoinRequest, elapsedTimeSinceStartup, expectedTimeOnAir );
+    Cycles += TestGetCycles( ) - start;
+
+    start = TestGetCycles( );
+    timeOffRef = UpdateBandTimeOffRef( StateRef.Joined, StateRef.Bands, NbBands, StateRef.DutyCycleEnabled,
+                                       lastTxIsJoinRequest, elapsedTimeSinceStartup, expectedTimeOnAir );
+    CyclesRef += TestGetCycles( ) - start;
+    NbUpdates++;
+
+    TEST_CHECK( timeOff == timeOffRef );
+    CheckBands( );
+}
+
+static void SetBandTxDone( void )
+{
+    SysTime_t elapsedTimeSinceStartup = GetElapsedTimeSinceStartup( );
+    TimerTime_t airTime = Random( 3000 );
+    uint8_t band = Random( NbBands - 1 );
+
+    RegionCommonSetBandTxDone( &State.Bands[band], airTime, State.Joined, elapsedTimeSinceStartup );
+    SetBandTxDoneRef( &StateRef.Bands[band], airTime, StateRef.Joined, elapsedTimeSinceStartup );
+    CheckBands( );
+}
+
+static void RunHistory( void )
+{
+    HistoryState_t saved;
+    bool isSaved = false;
+
+    NbBands = 1 + Random( REGION_NVM_MAX_NB_BANDS - 1 );
+    memset1( ( uint8_t* )DefaultBands, 0, sizeof( DefaultBands ) );
+    for( uint8_t i = 0; i < NbBands; i++ )
+    {
+        DefaultBands[i].DCycle = DutyCycles[Random( ( sizeof( DutyCycles ) / sizeof( DutyCycles[0] ) ) - 1 )];
+        DefaultBands[i].TxMaxPower = TX_POWER_0;
+    }
+    InitBands( );
+
+    for( uint32_t step = 0; step < NB_STEPS; step++ )
+    {
+        uint32_t draw = Random( 999 );
+
+        AdvanceTime( );
+        if( draw < 450 )
+        {
+            UpdateBandTimeOff( );
+        }
+        else if( draw < 900 )
+        {
+            // The MAC computes the time-off before every transmission
+            UpdateBandTimeOff( );
+            SetBandTxDone( );
+        }
+        else if( draw < 950 )
+        {
+            // Join accept, or a new join procedure
+            State.Joined = StateRef.Joined = ( Random( 3 ) != 0 );
+        }
+        else if( draw < 970 )
+        {
+            State.DutyCycleEnabled = StateRef.DutyCycleEnabled = !State.DutyCycleEnabled;
+        }
+        else if( draw < 985 )
+        {
+            // Contexts stored to the NVM
+            memcpy1( ( uint8_t* )&saved, ( uint8_t* )&State, sizeof( HistoryState_t ) );
+            isSaved = true;
+        }
+        else if( draw < 998 )
+        {
+            if( isSaved == true )
+            {
+                // Contexts restored from the NVM, refer to RestoreNvmData
+                memcpy1( ( uint8_t* )&State, ( uint8_t* )&saved, sizeof( HistoryState_t ) );
+                memcpy1( ( uint8_t* )&StateRef, ( uint8_t* )&saved, sizeof( HistoryState_t ) );
+                RegionCommonResetBandsCtx( );
+            }
+        }
+        else
+        {
+            InitBands( );
+        }
+    }
+}
+
+int main( void )
+{
+    srand( 1 );
+    // The bands consider a last update time of 0 as never synchronized
+    RtcHostAdvance( 1 );
+
+    for( uint32_t i = 0; i < NB_HISTORIES; i++ )
+    {
+        RunHistory( );
+    }
+
+    printf( "Time-off computation: %llu %s per call, %llu before\n",
+            ( unsigned long long )( Cycles / NbUpdates ), TEST_CYCLES_UNIT,
+            ( unsigned long long )( CyclesRef / NbUpdates ) );
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,292 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     EU868 channel selection host test. Simulates periodic uplinks
+ *            through the region band code, checks the sub-band limits and
+ *            compares the uplinks per hour of the channel selection modes.
+ *
+ *            Built once per EU868_CREDIT_AWARE_CHANNEL_SELECTION mode. The
+ *            random mode stores its results to the file given as argument,
+ *            the credit-aware mode compares its results with them.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "timer.h"
+#include "LoRaMac.h"
+#include "Region.h"
+#include "RegionNvm.h"
+#include "RegionEU868.h"
+#include "rtc-board-host.h"
+
+/*!
+ * Simulated duration
+ */
+#define SIMULATION_HOURS                            48
+
+/*!
+ * Period of the uplink attempts in ms
+ */
+#define UPLINK_PERIOD                               10000
+
+/*!
+ * Observation period of the bands in ms
+ */
+#define OBSERVATION_PERIOD                          3600000
+
+/*!
+ * Telemetry frame size
+ */
+#define FRAME_SIZE                                  20
+
+/*!
+ * Large frame size, the maximum payload at SF12
+ */
+#define LARGE_FRAME_SIZE                            51
+
+/*!
+ * Number of simulated datarates, SF12 to SF7
+ */
+#define NB_DATARATES                                6
+
+/*!
+ * Channel plan under test
+ */
+typedef struct sChannelPlan
+{
+    const char* Name;
+    /*!
+     * Frequencies of the channels added to the default channels
+     */
+    uint32_t Frequencies[8];
+    uint8_t NbFrequencies;
+}ChannelPlan_t;
+
+static const ChannelPlan_t ChannelPlans[] =
+{
+    { "8 channels in two 1% bands", { 867100000, 867300000, 867500000, 867700000, 867900000 }, 5 },
+    { "3 channels at 1% plus one at 0.1%", { 868850000 }, 1 },
+};
+
+/*!
+ * Frame size mix under test
+ */
+typedef struct sFrameMix
+{
+    const char* Name;
+    /*!
+     * Share of the large frames in %
+     */
+    uint8_t LargeFrames;
+}FrameMix_t;
+
+static const FrameMix_t FrameMixes[] =
+{
+    { "fixed size", 0 },
+    { "25% large", 25 },
+};
+
+/*!
+ * Region NVM storage
+ */
+static RegionNvmDataGroup1_t NvmGroup1;
+static RegionNvmDataGroup2_t NvmGroup2;
+static Band_t Bands[REGION_NVM_MAX_NB_BANDS];
+
+/*!
+ * Air time of the bands in the current observation period
+ */
+static TimerTime_t BandAirTime[REGION_NVM_MAX_NB_BANDS];
+
+static void InitRegion( const ChannelPlan_t* plan )
+{
+    InitDefaultsParams_t params;
+
+    memset( &NvmGroup1, 0, sizeof( NvmGroup1 ) );
+    memset( &NvmGroup2, 0, sizeof( NvmGroup2 ) );
+    memset( Bands, 0, sizeof( Bands ) );
+    params.Type = INIT_TYPE_DEFAULTS;
+    params.NvmGroup1 = &NvmGroup1;
+    params.NvmGroup2 = &NvmGroup2;
+    params.Bands = Bands;
+    RegionInitDefaults( LORAMAC_REGION_EU868, &params );
+    RegionResetBandsCtx( );
+
+    for( uint8_t i = 0; i < plan->NbFrequencies; i++ )
+    {
+        ChannelParams_t channel = { 0 };
+        ChannelAddParams_t channelAdd;
+
+        channel.Frequency = plan->Frequencies[i];
+        channel.DrRange.Value = ( DR_5 << 4 ) | DR_0;
+        channelAdd.NewChannel = &channel;
+        channelAdd.ChannelId = 3 + i;
+        TEST_CHECK( RegionChannelAdd( LORAMAC_REGION_EU868, &channelAdd ) == LORAMAC_STATUS_OK );
+    }
+}
+
+/*!
+ * \brief Simulates one uplink attempt per UPLINK_PERIOD and checks that no
+ *        band exceeds its duty cycle in any observation period
+ *
+ * \retval Number of uplinks sent
+ */
+static uint32_t Simulate( const ChannelPlan_t* plan, const FrameMix_t* mix, int8_t datarate )
+{
+    uint32_t startTime = 0;
+    uint32_t period = 0;
+    uint32_t nbUplinks = 0;
+
+    InitRegion( plan );
+    srand( 1 );
+    srand1( 1 );
+    memset( BandAirTime, 0, sizeof( BandAirTime ) );
+    startTime = RtcHostGetTime( );
+
+    for( uint32_t attempt = 0; attempt < ( SIMULATION_HOURS * 3600000UL / UPLINK_PERIOD ); attempt++ )
+    {
+        uint32_t elapsed = RtcHostGetTime( ) - startTime;
+        NextChanParams_t nextChan = { 0 };
+        SetBandTxDoneParams_t txDone;
+        TimerTime_t timeOnAir = 0;
+        TimerTime_t time = 0;
+        TimerTime_t aggregatedTimeOff = 0;
+        uint8_t channel = 0;
+
+        // The bands observation periods start with the first uplink attempt
+        if( ( elapsed / OBSERVATION_PERIOD ) != period )
+        {
+            period = elapsed / OBSERVATION_PERIOD;
+            memset( BandAirTime, 0, sizeof( BandAirTime ) );
+        }
+
+        nextChan.Datarate = datarate;
+        nextChan.Joined = true;
+        nextChan.DutyCycleEnabled = true;
+        nextChan.ElapsedTimeSinceStartUp.Seconds = elapsed / 1000;
+        nextChan.ElapsedTimeSinceStartUp.SubSeconds = elapsed % 1000;
+        nextChan.PktLen = ( ( uint32_t )( rand( ) % 100 ) < mix->LargeFrames ) ? LARGE_FRAME_SIZE : FRAME_SIZE;
+        // MAC header, frame header, port and MIC
+        nextChan.PktLen += 13;
+
+        RegionQueryNextChannel( LORAMAC_REGION_EU868, &nextChan, &time, &timeOnAir );
+        if( RegionNextChannel( LORAMAC_REGION_EU868, &nextChan, &channel, &time, &aggregatedTimeOff ) == LORAMAC_STATUS_OK )
+        {
+            uint8_t band = NvmGroup2.Channels[channel].Band;
+
+            txDone.Channel = channel;
+            txDone.Joined = true;
+            txDone.LastTxDoneTime = TimerGetCurrentTime( );
+            txDone.LastTxAirTime = timeOnAir;
+            txDone.ElapsedTimeSinceStartUp = nextChan.ElapsedTimeSinceStartUp;
+            RegionSetBandTxDone( LORAMAC_REGION_EU868, &txDone );
+
+            BandAirTime[band] += timeOnAir;
+            TEST_CHECK( ( BandAirTime[band] * Bands[band].DCycle ) <= OBSERVATION_PERIOD );
+            nbUplinks++;
+        }
+        RtcHostAdvance( UPLINK_PERIOD );
+    }
+    return nbUplinks;
+}
+
+int main( int argc, char* argv[] )
+{
+    uint32_t results[sizeof( ChannelPlans ) / sizeof( ChannelPlans[0] )]
+                    [sizeof( FrameMixes ) / sizeof( FrameMixes[0] )][NB_DATARATES];
+    FILE* file = NULL;
+
+    if( argc < 2 )
+    {
+        printf( "usage: %s <random mode results file>\n", argv[0] );
+        return 1;
+    }
+    // The bands consider a last update time of 0 as never synchronized
+    RtcHostAdvance( 1 );
+
+    for( uint8_t i = 0; i < ( sizeof( ChannelPlans ) / sizeof( ChannelPlans[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( FrameMixes ) / sizeof( FrameMixes[0] ) ); j++ )
+        {
+            for( int8_t dr = 0; dr < NB_DATARATES; dr++ )
+            {
+                results[i][j][dr] = Simulate( &ChannelPlans[i], &FrameMixes[j], dr );
+            }
+        }
+    }
+
+#if ( EU868_CREDIT_AWARE_CHANNEL_SELECTION == 0 )
+    file = fopen( argv[1], "w" );
+    TEST_CHECK( file != NULL );
+    if( file != NULL )
+    {
+        fwrite( results, sizeof( results ), 1, file );
+        fclose( file );
+    }
+    for( uint8_t i = 0; i < ( sizeof( ChannelPlans ) / sizeof( ChannelPlans[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( FrameMixes ) / sizeof( FrameMixes[0] ) ); j++ )
+        {
+            printf( "%s, %s:", ChannelPlans[i].Name, FrameMixes[j].Name );
+            for( int8_t dr = 0; dr < NB_DATARATES; dr++ )
+            {
+                printf( " SF%d %u/h", 12 - dr, results[i][j][dr] / SIMULATION_HOURS );
+            }
+            printf( "\n" );
+        }
+    }
+#else
+    uint32_t resultsRef[sizeof( ChannelPlans ) / sizeof( ChannelPlans[0] )]
+                       [sizeof( FrameMixes ) / sizeof( FrameMixes[0] )][NB_DATARATES];
+
+    file = fopen( argv[1], "r" );
+    TEST_CHECK( file != NULL );
+    if( ( file == NULL ) || ( fread( resultsRef, sizeof( resultsRef ), 1, file ) != 1 ) )
+    {
+        printf( "FAILED\n" );
+        return 1;
+    }
+    fclose( file );
+
+    for( uint8_t i = 0; i < ( sizeof( ChannelPlans ) / sizeof( ChannelPlans[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( FrameMixes ) / sizeof( FrameMixes[0] ) ); j++ )
+        {
+            printf( "%s, %s:", ChannelPlans[i].Name, FrameMixes[j].Name );
+            for( int8_t dr = 0; dr < NB_DATARATES; dr++ )
+            {
+                printf( " SF%d %u/h (%+.1f%%)", 12 - dr, results[i][j][dr] / SIMULATION_HOURS,
+                        ( 100.0 * results[i][j][dr] / resultsRef[i][j][dr] ) - 100.0 );
+                if( FrameMixes[j].LargeFrames == 0 )
+                {
+                    // Fixed size frames, both modes drain all the bands
+                    TEST_CHECK( results[i][j][dr] == resultsRef[i][j][dr] );
+                }
+                else
+                {
+                    // Mixed frame sizes, the band budgets still bound both modes
+                    TEST_CHECK( ( results[i][j][dr] * 100 ) >= ( resultsRef[i][j][dr] * 99 ) );
+                }
+            }
+            printf( "\n" );
+        }
+    }
+#endif
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
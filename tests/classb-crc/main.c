@@ -0,0 +1,255 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Class B beacon CRC and ping offsets host test. Checks the
+ *            nibble table beacon CRC against the bitwise CRC and the ping
+ *            offsets computed in one AES pass against the ones computed one
+ *            block at a time.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include "test.h"
+#include "rtc-board-host.h"
+#include "lmhandler-host.h"
+
+/*
+ * White box test, the beacon CRC and the ping offsets are private to the
+ * Class B module
+ */
+#include "LoRaMacClassB.c"
+
+/*!
+ * Number of random CRC buffers
+ */
+#define NB_CRC_BUFFERS                              100000
+
+/*!
+ * Maximum size of the random CRC buffers
+ */
+#define CRC_BUFFER_MAX_SIZE                         32
+
+/*!
+ * Number of random beacon periods
+ */
+#define NB_BEACON_PERIODS                           2000
+
+/*!
+ * Number of secure element AES encryptions
+ */
+static uint32_t NbAesEncrypt;
+
+SecureElementStatus_t __real_SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID, uint8_t* encBuffer );
+
+SecureElementStatus_t __wrap_SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID, uint8_t* encBuffer )
+{
+    NbAesEncrypt++;
+    return __real_SecureElementAesEncrypt( buffer, size, keyID, encBuffer );
+}
+
+/*
+ * Reference versions, processing one bit and one AES block at a time
+ */
+static uint16_t BeaconCrcRef( uint8_t *buffer, uint16_t length )
+{
+    // The CRC calculation follows CCITT
+    const uint16_t polynom = 0x1021;
+    uint16_t crc = 0x0000;
+
+    for( uint16_t i = 0; i < length; ++i )
+    {
+        crc ^= ( uint16_t ) buffer[i] << 8;
+        for( uint16_t j = 0; j < 8; ++j )
+        {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ polynom : ( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+static uint16_t ComputePingOffsetRef( uint32_t beaconTime, uint32_t address, uint16_t pingPeriod )
+{
+    uint8_t buffer[16];
+    uint8_t cipher[16];
+    uint32_t result = 0;
+
+    memset1( buffer, 0, 16 );
+    memset1( cipher, 0, 16 );
+
+    buffer[0] = ( beaconTime ) & 0xFF;
+    buffer[1] = ( beaconTime >> 8 ) & 0xFF;
+    buffer[2] = ( beaconTime >> 16 ) & 0xFF;
+    buffer[3] = ( beaconTime >> 24 ) & 0xFF;
+
+    buffer[4] = ( address ) & 0xFF;
+    buffer[5] = ( address >> 8 ) & 0xFF;
+    buffer[6] = ( address >> 16 ) & 0xFF;
+    buffer[7] = ( address >> 24 ) & 0xFF;
+
+    SecureElementAesEncrypt( buffer, 16, SLOT_RAND_ZERO_KEY, cipher );
+
+    result = ( ( ( uint32_t ) cipher[0] ) + ( ( ( uint32_t ) cipher[1] ) * 256 ) );
+    return ( uint16_t )( result % pingPeriod );
+}
+
+static void CheckBeaconCrc( void )
+{
+    uint8_t buffer[CRC_BUFFER_MAX_SIZE];
+    uint64_t cycles = 0;
+    uint64_t cyclesRef = 0;
+    uint32_t nbBytes = 0;
+
+    // All the 1 and 2 byte buffers
+    for( uint32_t value = 0; value < 0x10000; value++ )
+    {
+        buffer[0] = value & 0xFF;
+        buffer[1] = value >> 8;
+        TEST_CHECK( BeaconCrc( buffer, 1 ) == BeaconCrcRef( buffer, 1 ) );
+        TEST_CHECK( BeaconCrc( buffer, 2 ) == BeaconCrcRef( buffer, 2 ) );
+    }
+    TEST_CHECK( BeaconCrc( NULL, 4 ) == 0 );
+    TEST_CHECK( BeaconCrc( buffer, 0 ) == 0 );
+
+    for( uint32_t i = 0; i < NB_CRC_BUFFERS; i++ )
+    {
+        uint16_t length = rand( ) % ( CRC_BUFFER_MAX_SIZE + 1 );
+        uint16_t crc;
+        uint16_t crcRef;
+        uint64_t start;
+
+        for( uint16_t j = 0; j < length; j++ )
+        {
+            buffer[j] = rand( );
+        }
+        start = TestGetCycles( );
+        crc = BeaconCrc( buffer, length );
+        cycles += TestGetCycles( ) - start;
+        start = TestGetCycles( );
+        crcRef = BeaconCrcRef( buffer, length );
+        cyclesRef += TestGetCycles( ) - start;
+        nbBytes += length;
+
+        TEST_CHECK( crc == crcRef );
+    }
+    printf( "Beacon CRC: %.1f %s per byte, %.1f bitwise\n", ( double )cycles / nbBytes, TEST_CYCLES_UNIT,
+            ( double )cyclesRef / nbBytes );
+}
+
+/*!
+ * \brief Enables a random number of multicast groups, without unicast ping
+ *        slots one time out of four
+ *
+ * \retval Number of enabled multicast groups
+ */
+static uint8_t SetRandomGroups( void )
+{
+    uint8_t nbGroups = rand( ) % ( LORAMAC_MAX_MC_CTX + 1 );
+
+    *Ctx.LoRaMacClassBParams.LoRaMacDevAddr = rand( );
+    ClassBNvm->PingSlotCtx.Ctrl.Assigned = ( ( rand( ) % 4 ) != 0 ) ? 1 : 0;
+    ClassBNvm->PingSlotCtx.PingPeriod = 32 << ( rand( ) % 8 );
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        MulticastCtx_t *mc = &Ctx.LoRaMacClassBParams.MulticastChannels[i];
+
+        mc->ChannelParams.IsEnabled = ( i < nbGroups );
+        mc->ChannelParams.Address = rand( );
+        mc->PingPeriod = 32 << ( rand( ) % 8 );
+    }
+    return nbGroups;
+}
+
+static void CheckPingOffsets( void )
+{
+    uint32_t nbPrepared = 0;
+
+    for( uint32_t period = 0; period < NB_BEACON_PERIODS; period++ )
+    {
+        uint8_t nbGroups = SetRandomGroups( );
+        uint32_t beaconTime = ( ( uint32_t )rand( ) << 16 ) ^ rand( );
+        uint16_t pingOffset = 0;
+
+        Ctx.BeaconCtx.BeaconTime.Seconds = beaconTime;
+
+        // One AES pass at the beacon reception as soon as a ping slot
+        // sequence exists, the unicast one or a multicast one
+        NbAesEncrypt = 0;
+        PreparePingOffsetCache( );
+        if( ( ClassBNvm->PingSlotCtx.Ctrl.Assigned == 1 ) || ( nbGroups > 0 ) )
+        {
+            TEST_CHECK( NbAesEncrypt == 1 );
+            TEST_CHECK( Ctx.PingOffsetCache.BeaconTime == beaconTime );
+            TEST_CHECK( Ctx.PingOffsetCache.NbEntries == ( 1 + nbGroups ) );
+            nbPrepared++;
+        }
+        else
+        {
+            TEST_CHECK( NbAesEncrypt == 0 );
+        }
+
+        // The slots of the beacon period use the prepared ping offsets
+        NbAesEncrypt = 0;
+        if( ClassBNvm->PingSlotCtx.Ctrl.Assigned == 1 )
+        {
+            ComputePingOffset( beaconTime, *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
+                               ClassBNvm->PingSlotCtx.PingPeriod, &pingOffset );
+            TEST_CHECK( pingOffset == ComputePingOffsetRef( beaconTime, *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
+                                                            ClassBNvm->PingSlotCtx.PingPeriod ) );
+        }
+        for( uint8_t i = 0; i < nbGroups; i++ )
+        {
+            MulticastCtx_t *mc = &Ctx.LoRaMacClassBParams.MulticastChannels[i];
+
+            ComputePingOffset( beaconTime, mc->ChannelParams.Address, mc->PingPeriod, &pingOffset );
+            TEST_CHECK( pingOffset == ComputePingOffsetRef( beaconTime, mc->ChannelParams.Address, mc->PingPeriod ) );
+        }
+        // Only the reference versions encrypted
+        TEST_CHECK( NbAesEncrypt == ( ClassBNvm->PingSlotCtx.Ctrl.Assigned + nbGroups ) );
+
+        // An unknown address, e.g. a group enabled during the beacon period
+        {
+            uint32_t address = ~*Ctx.LoRaMacClassBParams.LoRaMacDevAddr;
+
+            ComputePingOffset( beaconTime, address, 128, &pingOffset );
+            TEST_CHECK( pingOffset == ComputePingOffsetRef( beaconTime, address, 128 ) );
+        }
+    }
+    printf( "Ping offsets: %u of %u beacon periods prepared\n", nbPrepared, NB_BEACON_PERIODS );
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+
+    // The ping offsets are computed by the secure element
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    srand( 1 );
+    CheckBeaconCrc( );
+    CheckPingOffsets( );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,152 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Class B clock drift estimator host test. Feeds the estimator
+ *            with the beacon receptions of drifting local clocks and checks
+ *            the predicted timing errors.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <math.h>
+#include <stdlib.h>
+#include "test.h"
+
+/*
+ * White box test, the estimator is private to the Class B module
+ */
+#include "LoRaMacClassB.c"
+
+/*!
+ * Number of simulated beacon periods
+ */
+#define NB_BEACONS                                  2000
+
+/*!
+ * One beacon out of BEACON_MISS_PERIOD is missed
+ */
+#define BEACON_MISS_PERIOD                          10
+
+/*!
+ * Longest beacon-less prediction, in beacon periods
+ */
+#define MAX_PREDICTION_PERIODS                      4
+
+/*!
+ * Amplitude of the slow drift wander, temperature for instance, in ppm
+ */
+#define DRIFT_WANDER_PPM                            5.0
+
+/*!
+ * Period of the drift wander in ms
+ */
+#define DRIFT_WANDER_PERIOD                         ( 6 * 3600e3 )
+
+/*!
+ * Fixed system error the windows are widened by without estimator, in ms
+ */
+#define SYSTEM_MAX_RX_ERROR                         10
+
+/*!
+ * Mean drifts of the simulated clocks in ppm
+ */
+static const double Drifts[] = { -40.0, -10.0, 0.0, 25.0, 60.0 };
+
+/*!
+ * Mean drift of the simulated clock in ppm
+ */
+static double DriftPpm;
+
+/*!
+ * \brief Local clock of the device
+ *
+ * \param [IN] time Network time in ms
+ *
+ * \retval Local time in ms
+ */
+static double LocalTime( double time )
+{
+    double w = 2.0 * M_PI / DRIFT_WANDER_PERIOD;
+
+    return 1000.0 + time + ( DriftPpm * 1e-6 * time ) + ( DRIFT_WANDER_PPM * 1e-6 * ( 1.0 - cos( w * time ) ) / w );
+}
+
+int main( void )
+{
+    for( uint8_t i = 0; i < ( sizeof( Drifts ) / sizeof( Drifts[0] ) ); i++ )
+    {
+        ClockDriftEstimator_t estimator = { 0 };
+        uint32_t nbPredictions[MAX_PREDICTION_PERIODS + 1] = { 0 };
+        uint32_t nbViolations[MAX_PREDICTION_PERIODS + 1] = { 0 };
+        double maxError[MAX_PREDICTION_PERIODS + 1] = { 0 };
+        double maxRawError[MAX_PREDICTION_PERIODS + 1] = { 0 };
+        double boundSum[MAX_PREDICTION_PERIODS + 1] = { 0 };
+
+        DriftPpm = Drifts[i];
+        srand( 7 + i );
+        for( uint32_t beacon = 0; beacon < NB_BEACONS; beacon++ )
+        {
+            double time = beacon * ( double )CLASSB_BEACON_INTERVAL;
+            TimerTime_t rxTime;
+
+            if( ( rand( ) % BEACON_MISS_PERIOD ) == 0 )
+            {
+                continue;
+            }
+            // The reception is time stamped with a +/- 1 ms error
+            rxTime = ( TimerTime_t )llround( LocalTime( time ) + ( ( rand( ) % 3 ) - 1 ) );
+            UpdateClockDrift( &estimator, rxTime, 1000000 + ( beacon * ( CLASSB_BEACON_INTERVAL / 1000 ) ) );
+            if( IsClockDriftValid( &estimator, rxTime ) == false )
+            {
+                continue;
+            }
+
+            // Predict the next beacons as if they were missed
+            for( uint8_t k = 1; k <= MAX_PREDICTION_PERIODS; k++ )
+            {
+                TimerTime_t nominal = rxTime + ( k * CLASSB_BEACON_INTERVAL );
+                double actual = LocalTime( time + ( k * ( double )CLASSB_BEACON_INTERVAL ) );
+                double error = fabs( ( double )ApplyClockDrift( &estimator, nominal ) - actual );
+                uint32_t bound = GetClockDriftError( &estimator, nominal );
+
+                nbPredictions[k]++;
+                boundSum[k] += bound;
+                if( error > bound )
+                {
+                    nbViolations[k]++;
+                }
+                maxError[k] = MAX( maxError[k], error );
+                maxRawError[k] = MAX( maxRawError[k], fabs( ( double )nominal - actual ) );
+            }
+        }
+
+        printf( "drift %+3.0f ppm: estimate %+6.1f ppm, deviation %4.1f ppm\n", DriftPpm,
+                estimator.Drift / 256.0, estimator.Deviation / 256.0 );
+        TEST_CHECK( fabs( ( estimator.Drift / 256.0 ) - DriftPpm ) <= ( DRIFT_WANDER_PPM * 2 ) );
+        for( uint8_t k = 1; k <= MAX_PREDICTION_PERIODS; k++ )
+        {
+            double meanBound = boundSum[k] / nbPredictions[k];
+
+            printf( "  +%u periods: max error %5.1f ms, uncompensated %5.1f ms, mean bound %4.1f ms, violations %u / %u\n",
+                    k, maxError[k], maxRawError[k], meanBound, nbViolations[k], nbPredictions[k] );
+            // The bound holds for at least 99 % of the receptions and stays
+            // below the fixed system error the windows were widened by
+            TEST_CHECK( ( nbViolations[k] * 100 ) <= nbPredictions[k] );
+            TEST_CHECK( meanBound < ( SYSTEM_MAX_RX_ERROR * k ) );
+            TEST_CHECK( maxError[k] <= ( maxRawError[k] + CLASSB_DRIFT_TIMESTAMP_ERROR ) );
+        }
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,267 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Class B slot schedule host test. Compares the merged slot
+ *            schedule of the unicast and of four multicast sequences with a
+ *            scan of the beacon window and reports the cost of a slot lookup.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include "test.h"
+#include "rtc-board-host.h"
+#include "lmhandler-host.h"
+
+/*
+ * White box test, the slot schedule is private to the Class B module
+ */
+#include "LoRaMacClassB.c"
+
+/*!
+ * Number of simulated beacon periods
+ */
+#define NB_RUNS                                     200
+
+/*!
+ * Number of multicast groups scheduled along with the unicast
+ */
+#define NB_MC_GROUPS                                4
+
+/*!
+ * \brief Finds the next slot of a state machine by scanning all the slots of
+ *        the beacon window
+ *
+ * \param [IN] isUnicast Set to true for the unicast state machine
+ * \param [OUT] sequence Sequence owning the slot
+ * \param [OUT] timeOffset Time offset of the next slot, based on current time
+ *
+ * \retval [true: slot found, false: no slot left in the beacon period]
+ */
+static bool FindNextSlot( bool isUnicast, uint8_t* sequence, TimerTime_t* timeOffset )
+{
+    SlotSequence_t sequences[CLASSB_NB_PING_OFFSETS];
+    TimerTime_t currentTime = TimerGetCurrentTime( );
+    TimerTime_t lastBeaconRx = SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx );
+    TimerTime_t periodStart = currentTime - ( ( currentTime - lastBeaconRx ) % CLASSB_BEACON_INTERVAL );
+
+    for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+    {
+        GetSlotSequence( i, &sequences[i] );
+        if( sequences[i].PingPeriod != 0 )
+        {
+            ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds, sequences[i].Address,
+                               sequences[i].PingPeriod, &sequences[i].PingOffset );
+        }
+    }
+
+    for( uint16_t slot = 0; slot < CLASSB_BEACON_WINDOW_SLOTS; slot++ )
+    {
+        TimerTime_t slotTime = periodStart + CLASSB_BEACON_RESERVED + ( slot * CLASSB_PING_SLOT_WINDOW );
+        int8_t owner = -1;
+
+        if( slotTime < currentTime )
+        {
+            continue;
+        }
+        for( uint8_t i = 0; i < CLASSB_NB_PING_OFFSETS; i++ )
+        {
+            if( ( sequences[i].PingPeriod == 0 ) || ( ( slot % sequences[i].PingPeriod ) != sequences[i].PingOffset ) )
+            {
+                continue;
+            }
+            if( ( owner < 0 ) ||
+                ( CheckSlotPriority( sequences[owner].Address, sequences[owner].FPendingSet, ( owner != 0 ) ? 1 : 0,
+                                     sequences[i].Address, sequences[i].FPendingSet, ( i != 0 ) ? 1 : 0 ) == true ) )
+            {
+                owner = i;
+            }
+        }
+        if( ( owner < 0 ) || ( ( owner == 0 ) != isUnicast ) )
+        {
+            continue;
+        }
+        if( slotTime > ( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - CLASSB_BEACON_GUARD - CLASSB_PING_SLOT_WINDOW ) )
+        {
+            return false;
+        }
+        *sequence = owner;
+        *timeOffset = slotTime - Radio.GetWakeupTime( ) - currentTime;
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief Looks up the next slot the way the state machines did before the
+ *        slot schedule, once per sequence
+ *
+ * \param [IN] isUnicast Set to true for the unicast state machine
+ */
+static void CalcNextSlots( bool isUnicast )
+{
+    TimerTime_t timeOffset;
+
+    if( isUnicast == true )
+    {
+        CalcNextSlotTime( Ctx.PingSlotCtx.PingOffset, ClassBNvm->PingSlotCtx.PingPeriod,
+                          ClassBNvm->PingSlotCtx.PingNb, &timeOffset );
+        return;
+    }
+    for( uint8_t i = 0; i < NB_MC_GROUPS; i++ )
+    {
+        MulticastCtx_t *mc = &Ctx.LoRaMacClassBParams.MulticastChannels[i];
+
+        CalcNextSlotTime( mc->PingOffset, mc->PingPeriod, mc->PingNb, &timeOffset );
+    }
+}
+
+/*!
+ * \brief Gets a random ping period, pingNb = 1 up to pingNb = 128
+ */
+static uint16_t RandomPingPeriod( void )
+{
+    return 32 << ( rand( ) % 8 );
+}
+
+/*!
+ * \brief Sets random slot sequences which fit into the slot schedule
+ */
+static void SetSlotSequences( void )
+{
+    uint16_t patternLength;
+    uint16_t nbSlots;
+
+    *Ctx.LoRaMacClassBParams.LoRaMacDevAddr = rand( );
+    ClassBNvm->PingSlotCtx.Ctrl.Assigned = 1;
+    ClassBNvm->PingSlotCtx.FPendingSet = rand( ) & 1;
+    for( uint8_t i = 0; i < NB_MC_GROUPS; i++ )
+    {
+        MulticastCtx_t *mc = &Ctx.LoRaMacClassBParams.MulticastChannels[i];
+
+        mc->ChannelParams.IsEnabled = true;
+        mc->ChannelParams.Address = rand( );
+        mc->FPendingSet = rand( ) & 1;
+    }
+
+    do
+    {
+        ClassBNvm->PingSlotCtx.PingPeriod = RandomPingPeriod( );
+        patternLength = ClassBNvm->PingSlotCtx.PingPeriod;
+        for( uint8_t i = 0; i < NB_MC_GROUPS; i++ )
+        {
+            Ctx.LoRaMacClassBParams.MulticastChannels[i].PingPeriod = RandomPingPeriod( );
+            patternLength = MAX( patternLength, Ctx.LoRaMacClassBParams.MulticastChannels[i].PingPeriod );
+        }
+        nbSlots = patternLength / ClassBNvm->PingSlotCtx.PingPeriod;
+        for( uint8_t i = 0; i < NB_MC_GROUPS; i++ )
+        {
+            nbSlots += patternLength / Ctx.LoRaMacClassBParams.MulticastChannels[i].PingPeriod;
+        }
+    }while( nbSlots > CLASSB_SLOT_SCHEDULE_SIZE );
+
+    ClassBNvm->PingSlotCtx.PingNb = CLASSB_BEACON_WINDOW_SLOTS / ClassBNvm->PingSlotCtx.PingPeriod;
+    for( uint8_t i = 0; i < NB_MC_GROUPS; i++ )
+    {
+        MulticastCtx_t *mc = &Ctx.LoRaMacClassBParams.MulticastChannels[i];
+
+        mc->PingNb = CLASSB_BEACON_WINDOW_SLOTS / mc->PingPeriod;
+    }
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    uint32_t nbEvents = 0;
+    uint32_t nbMismatches = 0;
+    uint64_t scheduleCycles = 0;
+    uint64_t calcCycles = 0;
+
+    // The ping offsets are computed by the secure element
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    srand( 1 );
+    for( uint16_t run = 0; run < NB_RUNS; run++ )
+    {
+        SetSlotSequences( );
+        Ctx.BeaconCtx.BeaconTime.Seconds = 1000000 + ( run * 128 );
+
+        for( uint8_t cursorId = 0; cursorId < SLOT_SCHEDULE_NB_CURSORS; cursorId++ )
+        {
+            bool isUnicast = ( cursorId == SLOT_SCHEDULE_CURSOR_UNICAST );
+
+            // Start at a random point of a new beacon period
+            RtcHostAdvance( CLASSB_BEACON_INTERVAL );
+            Ctx.BeaconCtx.LastBeaconRx = SysTimeFromMs( TimerGetCurrentTime( ) - ( rand( ) % 2000 ) );
+            Ctx.BeaconCtx.NextBeaconRx = Ctx.BeaconCtx.LastBeaconRx;
+            Ctx.BeaconCtx.NextBeaconRx.Seconds += CLASSB_BEACON_INTERVAL / 1000;
+            if( isUnicast == true )
+            {
+                ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds, *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
+                                   ClassBNvm->PingSlotCtx.PingPeriod, &Ctx.PingSlotCtx.PingOffset );
+            }
+
+            while( true )
+            {
+                uint8_t sequence = 0;
+                uint8_t refSequence = 0;
+                TimerTime_t timeOffset = 0;
+                TimerTime_t refTimeOffset = 0;
+                SlotScheduleStatus_t status;
+                bool found;
+                uint64_t start = TestGetCycles( );
+
+                status = GetNextScheduledSlot( ( SlotScheduleCursorId_t )cursorId, &sequence, &timeOffset );
+                scheduleCycles += TestGetCycles( ) - start;
+                start = TestGetCycles( );
+                CalcNextSlots( isUnicast );
+                calcCycles += TestGetCycles( ) - start;
+
+                found = FindNextSlot( isUnicast, &refSequence, &refTimeOffset );
+                nbEvents++;
+
+                TEST_CHECK( status != SLOT_SCHEDULE_UNAVAILABLE );
+                if( ( ( status == SLOT_SCHEDULE_FOUND ) != found ) ||
+                    ( ( found == true ) && ( ( sequence != refSequence ) || ( timeOffset != refTimeOffset ) ) ) )
+                {
+                    nbMismatches++;
+                }
+                if( ( found == false ) || ( status != SLOT_SCHEDULE_FOUND ) )
+                {
+                    break;
+                }
+                // The state machine wakes up after the slot
+                RtcHostAdvance( timeOffset + Radio.GetWakeupTime( ) + 1 + ( rand( ) % 20 ) );
+            }
+        }
+    }
+
+    printf( "%u slot lookups, %u mismatches\n", nbEvents, nbMismatches );
+    printf( "slot schedule %.0f %s / lookup, CalcNextSlotTime per sequence %.0f %s / lookup\n",
+            ( double )scheduleCycles / nbEvents, TEST_CYCLES_UNIT, ( double )calcCycles / nbEvents, TEST_CYCLES_UNIT );
+    TEST_CHECK( nbMismatches == 0 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,317 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Clock synchronization package host test. Runs the clock
+ *            discipline for a month on a drifting MCU clock and reports the
+ *            system time error and the number of requests.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <math.h>
+#include <string.h>
+#include "test.h"
+#include "rtc-board-host.h"
+#include "systime.h"
+#include "LmHandler.h"
+#include "LmhpClockSync.h"
+
+/*!
+ * Simulation length in days
+ */
+#define SIMULATION_DAYS                             30
+
+/*!
+ * Simulation step in ms of MCU time
+ */
+#define SIMULATION_STEP                             1000
+
+/*!
+ * Mean MCU clock drift and amplitude of its daily swing, in ppm
+ */
+#define MCU_DRIFT                                   25.0
+#define MCU_DRIFT_SWING                             3.0
+
+/*!
+ * AppTimeReq uplink time on air in ms
+ */
+#define UPLINK_TIME_ON_AIR                          400
+
+/*!
+ * Delay from the end of the uplink to the confirmation and the downlink, in ms
+ */
+#define RX_DELAY                                    1000
+
+/*!
+ * Percentage of lost uplinks and of AppTimeAns off by BOGUS_CORRECTION s
+ */
+#define UPLINK_LOSS_PERCENT                         10
+#define BOGUS_ANSWER_PERCENT                        2
+#define BOGUS_CORRECTION                            5
+
+/*!
+ * Period of the application AppTimeReq until the first synchronization, in ms
+ */
+#define FIRST_SYNC_PERIOD                           60000
+
+/*!
+ * The error is measured once the first synchronization is SETTLE_TIME old, in ms
+ */
+#define SETTLE_TIME                                 3600000
+
+typedef struct sSimResult
+{
+    double RequestsPerDay;
+    double RmsError;
+    double MaxError;
+}SimResult_t;
+
+/*
+ * Simulated network. The times are the true Unix times in ms.
+ */
+static double TrueTime;
+static double UplinkEndTime;
+static double BusyEndTime;
+static double ConfirmTime;
+static double DownlinkTime;
+static uint8_t AppTimeReq[6];
+static bool IsUplinkLost;
+static bool IsAnswerBogus;
+static bool IsDeviceTimeSupported;
+static uint32_t NbRequests;
+static bool IsSynchronized;
+static bool IsProcessRequested;
+
+/*!
+ * Random generator state
+ */
+static uint32_t RandomState;
+
+static uint32_t RandomPercent( void )
+{
+    RandomState = RandomState * 1103515245 + 12345;
+    return ( ( RandomState >> 8 ) & 0xFFFFFF ) % 100;
+}
+
+/*
+ * LoRaMac handler and MAC layer, only as far as the package uses them
+ */
+bool LmHandlerIsBusy( void )
+{
+    return TrueTime < BusyEndTime;
+}
+
+LmHandlerFlagStatus_t LmHandlerJoinStatus( void )
+{
+    return LORAMAC_HANDLER_SET;
+}
+
+TimerTime_t LmHandlerGetDutyCycleWaitTime( void )
+{
+    return 0;
+}
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
+{
+    memset( &mibGet->Param, 0, sizeof( mibGet->Param ) );
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed )
+{
+    if( ( appData->Port == 202 ) && ( appData->Buffer[0] == 0x01 ) )
+    {
+        memcpy( AppTimeReq, appData->Buffer, sizeof( AppTimeReq ) );
+        NbRequests++;
+        UplinkEndTime = TrueTime + UPLINK_TIME_ON_AIR;
+        ConfirmTime = UplinkEndTime + RX_DELAY;
+        DownlinkTime = ConfirmTime;
+        BusyEndTime = ConfirmTime + RX_DELAY;
+        IsUplinkLost = RandomPercent( ) < UPLINK_LOSS_PERCENT;
+        IsAnswerBogus = RandomPercent( ) < BOGUS_ANSWER_PERCENT;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+static LmHandlerErrorStatus_t OnDeviceTimeRequest( void )
+{
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+static void OnPackageProcessRequest( uint8_t id )
+{
+    IsProcessRequested = true;
+}
+
+static void OnSysTimeUpdate( bool isSynchronized, int32_t timeCorrection )
+{
+    IsSynchronized = true;
+}
+
+/*!
+ * \brief Sends the AppTimeAns, and the DeviceTimeAns when supported
+ *
+ * \param [IN] package Clock synchronization package
+ */
+static void ReceiveDownlink( LmhPackage_t *package )
+{
+    uint32_t deviceTime = AppTimeReq[1] | ( AppTimeReq[2] << 8 ) | ( AppTimeReq[3] << 16 ) | ( ( uint32_t )AppTimeReq[4] << 24 );
+    int64_t uplinkEndGpsTime = ( int64_t )floor( UplinkEndTime / 1000.0 ) - UNIX_GPS_EPOCH_OFFSET;
+    int32_t correction = ( int32_t )( uplinkEndGpsTime - deviceTime ) + ( IsAnswerBogus ? BOGUS_CORRECTION : 0 );
+    uint8_t appTimeAns[6] = { 0x01, correction, correction >> 8, correction >> 16, correction >> 24, AppTimeReq[5] & 0x0F };
+    McpsIndication_t mcpsIndication;
+
+    memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+    mcpsIndication.Port = 202;
+    mcpsIndication.Buffer = appTimeAns;
+    mcpsIndication.BufferSize = sizeof( appTimeAns );
+
+    if( IsDeviceTimeSupported == true )
+    {
+        // DeviceTimeAns has a resolution of 1/256 s
+        double time = ( floor( UplinkEndTime * 0.256 ) / 0.256 ) + ( TrueTime - UplinkEndTime );
+        SysTime_t sysTime = { .Seconds = ( uint32_t )( time / 1000.0 ), .SubSeconds = ( int16_t )fmod( time, 1000.0 ) };
+
+        SysTimeSet( sysTime );
+        mcpsIndication.DeviceTimeAnsReceived = true;
+        IsSynchronized = true;
+    }
+    package->OnMcpsIndicationProcess( &mcpsIndication );
+    package->OnPortDataProcess( &mcpsIndication );
+    // The LoRaMac handler processes the package after its events
+    IsProcessRequested = true;
+}
+
+/*!
+ * \brief Runs the clock discipline for SIMULATION_DAYS
+ *
+ * \param [IN]  isDeviceTimeSupported Set to true if the network answers DeviceTimeReq
+ * \param [OUT] result                Requests and system time error
+ */
+static void Simulate( bool isDeviceTimeSupported, SimResult_t *result )
+{
+    static uint8_t dataBuffer[242];
+    LmhPackage_t *package = LmphClockSyncPackageFactory( );
+    double lastRequestTime = -FIRST_SYNC_PERIOD;
+    double syncTime = 0;
+    double endTime;
+    double sumSquares = 0;
+    uint32_t nbRequestsAtSync = 0;
+    uint32_t nbErrors = 0;
+
+    TrueTime = 1.7e12;
+    endTime = TrueTime + ( SIMULATION_DAYS * 86400e3 );
+    BusyEndTime = 0;
+    ConfirmTime = 0;
+    DownlinkTime = 0;
+    NbRequests = 0;
+    IsSynchronized = false;
+    IsProcessRequested = false;
+    IsDeviceTimeSupported = isDeviceTimeSupported;
+    RandomState = 1;
+    result->MaxError = 0;
+
+    package->OnDeviceTimeRequest = OnDeviceTimeRequest;
+    package->OnPackageProcessRequest = OnPackageProcessRequest;
+    package->OnSysTimeUpdate = OnSysTimeUpdate;
+    package->Init( NULL, dataBuffer, sizeof( dataBuffer ) );
+
+    while( TrueTime < endTime )
+    {
+        double drift = MCU_DRIFT + ( MCU_DRIFT_SWING * sin( ( 2.0 * M_PI * TrueTime ) / 86400e3 ) );
+
+        TrueTime += SIMULATION_STEP / ( 1.0 + ( drift * 1e-6 ) );
+        RtcHostAdvance( SIMULATION_STEP );
+
+        if( ( ConfirmTime > 0 ) && ( TrueTime >= ConfirmTime ) )
+        {
+            McpsConfirm_t mcpsConfirm;
+
+            memset( &mcpsConfirm, 0, sizeof( mcpsConfirm ) );
+            mcpsConfirm.TxTimeOnAir = UPLINK_TIME_ON_AIR;
+            ConfirmTime = 0;
+            package->OnMcpsConfirmProcess( &mcpsConfirm );
+            IsProcessRequested = true;
+        }
+        if( ( DownlinkTime > 0 ) && ( TrueTime >= DownlinkTime ) )
+        {
+            DownlinkTime = 0;
+            if( IsUplinkLost == false )
+            {
+                ReceiveDownlink( package );
+            }
+        }
+
+        // The application only requests the first synchronization
+        if( ( IsSynchronized == false ) && ( ( TrueTime - lastRequestTime ) >= FIRST_SYNC_PERIOD ) &&
+            ( LmHandlerIsBusy( ) == false ) )
+        {
+            lastRequestTime = TrueTime;
+            LmhpClockSyncAppTimeReq( );
+        }
+        if( ( IsSynchronized == true ) && ( syncTime == 0 ) )
+        {
+            syncTime = TrueTime;
+            nbRequestsAtSync = NbRequests;
+        }
+
+        if( IsProcessRequested == true )
+        {
+            IsProcessRequested = false;
+            package->Process( );
+        }
+
+        if( ( syncTime != 0 ) && ( ( TrueTime - syncTime ) > SETTLE_TIME ) && ( ( RtcHostGetTime( ) % 60000 ) == 0 ) )
+        {
+            SysTime_t sysTime = SysTimeGet( );
+            double error = fabs( ( ( sysTime.Seconds * 1000.0 ) + sysTime.SubSeconds ) - TrueTime );
+
+            result->MaxError = MAX( result->MaxError, error );
+            sumSquares += error * error;
+            nbErrors++;
+        }
+    }
+
+    result->RequestsPerDay = ( NbRequests - nbRequestsAtSync ) / ( ( TrueTime - syncTime ) / 86400e3 );
+    result->RmsError = sqrt( sumSquares / nbErrors );
+}
+
+int main( void )
+{
+    SimResult_t result;
+
+    printf( "%u days, MCU clock %+.0f ppm +/- %.0f ppm daily, %u %% uplinks lost, %u %% bogus answers\n",
+            SIMULATION_DAYS, MCU_DRIFT, MCU_DRIFT_SWING, UPLINK_LOSS_PERCENT, BOGUS_ANSWER_PERCENT );
+
+    Simulate( false, &result );
+    printf( "AppTimeAns:    %5.2f requests / day, rms error %6.1f ms, max error %6.1f ms\n",
+            result.RequestsPerDay, result.RmsError, result.MaxError );
+    TEST_CHECK( result.RequestsPerDay < 1.0 );
+    TEST_CHECK( result.RmsError < 700.0 );
+    TEST_CHECK( result.MaxError < 1500.0 );
+
+    Simulate( true, &result );
+    printf( "DeviceTimeAns: %5.2f requests / day, rms error %6.1f ms, max error %6.1f ms\n",
+            result.RequestsPerDay, result.RmsError, result.MaxError );
+    TEST_CHECK( result.RequestsPerDay < 1.0 );
+    TEST_CHECK( result.RmsError < 100.0 );
+    TEST_CHECK( result.MaxError < 600.0 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
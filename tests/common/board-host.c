@@ -0,0 +1,56 @@
+/*!
+ * \file      board-host.c
+ *
+ * \brief     Board functions for the host tests
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include "utilities.h"
+#include "board.h"
+
+void BoardCriticalSectionBegin( uint32_t *mask )
+{
+    *mask = 0;
+}
+
+void BoardCriticalSectionEnd( uint32_t *mask )
+{
+}
+
+void BoardResetMcu( void )
+{
+}
+
+uint8_t BoardGetBatteryLevel( void )
+{
+    return 0;
+}
+
+int16_t BoardGetTemperature( void )
+{
+    return 25;
+}
+
+uint32_t BoardGetRandomSeed( void )
+{
+    return 0x12345678;
+}
+
+void BoardGetUniqueId( uint8_t *id )
+{
+    for( uint8_t i = 0; i < 8; i++ )
+    {
+        id[i] = i + 1;
+    }
+}
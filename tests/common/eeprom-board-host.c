@@ -0,0 +1,89 @@
+/*!
+ * \file      eeprom-board-host.c
+ *
+ * \brief     RAM backed EEPROM driver for the host tests
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "utilities.h"
+#include "eeprom-board.h"
+#include "eeprom-board-host.h"
+
+static uint8_t Eeprom[EEPROM_HOST_SIZE];
+
+EepromHostStats_t EepromHostStats;
+
+/*!
+ * Number of bytes written before a simulated power failure. -1: disabled
+ */
+static int32_t PowerFailCountdown = -1;
+
+void EepromHostErase( void )
+{
+    memset( Eeprom, 0xFF, sizeof( Eeprom ) );
+    memset( &EepromHostStats, 0, sizeof( EepromHostStats ) );
+    PowerFailCountdown = -1;
+}
+
+void EepromHostSetPowerFail( int32_t nbBytes )
+{
+    PowerFailCountdown = nbBytes;
+}
+
+LmnStatus_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    if( ( ( uint32_t )addr + size ) > sizeof( Eeprom ) )
+    {
+        return LMN_STATUS_ERROR;
+    }
+    EepromHostStats.NbWrites++;
+    EepromHostStats.NbBytesWritten += size;
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        if( PowerFailCountdown == 0 )
+        {
+            return LMN_STATUS_ERROR;
+        }
+        if( PowerFailCountdown > 0 )
+        {
+            PowerFailCountdown--;
+        }
+        if( Eeprom[addr + i] != buffer[i] )
+        {
+            EepromHostStats.NbCellWrites[addr + i]++;
+        }
+        Eeprom[addr + i] = buffer[i];
+    }
+    return LMN_STATUS_OK;
+}
+
+LmnStatus_t EepromMcuReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    if( ( ( uint32_t )addr + size ) > sizeof( Eeprom ) )
+    {
+        return LMN_STATUS_ERROR;
+    }
+    memcpy( buffer, Eeprom + addr, size );
+    return LMN_STATUS_OK;
+}
+
+void EepromMcuSetDeviceAddr( uint8_t addr )
+{
+}
+
+LmnStatus_t EepromMcuGetDeviceAddr( void )
+{
+    return LMN_STATUS_OK;
+}
@@ -0,0 +1,63 @@
+/*!
+ * \file      eeprom-board-host.h
+ *
+ * \brief     RAM backed EEPROM driver for the host tests
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#ifndef __EEPROM_BOARD_HOST_H__
+#define __EEPROM_BOARD_HOST_H__
+
+#include <stdint.h>
+
+/*!
+ * Size of the simulated EEPROM
+ */
+#define EEPROM_HOST_SIZE                            16384
+
+/*!
+ * Simulated EEPROM statistics
+ */
+typedef struct EepromHostStats_s
+{
+    /*!
+     * Number of write operations
+     */
+    uint32_t NbWrites;
+    /*!
+     * Number of bytes written
+     */
+    uint32_t NbBytesWritten;
+    /*!
+     * Number of times each cell value has changed
+     */
+    uint32_t NbCellWrites[EEPROM_HOST_SIZE];
+}EepromHostStats_t;
+
+extern EepromHostStats_t EepromHostStats;
+
+/*!
+ * \brief Erases the EEPROM and clears the statistics
+ */
+void EepromHostErase( void );
+
+/*!
+ * \brief Simulates a power failure after the given number of written bytes.
+ *        The following writes fail.
+ *
+ * \param [IN] nbBytes Number of bytes. -1 disables the power failure
+ */
+void EepromHostSetPowerFail( int32_t nbBytes );
+
+#endif // __EEPROM_BOARD_HOST_H__
@@ -0,0 +1,120 @@
+/*!
+ * \file      lmhandler-host.c
+ *
+ * \brief     Runs the LoRaMac handler on the simulated radio and RTC
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include "eeprom-board-host.h"
+#include "rtc-board-host.h"
+#include "radio-host.h"
+#include "LoRaMac.h"
+#include "lmhandler-host.h"
+
+/*
+ * LmHandler callbacks
+ */
+static uint8_t GetBatteryLevel( void )
+{
+    return 0;
+}
+
+static float GetTemperature( void )
+{
+    return 25.0f;
+}
+
+static uint32_t GetRandomSeed( void )
+{
+    return 0x12345678;
+}
+
+static void OnMacProcess( void )
+{
+}
+
+static void OnNetworkParametersChange( CommissioningParams_t *params )
+{
+}
+
+static void OnClassChange( DeviceClass_t deviceClass )
+{
+}
+
+static void OnBeaconStatusChange( LoRaMacHandlerBeaconParams_t *params )
+{
+}
+
+static LmHandlerCallbacks_t LmHandlerCallbacks =
+{
+    .GetBatteryLevel = GetBatteryLevel,
+    .GetTemperature = GetTemperature,
+    .GetRandomSeed = GetRandomSeed,
+    .OnMacProcess = OnMacProcess,
+    .OnNetworkParametersChange = OnNetworkParametersChange,
+    .OnClassChange = OnClassChange,
+    .OnBeaconStatusChange = OnBeaconStatusChange,
+};
+
+static uint8_t AppDataBuffer[242];
+
+bool LmHandlerHostInit( LmHandlerParams_t *params )
+{
+    MlmeReq_t mlmeReq;
+
+    if( params->DataBuffer == NULL )
+    {
+        params->DataBuffer = AppDataBuffer;
+        params->DataBufferMaxSize = sizeof( AppDataBuffer );
+    }
+
+    EepromHostErase( );
+    RadioHostReset( );
+    if( LmHandlerInit( &LmHandlerCallbacks, params ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return false;
+    }
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.NetworkActivation = ACTIVATION_TYPE_ABP;
+    mlmeReq.Req.Join.Datarate = params->TxDatarate;
+    if( LoRaMacMlmeRequest( &mlmeReq ) != LORAMAC_STATUS_OK )
+    {
+        return false;
+    }
+    LmHandlerHostRunUntilIdle( );
+    return LmHandlerJoinStatus( ) == LORAMAC_HANDLER_SET;
+}
+
+void LmHandlerHostRunUntilIdle( void )
+{
+    LmHandlerProcess( );
+    while( ( LoRaMacIsBusy( ) == true ) || ( RadioHost.State != RF_IDLE ) )
+    {
+        if( RadioHost.State == RF_TX_RUNNING )
+        {
+            RtcHostAdvance( RadioHost.TxTimeOnAir );
+            RadioHostTxDone( );
+        }
+        else if( RadioHost.State == RF_RX_RUNNING )
+        {
+            RadioHostRxTimeout( );
+        }
+        else if( RtcHostRunNextAlarm( ) == false )
+        {
+            break;
+        }
+        LmHandlerProcess( );
+    }
+}
@@ -0,0 +1,43 @@
+/*!
+ * \file      lmhandler-host.h
+ *
+ * \brief     Runs the LoRaMac handler on the simulated radio and RTC
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#ifndef __LMHANDLER_HOST_H__
+#define __LMHANDLER_HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "LmHandler.h"
+
+/*!
+ * \brief Initializes the simulated radio and EEPROM, the LoRaMac handler and
+ *        activates the device by personalization
+ *
+ * \param [IN] params LoRaMac handler parameters. The data buffer is provided
+ *                    when NULL
+ *
+ * \retval status [true: device activated, false: error]
+ */
+bool LmHandlerHostInit( LmHandlerParams_t *params );
+
+/*!
+ * \brief Runs the stack until the class A uplink cycle is over. No downlink
+ *        is received.
+ */
+void LmHandlerHostRunUntilIdle( void );
+
+#endif // __LMHANDLER_HOST_H__
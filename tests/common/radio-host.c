@@ -0,0 +1,319 @@
+/*!
+ * \file      radio-host.c
+ *
+ * \brief     Simulated radio driver for the host tests
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "radio-host.h"
+
+RadioHost_t RadioHost;
+
+/*!
+ * Radio events registered by the upper layer
+ */
+static RadioEvents_t *RadioEvents = NULL;
+
+/*!
+ * Settings of the last SetTxConfig call
+ */
+static struct
+{
+    RadioModems_t Modem;
+    uint32_t Bandwidth;
+    uint32_t Datarate;
+    uint8_t Coderate;
+    uint16_t PreambleLen;
+    bool FixLen;
+    bool CrcOn;
+}TxConfig;
+
+/*!
+ * Computes the LoRa time on air numerator, refer to the SX1276 driver
+ */
+static uint32_t RadioHostGetLoRaTimeOnAirNumerator( uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                                    uint16_t preambleLen, bool fixLen, uint8_t payloadLen,
+                                                    bool crcOn )
+{
+    int32_t crDenom = coderate + 4;
+    bool lowDatareOptimize = false;
+
+    if( ( datarate == 5 ) || ( datarate == 6 ) )
+    {
+        if( preambleLen < 12 )
+        {
+            preambleLen = 12;
+        }
+    }
+
+    if( ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+        ( ( bandwidth == 1 ) && ( datarate == 12 ) ) )
+    {
+        lowDatareOptimize = true;
+    }
+
+    int32_t ceilDenominator;
+    int32_t ceilNumerator = ( payloadLen << 3 ) + ( crcOn ? 16 : 0 ) - ( 4 * datarate ) + ( fixLen ? 0 : 20 );
+
+    if( datarate <= 6 )
+    {
+        ceilDenominator = 4 * datarate;
+    }
+    else
+    {
+        ceilNumerator += 8;
+        ceilDenominator = ( lowDatareOptimize == true ) ? 4 * ( datarate - 2 ) : 4 * datarate;
+    }
+
+    if( ceilNumerator < 0 )
+    {
+        ceilNumerator = 0;
+    }
+
+    int32_t intermediate =
+        ( ( ceilNumerator + ceilDenominator - 1 ) / ceilDenominator ) * crDenom + preambleLen + 12;
+
+    if( datarate <= 6 )
+    {
+        intermediate += 2;
+    }
+
+    return ( uint32_t )( ( 4 * intermediate + 1 ) * ( 1 << ( datarate - 2 ) ) );
+}
+
+static uint32_t RadioHostTimeOnAir( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                    uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn )
+{
+    uint32_t numerator = 0;
+    uint32_t denominator = 1;
+
+    if( modem == MODEM_FSK )
+    {
+        numerator = 1000U * ( ( preambleLen << 3 ) + 24 + ( ( fixLen ? 0 : 1 ) + payloadLen + ( crcOn ? 2 : 0 ) ) * 8 );
+        denominator = datarate;
+    }
+    else
+    {
+        numerator = 1000U * RadioHostGetLoRaTimeOnAirNumerator( bandwidth, datarate, coderate, preambleLen, fixLen,
+                                                                payloadLen, crcOn );
+        denominator = 125000UL << bandwidth;
+    }
+    return ( numerator + denominator - 1 ) / denominator;
+}
+
+static void RadioHostInit( RadioEvents_t *events )
+{
+    RadioEvents = events;
+    RadioHost.State = RF_IDLE;
+}
+
+static RadioState_t RadioHostGetStatus( void )
+{
+    return RadioHost.State;
+}
+
+static void RadioHostSetModem( RadioModems_t modem )
+{
+}
+
+static void RadioHostSetChannel( uint32_t freq )
+{
+    RadioHost.Frequency = freq;
+}
+
+static bool RadioHostIsChannelFree( uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh,
+                                    uint32_t maxCarrierSenseTime )
+{
+    return true;
+}
+
+static uint32_t RadioHostRandom( void )
+{
+    static uint32_t seed = 0x12345678;
+
+    seed = seed * 1103515245 + 12345;
+    return seed;
+}
+
+static void RadioHostSetRxConfig( RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                  uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted,
+                                  bool rxContinuous )
+{
+    RadioHost.RxDatarate = datarate;
+}
+
+static void RadioHostSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                  uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                  bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+    TxConfig.Modem = modem;
+    TxConfig.Bandwidth = bandwidth;
+    TxConfig.Datarate = datarate;
+    TxConfig.Coderate = coderate;
+    TxConfig.PreambleLen = preambleLen;
+    TxConfig.FixLen = fixLen;
+    TxConfig.CrcOn = crcOn;
+    RadioHost.TxPower = power;
+}
+
+static bool RadioHostCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+static void RadioHostSend( uint8_t *buffer, uint8_t size )
+{
+    memcpy( RadioHost.TxBuffer, buffer, size );
+    RadioHost.TxSize = size;
+    RadioHost.TxDatarate = TxConfig.Datarate;
+    RadioHost.TxTimeOnAir = RadioHostTimeOnAir( TxConfig.Modem, TxConfig.Bandwidth, TxConfig.Datarate,
+                                                TxConfig.Coderate, TxConfig.PreambleLen, TxConfig.FixLen, size,
+                                                TxConfig.CrcOn );
+    RadioHost.TotalTxTimeOnAir += RadioHost.TxTimeOnAir;
+    RadioHost.NbTx++;
+    RadioHost.State = RF_TX_RUNNING;
+}
+
+static void RadioHostSleep( void )
+{
+    RadioHost.State = RF_IDLE;
+}
+
+static void RadioHostStandby( void )
+{
+    RadioHost.State = RF_IDLE;
+}
+
+static void RadioHostRx( uint32_t timeout )
+{
+    RadioHost.NbRx++;
+    RadioHost.State = RF_RX_RUNNING;
+}
+
+static void RadioHostStartCad( void )
+{
+}
+
+static void RadioHostSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
+{
+}
+
+static int16_t RadioHostRssi( RadioModems_t modem )
+{
+    return -120;
+}
+
+static void RadioHostWrite( uint32_t addr, uint8_t data )
+{
+}
+
+static uint8_t RadioHostRead( uint32_t addr )
+{
+    return 0;
+}
+
+static void RadioHostWriteBuffer( uint32_t addr, uint8_t *buffer, uint8_t size )
+{
+}
+
+static void RadioHostReadBuffer( uint32_t addr, uint8_t *buffer, uint8_t size )
+{
+}
+
+static void RadioHostSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+}
+
+static void RadioHostSetPublicNetwork( bool enable )
+{
+}
+
+static uint32_t RadioHostGetWakeupTime( void )
+{
+    return 1;
+}
+
+static void RadioHostIrqProcess( void )
+{
+}
+
+static void RadioHostSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
+{
+}
+
+const struct Radio_s Radio =
+{
+    RadioHostInit,
+    RadioHostGetStatus,
+    RadioHostSetModem,
+    RadioHostSetChannel,
+    RadioHostIsChannelFree,
+    RadioHostRandom,
+    RadioHostSetRxConfig,
+    RadioHostSetTxConfig,
+    RadioHostCheckRfFrequency,
+    RadioHostTimeOnAir,
+    RadioHostSend,
+    RadioHostSleep,
+    RadioHostStandby,
+    RadioHostRx,
+    RadioHostStartCad,
+    RadioHostSetTxContinuousWave,
+    RadioHostRssi,
+    RadioHostWrite,
+    RadioHostRead,
+    RadioHostWriteBuffer,
+    RadioHostReadBuffer,
+    RadioHostSetMaxPayloadLength,
+    RadioHostSetPublicNetwork,
+    RadioHostGetWakeupTime,
+    RadioHostIrqProcess,
+    // Available on SX126x only
+    RadioHostRx,
+    RadioHostSetRxDutyCycle
+};
+
+void RadioHostReset( void )
+{
+    memset( &RadioHost, 0, sizeof( RadioHost ) );
+}
+
+void RadioHostTxDone( void )
+{
+    RadioHost.State = RF_IDLE;
+    if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+    {
+        RadioEvents->TxDone( );
+    }
+}
+
+void RadioHostRxTimeout( void )
+{
+    RadioHost.State = RF_IDLE;
+    if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
+    {
+        RadioEvents->RxTimeout( );
+    }
+}
+
+void RadioHostRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
+{
+    RadioHost.State = RF_IDLE;
+    if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+    {
+        RadioEvents->RxDone( payload, size, rssi, snr );
+    }
+}
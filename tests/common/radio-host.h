@@ -0,0 +1,104 @@
+/*!
+ * \file      radio-host.h
+ *
+ * \brief     Simulated radio driver for the host tests
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#ifndef __RADIO_HOST_H__
+#define __RADIO_HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio.h"
+
+/*!
+ * Simulated radio state, updated by the radio driver calls
+ */
+typedef struct RadioHost_s
+{
+    /*!
+     * Radio state
+     */
+    RadioState_t State;
+    /*!
+     * Current channel frequency
+     */
+    uint32_t Frequency;
+    /*!
+     * Last transmitted frame
+     */
+    uint8_t TxBuffer[255];
+    /*!
+     * Size of the last transmitted frame
+     */
+    uint8_t TxSize;
+    /*!
+     * Spreading factor of the last transmission
+     */
+    uint32_t TxDatarate;
+    /*!
+     * Output power of the last transmission
+     */
+    int8_t TxPower;
+    /*!
+     * Time on air of the last transmission
+     */
+    uint32_t TxTimeOnAir;
+    /*!
+     * Spreading factor of the last reception
+     */
+    uint32_t RxDatarate;
+    /*!
+     * Number of transmissions
+     */
+    uint32_t NbTx;
+    /*!
+     * Number of receptions started
+     */
+    uint32_t NbRx;
+    /*!
+     * Cumulated time on air of the transmissions
+     */
+    uint32_t TotalTxTimeOnAir;
+}RadioHost_t;
+
+extern RadioHost_t RadioHost;
+
+/*!
+ * \brief Clears the simulated radio state and statistics
+ */
+void RadioHostReset( void );
+
+/*!
+ * \brief Ends the ongoing transmission
+ */
+void RadioHostTxDone( void );
+
+/*!
+ * \brief Ends the ongoing reception without any frame
+ */
+void RadioHostRxTimeout( void );
+
+/*!
+ * \brief Ends the ongoing reception with the given frame
+ *
+ * \param [IN] payload Received frame
+ * \param [IN] size    Received frame size
+ * \param [IN] rssi    RSSI of the frame [dBm]
+ * \param [IN] snr     SNR of the frame [dB]
+ */
+void RadioHostRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr );
+
+#endif // __RADIO_HOST_H__
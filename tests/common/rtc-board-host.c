@@ -0,0 +1,166 @@
+/*!
+ * \file      rtc-board-host.c
+ *
+ * \brief     Simulated RTC driver for the host tests. One tick is one
+ *            millisecond and the time only advances on request.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include "timer.h"
+#include "rtc-board.h"
+#include "rtc-board-host.h"
+
+/*!
+ * Simulated RTC counter
+ */
+static uint32_t RtcTicks = 0;
+
+/*!
+ * Timer context, refer to RtcSetTimerContext
+ */
+static uint32_t RtcTimerContext = 0;
+
+/*!
+ * Absolute expiry time of the alarm
+ */
+static uint32_t RtcAlarmTicks = 0;
+
+/*!
+ * Indicates if the alarm is armed
+ */
+static bool RtcAlarmArmed = false;
+
+/*!
+ * Backup registers
+ */
+static uint32_t RtcBkupRegisters[2];
+
+uint32_t RtcHostGetTime( void )
+{
+    return RtcTicks;
+}
+
+void RtcHostAdvance( uint32_t milliseconds )
+{
+    uint32_t end = RtcTicks + milliseconds;
+
+    while( ( RtcAlarmArmed == true ) && ( ( int32_t )( end - RtcAlarmTicks ) >= 0 ) )
+    {
+        RtcHostRunNextAlarm( );
+    }
+    RtcTicks = end;
+}
+
+bool RtcHostRunNextAlarm( void )
+{
+    if( RtcAlarmArmed == false )
+    {
+        return false;
+    }
+    if( ( int32_t )( RtcAlarmTicks - RtcTicks ) > 0 )
+    {
+        RtcTicks = RtcAlarmTicks;
+    }
+    RtcAlarmArmed = false;
+    TimerIrqHandler( );
+    return true;
+}
+
+void RtcInit( void )
+{
+}
+
+uint32_t RtcGetMinimumTimeout( void )
+{
+    return 1;
+}
+
+uint32_t RtcMs2Tick( TimerTime_t milliseconds )
+{
+    return ( uint32_t )milliseconds;
+}
+
+TimerTime_t RtcTick2Ms( uint32_t tick )
+{
+    return ( TimerTime_t )tick;
+}
+
+void RtcDelayMs( TimerTime_t milliseconds )
+{
+    RtcHostAdvance( milliseconds );
+}
+
+void RtcSetAlarm( uint32_t timeout )
+{
+    RtcStartAlarm( timeout );
+}
+
+void RtcStopAlarm( void )
+{
+    RtcAlarmArmed = false;
+}
+
+void RtcStartAlarm( uint32_t timeout )
+{
+    RtcAlarmTicks = RtcTimerContext + timeout;
+    RtcAlarmArmed = true;
+}
+
+uint32_t RtcSetTimerContext( void )
+{
+    RtcTimerContext = RtcTicks;
+    return RtcTimerContext;
+}
+
+uint32_t RtcGetTimerContext( void )
+{
+    return RtcTimerContext;
+}
+
+uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
+{
+    *milliseconds = RtcTicks % 1000;
+    return RtcTicks / 1000;
+}
+
+uint32_t RtcGetTimerValue( void )
+{
+    return RtcTicks;
+}
+
+uint32_t RtcGetTimerElapsedTime( void )
+{
+    return RtcTicks - RtcTimerContext;
+}
+
+void RtcBkupWrite( uint32_t data0, uint32_t data1 )
+{
+    RtcBkupRegisters[0] = data0;
+    RtcBkupRegisters[1] = data1;
+}
+
+void RtcBkupRead( uint32_t *data0, uint32_t *data1 )
+{
+    *data0 = RtcBkupRegisters[0];
+    *data1 = RtcBkupRegisters[1];
+}
+
+void RtcProcess( void )
+{
+}
+
+TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
+{
+    return period;
+}
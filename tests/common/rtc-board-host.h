@@ -0,0 +1,48 @@
+/*!
+ * \file      rtc-board-host.h
+ *
+ * \brief     Simulated RTC driver for the host tests. One tick is one
+ *            millisecond and the time only advances on request.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#ifndef __RTC_BOARD_HOST_H__
+#define __RTC_BOARD_HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * \brief Gets the simulated time
+ *
+ * \retval time Milliseconds elapsed since the start of the simulation
+ */
+uint32_t RtcHostGetTime( void );
+
+/*!
+ * \brief Advances the simulated time. The alarms expiring in between are
+ *        handled in order.
+ *
+ * \param [IN] milliseconds Time to advance
+ */
+void RtcHostAdvance( uint32_t milliseconds );
+
+/*!
+ * \brief Advances the simulated time up to the next alarm and handles it
+ *
+ * \retval status [true: an alarm has been handled, false: no alarm armed]
+ */
+bool RtcHostRunNextAlarm( void );
+
+#endif // __RTC_BOARD_HOST_H__
@@ -0,0 +1,76 @@
+/*!
+ * \file      test.h
+ *
+ * \brief     Minimal host test helpers
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+/*!
+ * Number of failed checks
+ */
+static int TestNbFailures = 0;
+
+/*!
+ * Checks a condition and reports the failure location
+ */
+#define TEST_CHECK( cond )                                                     \
+    do                                                                         \
+    {                                                                          \
+        if( !( cond ) )                                                        \
+        {                                                                      \
+            printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond );  \
+            TestNbFailures++;                                                  \
+        }                                                                      \
+    } while( 0 )
+
+/*!
+ * Test program exit code
+ */
+#define TEST_RESULT( )                  ( ( TestNbFailures == 0 ) ? 0 : 1 )
+
+/*!
+ * Unit of \ref TestGetCycles
+ */
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define TEST_CYCLES_UNIT                "cycles"
+#else
+#define TEST_CYCLES_UNIT                "ns"
+#endif
+
+/*!
+ * Reads the cycle counter, or the monotonic time in ns when not available
+ */
+static inline uint64_t TestGetCycles( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc( );
+#else
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( ( uint64_t )ts.tv_sec * 1000000000 ) + ts.tv_nsec;
+#endif
+}
+
+#endif // __TEST_H__
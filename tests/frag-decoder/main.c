@@ -0,0 +1,347 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Fragmentation decoder host test. Decodes files sent over a lossy
+ *            link and reports the per-fragment decoding cost along with the
+ *            decoder memory footprint.
+ *
+ *            The storage models a flash memory, counting the page programs
+ *            and the writes of the storage pre-fill.
+ *
+ *            Built with the M2B matrix in RAM, with
+ *            FRAG_DECODER_EXTERNAL_MATRIX = 1 and with 64 and 256 bytes
+ *            FRAG_DECODER_CACHE_PAGE_SIZE.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+/*
+ * White box test, the coded fragments are built with the parity matrix
+ * generator of the decoder
+ */
+#include "FragDecoder.c"
+
+/*!
+ * Fragment size
+ */
+#define FRAG_SIZE                                   50
+
+/*!
+ * Flash page size of the storage model
+ */
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+#define FLASH_PAGE_SIZE                             FRAG_DECODER_CACHE_PAGE_SIZE
+#else
+#define FLASH_PAGE_SIZE                             256
+#endif
+
+/*!
+ * Flash model statistics
+ */
+typedef struct sFlashStats
+{
+    /*!
+     * Number of programmed pages. A write spanning several pages programs
+     * each of them.
+     */
+    uint32_t NbPagePrograms;
+    /*!
+     * Number of writes of the storage pre-fill
+     */
+    uint32_t NbPreFillWrites;
+    /*!
+     * Number of writes, outside of the pre-fill, setting bits which would
+     * require a page erase. The decoder reuses the slots of the lost
+     * fragments while recovering them.
+     */
+    uint32_t NbErasingWrites;
+    /*!
+     * Number of M2B matrix bytes set by writes outside of the pre-fill
+     */
+    uint32_t NbMatrixBitSets;
+}FlashStats_t;
+
+static FlashStats_t FlashStats;
+
+/*!
+ * Set while FragDecoderInit pre-fills the storage
+ */
+static bool IsPreFilling = false;
+
+/*!
+ * File sizes of the sweep, in fragments
+ */
+static const uint16_t SweepFragNb[] = { 250, 1000, FRAG_MAX_NB };
+
+/*!
+ * Loss rates of the sweep, in percent
+ */
+static const uint8_t SweepLossPercent[] = { 1, 5, 10 };
+
+/*!
+ * Original file and file storage
+ */
+static uint8_t File[FRAG_MAX_NB * FRAG_MAX_SIZE];
+static uint8_t Storage[FRAG_DECODER_STORAGE_SIZE];
+
+static int8_t StorageWriteCallback( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    TEST_CHECK( ( addr + size ) <= sizeof( Storage ) );
+    if( ( size == 0 ) || ( ( addr + size ) > sizeof( Storage ) ) )
+    {
+        return -1;
+    }
+#if( FRAG_DECODER_CACHE_PAGE_SIZE > 0 )
+    // Whole pages only, the last one being cut at the end of the storage
+    TEST_CHECK( ( addr % FLASH_PAGE_SIZE ) == 0 );
+    TEST_CHECK( ( size == FLASH_PAGE_SIZE ) || ( ( addr + size ) == sizeof( Storage ) ) );
+#endif
+    FlashStats.NbPagePrograms += ( ( addr + size - 1 ) / FLASH_PAGE_SIZE ) - ( addr / FLASH_PAGE_SIZE ) + 1;
+    if( IsPreFilling == true )
+    {
+        FlashStats.NbPreFillWrites++;
+    }
+    else
+    {
+        bool isErasing = false;
+
+        for( uint32_t i = 0; i < size; i++ )
+        {
+            if( ( data[i] & ~Storage[addr + i] ) != 0 )
+            {
+                isErasing = true;
+                if( ( addr + i ) >= ( FRAG_MAX_NB * FRAG_MAX_SIZE ) )
+                {
+                    FlashStats.NbMatrixBitSets++;
+                }
+            }
+        }
+        if( isErasing == true )
+        {
+            FlashStats.NbErasingWrites++;
+        }
+    }
+    memcpy( &Storage[addr], data, size );
+    return 0;
+}
+
+static int8_t StorageReadCallback( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    TEST_CHECK( ( addr + size ) <= sizeof( Storage ) );
+    memcpy( data, &Storage[addr], size );
+    return 0;
+}
+
+static FragDecoderCallbacks_t FragDecoderCallbacks =
+{
+    .FragDecoderWrite = StorageWriteCallback,
+    .FragDecoderRead = StorageReadCallback,
+};
+
+/*!
+ * \brief Builds a fragment the way the fragmentation server does
+ *
+ * \param [IN]  fragCounter Fragment counter
+ * \param [IN]  fragNb      Number of uncoded fragments
+ * \param [OUT] fragment    Fragment data
+ */
+static void BuildFragment( uint16_t fragCounter, uint16_t fragNb, uint8_t *fragment )
+{
+    FragWord_t matrixRow[FRAG_BIT_ARRAY_SIZE( FRAG_MAX_NB )];
+
+    if( fragCounter <= fragNb )
+    {
+        memcpy( fragment, &File[( fragCounter - 1 ) * FRAG_SIZE], FRAG_SIZE );
+        return;
+    }
+
+    memset( fragment, 0, FRAG_SIZE );
+    memset( matrixRow, 0, sizeof( matrixRow ) );
+    FragGetParityMatrixRow( fragCounter - fragNb, fragNb, matrixRow );
+    for( uint16_t i = 0; i < fragNb; i++ )
+    {
+        if( GetParity( i, matrixRow ) == 1 )
+        {
+            for( uint8_t j = 0; j < FRAG_SIZE; j++ )
+            {
+                fragment[j] ^= File[( i * FRAG_SIZE ) + j];
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Decodes files received over a lossy link
+ *
+ * \param [IN] fragNb      Number of fragments of the file
+ * \param [IN] lossPercent Percentage of lost fragments
+ * \param [IN] nbRuns      Number of decoded files
+ */
+static void CheckLossyDecoding( uint16_t fragNb, uint8_t lossPercent, uint8_t nbRuns )
+{
+    uint32_t nbDecoded = 0;
+    uint32_t nbFrags = 0;
+    uint32_t nbCodedFrags = 0;
+    uint64_t cycles = 0;
+    uint64_t codedCycles = 0;
+    uint64_t maxCycles = 0;
+    FlashStats_t flashStats = { 0 };
+
+    for( uint8_t run = 0; run < nbRuns; run++ )
+    {
+        int32_t status = FRAG_SESSION_ONGOING;
+
+        srand( 1 + run );
+        for( uint32_t i = 0; i < ( fragNb * FRAG_SIZE ); i++ )
+        {
+            File[i] = rand( );
+        }
+        memset( &FlashStats, 0, sizeof( FlashStats ) );
+        IsPreFilling = true;
+        FragDecoderInit( fragNb, FRAG_SIZE, &FragDecoderCallbacks );
+        IsPreFilling = false;
+
+        for( uint16_t fragCounter = 1; ( fragCounter <= ( fragNb + FRAG_MAX_REDUNDANCY ) ) &&
+                                       ( status == FRAG_SESSION_ONGOING ); fragCounter++ )
+        {
+            // Radio buffers are not word aligned
+            uint8_t frame[FRAG_SIZE + 1];
+            uint64_t start;
+            uint64_t elapsed;
+
+            BuildFragment( fragCounter, fragNb, &frame[1] );
+            if( ( rand( ) % 100 ) < lossPercent )
+            {
+                continue;
+            }
+
+            start = TestGetCycles( );
+            status = FragDecoderProcess( fragCounter, &frame[1] );
+            elapsed = TestGetCycles( ) - start;
+
+            cycles += elapsed;
+            nbFrags++;
+            if( fragCounter > fragNb )
+            {
+                codedCycles += elapsed;
+                nbCodedFrags++;
+            }
+            maxCycles = MAX( maxCycles, elapsed );
+        }
+
+        TEST_CHECK( FragDecoderGetStatus( ).MatrixError == 0 );
+        if( ( status >= FRAG_SESSION_FINISHED ) && ( memcmp( Storage, File, fragNb * FRAG_SIZE ) == 0 ) )
+        {
+            nbDecoded++;
+        }
+        flashStats.NbPagePrograms += FlashStats.NbPagePrograms;
+        flashStats.NbPreFillWrites += FlashStats.NbPreFillWrites;
+        flashStats.NbErasingWrites += FlashStats.NbErasingWrites;
+        flashStats.NbMatrixBitSets += FlashStats.NbMatrixBitSets;
+    }
+
+    printf( "%u fragments, %u %% loss: %u / %u files decoded\n", fragNb, lossPercent, nbDecoded, nbRuns );
+    printf( "  %.0f %s / file, %.0f %s / fragment, %.0f %s / coded fragment, max %llu %s\n",
+            ( double )( cycles / nbRuns ), TEST_CYCLES_UNIT, ( double )cycles / nbFrags, TEST_CYCLES_UNIT,
+            ( double )codedCycles / MAX( nbCodedFrags, 1 ), TEST_CYCLES_UNIT,
+            ( unsigned long long )maxCycles, TEST_CYCLES_UNIT );
+    printf( "  FragDecoder_t %u bytes, M2B matrix %u bytes %s\n", ( unsigned )sizeof( FragDecoder_t ),
+            ( unsigned )FRAG_DECODER_MATRIX_SIZE,
+            ( FRAG_DECODER_EXTERNAL_MATRIX == 1 ) ? "in the storage" : "in FragDecoder_t" );
+    printf( "  flash: %u page programs of %u bytes, %u pre-fill writes, %u writes needing an erase / session\n",
+            flashStats.NbPagePrograms / nbRuns, FLASH_PAGE_SIZE, flashStats.NbPreFillWrites / nbRuns,
+            flashStats.NbErasingWrites / nbRuns );
+    TEST_CHECK( nbDecoded == nbRuns );
+    // The M2B matrix rows only clear bits of the pre-filled storage
+    TEST_CHECK( flashStats.NbMatrixBitSets == 0 );
+}
+
+/*!
+ * \brief Loses the last uncoded fragments. The session ends with a matrix
+ *        error on the first coded fragment when more fragments are lost than
+ *        the decoder can recover.
+ *
+ * \param [IN] fragNb Number of fragments of the file
+ * \param [IN] nbLost Number of lost fragments at the end of the file
+ */
+static void CheckTailLoss( uint16_t fragNb, uint16_t nbLost )
+{
+    bool isRecoverable = ( nbLost <= FRAG_MAX_REDUNDANCY );
+    int32_t status = FRAG_SESSION_ONGOING;
+    uint16_t fragCounter;
+    uint8_t frame[FRAG_SIZE];
+
+    srand( nbLost );
+    for( uint32_t i = 0; i < ( fragNb * FRAG_SIZE ); i++ )
+    {
+        File[i] = rand( );
+    }
+    FragDecoderInit( fragNb, FRAG_SIZE, &FragDecoderCallbacks );
+
+    for( fragCounter = 1; fragCounter <= ( fragNb - nbLost ); fragCounter++ )
+    {
+        BuildFragment( fragCounter, fragNb, frame );
+        TEST_CHECK( FragDecoderProcess( fragCounter, frame ) == FRAG_SESSION_ONGOING );
+    }
+
+    for( fragCounter = fragNb + 1; ( fragCounter <= ( fragNb + ( 2 * FRAG_MAX_REDUNDANCY ) ) ) &&
+                                   ( status == FRAG_SESSION_ONGOING ); fragCounter++ )
+    {
+        BuildFragment( fragCounter, fragNb, frame );
+        status = FragDecoderProcess( fragCounter, frame );
+    }
+
+    printf( "%u fragments, last %u lost: status %d, matrix error %u\n", fragNb, nbLost, status,
+            FragDecoderGetStatus( ).MatrixError );
+    TEST_CHECK( FragDecoderGetStatus( ).FragNbLost == nbLost );
+    if( isRecoverable == true )
+    {
+        TEST_CHECK( status == nbLost );
+        TEST_CHECK( FragDecoderGetStatus( ).MatrixError == 0 );
+        TEST_CHECK( memcmp( Storage, File, fragNb * FRAG_SIZE ) == 0 );
+    }
+    else
+    {
+        TEST_CHECK( status == FRAG_SESSION_FINISHED );
+        TEST_CHECK( FragDecoderGetStatus( ).MatrixError == 1 );
+        TEST_CHECK( fragCounter == ( fragNb + 2 ) );
+    }
+}
+
+int main( void )
+{
+    CheckLossyDecoding( 500, 10, 20 );
+
+    // File size x loss rate sweep, within the recoverable losses
+    for( uint8_t i = 0; i < ( sizeof( SweepFragNb ) / sizeof( SweepFragNb[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( SweepLossPercent ) / sizeof( SweepLossPercent[0] ) ); j++ )
+        {
+            if( ( ( uint32_t )SweepFragNb[i] * SweepLossPercent[j] ) <= ( 50 * FRAG_MAX_REDUNDANCY ) )
+            {
+                CheckLossyDecoding( SweepFragNb[i], SweepLossPercent[j], 2 );
+            }
+        }
+    }
+
+    CheckTailLoss( 1000, FRAG_MAX_REDUNDANCY );
+    CheckTailLoss( 1000, FRAG_MAX_REDUNDANCY + 1 );
+    CheckTailLoss( 1000, 2 * FRAG_MAX_REDUNDANCY );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,145 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Fragmentation parity matrix host test. Checks every row drawn by
+ *            the multiply-shift generator against the reference generator
+ *            using the modulo operator.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+/*
+ * White box test, the parity matrix generator is private to the decoder
+ */
+#include "FragDecoder.c"
+
+/*!
+ * Largest number of fragments checked
+ */
+#define PARITY_MAX_M                                4096
+
+/*!
+ * Number of random rows checked per number of fragments, in addition to the
+ * first ones
+ */
+#define NB_RANDOM_ROWS                              4
+
+/*!
+ * Number of first rows checked per number of fragments
+ */
+#define NB_FIRST_ROWS                               4
+
+/*
+ * Reference version, the generator of the LoRa Alliance fragmented data block
+ * transport specification
+ */
+static void FragGetParityMatrixRowRef( int32_t n, int32_t m, FragWord_t *matrixRow )
+{
+    int32_t mTemp;
+    int32_t x;
+    int32_t nbCoeff = 0;
+    int32_t r;
+
+    if( IsPowerOfTwo( m ) != false )
+    {
+        mTemp = 1;
+    }
+    else
+    {
+        mTemp = 0;
+    }
+
+    x = 1 + ( 1001 * n );
+    for( int32_t i = 0; i < ( ( m / FRAG_WORD_BITS ) + 1 ); i++ )
+    {
+        matrixRow[i] = 0;
+    }
+    while( nbCoeff < ( m >> 1 ) )
+    {
+        r = 1 << 16;
+        while( r >= m )
+        {
+            x = FragPrbs23( x );
+            r = x % ( m + mTemp );
+        }
+        SetParity( r, matrixRow, 1 );
+        nbCoeff += 1;
+    }
+}
+
+static FragWord_t Row[FRAG_BIT_ARRAY_SIZE( PARITY_MAX_M )];
+static FragWord_t RowRef[FRAG_BIT_ARRAY_SIZE( PARITY_MAX_M )];
+
+/*!
+ * \brief Compares one row of both generators
+ *
+ * \retval Number of differing rows, 0 or 1
+ */
+static uint32_t CheckRow( int32_t n, int32_t m, uint64_t* cycles, uint64_t* cyclesRef )
+{
+    uint64_t start;
+
+    start = TestGetCycles( );
+    FragGetParityMatrixRow( n, m, Row );
+    *cycles += TestGetCycles( ) - start;
+    start = TestGetCycles( );
+    FragGetParityMatrixRowRef( n, m, RowRef );
+    *cyclesRef += TestGetCycles( ) - start;
+
+    if( memcmp( Row, RowRef, ( ( m / FRAG_WORD_BITS ) + 1 ) * sizeof( FragWord_t ) ) != 0 )
+    {
+        printf( "m %d, n %d: rows differ\n", m, n );
+        return 1;
+    }
+    return 0;
+}
+
+int main( void )
+{
+    uint64_t cycles = 0;
+    uint64_t cyclesRef = 0;
+    uint32_t nbRows = 0;
+    uint32_t nbErrors = 0;
+
+    srand( 1 );
+    for( int32_t m = 1; m <= PARITY_MAX_M; m++ )
+    {
+        for( int32_t n = 1; n <= NB_FIRST_ROWS; n++ )
+        {
+            nbErrors += CheckRow( n, m, &cycles, &cyclesRef );
+            nbRows++;
+        }
+        for( uint8_t i = 0; i < NB_RANDOM_ROWS; i++ )
+        {
+            nbErrors += CheckRow( 1 + ( rand( ) % 0xFFFF ), m, &cycles, &cyclesRef );
+            nbRows++;
+        }
+    }
+    // The generator constants follow changes of the number of fragments
+    for( uint32_t i = 0; i < 10000; i++ )
+    {
+        nbErrors += CheckRow( 1 + ( rand( ) % 0xFFFF ), 1 + ( rand( ) % PARITY_MAX_M ), &cycles, &cyclesRef );
+        nbRows++;
+    }
+
+    printf( "%u rows, %u differ: %.0f %s / row, %.0f with the modulo operator\n", nbRows, nbErrors,
+            ( double )cycles / nbRows, TEST_CYCLES_UNIT, ( double )cyclesRef / nbRows );
+    TEST_CHECK( nbErrors == 0 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,485 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Delta firmware update host test. Generates patches with the
+ *            fragpatch tool, applies them with the FragPatch module and
+ *            checks the rejection of wrong sources, truncated patches and
+ *            bit flips. Then receives a patch through the fragmentation
+ *            package and checks that its patch hook rebuilds the new image.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "rtc-board-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+#include "LmhpFragmentation.h"
+
+/*
+ * White box test, the patches are generated by the host tool. Its command
+ * line entry point is renamed.
+ */
+#define main FragPatchToolMain
+#include "fragpatch.c"
+#undef main
+
+/*!
+ * Size of the running image
+ */
+#define IMAGE_SIZE                                  32768
+
+/*!
+ * Size of the new image slot
+ */
+#define IMAGE_MAX_SIZE                              ( IMAGE_SIZE + 4096 )
+
+/*!
+ * Number of random bit flips of the largest patch
+ */
+#define NB_BIT_FLIPS                                1000
+
+/*!
+ * Fragmentation package port
+ */
+#define FRAGMENTATION_PORT                          201
+
+/*!
+ * Fragment size of the fragmentation sessions
+ */
+#define FRAG_SIZE                                   FRAG_MAX_SIZE
+
+/*!
+ * Image edits under test
+ */
+typedef enum eImageEdit
+{
+    IMAGE_EDIT_NONE,
+    IMAGE_EDIT_CONSTANT,
+    IMAGE_EDIT_INSERT,
+    IMAGE_EDIT_DELETE,
+    IMAGE_EDIT_APPEND,
+    IMAGE_EDIT_REPLACE,
+    IMAGE_EDIT_MAX,
+}ImageEdit_t;
+
+static const char* ImageEditNames[IMAGE_EDIT_MAX] =
+{
+    "unchanged image",
+    "constant changed",
+    "function inserted",
+    "function removed",
+    "function appended",
+    "unrelated image",
+};
+
+/*!
+ * Running image and expected new image. The tool images Source, Patch and
+ * Target are the ones read and written by the FragPatch callbacks.
+ */
+static uint8_t OldImage[IMAGE_SIZE];
+static Buffer_t Expected;
+
+/*!
+ * MAC layer primitives of the LoRaMac handler, to simulate the downlinks
+ */
+static LoRaMacPrimitives_t *MacPrimitives;
+
+LoRaMacStatus_t __real_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region );
+
+LoRaMacStatus_t __wrap_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region )
+{
+    MacPrimitives = primitives;
+    return __real_LoRaMacInitialization( primitives, callbacks, region );
+}
+
+/*!
+ * \brief Fills a buffer with code-like data, mostly made of a few frequent
+ *        words, followed by erased flash
+ */
+static void BuildImage( uint8_t *image, size_t size )
+{
+    uint32_t words[64];
+
+    for( uint8_t i = 0; i < 64; i++ )
+    {
+        words[i] = ( ( uint32_t )rand( ) << 16 ) ^ rand( );
+    }
+    for( size_t i = 0; i < ( size - ( size / 8 ) ); i += 4 )
+    {
+        uint32_t word = ( ( rand( ) % 4 ) != 0 ) ? words[rand( ) % 64] : ( ( ( uint32_t )rand( ) << 16 ) ^ rand( ) );
+
+        memcpy( &image[i], &word, MIN( 4, size - i ) );
+    }
+    memset( &image[size - ( size / 8 )], 0xFF, size / 8 );
+}
+
+/*!
+ * \brief Builds the new image from the running image
+ *
+ * \param [IN]  edit  Image edit
+ * \param [OUT] image New image
+ *
+ * \retval size New image size
+ */
+static size_t EditImage( ImageEdit_t edit, uint8_t *image )
+{
+    size_t codeSize = IMAGE_SIZE - ( IMAGE_SIZE / 8 );
+
+    memcpy( image, OldImage, IMAGE_SIZE );
+    switch( edit )
+    {
+        case IMAGE_EDIT_CONSTANT:
+            image[codeSize / 3] ^= 0x5A;
+            return IMAGE_SIZE;
+        case IMAGE_EDIT_INSERT:
+            memmove( &image[( codeSize / 2 ) + 512], &image[codeSize / 2], IMAGE_SIZE - ( codeSize / 2 ) - 512 );
+            BuildImage( &image[codeSize / 2], 512 );
+            return IMAGE_SIZE;
+        case IMAGE_EDIT_DELETE:
+            memmove( &image[codeSize / 4], &image[( codeSize / 4 ) + 1024], IMAGE_SIZE - ( codeSize / 4 ) - 1024 );
+            memset( &image[IMAGE_SIZE - 1024], 0xFF, 1024 );
+            return IMAGE_SIZE;
+        case IMAGE_EDIT_APPEND:
+            BuildImage( &image[IMAGE_SIZE], 2048 );
+            return IMAGE_SIZE + 2048;
+        case IMAGE_EDIT_REPLACE:
+            BuildImage( image, IMAGE_SIZE );
+            return IMAGE_SIZE;
+        case IMAGE_EDIT_NONE:
+        default:
+            return IMAGE_SIZE;
+    }
+}
+
+static void SetBuffer( Buffer_t *buffer, const uint8_t *data, size_t size )
+{
+    buffer->Size = 0;
+    BufferPut( buffer, data, size );
+}
+
+static FragPatchStatus_t ApplyPatch( uint32_t targetMaxSize, uint32_t *targetSize )
+{
+    FragPatchCallbacks_t callbacks = { PatchRead, SourceRead, TargetWrite, TargetRead };
+
+    Target.Size = 0;
+    return FragPatchApply( &callbacks, Patch.Size, Source.Size, targetMaxSize, targetSize );
+}
+
+static bool IsTargetExpected( void )
+{
+    return ( Target.Size == Expected.Size ) && ( memcmp( Target.Data, Expected.Data, Expected.Size ) == 0 );
+}
+
+/*!
+ * \brief Generates the patch of an image edit and applies it
+ *
+ * \retval size Patch size
+ */
+static size_t CheckRoundTrip( ImageEdit_t edit )
+{
+    FragPatchCallbacks_t callbacks = { PatchRead, SourceRead, TargetWrite, TargetRead };
+    static uint8_t newImage[IMAGE_MAX_SIZE];
+    PatchStats_t stats = { 0 };
+    uint32_t targetSize = 0;
+
+    SetBuffer( &Source, OldImage, IMAGE_SIZE );
+    SetBuffer( &Expected, newImage, EditImage( edit, newImage ) );
+    Patch.Size = 0;
+    Diff( &Source, &Expected, &Patch, &stats );
+
+    TEST_CHECK( FragPatchIsPatch( &callbacks, Patch.Size ) == true );
+    TEST_CHECK( ApplyPatch( IMAGE_MAX_SIZE, &targetSize ) == FRAG_PATCH_STATUS_OK );
+    TEST_CHECK( targetSize == Expected.Size );
+    TEST_CHECK( IsTargetExpected( ) == true );
+    printf( "%s: target %zu bytes, patch %zu bytes\n", ImageEditNames[edit], Expected.Size, Patch.Size );
+    return Patch.Size;
+}
+
+/*!
+ * \brief Applies the current patch to a wrong running image and to a too
+ *        small slot. Nothing is written.
+ */
+static void CheckWrongSource( void )
+{
+    uint32_t targetSize = 0;
+
+    Source.Data[IMAGE_SIZE / 2] ^= 0x01;
+    TEST_CHECK( ApplyPatch( IMAGE_MAX_SIZE, &targetSize ) == FRAG_PATCH_STATUS_WRONG_SOURCE );
+    TEST_CHECK( Target.Size == 0 );
+    Source.Data[IMAGE_SIZE / 2] ^= 0x01;
+
+    Source.Size--;
+    TEST_CHECK( ApplyPatch( IMAGE_MAX_SIZE, &targetSize ) == FRAG_PATCH_STATUS_WRONG_SOURCE );
+    TEST_CHECK( Target.Size == 0 );
+    Source.Size++;
+
+    TEST_CHECK( ApplyPatch( Expected.Size - 1, &targetSize ) == FRAG_PATCH_STATUS_TARGET_TOO_LARGE );
+    TEST_CHECK( Target.Size == 0 );
+}
+
+/*!
+ * \brief Applies every truncation of the current patch
+ */
+static void CheckTruncatedPatch( void )
+{
+    FragPatchCallbacks_t callbacks = { PatchRead, SourceRead, TargetWrite, TargetRead };
+    size_t patchSize = Patch.Size;
+    uint32_t nbCorrupted = 0;
+    uint32_t targetSize = 0;
+
+    for( Patch.Size = 0; Patch.Size < patchSize; Patch.Size++ )
+    {
+        FragPatchStatus_t status = ApplyPatch( IMAGE_MAX_SIZE, &targetSize );
+
+        if( Patch.Size < FRAG_PATCH_HEADER_SIZE )
+        {
+            TEST_CHECK( FragPatchIsPatch( &callbacks, Patch.Size ) == false );
+            TEST_CHECK( status == FRAG_PATCH_STATUS_NOT_A_PATCH );
+        }
+        else
+        {
+            TEST_CHECK( status == FRAG_PATCH_STATUS_CORRUPTED );
+            nbCorrupted += ( status == FRAG_PATCH_STATUS_CORRUPTED ) ? 1 : 0;
+        }
+    }
+    Patch.Size = patchSize;
+    printf( "truncated patches: %u of %zu rejected as corrupted\n", nbCorrupted, patchSize - FRAG_PATCH_HEADER_SIZE );
+}
+
+/*!
+ * \brief Applies the current patch with one bit flipped. The patch is either
+ *        rejected or still rebuilds the expected image.
+ *
+ * \param [IN] nbFlips Number of random bit flips, 0 for every bit
+ */
+static void CheckBitFlips( uint32_t nbFlips )
+{
+    uint32_t nbStatus[FRAG_PATCH_STATUS_TARGET_CRC_ERROR + 1] = { 0 };
+    uint32_t nbBits = ( nbFlips == 0 ) ? ( Patch.Size * 8 ) : nbFlips;
+    uint32_t targetSize = 0;
+
+    for( uint32_t i = 0; i < nbBits; i++ )
+    {
+        uint32_t bit = ( nbFlips == 0 ) ? i : ( rand( ) % ( Patch.Size * 8 ) );
+        FragPatchStatus_t status;
+
+        Patch.Data[bit / 8] ^= 1 << ( bit % 8 );
+        status = ApplyPatch( IMAGE_MAX_SIZE, &targetSize );
+        Patch.Data[bit / 8] ^= 1 << ( bit % 8 );
+
+        TEST_CHECK( status <= FRAG_PATCH_STATUS_TARGET_CRC_ERROR );
+        TEST_CHECK( ( status != FRAG_PATCH_STATUS_OK ) || ( IsTargetExpected( ) == true ) );
+        nbStatus[MIN( status, FRAG_PATCH_STATUS_TARGET_CRC_ERROR )]++;
+    }
+    printf( "%u bit flips: %u still ok, %u not a patch, %u wrong source, %u too large, %u corrupted, %u CRC errors\n",
+            nbBits, nbStatus[FRAG_PATCH_STATUS_OK], nbStatus[FRAG_PATCH_STATUS_NOT_A_PATCH],
+            nbStatus[FRAG_PATCH_STATUS_WRONG_SOURCE], nbStatus[FRAG_PATCH_STATUS_TARGET_TOO_LARGE],
+            nbStatus[FRAG_PATCH_STATUS_CORRUPTED], nbStatus[FRAG_PATCH_STATUS_TARGET_CRC_ERROR] );
+}
+
+/*
+ * Fragmentation package parameters, the received file is stored in RAM
+ */
+static uint8_t FileStorage[FRAG_MAX_NB * FRAG_MAX_SIZE];
+static uint32_t NbPatchDone;
+static FragPatchStatus_t PatchDoneStatus;
+static uint32_t PatchDoneSize;
+static uint32_t PatchDoneNbDone;
+static uint32_t NbDone;
+static uint32_t DoneSize;
+
+static int8_t FragDecoderWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( ( addr + size ) > sizeof( FileStorage ) )
+    {
+        return -1;
+    }
+    memcpy( &FileStorage[addr], data, size );
+    return 0;
+}
+
+static int8_t FragDecoderRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( ( addr + size ) > sizeof( FileStorage ) )
+    {
+        return -1;
+    }
+    memcpy( data, &FileStorage[addr], size );
+    return 0;
+}
+
+static void OnFragDone( int32_t status, uint32_t size )
+{
+    NbDone++;
+    DoneSize = size;
+}
+
+static void OnPatchDone( FragPatchStatus_t status, uint32_t targetSize )
+{
+    NbPatchDone++;
+    PatchDoneStatus = status;
+    PatchDoneSize = targetSize;
+    PatchDoneNbDone = NbDone;
+}
+
+static LmhpFragmentationParams_t FragmentationParams =
+{
+    .DecoderCallbacks =
+    {
+        .FragDecoderWrite = FragDecoderWrite,
+        .FragDecoderRead = FragDecoderRead,
+    },
+    .OnProgress = NULL,
+    .OnDone = OnFragDone,
+    .PatchCallbacks =
+    {
+        .PatchRead = NULL,
+        .SourceRead = SourceRead,
+        .TargetWrite = TargetWrite,
+        .TargetRead = TargetRead,
+    },
+    .PatchSourceSize = IMAGE_SIZE,
+    .PatchTargetMaxSize = IMAGE_MAX_SIZE,
+    .OnPatchDone = OnPatchDone,
+};
+
+/*!
+ * \brief Simulates a downlink on the fragmentation package port
+ */
+static void ReceiveFragmentationDownlink( uint8_t *buffer, uint8_t size )
+{
+    McpsIndication_t mcpsIndication;
+
+    memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+    mcpsIndication.McpsIndication = MCPS_UNCONFIRMED;
+    mcpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    mcpsIndication.RxData = true;
+    mcpsIndication.Port = FRAGMENTATION_PORT;
+    mcpsIndication.Buffer = buffer;
+    mcpsIndication.BufferSize = size;
+    MacPrimitives->MacMcpsIndication( &mcpsIndication );
+    LmHandlerProcess( );
+    LmHandlerHostRunUntilIdle( );
+}
+
+/*!
+ * \brief Sends a file through a fragmentation session without losses
+ */
+static void SendFile( const uint8_t *file, size_t size )
+{
+    uint16_t fragNb = ( size + FRAG_SIZE - 1 ) / FRAG_SIZE;
+    uint8_t padding = ( fragNb * FRAG_SIZE ) - size;
+    uint8_t setupReq[] =
+    {
+        0x02, 0x00, fragNb & 0xFF, fragNb >> 8, FRAG_SIZE, 0x00, padding, 0x04, 0x03, 0x02, 0x01
+    };
+
+    ReceiveFragmentationDownlink( setupReq, sizeof( setupReq ) );
+    for( uint16_t fragCounter = 1; fragCounter <= fragNb; fragCounter++ )
+    {
+        uint8_t dataFragment[3 + FRAG_SIZE];
+        size_t offset = ( fragCounter - 1 ) * FRAG_SIZE;
+
+        dataFragment[0] = 0x08;
+        dataFragment[1] = fragCounter & 0xFF;
+        dataFragment[2] = fragCounter >> 8;
+        memset( &dataFragment[3], 0, FRAG_SIZE );
+        memcpy( &dataFragment[3], &file[offset], MIN( FRAG_SIZE, size - offset ) );
+        ReceiveFragmentationDownlink( dataFragment, sizeof( dataFragment ) );
+    }
+}
+
+/*!
+ * \brief Receives the current patch, then a regular file, through the
+ *        fragmentation package
+ */
+static void CheckPackageHook( void )
+{
+    static uint8_t patch[FRAG_MAX_NB * FRAG_MAX_SIZE];
+    size_t patchSize = Patch.Size;
+
+    TEST_CHECK( patchSize <= sizeof( patch ) );
+    memcpy( patch, Patch.Data, patchSize );
+
+    // The patch is applied, then the file is reported
+    Target.Size = 0;
+    SendFile( patch, patchSize );
+    TEST_CHECK( NbPatchDone == 1 );
+    TEST_CHECK( PatchDoneStatus == FRAG_PATCH_STATUS_OK );
+    TEST_CHECK( PatchDoneSize == Expected.Size );
+    TEST_CHECK( IsTargetExpected( ) == true );
+    TEST_CHECK( PatchDoneNbDone == 0 );
+    TEST_CHECK( NbDone == 1 );
+    TEST_CHECK( DoneSize == patchSize );
+
+    // A regular file is only reported
+    Target.Size = 0;
+    SendFile( OldImage, 1000 );
+    TEST_CHECK( NbPatchDone == 1 );
+    TEST_CHECK( Target.Size == 0 );
+    TEST_CHECK( NbDone == 2 );
+    TEST_CHECK( DoneSize == 1000 );
+    TEST_CHECK( memcmp( FileStorage, OldImage, 1000 ) == 0 );
+
+    printf( "fragmentation package: %zu bytes patch received and applied\n", patchSize );
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_5,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    size_t patchSizes[IMAGE_EDIT_MAX];
+
+    srand( 1 );
+    BuildImage( OldImage, IMAGE_SIZE );
+    for( ImageEdit_t edit = IMAGE_EDIT_NONE; edit < IMAGE_EDIT_MAX; edit++ )
+    {
+        patchSizes[edit] = CheckRoundTrip( edit );
+    }
+    // Small edits make small patches
+    TEST_CHECK( patchSizes[IMAGE_EDIT_CONSTANT] < 64 );
+    TEST_CHECK( patchSizes[IMAGE_EDIT_INSERT] < 1024 );
+    TEST_CHECK( patchSizes[IMAGE_EDIT_DELETE] < 256 );
+    TEST_CHECK( patchSizes[IMAGE_EDIT_APPEND] < 2560 );
+
+    CheckRoundTrip( IMAGE_EDIT_CONSTANT );
+    CheckBitFlips( 0 );
+
+    CheckRoundTrip( IMAGE_EDIT_INSERT );
+    CheckWrongSource( );
+    CheckTruncatedPatch( );
+    CheckBitFlips( NB_BIT_FLIPS );
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+    TEST_CHECK( LmHandlerPackageRegister( PACKAGE_ID_FRAGMENTATION, &FragmentationParams ) == LORAMAC_HANDLER_SUCCESS );
+    CheckPackageHook( );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
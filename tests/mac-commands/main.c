@@ -0,0 +1,559 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     MAC commands host test. Checks and measures the slot pool,
+ *            answers synthetic LinkADRReq and DevStatusReq bursts, checks that
+ *            every answer is sent or replaced by the answers of the next
+ *            downlink and measures the frames saved by piggybacking the
+ *            answers on the application uplinks.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LoRaMacCommands.h"
+#include "LmHandler.h"
+
+/*!
+ * Number of application uplinks per datarate
+ */
+#define NB_UPLINKS                                  500
+
+/*!
+ * A burst of MAC commands is received every BURST_PERIOD uplinks
+ */
+#define BURST_PERIOD                                3
+
+/*!
+ * Number of MAC command slots, refer to NUM_OF_MAC_COMMANDS
+ */
+#define NB_SLOTS                                    32
+
+/*!
+ * Number of MAC commands of the benchmark, one full FOpts field
+ */
+#define NB_BENCHMARK_CMDS                           15
+
+/*!
+ * Number of benchmark runs
+ */
+#define NB_BENCHMARK_RUNS                           10000
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * FOpts field maximum size
+ */
+#define FOPTS_MAX_SIZE                              15
+
+/*!
+ * Number of answers added and serialized per CID
+ */
+static uint32_t NbAdded[256];
+static uint32_t NbSerialized[256];
+
+/*!
+ * Number of answers dropped on a new downlink
+ */
+static uint32_t NbDiscarded;
+
+/*!
+ * Indicates if the last MCPS request carried the application payload
+ */
+static bool IsAppDataSent;
+
+LoRaMacCommandStatus_t __real_LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer );
+
+LoRaMacCommandStatus_t __wrap_LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer )
+{
+    LoRaMacCommandStatus_t status = __real_LoRaMacCommandsSerializeCmds( availableSize, effectiveSize, buffer );
+    size_t itr = 0;
+
+    // Only the uplink commands of this test are expected
+    while( ( status == LORAMAC_COMMANDS_SUCCESS ) && ( itr < *effectiveSize ) )
+    {
+        uint8_t cid = buffer[itr];
+
+        NbSerialized[cid]++;
+        switch( cid )
+        {
+            case MOTE_MAC_DUTY_CYCLE_ANS:
+            case MOTE_MAC_LINK_CHECK_REQ:
+            case MOTE_MAC_DEVICE_TIME_REQ:
+                itr += 1;
+                break;
+            case MOTE_MAC_DEV_STATUS_ANS:
+                itr += 3;
+                break;
+            default:
+                itr += 2;
+                break;
+        }
+    }
+    return status;
+}
+
+LoRaMacStatus_t __real_LoRaMacMcpsRequest( McpsReq_t* mcpsRequest );
+
+LoRaMacStatus_t __wrap_LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
+{
+    LoRaMacStatus_t status = __real_LoRaMacMcpsRequest( mcpsRequest );
+
+    IsAppDataSent = ( status == LORAMAC_STATUS_OK ) && ( mcpsRequest->Req.Unconfirmed.fBuffer != NULL );
+    return status;
+}
+
+static void AddCmd( uint8_t cid, uint8_t *payload, size_t payloadSize )
+{
+    TEST_CHECK( LoRaMacCommandsAddCmd( cid, payload, payloadSize ) == LORAMAC_COMMANDS_SUCCESS );
+    NbAdded[cid]++;
+}
+
+/*!
+ * Counts the pending MAC commands of the given CID
+ */
+static uint32_t CountCmds( uint8_t cid )
+{
+    MacCommand_t* macCmd = NULL;
+    uint32_t nbCmds = 0;
+
+    if( LoRaMacCommandsGetCmd( cid, &macCmd ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return 0;
+    }
+    for( ; macCmd != NULL; macCmd = macCmd->Next )
+    {
+        if( macCmd->CID == cid )
+        {
+            nbCmds++;
+        }
+    }
+    return nbCmds;
+}
+
+/*!
+ * Simulates the reception of a new downlink. The none sticky answers still
+ * pending are dropped, the network server repeats their requests.
+ */
+static void ReceiveDownlink( void )
+{
+    static const uint8_t answers[] =
+    {
+        MOTE_MAC_LINK_ADR_ANS, MOTE_MAC_DEV_STATUS_ANS, MOTE_MAC_NEW_CHANNEL_ANS, MOTE_MAC_DUTY_CYCLE_ANS
+    };
+
+    for( uint8_t i = 0; i < sizeof( answers ); i++ )
+    {
+        uint32_t nbCmds = CountCmds( answers[i] );
+
+        NbAdded[answers[i]] -= nbCmds;
+        NbDiscarded += nbCmds;
+    }
+    TEST_CHECK( LoRaMacCommandsRemoveStickyAnsCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyAnsCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+}
+
+/*!
+ * Answers a synthetic burst: up to 4 LinkADRReq blocks, a DevStatusReq and
+ * sometimes NewChannelReq, DutyCycleReq and RxParamSetupReq commands
+ */
+static void AddBurst( void )
+{
+    uint8_t status = 0x07;
+    uint8_t devStatus[2] = { 0xFE, 0x0A };
+
+    for( int i = rand( ) % 4; i >= 0; i-- )
+    {
+        AddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 );
+    }
+    AddCmd( MOTE_MAC_DEV_STATUS_ANS, devStatus, sizeof( devStatus ) );
+    for( int i = rand( ) % 3; i > 0; i-- )
+    {
+        AddCmd( MOTE_MAC_NEW_CHANNEL_ANS, &status, 1 );
+    }
+    if( ( rand( ) % 2 ) == 0 )
+    {
+        AddCmd( MOTE_MAC_DUTY_CYCLE_ANS, &status, 0 );
+    }
+    if( ( rand( ) % 4 ) == 0 )
+    {
+        AddCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &status, 1 );
+    }
+}
+
+/*!
+ * Checks that every answer which has not been dropped by a new downlink has
+ * been sent. The sticky answers are sent until a downlink is received, at
+ * least once.
+ */
+static void CheckAllSent( void )
+{
+    TEST_CHECK( NbSerialized[MOTE_MAC_LINK_ADR_ANS] == NbAdded[MOTE_MAC_LINK_ADR_ANS] );
+    TEST_CHECK( NbSerialized[MOTE_MAC_DEV_STATUS_ANS] == NbAdded[MOTE_MAC_DEV_STATUS_ANS] );
+    TEST_CHECK( NbSerialized[MOTE_MAC_NEW_CHANNEL_ANS] == NbAdded[MOTE_MAC_NEW_CHANNEL_ANS] );
+    TEST_CHECK( NbSerialized[MOTE_MAC_DUTY_CYCLE_ANS] == NbAdded[MOTE_MAC_DUTY_CYCLE_ANS] );
+    TEST_CHECK( NbSerialized[MOTE_MAC_RX_PARAM_SETUP_ANS] >= NbAdded[MOTE_MAC_RX_PARAM_SETUP_ANS] );
+}
+
+/*!
+ * Serializes a burst bigger than the FOpts field. The answers which don't fit
+ * stay queued for the next frame.
+ */
+static void CheckBurstSerialization( void )
+{
+    uint8_t buffer[FOPTS_MAX_SIZE];
+    uint8_t status = 0x07;
+    uint8_t devStatus[2] = { 0xFE, 0x0A };
+    size_t size = 0;
+    size_t effectiveSize = 0;
+
+    memset( NbAdded, 0, sizeof( NbAdded ) );
+    memset( NbSerialized, 0, sizeof( NbSerialized ) );
+    TEST_CHECK( LoRaMacCommandsInit( ) == LORAMAC_COMMANDS_SUCCESS );
+
+    // 4 x 2 + 3 + 3 x 2 + 2 = 19 bytes
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        AddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 );
+    }
+    AddCmd( MOTE_MAC_DEV_STATUS_ANS, devStatus, sizeof( devStatus ) );
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        AddCmd( MOTE_MAC_NEW_CHANNEL_ANS, &status, 1 );
+    }
+    AddCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &status, 1 );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 19 );
+
+    // The sticky answer is selected first, the answers keep the order of the
+    // requests
+    TEST_CHECK( LoRaMacCommandsSerializeCmds( sizeof( buffer ), &effectiveSize, buffer ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( effectiveSize == 15 );
+    TEST_CHECK( buffer[0] == MOTE_MAC_LINK_ADR_ANS );
+    TEST_CHECK( buffer[8] == MOTE_MAC_DEV_STATUS_ANS );
+    TEST_CHECK( buffer[11] == MOTE_MAC_NEW_CHANNEL_ANS );
+    TEST_CHECK( buffer[13] == MOTE_MAC_RX_PARAM_SETUP_ANS );
+    TEST_CHECK( NbSerialized[MOTE_MAC_RX_PARAM_SETUP_ANS] == 1 );
+    TEST_CHECK( NbSerialized[MOTE_MAC_LINK_ADR_ANS] == 4 );
+    TEST_CHECK( NbSerialized[MOTE_MAC_DEV_STATUS_ANS] == 1 );
+    TEST_CHECK( NbSerialized[MOTE_MAC_NEW_CHANNEL_ANS] == 1 );
+
+    // Nothing is dropped before the frame is sent
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 19 );
+
+    // Once sent, only the serialized answers are removed
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == ( 2 + 2 + 2 ) );
+
+    // The sticky answer is repeated with the remaining answers
+    TEST_CHECK( LoRaMacCommandsSerializeCmds( sizeof( buffer ), &effectiveSize, buffer ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( effectiveSize == 6 );
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LoRaMacCommandsRemoveStickyAnsCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 0 );
+    CheckAllSent( );
+}
+
+/*!
+ * Serializes a burst bigger than the FOpts field, then receives a new
+ * downlink before the remaining answers have been sent. Only the requests
+ * initiated by the end-device are carried over.
+ */
+static void CheckNewDownlink( void )
+{
+    uint8_t buffer[FOPTS_MAX_SIZE];
+    uint8_t status = 0x07;
+    uint8_t devStatus[2] = { 0xFE, 0x0A };
+    size_t size = 0;
+    size_t effectiveSize = 0;
+
+    memset( NbAdded, 0, sizeof( NbAdded ) );
+    memset( NbSerialized, 0, sizeof( NbSerialized ) );
+    NbDiscarded = 0;
+    TEST_CHECK( LoRaMacCommandsInit( ) == LORAMAC_COMMANDS_SUCCESS );
+
+    // 1 + 1 + 4 x 2 + 3 + 3 x 2 + 2 = 21 bytes
+    AddCmd( MOTE_MAC_LINK_CHECK_REQ, &status, 0 );
+    AddCmd( MOTE_MAC_DEVICE_TIME_REQ, &status, 0 );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        AddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 );
+    }
+    AddCmd( MOTE_MAC_DEV_STATUS_ANS, devStatus, sizeof( devStatus ) );
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        AddCmd( MOTE_MAC_NEW_CHANNEL_ANS, &status, 1 );
+    }
+    AddCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &status, 1 );
+
+    // The requests have the lowest priority, they don't fit
+    TEST_CHECK( LoRaMacCommandsSerializeCmds( sizeof( buffer ), &effectiveSize, buffer ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( effectiveSize == 15 );
+    TEST_CHECK( NbSerialized[MOTE_MAC_LINK_CHECK_REQ] == 0 );
+    TEST_CHECK( NbSerialized[MOTE_MAC_DEVICE_TIME_REQ] == 0 );
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == ( 1 + 1 + 2 + 2 + 2 ) );
+
+    // The new downlink confirms the sticky answer and replaces the answers
+    // which have not been sent
+    ReceiveDownlink( );
+    TEST_CHECK( NbDiscarded == 2 );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 2 );
+    TEST_CHECK( CountCmds( MOTE_MAC_LINK_CHECK_REQ ) == 1 );
+    TEST_CHECK( CountCmds( MOTE_MAC_DEVICE_TIME_REQ ) == 1 );
+
+    // The answers of the new downlink keep the order of the requests, ahead
+    // of the carried over requests
+    AddCmd( MOTE_MAC_DEV_STATUS_ANS, devStatus, sizeof( devStatus ) );
+    AddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 );
+    TEST_CHECK( LoRaMacCommandsSerializeCmds( sizeof( buffer ), &effectiveSize, buffer ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( effectiveSize == ( 1 + 1 + 3 + 2 ) );
+    TEST_CHECK( buffer[0] == MOTE_MAC_LINK_CHECK_REQ );
+    TEST_CHECK( buffer[1] == MOTE_MAC_DEVICE_TIME_REQ );
+    TEST_CHECK( buffer[2] == MOTE_MAC_DEV_STATUS_ANS );
+    TEST_CHECK( buffer[5] == MOTE_MAC_LINK_ADR_ANS );
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 0 );
+    CheckAllSent( );
+    TEST_CHECK( NbSerialized[MOTE_MAC_LINK_CHECK_REQ] == NbAdded[MOTE_MAC_LINK_CHECK_REQ] );
+    TEST_CHECK( NbSerialized[MOTE_MAC_DEVICE_TIME_REQ] == NbAdded[MOTE_MAC_DEVICE_TIME_REQ] );
+}
+
+/*!
+ * Fills the slot pool, frees slots in the middle of the list and checks that
+ * they are allocated again
+ */
+static void CheckSlotPool( void )
+{
+    uint8_t buffer[NB_SLOTS * 2];
+    uint8_t status = 0x07;
+    MacCommand_t* macCmd = NULL;
+    size_t size = 0;
+
+    TEST_CHECK( LoRaMacCommandsInit( ) == LORAMAC_COMMANDS_SUCCESS );
+    for( uint8_t i = 0; i < NB_SLOTS; i++ )
+    {
+        uint8_t cid = ( ( i % 2 ) == 0 ) ? MOTE_MAC_RX_PARAM_SETUP_ANS : MOTE_MAC_LINK_ADR_ANS;
+
+        TEST_CHECK( LoRaMacCommandsAddCmd( cid, &status, 1 ) == LORAMAC_COMMANDS_SUCCESS );
+    }
+    TEST_CHECK( LoRaMacCommandsAddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 ) == LORAMAC_COMMANDS_ERROR_MEMORY );
+
+    // Every other slot is freed in one pass
+    TEST_CHECK( LoRaMacCommandsSerializeCmds( sizeof( buffer ), &size, buffer ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( size == sizeof( buffer ) );
+    TEST_CHECK( LoRaMacCommandsRemoveNoneStickyCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == ( NB_SLOTS / 2 ) * 2 );
+
+    // An element is removed once only
+    TEST_CHECK( LoRaMacCommandsGetCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LoRaMacCommandsRemoveCmd( macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LoRaMacCommandsRemoveCmd( macCmd ) == LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND );
+
+    // The sticky answers are removed, the other sticky commands stay
+    TEST_CHECK( LoRaMacCommandsAddCmd( MOTE_MAC_RESET_IND, &status, 1 ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LoRaMacCommandsRemoveStickyAnsCmds( ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacCommandsGetSizeSerializedCmds( &size );
+    TEST_CHECK( size == 2 );
+    TEST_CHECK( LoRaMacCommandsGetCmd( MOTE_MAC_RESET_IND, &macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+
+    // The freed slots are allocated again
+    for( uint8_t i = 1; i < NB_SLOTS; i++ )
+    {
+        TEST_CHECK( LoRaMacCommandsAddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 ) == LORAMAC_COMMANDS_SUCCESS );
+    }
+    TEST_CHECK( LoRaMacCommandsAddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 ) == LORAMAC_COMMANDS_ERROR_MEMORY );
+    TEST_CHECK( LoRaMacCommandsInit( ) == LORAMAC_COMMANDS_SUCCESS );
+}
+
+/*!
+ * Measures the MAC command list operations with one FOpts field of commands
+ */
+static void BenchmarkCmds( void )
+{
+    uint8_t buffer[FOPTS_MAX_SIZE * 2];
+    size_t size = 0;
+    uint8_t status = 0x07;
+    MacCommand_t* macCmd = NULL;
+    uint64_t addCycles = UINT64_MAX;
+    uint64_t removeCycles = UINT64_MAX;
+    uint64_t serializeCycles = UINT64_MAX;
+    uint64_t filterCycles = UINT64_MAX;
+
+    for( uint32_t run = 0; run < NB_BENCHMARK_RUNS; run++ )
+    {
+        uint64_t cycles = TestGetCycles( );
+
+        for( uint8_t i = 0; i < NB_BENCHMARK_CMDS; i++ )
+        {
+            uint8_t cid = ( ( i % 5 ) == 0 ) ? MOTE_MAC_RX_PARAM_SETUP_ANS : MOTE_MAC_LINK_ADR_ANS;
+
+            LoRaMacCommandsAddCmd( cid, &status, 1 );
+        }
+        cycles = TestGetCycles( ) - cycles;
+        addCycles = MIN( addCycles, cycles );
+
+        // Remove the first sticky answer, at the head of the list
+        LoRaMacCommandsGetCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &macCmd );
+        cycles = TestGetCycles( );
+        LoRaMacCommandsRemoveCmd( macCmd );
+        cycles = TestGetCycles( ) - cycles;
+        removeCycles = MIN( removeCycles, cycles );
+
+        cycles = TestGetCycles( );
+        LoRaMacCommandsSerializeCmds( sizeof( buffer ), &size, buffer );
+        cycles = TestGetCycles( ) - cycles;
+        serializeCycles = MIN( serializeCycles, cycles );
+
+        cycles = TestGetCycles( );
+        LoRaMacCommandsRemoveNoneStickyCmds( );
+        LoRaMacCommandsRemoveStickyAnsCmds( );
+        cycles = TestGetCycles( ) - cycles;
+        filterCycles = MIN( filterCycles, cycles );
+    }
+
+    printf( "%u MAC commands, " TEST_CYCLES_UNIT ": add %llu, remove one %llu, serialize %llu, remove the others %llu\n",
+            NB_BENCHMARK_CMDS, ( unsigned long long )addCycles, ( unsigned long long )removeCycles,
+            ( unsigned long long )serializeCycles, ( unsigned long long )filterCycles );
+    TEST_CHECK( size == ( ( NB_BENCHMARK_CMDS - 1 ) * 2 ) );
+}
+
+/*!
+ * Sends application uplinks of random size while the network sends MAC
+ * command bursts
+ *
+ * \param [IN] datarate Uplink datarate
+ */
+static void RunBursts( int8_t datarate )
+{
+    static uint8_t buffer[242];
+    LmHandlerAppData_t appData;
+    MibRequestConfirm_t mibReq;
+    uint32_t nbFrames = 0;
+    uint32_t nbFlushFrames = 0;
+    uint32_t nbReferenceFrames = 0;
+    size_t cmdsSize = 0;
+    uint8_t maxSize = 0;
+
+    memset( NbAdded, 0, sizeof( NbAdded ) );
+    memset( NbSerialized, 0, sizeof( NbSerialized ) );
+    NbDiscarded = 0;
+    srand( 1 );
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = datarate;
+    TEST_CHECK( LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK );
+    TEST_CHECK( LmHandlerReserveAppData( &appData ) == LORAMAC_HANDLER_SUCCESS );
+    maxSize = appData.BufferSize;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        if( ( i % BURST_PERIOD ) == 0 )
+        {
+            ReceiveDownlink( );
+            AddBurst( );
+        }
+
+        appData.Port = APP_PORT;
+        appData.Buffer = buffer;
+        appData.BufferSize = 1 + ( rand( ) % maxSize );
+
+        // Without priority packing all the answers had to fit into the room
+        // left in FOpts. Otherwise a port 0 frame was sent and the
+        // application payload had to be sent again.
+        LoRaMacCommandsGetSizeSerializedCmds( &cmdsSize );
+        nbReferenceFrames++;
+        if( ( cmdsSize > FOPTS_MAX_SIZE ) || ( ( appData.BufferSize + cmdsSize ) > maxSize ) )
+        {
+            nbReferenceFrames++;
+        }
+
+        do
+        {
+            uint32_t nbTx = RadioHost.NbTx;
+
+            IsAppDataSent = false;
+            LmHandlerSendAtDatarate( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG, datarate );
+            TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+            nbFrames++;
+            LmHandlerHostRunUntilIdle( );
+            // The answers are confirmed by the next downlink
+            LoRaMacCommandsRemoveStickyAnsCmds( );
+        } while( IsAppDataSent == false );
+    }
+
+    // Flush the remaining answers
+    LoRaMacCommandsGetSizeSerializedCmds( &cmdsSize );
+    while( cmdsSize > 0 )
+    {
+        appData.Buffer = NULL;
+        appData.BufferSize = 0;
+        TEST_CHECK( LmHandlerSendAtDatarate( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG, datarate ) == LORAMAC_HANDLER_SUCCESS );
+        nbFlushFrames++;
+        LmHandlerHostRunUntilIdle( );
+        LoRaMacCommandsRemoveStickyAnsCmds( );
+        LoRaMacCommandsGetSizeSerializedCmds( &cmdsSize );
+    }
+
+    printf( "DR%d: %u uplinks, %u frames + %u flush frames, %u frames without priority packing, %u saved, "
+            "%u answers replaced by a new downlink\n",
+            datarate, NB_UPLINKS, nbFrames, nbFlushFrames, nbReferenceFrames,
+            nbReferenceFrames - ( nbFrames + nbFlushFrames ), NbDiscarded );
+    CheckAllSent( );
+    TEST_CHECK( ( nbFrames + nbFlushFrames ) < nbReferenceFrames );
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    CheckSlotPool( );
+    BenchmarkCmds( );
+    CheckBurstSerialization( );
+    CheckNewDownlink( );
+    RunBursts( DR_0 );
+    RunBursts( DR_3 );
+    RunBursts( DR_5 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,132 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     MAC layer uplink host benchmark. Measures the MAC layer cycles
+ *            spent per unconfirmed uplink and the cost of a region dispatch.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include "test.h"
+#include "utilities.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+#include "Region.h"
+
+/*!
+ * Number of measured uplinks
+ */
+#define NB_UPLINKS                                  1000
+
+/*!
+ * Number of region dispatches per benchmark run
+ */
+#define NB_DISPATCHES                               1000
+
+/*!
+ * Number of benchmark runs
+ */
+#define NB_BENCHMARK_RUNS                           1000
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * \brief Measures the cycles of a region dispatch which returns a constant
+ *
+ * \retval cycles Minimum number of cycles per dispatch
+ */
+static uint64_t BenchmarkDispatch( void )
+{
+    uint64_t minCycles = UINT64_MAX;
+    volatile uintptr_t sink = 0;
+
+    for( uint32_t run = 0; run < NB_BENCHMARK_RUNS; run++ )
+    {
+        uint64_t cycles = TestGetCycles( );
+
+        for( uint32_t i = 0; i < NB_DISPATCHES; i++ )
+        {
+            sink += ( uintptr_t )RegionGetPhyParams( LORAMAC_REGION_EU868 );
+        }
+        cycles = TestGetCycles( ) - cycles;
+        minCycles = MIN( minCycles, cycles );
+    }
+    TEST_CHECK( sink != 0 );
+    return minCycles / NB_DISPATCHES;
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_5,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    uint8_t buffer[16] = { 0 };
+    LmHandlerAppData_t appData = { .Port = APP_PORT, .BufferSize = sizeof( buffer ), .Buffer = buffer };
+    uint64_t requestCycles = 0;
+    uint64_t cycleCycles = 0;
+    uint64_t minCycles = UINT64_MAX;
+    uint32_t nbTx;
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    // Warm up the caches
+    for( uint32_t i = 0; i < 10; i++ )
+    {
+        TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+        LmHandlerHostRunUntilIdle( );
+    }
+
+    nbTx = RadioHost.NbTx;
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        uint64_t request;
+        uint64_t cycle;
+
+        // MAC request: channel selection, frame build, radio configuration
+        request = TestGetCycles( );
+        TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+        request = TestGetCycles( ) - request;
+
+        // TX done, RX windows and confirmation
+        cycle = TestGetCycles( );
+        LmHandlerHostRunUntilIdle( );
+        cycle = TestGetCycles( ) - cycle;
+
+        requestCycles += request;
+        cycleCycles += cycle;
+        minCycles = MIN( minCycles, request + cycle );
+    }
+    TEST_CHECK( RadioHost.NbTx == ( nbTx + NB_UPLINKS ) );
+
+    printf( "MAC " TEST_CYCLES_UNIT " per uplink: request %llu, tx done + rx windows %llu, total %llu (min %llu)\n",
+            ( unsigned long long )( requestCycles / NB_UPLINKS ), ( unsigned long long )( cycleCycles / NB_UPLINKS ),
+            ( unsigned long long )( ( requestCycles + cycleCycles ) / NB_UPLINKS ), ( unsigned long long )minCycles );
+    printf( "region dispatch: %llu " TEST_CYCLES_UNIT "\n", ( unsigned long long )BenchmarkDispatch( ) );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
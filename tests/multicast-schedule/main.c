@@ -0,0 +1,338 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Remote multicast setup host test. Runs overlapping class B
+ *            sessions on a MAC layer which switches to class B some time
+ *            after the request, and checks the class set by the schedule.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "test.h"
+#include "rtc-board-host.h"
+#include "systime.h"
+#include "LmHandler.h"
+#include "LmhpRemoteMcastSetup.h"
+
+/*!
+ * Delay of the class B switch, DeviceTimeAns, beacon acquisition and
+ * PingSlotInfoAns, in s
+ */
+#define CLASS_B_SWITCH_DELAY                        40
+
+/*!
+ * Period of the multicast frames of a session, in s
+ */
+#define FRAME_PERIOD                                8
+
+/*!
+ * Number of multicast groups
+ */
+#define NB_GROUPS                                   4
+
+/*!
+ * Multicast session, times relative to the simulation start in s
+ */
+typedef struct sSession
+{
+    uint32_t Start;
+    /*!
+     * The session lasts 2^Timeout s
+     */
+    uint8_t Timeout;
+}Session_t;
+
+typedef struct sSimResult
+{
+    /*!
+     * First and last second the device ran class B, 0 if never
+     */
+    uint32_t ClassBStart;
+    uint32_t ClassBEnd;
+    /*!
+     * Number of class B switches started by the MAC layer
+     */
+    uint32_t NbClassBSwitches;
+    /*!
+     * Frames received by the radio for each group
+     */
+    uint32_t NbFrames[NB_GROUPS];
+}SimResult_t;
+
+/*
+ * Simulated LoRaMac handler. The class B switch completes CLASS_B_SWITCH_DELAY
+ * after the request, unless another class is requested meanwhile.
+ */
+static DeviceClass_t MacClass;
+static bool IsClassBSwitchPending;
+static uint32_t ClassBSwitchTime;
+static uint32_t NbClassBSwitches;
+static uint8_t NbClassBFailures;
+static bool IsProcessRequested;
+static uint8_t Answer[16];
+
+LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMcChannelDelete( AddressIdentifier_t groupID )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRxParams_t *rxParams, uint8_t *status )
+{
+    *status = 0;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
+{
+    return LORAMAC_STATUS_OK;
+}
+
+LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed )
+{
+    memcpy( Answer, appData->Buffer, MIN( appData->BufferSize, sizeof( Answer ) ) );
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+DeviceClass_t LmHandlerGetCurrentClass( void )
+{
+    return MacClass;
+}
+
+LmHandlerErrorStatus_t LmHandlerRequestClass( DeviceClass_t newClass )
+{
+    if( newClass != CLASS_B )
+    {
+        IsClassBSwitchPending = false;
+    }
+    if( newClass == MacClass )
+    {
+        return LORAMAC_HANDLER_SUCCESS;
+    }
+    // Only switch from class A to class B/C or from class B/C to class A
+    TEST_CHECK( ( newClass == CLASS_A ) || ( MacClass == CLASS_A ) );
+
+    if( newClass != CLASS_B )
+    {
+        MacClass = newClass;
+    }
+    else if( IsClassBSwitchPending == false )
+    {
+        if( NbClassBFailures > 0 )
+        {
+            // DeviceTimeReq not sent, duty cycle for instance
+            NbClassBFailures--;
+            return LORAMAC_HANDLER_ERROR;
+        }
+        IsClassBSwitchPending = true;
+        ClassBSwitchTime = SysTimeGet( ).Seconds + CLASS_B_SWITCH_DELAY;
+        NbClassBSwitches++;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+static void OnPackageProcessRequest( uint8_t id )
+{
+    IsProcessRequested = true;
+}
+
+/*!
+ * \brief Sends a remote multicast setup command to the package
+ *
+ * \param [IN] package Remote multicast setup package
+ * \param [IN] buffer  Command
+ * \param [IN] size    Command size
+ */
+static void ReceiveCommand( LmhPackage_t *package, uint8_t *buffer, uint8_t size )
+{
+    McpsIndication_t mcpsIndication;
+
+    memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+    mcpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    mcpsIndication.Port = package->Port;
+    mcpsIndication.Buffer = buffer;
+    mcpsIndication.BufferSize = size;
+    package->OnMcpsIndicationProcess( &mcpsIndication );
+    package->OnPortDataProcess( &mcpsIndication );
+    IsProcessRequested = true;
+}
+
+/*!
+ * \brief Sets up the multicast groups and schedules their class B sessions
+ *
+ * \param [IN] package  Remote multicast setup package
+ * \param [IN] sessions Sessions of the groups
+ * \param [IN] start    GPS time of the simulation start in s
+ */
+static void SetupSessions( LmhPackage_t *package, const Session_t *sessions, uint32_t start )
+{
+    for( uint8_t id = 0; id < NB_GROUPS; id++ )
+    {
+        uint8_t setupReq[30] = { 0x02, id, 0x01 + id, 0x00, 0x00, 0x01 };
+        uint32_t sessionTime = start + sessions[id].Start;
+        uint32_t frequency = 869525000 / 100;
+        // Ping slot periodicity 2
+        uint8_t sessionReq[11] = { 0x05, id, sessionTime, sessionTime >> 8, sessionTime >> 16, sessionTime >> 24,
+                                   ( 2 << 4 ) | sessions[id].Timeout, frequency, frequency >> 8, frequency >> 16, DR_3 };
+
+        // FCountMax
+        memset( &setupReq[26], 0xFF, 4 );
+        ReceiveCommand( package, setupReq, sizeof( setupReq ) );
+        TEST_CHECK( Answer[1] == id );
+        ReceiveCommand( package, sessionReq, sizeof( sessionReq ) );
+        TEST_CHECK( Answer[1] == 0 );
+    }
+}
+
+/*!
+ * \brief Runs the sessions. The radio receives the frames of a group while its
+ *        session is on and the device runs class B.
+ *
+ * \param [IN]  sessions   Sessions of the groups
+ * \param [IN]  nbFailures Number of class B requests failing
+ * \param [OUT] result     Class B period and received frames
+ */
+static void Simulate( const Session_t *sessions, uint8_t nbFailures, SimResult_t *result )
+{
+    static uint8_t dataBuffer[242];
+    LmhPackage_t *package = LmhpRemoteMcastSetupPackageFactory( );
+    uint32_t start = SysTimeGet( ).Seconds - UNIX_GPS_EPOCH_OFFSET;
+    uint32_t end = 0;
+    uint32_t fCnt[NB_GROUPS] = { 0 };
+
+    memset( result, 0, sizeof( SimResult_t ) );
+    NbClassBSwitches = 0;
+    NbClassBFailures = nbFailures;
+
+    package->OnPackageProcessRequest = OnPackageProcessRequest;
+    package->Init( NULL, dataBuffer, sizeof( dataBuffer ) );
+    SetupSessions( package, sessions, start );
+    for( uint8_t id = 0; id < NB_GROUPS; id++ )
+    {
+        end = MAX( end, sessions[id].Start + ( 1 << sessions[id].Timeout ) );
+    }
+
+    for( uint32_t t = 1; t <= ( end + 100 ); t++ )
+    {
+        RtcHostAdvance( 1000 );
+        if( ( IsClassBSwitchPending == true ) && ( SysTimeGet( ).Seconds >= ClassBSwitchTime ) )
+        {
+            IsClassBSwitchPending = false;
+            MacClass = CLASS_B;
+        }
+        if( IsProcessRequested == true )
+        {
+            IsProcessRequested = false;
+            package->Process( );
+        }
+
+        if( MacClass == CLASS_B )
+        {
+            result->ClassBStart = ( result->ClassBStart == 0 ) ? t : result->ClassBStart;
+            result->ClassBEnd = t;
+        }
+        for( uint8_t id = 0; id < NB_GROUPS; id++ )
+        {
+            McpsIndication_t mcpsIndication;
+
+            if( ( t < sessions[id].Start ) || ( t >= ( sessions[id].Start + ( 1 << sessions[id].Timeout ) ) ) ||
+                ( ( ( t - sessions[id].Start ) % FRAME_PERIOD ) != 0 ) )
+            {
+                continue;
+            }
+            fCnt[id]++;
+            if( MacClass != CLASS_B )
+            {
+                continue;
+            }
+            memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+            mcpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+            mcpsIndication.Multicast = 1;
+            mcpsIndication.Port = 201;
+            mcpsIndication.DevAddress = 0x01000001 + id;
+            mcpsIndication.DownLinkCounter = fCnt[id];
+            package->OnMcpsIndicationProcess( &mcpsIndication );
+            result->NbFrames[id]++;
+        }
+    }
+    result->NbClassBSwitches = NbClassBSwitches;
+
+    // Nothing is left running once the sessions are over
+    TEST_CHECK( MacClass == CLASS_A );
+    TEST_CHECK( IsClassBSwitchPending == false );
+}
+
+/*!
+ * \brief Checks the received frames against the group statistics
+ *
+ * \param [IN] result Simulation result
+ */
+static void CheckGroupStats( const SimResult_t *result )
+{
+    for( uint8_t id = 0; id < NB_GROUPS; id++ )
+    {
+        LmhpRemoteMcastSetupGroupStats_t stats;
+
+        TEST_CHECK( LmhpRemoteMcastSetupGetGroupStats( id, &stats ) == LORAMAC_HANDLER_SUCCESS );
+        printf( "  group %u: received %u, missed %u, late %u\n", id, stats.Received, stats.Missed, stats.Late );
+        TEST_CHECK( stats.Received == result->NbFrames[id] );
+        TEST_CHECK( stats.Missed == 0 );
+        TEST_CHECK( stats.Late == 0 );
+    }
+}
+
+int main( void )
+{
+    // Overlapping sessions [100, 612), [200, 456), [300, 1324) and [400, 528)
+    const Session_t overlapping[NB_GROUPS] = { { 100, 9 }, { 200, 8 }, { 300, 10 }, { 400, 7 } };
+    // Sessions shorter than the class B switch
+    const Session_t shortSessions[NB_GROUPS] = { { 100, 4 }, { 110, 3 }, { 200, 4 }, { 210, 4 } };
+    SimResult_t result;
+
+    SysTimeSet( ( SysTime_t ){ .Seconds = UNIX_GPS_EPOCH_OFFSET + 1000000000, .SubSeconds = 0 } );
+
+    // One class B switch for all the overlapping sessions, kept up to the end
+    // of the last one
+    Simulate( overlapping, 0, &result );
+    printf( "overlapping sessions: %u class B switch, class B [%u, %u]\n", result.NbClassBSwitches,
+            result.ClassBStart, result.ClassBEnd );
+    TEST_CHECK( result.NbClassBSwitches == 1 );
+    TEST_CHECK( result.ClassBStart == ( 100 + CLASS_B_SWITCH_DELAY ) );
+    TEST_CHECK( result.ClassBEnd == 1323 );
+    CheckGroupStats( &result );
+
+    // The failed class B requests are retried on the next windows, at 200 and
+    // at 300
+    Simulate( overlapping, 2, &result );
+    printf( "2 failed requests: %u class B switch, class B [%u, %u]\n", result.NbClassBSwitches,
+            result.ClassBStart, result.ClassBEnd );
+    TEST_CHECK( result.NbClassBSwitches == 1 );
+    TEST_CHECK( result.ClassBStart == ( 300 + CLASS_B_SWITCH_DELAY ) );
+    TEST_CHECK( result.ClassBEnd == 1323 );
+    CheckGroupStats( &result );
+
+    // The pending switches are cancelled at the end of the sessions
+    Simulate( shortSessions, 0, &result );
+    printf( "short sessions: %u class B switches, class B [%u, %u]\n", result.NbClassBSwitches,
+            result.ClassBStart, result.ClassBEnd );
+    TEST_CHECK( result.NbClassBSwitches == 2 );
+    TEST_CHECK( result.ClassBStart == 0 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
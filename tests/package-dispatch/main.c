@@ -0,0 +1,306 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     LoRaMac handler package dispatch host test. Runs an idle hour
+ *            with the four packages registered and counts the package calls
+ *            for several main loop wake-up rates.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "rtc-board-host.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+#include "LmhpCompliance.h"
+#include "LmhpClockSync.h"
+#include "LmhpRemoteMcastSetup.h"
+#include "LmhpFragmentation.h"
+
+/*!
+ * Simulated idle time in ms
+ */
+#define IDLE_TIME                                   3600000
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * Number of registered packages
+ */
+#define NB_PACKAGES                                 4
+
+/*!
+ * Background wake-up periods of the main loop in ms, 0 for none
+ */
+static const uint32_t WakeUpPeriods[] = { 0, 1000, 100 };
+
+/*!
+ * MAC layer primitives of the LoRaMac handler, to simulate the MAC events
+ */
+static LoRaMacPrimitives_t *MacPrimitives;
+
+/*!
+ * Original package functions and number of calls
+ */
+static void ( *PackageProcess[NB_PACKAGES] )( void );
+static bool ( *PackageIsTxPending[NB_PACKAGES] )( void );
+static uint32_t NbProcess;
+static uint32_t NbIsTxPending;
+
+/*!
+ * Time and port of the last uplink accepted by the MAC layer
+ */
+static uint32_t UplinkTime;
+static uint8_t UplinkPort;
+
+LoRaMacStatus_t __real_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region );
+
+LoRaMacStatus_t __wrap_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region )
+{
+    MacPrimitives = primitives;
+    return __real_LoRaMacInitialization( primitives, callbacks, region );
+}
+
+LoRaMacStatus_t __real_LoRaMacMcpsRequest( McpsReq_t *mcpsRequest );
+
+LoRaMacStatus_t __wrap_LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
+{
+    LoRaMacStatus_t status = __real_LoRaMacMcpsRequest( mcpsRequest );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        // The MAC layer may delay the transmission further
+        UplinkTime = RtcHostGetTime( );
+        UplinkPort = mcpsRequest->Req.Unconfirmed.fPort;
+    }
+    return status;
+}
+
+#define PACKAGE_WRAPPERS( id )                                                 \
+    static void ProcessWrapper##id( void )                                     \
+    {                                                                          \
+        NbProcess++;                                                           \
+        PackageProcess[id]( );                                                 \
+    }                                                                          \
+    static bool IsTxPendingWrapper##id( void )                                 \
+    {                                                                          \
+        NbIsTxPending++;                                                       \
+        return PackageIsTxPending[id]( );                                      \
+    }
+
+PACKAGE_WRAPPERS( 0 )
+PACKAGE_WRAPPERS( 1 )
+PACKAGE_WRAPPERS( 2 )
+PACKAGE_WRAPPERS( 3 )
+
+static void ( *ProcessWrappers[NB_PACKAGES] )( void ) =
+{
+    ProcessWrapper0, ProcessWrapper1, ProcessWrapper2, ProcessWrapper3
+};
+
+static bool ( *IsTxPendingWrappers[NB_PACKAGES] )( void ) =
+{
+    IsTxPendingWrapper0, IsTxPendingWrapper1, IsTxPendingWrapper2, IsTxPendingWrapper3
+};
+
+/*
+ * Package parameters
+ */
+static int8_t FragDecoderWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return 0;
+}
+
+static int8_t FragDecoderRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return 0;
+}
+
+static LmhpComplianceParams_t ComplianceParams =
+{
+    .FwVersion.Value = 0x01000000,
+    .OnTxPeriodicityChanged = NULL,
+    .OnTxFrameCtrlChanged = NULL,
+    .OnPingSlotPeriodicityChanged = NULL,
+};
+
+static LmhpFragmentationParams_t FragmentationParams =
+{
+    .DecoderCallbacks =
+    {
+        .FragDecoderWrite = FragDecoderWrite,
+        .FragDecoderRead = FragDecoderRead,
+    },
+    .OnProgress = NULL,
+    .OnDone = NULL,
+};
+
+/*!
+ * \brief Simulates a downlink indication of the MAC layer
+ *
+ * \param [IN] mcpsIndication MCPS indication primitive data
+ */
+static void ReceiveDownlink( McpsIndication_t *mcpsIndication )
+{
+    mcpsIndication->McpsIndication = MCPS_UNCONFIRMED;
+    mcpsIndication->Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    MacPrimitives->MacMcpsIndication( mcpsIndication );
+}
+
+/*!
+ * \brief Runs the main loop of an idle device. The main loop sleeps up to the
+ *        next timer or to the next background wake-up.
+ *
+ * \param [IN] duration     Time to run in ms
+ * \param [IN] wakeUpPeriod Background wake-up period in ms, 0 for none
+ * \param [IN] nbTx         Stops once the radio has sent nbTx frames
+ *
+ * \retval nbIterations Number of main loop iterations
+ */
+static uint32_t RunMainLoop( uint32_t duration, uint32_t wakeUpPeriod, uint32_t nbTx )
+{
+    uint32_t end = RtcHostGetTime( ) + duration;
+    uint32_t nbIterations = 0;
+
+    while( ( RtcHostGetTime( ) < end ) && ( RadioHost.NbTx < nbTx ) )
+    {
+        LmHandlerProcess( );
+        nbIterations++;
+        if( wakeUpPeriod != 0 )
+        {
+            RtcHostAdvance( wakeUpPeriod );
+        }
+        else if( RtcHostRunNextAlarm( ) == false )
+        {
+            break;
+        }
+    }
+    return nbIterations;
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = true,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    LmhPackage_t *packages[NB_PACKAGES] =
+    {
+        LmphCompliancePackageFactory( ),
+        LmphClockSyncPackageFactory( ),
+        LmhpRemoteMcastSetupPackageFactory( ),
+        LmhpFragmentationPackageFactory( ),
+    };
+    void *packageParams[NB_PACKAGES] = { &ComplianceParams, NULL, NULL, &FragmentationParams };
+    McpsIndication_t mcpsIndication;
+    uint32_t nbProcess = 0;
+    uint32_t nbIsTxPending = 0;
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+    for( uint8_t id = 0; id < NB_PACKAGES; id++ )
+    {
+        PackageProcess[id] = packages[id]->Process;
+        PackageIsTxPending[id] = packages[id]->IsTxPending;
+        packages[id]->Process = ProcessWrappers[id];
+        packages[id]->IsTxPending = IsTxPendingWrappers[id];
+        TEST_CHECK( LmHandlerPackageRegister( id, packageParams[id] ) == LORAMAC_HANDLER_SUCCESS );
+    }
+
+    // A DeviceTimeAns gives the clock synchronization its first sample
+    memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+    mcpsIndication.DeviceTimeAnsReceived = true;
+    ReceiveDownlink( &mcpsIndication );
+    LmHandlerProcess( );
+
+    // The packages are only processed on their events and timers, whatever
+    // the main loop wake-up rate
+    for( uint8_t i = 0; i < ( sizeof( WakeUpPeriods ) / sizeof( WakeUpPeriods[0] ) ); i++ )
+    {
+        uint32_t nbIterations;
+
+        NbProcess = 0;
+        NbIsTxPending = 0;
+        nbIterations = RunMainLoop( IDLE_TIME, WakeUpPeriods[i], UINT32_MAX );
+        printf( "wake-up period %4u ms: %5u iterations, %3u Process, %3u IsTxPending calls / h\n",
+                WakeUpPeriods[i], nbIterations, NbProcess, NbIsTxPending );
+        if( i == 0 )
+        {
+            nbProcess = NbProcess;
+            nbIsTxPending = NbIsTxPending;
+            TEST_CHECK( NbProcess < ( nbIterations * NB_PACKAGES ) );
+        }
+        // Up to one timer event more, on the edge of the idle time
+        TEST_CHECK( NbProcess <= ( nbProcess + 1 ) );
+        TEST_CHECK( NbIsTxPending <= ( nbIsTxPending + 1 ) );
+    }
+
+    // A compliance echo blocked by the duty cycle is passed to the MAC layer
+    // once the duty cycle allows it, without any other wake-up source
+    {
+        static uint8_t echoReq[] = { 0x08, 0x01, 0x02, 0x03 };
+        uint8_t appData[] = { 0x00 };
+        LmHandlerAppData_t appDataParams = { .Port = APP_PORT, .BufferSize = sizeof( appData ), .Buffer = appData };
+        uint32_t nbTx;
+        uint32_t start;
+        uint32_t waitTime;
+        uint8_t fOptsLen;
+
+        // Use up the duty cycle time credits
+        while( LmHandlerSend( &appDataParams, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS )
+        {
+            LmHandlerHostRunUntilIdle( );
+        }
+        nbTx = RadioHost.NbTx;
+
+        memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+        mcpsIndication.RxData = true;
+        mcpsIndication.Port = 224;
+        mcpsIndication.Buffer = echoReq;
+        mcpsIndication.BufferSize = sizeof( echoReq );
+        ReceiveDownlink( &mcpsIndication );
+        start = RtcHostGetTime( );
+        LmHandlerProcess( );
+        waitTime = LmHandlerGetDutyCycleWaitTime( );
+        TEST_CHECK( RadioHost.NbTx == nbTx );
+        TEST_CHECK( waitTime > 0 );
+
+        RunMainLoop( IDLE_TIME, 0, nbTx + 1 );
+        fOptsLen = RadioHost.TxBuffer[5] & 0x0F;
+        printf( "compliance echo: duty cycle wait %u ms, requested after %u ms, sent after %u ms\n", waitTime,
+                UplinkTime - start, RtcHostGetTime( ) - start );
+        TEST_CHECK( UplinkPort == 224 );
+        TEST_CHECK( ( UplinkTime - start ) <= ( waitTime + 10 ) );
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        TEST_CHECK( RadioHost.TxBuffer[8 + fOptsLen] == 224 );
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
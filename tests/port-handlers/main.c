@@ -0,0 +1,334 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     LoRaMac handler port handlers host test. Checks the handler
+ *            registration rejections and that each downlink payload reaches
+ *            the consumer of its port, OnRxData being notified of every
+ *            reception.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "rtc-board-host.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+#include "LmhpCompliance.h"
+#include "LmhpFragmentation.h"
+
+/*!
+ * Size of the port handlers table, default LMHANDLER_PORT_HANDLERS_MAX
+ */
+#define PORT_HANDLERS_MAX                           ( PKG_MAX_NUMBER + 4 )
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * Port never given a handler
+ */
+#define FREE_PORT                                   100
+
+/*!
+ * Package ports
+ */
+#define FRAGMENTATION_PORT                          201
+#define COMPLIANCE_PORT                             224
+
+/*!
+ * Ports the table is filled with
+ */
+#define FILL_PORT_FIRST                             10
+#define FILL_PORT_LAST                              40
+
+/*!
+ * Last notification of a port handler and of OnRxData
+ */
+typedef struct sRxRecord
+{
+    uint32_t NbCalls;
+    uint8_t Port;
+    uint8_t *Buffer;
+    uint8_t BufferSize;
+}RxRecord_t;
+
+static RxRecord_t HandlerRx;
+static RxRecord_t OnRxDataRx;
+
+/*!
+ * MAC layer primitives of the LoRaMac handler, to simulate the downlinks
+ */
+static LoRaMacPrimitives_t *MacPrimitives;
+
+LoRaMacStatus_t __real_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region );
+
+LoRaMacStatus_t __wrap_LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
+                                              LoRaMacRegion_t region )
+{
+    MacPrimitives = primitives;
+    return __real_LoRaMacInitialization( primitives, callbacks, region );
+}
+
+static void Record( RxRecord_t *record, LmHandlerAppData_t *appData )
+{
+    record->NbCalls++;
+    record->Port = appData->Port;
+    record->Buffer = appData->Buffer;
+    record->BufferSize = appData->BufferSize;
+}
+
+static void OnRxData( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
+{
+    // Only the MCPS indications are simulated
+    TEST_CHECK( appData != NULL );
+    if( appData != NULL )
+    {
+        Record( &OnRxDataRx, appData );
+    }
+}
+
+LmHandlerErrorStatus_t __real_LmHandlerInit( LmHandlerCallbacks_t *callbacks, LmHandlerParams_t *handlerParams );
+
+LmHandlerErrorStatus_t __wrap_LmHandlerInit( LmHandlerCallbacks_t *callbacks, LmHandlerParams_t *handlerParams )
+{
+    callbacks->OnRxData = OnRxData;
+    return __real_LmHandlerInit( callbacks, handlerParams );
+}
+
+static void OnPortData( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
+{
+    Record( &HandlerRx, appData );
+}
+
+static void OnOtherPortData( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
+{
+    TEST_CHECK( false );
+}
+
+/*
+ * Package parameters
+ */
+static int8_t FragDecoderWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return 0;
+}
+
+static int8_t FragDecoderRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return 0;
+}
+
+static LmhpComplianceParams_t ComplianceParams =
+{
+    .FwVersion.Value = 0x01000000,
+    .OnTxPeriodicityChanged = NULL,
+    .OnTxFrameCtrlChanged = NULL,
+    .OnPingSlotPeriodicityChanged = NULL,
+};
+
+static LmhpFragmentationParams_t FragmentationParams =
+{
+    .DecoderCallbacks =
+    {
+        .FragDecoderWrite = FragDecoderWrite,
+        .FragDecoderRead = FragDecoderRead,
+    },
+    .OnProgress = NULL,
+    .OnDone = NULL,
+};
+
+/*!
+ * \brief Simulates a downlink indication of the MAC layer
+ *
+ * \param [IN] rxData Indicates if the downlink has a port and a payload
+ * \param [IN] port   Downlink port
+ * \param [IN] buffer Downlink payload
+ * \param [IN] size   Downlink payload size
+ */
+static void ReceiveDownlink( bool rxData, uint8_t port, uint8_t *buffer, uint8_t size )
+{
+    McpsIndication_t mcpsIndication;
+
+    memset( &mcpsIndication, 0, sizeof( mcpsIndication ) );
+    memset( &HandlerRx, 0, sizeof( HandlerRx ) );
+    memset( &OnRxDataRx, 0, sizeof( OnRxDataRx ) );
+    mcpsIndication.McpsIndication = MCPS_UNCONFIRMED;
+    mcpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    mcpsIndication.RxData = rxData;
+    mcpsIndication.Port = port;
+    mcpsIndication.Buffer = buffer;
+    mcpsIndication.BufferSize = size;
+    MacPrimitives->MacMcpsIndication( &mcpsIndication );
+    LmHandlerHostRunUntilIdle( );
+}
+
+/*!
+ * \brief Checks that a downlink payload reaches the handler of its port only
+ *        and that OnRxData is notified without the payload
+ */
+static void CheckHandlerDownlink( uint8_t port )
+{
+    uint8_t payload[] = { 0x01, port };
+
+    ReceiveDownlink( true, port, payload, sizeof( payload ) );
+    TEST_CHECK( HandlerRx.NbCalls == 1 );
+    TEST_CHECK( HandlerRx.Port == port );
+    TEST_CHECK( HandlerRx.Buffer == payload );
+    TEST_CHECK( HandlerRx.BufferSize == sizeof( payload ) );
+    TEST_CHECK( OnRxDataRx.NbCalls == 1 );
+    TEST_CHECK( OnRxDataRx.Port == port );
+    TEST_CHECK( OnRxDataRx.Buffer == NULL );
+    TEST_CHECK( OnRxDataRx.BufferSize == 0 );
+}
+
+/*!
+ * \brief Checks that a downlink payload without port handler reaches
+ *        OnRxData
+ */
+static void CheckOnRxDataDownlink( uint8_t port )
+{
+    uint8_t payload[] = { 0x01, port };
+
+    ReceiveDownlink( true, port, payload, sizeof( payload ) );
+    TEST_CHECK( HandlerRx.NbCalls == 0 );
+    TEST_CHECK( OnRxDataRx.NbCalls == 1 );
+    TEST_CHECK( OnRxDataRx.Port == port );
+    TEST_CHECK( OnRxDataRx.Buffer == payload );
+    TEST_CHECK( OnRxDataRx.BufferSize == sizeof( payload ) );
+}
+
+static void CheckRegistration( uint8_t *fillPorts, uint8_t *nbFillPorts )
+{
+    uint8_t candidates[FILL_PORT_LAST - FILL_PORT_FIRST + 1];
+    uint8_t nbCandidates = sizeof( candidates );
+
+    // Invalid handlers and ports already used
+    TEST_CHECK( LmHandlerPortHandlerRegister( 0, OnPortData ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerRegister( APP_PORT, NULL ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerRegister( APP_PORT, OnPortData ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( LmHandlerPortHandlerRegister( APP_PORT, OnPortData ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerRegister( APP_PORT, OnOtherPortData ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerRegister( FRAGMENTATION_PORT, OnOtherPortData ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerRegister( COMPLIANCE_PORT, OnOtherPortData ) == LORAMAC_HANDLER_ERROR );
+
+    // Fill the table in random port order
+    for( uint8_t i = 0; i < nbCandidates; i++ )
+    {
+        candidates[i] = FILL_PORT_FIRST + i;
+    }
+    *nbFillPorts = 0;
+    while( nbCandidates > 0 )
+    {
+        uint8_t index = rand( ) % nbCandidates;
+        uint8_t port = candidates[index];
+
+        candidates[index] = candidates[--nbCandidates];
+        if( LmHandlerPortHandlerRegister( port, OnPortData ) != LORAMAC_HANDLER_SUCCESS )
+        {
+            break;
+        }
+        fillPorts[( *nbFillPorts )++] = port;
+    }
+    // The application port and the two package ports use the other entries
+    printf( "%u application handlers registered with the table full\n", *nbFillPorts + 1 );
+    TEST_CHECK( ( *nbFillPorts + 3 ) == PORT_HANDLERS_MAX );
+    TEST_CHECK( LmHandlerPortHandlerRegister( FREE_PORT, OnPortData ) == LORAMAC_HANDLER_ERROR );
+
+    // Only the application handlers can be unregistered
+    TEST_CHECK( LmHandlerPortHandlerUnregister( 0 ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerUnregister( FREE_PORT ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerUnregister( FRAGMENTATION_PORT ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( LmHandlerPortHandlerUnregister( COMPLIANCE_PORT ) == LORAMAC_HANDLER_ERROR );
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_5,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = false,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    uint8_t fillPorts[PORT_HANDLERS_MAX];
+    uint8_t nbFillPorts = 0;
+
+    srand( 1 );
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+    TEST_CHECK( LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &ComplianceParams ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( LmHandlerPackageRegister( PACKAGE_ID_FRAGMENTATION, &FragmentationParams ) == LORAMAC_HANDLER_SUCCESS );
+
+    CheckRegistration( fillPorts, &nbFillPorts );
+
+    // Each handler gets the payloads of its port
+    CheckHandlerDownlink( APP_PORT );
+    for( uint8_t i = 0; i < nbFillPorts; i++ )
+    {
+        CheckHandlerDownlink( fillPorts[i] );
+    }
+    // The ports without handler still use OnRxData
+    CheckOnRxDataDownlink( FREE_PORT );
+    CheckOnRxDataDownlink( FILL_PORT_LAST + 1 );
+
+    // The packages consume their ports, the reception is notified
+    {
+        uint8_t pkgVersionReq[] = { 0x00 };
+        uint32_t nbTx = RadioHost.NbTx;
+        uint8_t fOptsLen;
+
+        ReceiveDownlink( true, FRAGMENTATION_PORT, pkgVersionReq, sizeof( pkgVersionReq ) );
+        fOptsLen = RadioHost.TxBuffer[5] & 0x0F;
+        TEST_CHECK( HandlerRx.NbCalls == 0 );
+        TEST_CHECK( OnRxDataRx.NbCalls == 1 );
+        TEST_CHECK( OnRxDataRx.Port == FRAGMENTATION_PORT );
+        TEST_CHECK( OnRxDataRx.Buffer == NULL );
+        TEST_CHECK( OnRxDataRx.BufferSize == 0 );
+        // PackageVersionAns
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        TEST_CHECK( RadioHost.TxBuffer[8 + fOptsLen] == FRAGMENTATION_PORT );
+    }
+
+    // Port 0 and acknowledgements without payload are notified through
+    // OnRxData
+    ReceiveDownlink( false, 0, NULL, 0 );
+    TEST_CHECK( HandlerRx.NbCalls == 0 );
+    TEST_CHECK( OnRxDataRx.NbCalls == 1 );
+    TEST_CHECK( OnRxDataRx.BufferSize == 0 );
+
+    // An unregistered port goes back to OnRxData and frees its entry
+    TEST_CHECK( LmHandlerPortHandlerUnregister( APP_PORT ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( LmHandlerPortHandlerUnregister( APP_PORT ) == LORAMAC_HANDLER_ERROR );
+    CheckOnRxDataDownlink( APP_PORT );
+    TEST_CHECK( LmHandlerPortHandlerRegister( FREE_PORT, OnPortData ) == LORAMAC_HANDLER_SUCCESS );
+    CheckHandlerDownlink( FREE_PORT );
+    for( uint8_t i = 0; i < nbFillPorts; i++ )
+    {
+        CheckHandlerDownlink( fillPorts[i] );
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
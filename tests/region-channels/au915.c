@@ -0,0 +1,28 @@
+/*!
+ * \file      au915.c
+ *
+ * \brief     White-box access to the AU915 datarate channels masks
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include "RegionAU915.c"
+
+const uint16_t* RegionAU915HostGetDrChannelsMask( int8_t datarate )
+{
+    if( ( datarate < 0 ) || ( datarate > AU915_TX_MAX_DATARATE ) )
+    {
+        return NULL;
+    }
+    return DrChannelsMaskAU915[datarate];
+}
@@ -0,0 +1,472 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Region channels mask host test. Checks the channels mask
+ *            primitives and the enabled channels count against bit-by-bit
+ *            versions for every region and measures the channels count.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "Region.h"
+#include "RegionCommon.h"
+#include "RegionNvm.h"
+
+/*!
+ * Number of random masks checked by the select-nth and count channels tests
+ */
+#define NB_RANDOM_MASKS                             100000
+
+/*!
+ * Number of random channel plans checked per region
+ */
+#define NB_RANDOM_PLANS                             20000
+
+/*!
+ * Number of benchmark runs
+ */
+#define NB_BENCHMARK_RUNS                           10000
+
+/*!
+ * Number of channels mask words
+ */
+#define NB_MASK_WORDS                               REGION_NVM_CHANNELS_MASK_SIZE
+
+/*!
+ * Datarate channels masks of the regions with a fixed channel plan, refer to
+ * us915.c and au915.c
+ */
+const uint16_t* RegionUS915HostGetDrChannelsMask( int8_t datarate );
+const uint16_t* RegionAU915HostGetDrChannelsMask( int8_t datarate );
+
+/*!
+ * Region under test
+ */
+typedef struct sRegionUnderTest
+{
+    const char* Name;
+    LoRaMacRegion_t Region;
+    /*!
+     * Gets the datarate channels mask. NULL if the channels are checked one
+     * by one
+     */
+    const uint16_t* ( *GetDrChannelsMask )( int8_t datarate );
+}RegionUnderTest_t;
+
+static const RegionUnderTest_t Regions[] =
+{
+    { "AS923", LORAMAC_REGION_AS923, NULL },
+    { "AU915", LORAMAC_REGION_AU915, RegionAU915HostGetDrChannelsMask },
+    { "CN470", LORAMAC_REGION_CN470, NULL },
+    { "CN779", LORAMAC_REGION_CN779, NULL },
+    { "EU433", LORAMAC_REGION_EU433, NULL },
+    { "EU868", LORAMAC_REGION_EU868, NULL },
+    { "KR920", LORAMAC_REGION_KR920, NULL },
+    { "IN865", LORAMAC_REGION_IN865, NULL },
+    { "US915", LORAMAC_REGION_US915, RegionUS915HostGetDrChannelsMask },
+    { "RU864", LORAMAC_REGION_RU864, NULL },
+};
+
+/*!
+ * Region NVM storage
+ */
+static RegionNvmDataGroup1_t NvmGroup1;
+static RegionNvmDataGroup2_t NvmGroup2;
+static Band_t Bands[REGION_NVM_MAX_NB_BANDS];
+
+/*
+ * Bit-by-bit reference versions
+ */
+static uint8_t CountBitsRef( uint16_t mask )
+{
+    uint8_t nbBits = 0;
+
+    for( uint8_t j = 0; j < 16; j++ )
+    {
+        if( ( mask & ( 1 << j ) ) != 0 )
+        {
+            nbBits++;
+        }
+    }
+    return nbBits;
+}
+
+static uint8_t FindFirstSetBitRef( uint16_t mask )
+{
+    uint8_t j = 0;
+
+    while( ( mask & ( 1 << j ) ) == 0 )
+    {
+        j++;
+    }
+    return j;
+}
+
+static int16_t SelectNthSetBitRef( uint16_t* channelsMask, uint8_t nbWords, uint8_t n )
+{
+    for( uint16_t i = 0; i < ( nbWords * 16 ); i++ )
+    {
+        if( ( channelsMask[i / 16] & ( 1 << ( i % 16 ) ) ) != 0 )
+        {
+            if( n == 0 )
+            {
+                return i;
+            }
+            n--;
+        }
+    }
+    return -1;
+}
+
+static uint8_t CountChannelsRef( uint16_t* channelsMask, uint8_t startIdx, uint8_t stopIdx )
+{
+    uint8_t nbChannels = 0;
+
+    for( uint8_t i = startIdx; i < stopIdx; i++ )
+    {
+        nbChannels += CountBitsRef( channelsMask[i] );
+    }
+    return nbChannels;
+}
+
+/*!
+ * Enabled channels count before the word-wide version. The datarate range of
+ * every channel is checked.
+ */
+static void CountNbOfEnabledChannelsRef( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
+                                         uint8_t* enabledChannels, uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels )
+{
+    uint8_t nbChannelCount = 0;
+    uint8_t nbRestrictedChannelsCount = 0;
+
+    for( uint8_t i = 0, k = 0; i < countNbOfEnabledChannelsParams->MaxNbChannels; i += 16, k++ )
+    {
+        for( uint8_t j = 0; j < 16; j++ )
+        {
+            if( ( countNbOfEnabledChannelsParams->ChannelsMask[k] & ( 1 << j ) ) != 0 )
+            {
+                if( countNbOfEnabledChannelsParams->Channels[i + j].Frequency == 0 )
+                { // Check if the channel is enabled
+                    continue;
+                }
+                if( ( countNbOfEnabledChannelsParams->Joined == false ) &&
+                    ( countNbOfEnabledChannelsParams->JoinChannels != NULL ) )
+                {
+                    if( ( countNbOfEnabledChannelsParams->JoinChannels[k] & ( 1 << j ) ) == 0 )
+                    {
+                        continue;
+                    }
+                }
+                if( RegionCommonValueInRange( countNbOfEnabledChannelsParams->Datarate,
+                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Min,
+                                              countNbOfEnabledChannelsParams->Channels[i + j].DrRange.Fields.Max ) == false )
+                { // Check if the current channel selection supports the given datarate
+                    continue;
+                }
+                if( countNbOfEnabledChannelsParams->Bands[countNbOfEnabledChannelsParams->Channels[i + j].Band].ReadyForTransmission == false )
+                { // Check if the band is available for transmission
+                    nbRestrictedChannelsCount++;
+                    continue;
+                }
+                enabledChannels[nbChannelCount++] = i + j;
+            }
+        }
+    }
+    *nbEnabledChannels = nbChannelCount;
+    *nbRestrictedChannels = nbRestrictedChannelsCount;
+}
+
+/*!
+ * \brief Draws a random channels mask word, from sparse to dense
+ */
+static uint16_t RandomMaskWord( void )
+{
+    uint16_t mask = ( uint16_t )rand( );
+
+    switch( rand( ) % 4 )
+    {
+        case 0:
+            return mask & ( uint16_t )rand( ) & ( uint16_t )rand( );
+        case 1:
+            return mask | ( uint16_t )rand( );
+        case 2:
+            return ( rand( ) % 2 ) ? 0x0000 : 0xFFFF;
+        default:
+            return mask;
+    }
+}
+
+/*!
+ * \brief Draws a random channels mask of the given number of channels
+ */
+static void RandomMask( uint16_t* mask, uint16_t nbChannels )
+{
+    for( uint8_t k = 0; k < NB_MASK_WORDS; k++ )
+    {
+        if( ( k * 16 ) >= nbChannels )
+        {
+            mask[k] = 0;
+        }
+        else if( ( ( k + 1 ) * 16 ) > nbChannels )
+        {
+            mask[k] = RandomMaskWord( ) & ( ( 1 << ( nbChannels % 16 ) ) - 1 );
+        }
+        else
+        {
+            mask[k] = RandomMaskWord( );
+        }
+    }
+}
+
+static void CheckPrimitives( void )
+{
+    uint16_t mask[NB_MASK_WORDS];
+    uint32_t nbErrors = 0;
+
+    for( uint32_t value = 0; value <= UINT16_MAX; value++ )
+    {
+        if( RegionCommonCountBits( value ) != CountBitsRef( value ) )
+        {
+            nbErrors++;
+        }
+        if( ( value != 0 ) && ( RegionCommonFindFirstSetBit( value ) != FindFirstSetBitRef( value ) ) )
+        {
+            nbErrors++;
+        }
+    }
+    TEST_CHECK( nbErrors == 0 );
+
+    nbErrors = 0;
+    for( uint32_t i = 0; i < NB_RANDOM_MASKS; i++ )
+    {
+        uint8_t nbWords = 1 + ( rand( ) % NB_MASK_WORDS );
+        uint8_t startIdx = rand( ) % ( nbWords + 1 );
+        uint8_t nbBits;
+
+        RandomMask( mask, nbWords * 16 );
+        nbBits = CountChannelsRef( mask, 0, nbWords );
+        // Every rank, one out of range
+        for( uint8_t n = 0; n <= nbBits; n++ )
+        {
+            if( RegionCommonSelectNthSetBit( mask, nbWords, n ) != SelectNthSetBitRef( mask, nbWords, n ) )
+            {
+                nbErrors++;
+            }
+        }
+        if( RegionCommonCountChannels( mask, startIdx, nbWords ) != CountChannelsRef( mask, startIdx, nbWords ) )
+        {
+            nbErrors++;
+        }
+    }
+    TEST_CHECK( nbErrors == 0 );
+    TEST_CHECK( RegionCommonSelectNthSetBit( NULL, 1, 0 ) == -1 );
+    TEST_CHECK( RegionCommonCountChannels( NULL, 0, 1 ) == 0 );
+}
+
+/*!
+ * \brief Initializes the default channel plan of a region
+ *
+ * \retval nbChannels Maximum number of channels of the region
+ */
+static uint16_t InitRegion( LoRaMacRegion_t region )
+{
+    InitDefaultsParams_t params;
+    GetPhyParams_t getPhy;
+
+    memset( &NvmGroup1, 0, sizeof( NvmGroup1 ) );
+    memset( &NvmGroup2, 0, sizeof( NvmGroup2 ) );
+    memset( Bands, 0, sizeof( Bands ) );
+    params.Type = INIT_TYPE_DEFAULTS;
+    params.NvmGroup1 = &NvmGroup1;
+    params.NvmGroup2 = &NvmGroup2;
+    params.Bands = Bands;
+    RegionInitDefaults( region, &params );
+
+    getPhy.Attribute = PHY_MAX_NB_CHANNELS;
+    return RegionGetPhyParam( region, &getPhy ).Value;
+}
+
+/*!
+ * \brief Compares the enabled channels count with the reference version
+ *
+ * \retval status [true: same result, false: different]
+ */
+static bool CompareCount( RegionCommonCountNbOfEnabledChannelsParams_t* params )
+{
+    uint8_t enabledChannels[REGION_NVM_MAX_NB_CHANNELS] = { 0 };
+    uint8_t enabledChannelsRef[REGION_NVM_MAX_NB_CHANNELS] = { 0 };
+    uint8_t nbEnabled = 0;
+    uint8_t nbEnabledRef = 0;
+    uint8_t nbRestricted = 0;
+    uint8_t nbRestrictedRef = 0;
+    RegionCommonCountNbOfEnabledChannelsParams_t paramsRef = *params;
+
+    // The reference checks the datarate range of every channel
+    paramsRef.DrChannelsMask = NULL;
+    RegionCommonCountNbOfEnabledChannels( params, enabledChannels, &nbEnabled, &nbRestricted );
+    CountNbOfEnabledChannelsRef( &paramsRef, enabledChannelsRef, &nbEnabledRef, &nbRestrictedRef );
+
+    return ( nbEnabled == nbEnabledRef ) && ( nbRestricted == nbRestrictedRef ) &&
+           ( memcmp( enabledChannels, enabledChannelsRef, nbEnabled ) == 0 );
+}
+
+/*!
+ * \brief Compares the enabled channels count with the reference version on
+ *        random masks, join masks, bands and datarates. The channels of the
+ *        regions without a fixed channel plan are drawn at random too.
+ */
+static void CheckCount( const RegionUnderTest_t* regionUnderTest )
+{
+    const RegionPhyParams_t* phy = RegionGetPhyParams( regionUnderTest->Region );
+    uint16_t nbChannels = InitRegion( regionUnderTest->Region );
+    uint16_t channelsMask[NB_MASK_WORDS];
+    uint16_t joinChannels[NB_MASK_WORDS];
+    RegionCommonCountNbOfEnabledChannelsParams_t params;
+    uint32_t nbErrors = 0;
+
+    params.Channels = NvmGroup2.Channels;
+    params.Bands = Bands;
+    params.MaxNbChannels = nbChannels;
+    params.ChannelsMask = channelsMask;
+
+    // The fixed channel plans match their datarate channels masks
+    if( regionUnderTest->GetDrChannelsMask != NULL )
+    {
+        for( int8_t dr = phy->MinTxDr[0]; dr <= phy->MaxTxDr; dr++ )
+        {
+            const uint16_t* drMask = regionUnderTest->GetDrChannelsMask( dr );
+
+            for( uint16_t i = 0; i < nbChannels; i++ )
+            {
+                bool isSupported = RegionCommonValueInRange( dr, NvmGroup2.Channels[i].DrRange.Fields.Min,
+                                                             NvmGroup2.Channels[i].DrRange.Fields.Max );
+
+                if( isSupported != ( ( drMask[i / 16] & ( 1 << ( i % 16 ) ) ) != 0 ) )
+                {
+                    nbErrors++;
+                }
+            }
+        }
+    }
+
+    for( uint32_t plan = 0; plan < NB_RANDOM_PLANS; plan++ )
+    {
+        if( regionUnderTest->GetDrChannelsMask == NULL )
+        {
+            // Channels added or removed by NewChannelReq
+            for( uint16_t i = 0; i < nbChannels; i++ )
+            {
+                uint8_t min = rand( ) % 8;
+
+                NvmGroup2.Channels[i].Frequency = ( ( rand( ) % 4 ) == 0 ) ? 0 : 868100000;
+                NvmGroup2.Channels[i].DrRange.Fields.Min = min;
+                NvmGroup2.Channels[i].DrRange.Fields.Max = min + ( rand( ) % ( 8 - min ) );
+                NvmGroup2.Channels[i].Band = rand( ) % REGION_NVM_MAX_NB_BANDS;
+            }
+        }
+        for( uint8_t i = 0; i < REGION_NVM_MAX_NB_BANDS; i++ )
+        {
+            Bands[i].ReadyForTransmission = ( rand( ) % 4 ) != 0;
+        }
+        RandomMask( channelsMask, nbChannels );
+        RandomMask( joinChannels, nbChannels );
+
+        params.Joined = ( rand( ) % 2 ) == 0;
+        params.JoinChannels = ( ( rand( ) % 2 ) == 0 ) ? joinChannels : NULL;
+        // Every datarate, one out of the TX range
+        params.Datarate = rand( ) % ( phy->MaxTxDr + 2 );
+        params.DrChannelsMask = ( regionUnderTest->GetDrChannelsMask != NULL ) ?
+                                regionUnderTest->GetDrChannelsMask( params.Datarate ) : NULL;
+        if( CompareCount( &params ) == false )
+        {
+            nbErrors++;
+        }
+    }
+    if( nbErrors != 0 )
+    {
+        printf( "%s: %u errors\n", regionUnderTest->Name, nbErrors );
+    }
+    TEST_CHECK( nbErrors == 0 );
+}
+
+/*!
+ * \brief Measures the enabled channels count of the default channel plan,
+ *        all channels enabled, joined, at the default datarate
+ */
+static void BenchmarkCount( const RegionUnderTest_t* regionUnderTest )
+{
+    uint16_t nbChannels = InitRegion( regionUnderTest->Region );
+    uint8_t enabledChannels[REGION_NVM_MAX_NB_CHANNELS];
+    uint8_t nbEnabled = 0;
+    uint8_t nbRestricted = 0;
+    uint64_t minCycles = UINT64_MAX;
+    uint64_t minCyclesRef = UINT64_MAX;
+    RegionCommonCountNbOfEnabledChannelsParams_t params;
+    GetPhyParams_t getPhy;
+
+    getPhy.Attribute = PHY_DEF_TX_DR;
+    params.Joined = true;
+    params.Datarate = RegionGetPhyParam( regionUnderTest->Region, &getPhy ).Value;
+    params.ChannelsMask = NvmGroup2.ChannelsMask;
+    params.Channels = NvmGroup2.Channels;
+    params.Bands = Bands;
+    params.MaxNbChannels = nbChannels;
+    params.JoinChannels = NULL;
+    params.DrChannelsMask = ( regionUnderTest->GetDrChannelsMask != NULL ) ?
+                            regionUnderTest->GetDrChannelsMask( params.Datarate ) : NULL;
+    for( uint8_t i = 0; i < REGION_NVM_MAX_NB_BANDS; i++ )
+    {
+        Bands[i].ReadyForTransmission = true;
+    }
+
+    for( uint32_t run = 0; run < NB_BENCHMARK_RUNS; run++ )
+    {
+        uint64_t cycles = TestGetCycles( );
+
+        RegionCommonCountNbOfEnabledChannels( &params, enabledChannels, &nbEnabled, &nbRestricted );
+        cycles = TestGetCycles( ) - cycles;
+        minCycles = MIN( minCycles, cycles );
+
+        cycles = TestGetCycles( );
+        CountNbOfEnabledChannelsRef( &params, enabledChannels, &nbEnabled, &nbRestricted );
+        cycles = TestGetCycles( ) - cycles;
+        minCyclesRef = MIN( minCyclesRef, cycles );
+    }
+    printf( "%s: %2u channels, %2u enabled at DR%u, " TEST_CYCLES_UNIT ": bit by bit %4llu, word wide %4llu\n",
+            regionUnderTest->Name, nbChannels, nbEnabled, params.Datarate,
+            ( unsigned long long )minCyclesRef, ( unsigned long long )minCycles );
+    TEST_CHECK( nbEnabled > 0 );
+}
+
+int main( void )
+{
+    srand( 1 );
+
+    CheckPrimitives( );
+    for( uint8_t i = 0; i < ( sizeof( Regions ) / sizeof( Regions[0] ) ); i++ )
+    {
+        CheckCount( &Regions[i] );
+    }
+    for( uint8_t i = 0; i < ( sizeof( Regions ) / sizeof( Regions[0] ) ); i++ )
+    {
+        BenchmarkCount( &Regions[i] );
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
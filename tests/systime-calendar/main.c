@@ -0,0 +1,154 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     System time calendar host test. Checks SysTimeLocalTime against
+ *            gmtime and the SysTimeMkTime round trip over the whole uint32_t
+ *            range and reports the cost of a conversion.
+ *
+ *            Checks every day of the range at several times of the day, and
+ *            every second around the leap days. Run with "all" as argument to
+ *            check every second of the range, which takes a few minutes.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "systime.h"
+
+/*!
+ * Times of the day checked for every day of the range, in s
+ */
+static const uint32_t DayTimes[] = { 0, 1, 3599, 43210, 86340, 86399 };
+
+/*!
+ * Dates of which the surrounding seconds are all checked, consecutive
+ * conversions also go through the cache of the last converted day
+ */
+static const uint32_t Boundaries[] =
+{
+    951782400,  // 2000-02-29
+    4107456000, // 2100-02-28
+    4107542400, // 2100-03-01
+    4294967295, // 2106-02-07, last second of the range
+};
+
+/*!
+ * \brief Compares a SysTimeLocalTime conversion with gmtime and checks that
+ *        SysTimeMkTime converts it back
+ *
+ * \param [IN] timestamp Seconds since the Unix epoch
+ *
+ * \retval status [true: conversions match, false: mismatch]
+ */
+static bool CheckTimestamp( uint32_t timestamp )
+{
+    time_t time = timestamp;
+    struct tm expected;
+    struct tm actual;
+
+    gmtime_r( &time, &expected );
+    SysTimeLocalTime( timestamp, &actual );
+    if( ( actual.tm_sec != expected.tm_sec ) || ( actual.tm_min != expected.tm_min ) ||
+        ( actual.tm_hour != expected.tm_hour ) || ( actual.tm_mday != expected.tm_mday ) ||
+        ( actual.tm_mon != expected.tm_mon ) || ( actual.tm_year != expected.tm_year ) ||
+        ( actual.tm_wday != expected.tm_wday ) || ( actual.tm_yday != expected.tm_yday ) )
+    {
+        printf( "SysTimeLocalTime( %u ) mismatch\n", timestamp );
+        return false;
+    }
+    if( SysTimeMkTime( &expected ) != timestamp )
+    {
+        printf( "SysTimeMkTime( %u ) mismatch\n", timestamp );
+        return false;
+    }
+    return true;
+}
+
+int main( int argc, char *argv[] )
+{
+    bool isExhaustive = ( argc > 1 ) && ( strcmp( argv[1], "all" ) == 0 );
+    uint32_t nbMismatches = 0;
+    uint64_t nbChecks = 0;
+    uint64_t localTimeCycles = 0;
+    uint64_t sameDayCycles = 0;
+    uint64_t mkTimeCycles = 0;
+    uint32_t nbRuns = 100000;
+
+    // Every day of the range
+    for( uint64_t day = 0; ( day * 86400 ) <= UINT32_MAX; day++ )
+    {
+        for( uint8_t i = 0; i < ( sizeof( DayTimes ) / sizeof( DayTimes[0] ) ); i++ )
+        {
+            uint64_t timestamp = ( day * 86400 ) + DayTimes[i];
+
+            if( timestamp <= UINT32_MAX )
+            {
+                nbMismatches += ( CheckTimestamp( ( uint32_t )timestamp ) == true ) ? 0 : 1;
+                nbChecks++;
+            }
+        }
+    }
+
+    // Every second around the leap days and the end of the range
+    for( uint8_t i = 0; i < ( sizeof( Boundaries ) / sizeof( Boundaries[0] ) ); i++ )
+    {
+        for( int64_t timestamp = ( int64_t )Boundaries[i] - 86400; timestamp <= ( ( int64_t )Boundaries[i] + 86400 ); timestamp++ )
+        {
+            if( timestamp <= UINT32_MAX )
+            {
+                nbMismatches += ( CheckTimestamp( ( uint32_t )timestamp ) == true ) ? 0 : 1;
+                nbChecks++;
+            }
+        }
+    }
+
+    // Every 4093th second, a prime which sweeps all the times of the day, or
+    // every second
+    for( uint64_t timestamp = 0; timestamp <= UINT32_MAX; timestamp += ( isExhaustive == true ) ? 1 : 4093 )
+    {
+        nbMismatches += ( CheckTimestamp( ( uint32_t )timestamp ) == true ) ? 0 : 1;
+        nbChecks++;
+    }
+
+    printf( "%llu conversions, %u mismatches\n", ( unsigned long long )nbChecks, nbMismatches );
+    TEST_CHECK( nbMismatches == 0 );
+
+    srand( 1 );
+    for( uint32_t run = 0; run < nbRuns; run++ )
+    {
+        uint32_t timestamp = ( ( uint32_t )rand( ) << 16 ) ^ ( uint32_t )rand( );
+        struct tm localtime;
+        uint64_t start;
+
+        start = TestGetCycles( );
+        SysTimeLocalTime( timestamp, &localtime );
+        localTimeCycles += TestGetCycles( ) - start;
+
+        start = TestGetCycles( );
+        SysTimeLocalTime( timestamp + 1, &localtime );
+        sameDayCycles += TestGetCycles( ) - start;
+
+        start = TestGetCycles( );
+        SysTimeMkTime( &localtime );
+        mkTimeCycles += TestGetCycles( ) - start;
+    }
+    printf( "SysTimeLocalTime %.0f %s, same day %.0f %s, SysTimeMkTime %.0f %s\n",
+            ( double )localTimeCycles / nbRuns, TEST_CYCLES_UNIT, ( double )sameDayCycles / nbRuns, TEST_CYCLES_UNIT,
+            ( double )mkTimeCycles / nbRuns, TEST_CYCLES_UNIT );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,488 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Telemetry store host test. Simulates a 12 hours coverage outage
+ *            and checks the ordering, the completeness and the airtime of
+ *            the backfill.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "test.h"
+#include "eeprom-board-host.h"
+#include "utilities.h"
+#include "systime.h"
+#include "LoRaMac.h"
+#include "LoRaMacAdr.h"
+#include "LmHandler.h"
+#include "TelemetryStore.h"
+
+/*!
+ * Measurement period [s]
+ */
+#define MEASUREMENT_PERIOD                          600
+
+/*!
+ * Measurement size [bytes]. 4 bytes index + 8 bytes of data
+ */
+#define MEASUREMENT_SIZE                            12
+
+/*!
+ * Start and end of the coverage outage [s]
+ */
+#define OUTAGE_START                                3600
+#define OUTAGE_END                                  ( OUTAGE_START + ( 12 * 3600 ) )
+
+/*!
+ * End of the simulation [s]
+ */
+#define SIMULATION_END                              ( OUTAGE_END + ( 4 * 3600 ) )
+
+/*!
+ * Maximum number of measurements
+ */
+#define MAX_MEASUREMENTS                            256
+
+/*
+ * Simulated network and MAC layer
+ */
+static uint64_t Now;                                // ms
+static bool IsNetworkAvailable;
+static int8_t Datarate;
+static int8_t LinkMarginDatarate;
+static uint64_t DutyCycleEnd;
+static TimerTime_t DutyCycleWaitTime;
+static uint8_t FrameBuffer[255];
+static double Airtime[DR_5 + 1];
+static uint32_t NbFrames[DR_5 + 1];
+static bool IsBackfillDone;
+
+/*
+ * Received records
+ */
+static uint32_t NbReceived[MAX_MEASUREMENTS];
+static uint32_t PushTime[MAX_MEASUREMENTS];
+static int32_t LastIndex;
+static uint32_t NbOutOfOrder;
+
+/*!
+ * EU868 maximum application payload size per datarate
+ */
+static const uint8_t MaxPayloadEU868[] = { 51, 51, 51, 115, 242, 242 };
+
+SysTime_t SysTimeGet( void )
+{
+    SysTime_t sysTime = { .Seconds = ( uint32_t )( Now / 1000 ), .SubSeconds = ( int16_t )( Now % 1000 ) };
+    return sysTime;
+}
+
+TimerTime_t TimerGetCurrentTime( void )
+{
+    return ( TimerTime_t )Now;
+}
+
+TimerTime_t TimerGetElapsedTime( TimerTime_t past )
+{
+    return ( TimerTime_t )Now - past;
+}
+
+LmHandlerFlagStatus_t LmHandlerJoinStatus( void )
+{
+    return ( IsNetworkAvailable == true ) ? LORAMAC_HANDLER_SET : LORAMAC_HANDLER_RESET;
+}
+
+bool LmHandlerIsBusy( void )
+{
+    return false;
+}
+
+int8_t LmHandlerGetCurrentDatarate( void )
+{
+    return Datarate;
+}
+
+LoRaMacRegion_t LmHandlerGetActiveRegion( void )
+{
+    return LORAMAC_REGION_EU868;
+}
+
+TimerTime_t LmHandlerGetDutyCycleWaitTime( void )
+{
+    return DutyCycleWaitTime;
+}
+
+LmHandlerErrorStatus_t LmHandlerReserveAppData( LmHandlerAppData_t *appData )
+{
+    appData->Buffer = FrameBuffer;
+    appData->BufferSize = MaxPayloadEU868[Datarate];
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+int8_t LoRaMacAdrLinkMarginGetMaxDatarate( LoRaMacRegion_t region, int8_t txPower )
+{
+    return LinkMarginDatarate;
+}
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t *mibGet )
+{
+    switch( mibGet->Type )
+    {
+        case MIB_ADR:
+            mibGet->Param.AdrEnable = false;
+            break;
+        case MIB_CHANNELS_TX_POWER:
+            mibGet->Param.ChannelsTxPower = 0;
+            break;
+        default:
+            return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t *mibSet )
+{
+    if( ( mibSet->Type != MIB_CHANNELS_DATARATE ) || ( mibSet->Param.ChannelsDatarate > DR_5 ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    Datarate = mibSet->Param.ChannelsDatarate;
+    return LORAMAC_STATUS_OK;
+}
+
+/*!
+ * \brief LoRa time on air of an EU868 125 kHz uplink, CR 4/5, explicit header
+ *
+ * \param [IN] datarate Datarate
+ * \param [IN] appSize  Application payload size
+ *
+ * \retval Time on air [ms]
+ */
+static double GetTimeOnAir( int8_t datarate, uint8_t appSize )
+{
+    int sf = 12 - datarate;
+    int de = ( sf >= 11 ) ? 1 : 0;
+    // MHDR + FHDR + FPort + MIC
+    int phySize = 1 + 7 + 1 + appSize + 4;
+    double tSym = ( double )( 1 << sf ) / 125.0;
+    double nbPayloadSymbols = 8 + fmax( ceil( ( 8.0 * phySize - 4 * sf + 28 + 16 ) / ( 4.0 * ( sf - 2 * de ) ) ) * 5, 0 );
+
+    return ( 12.25 + nbPayloadSymbols ) * tSym;
+}
+
+/*!
+ * \brief Unpacks a backfill frame and records the received measurements
+ */
+static void ReceiveFrame( const uint8_t *buffer, uint8_t size )
+{
+    uint32_t baseTimestamp = ( ( uint32_t )buffer[0] << 24 ) | ( ( uint32_t )buffer[1] << 16 ) |
+                             ( ( uint32_t )buffer[2] << 8 ) | buffer[3];
+    uint8_t i = 4;
+
+    while( i < size )
+    {
+        uint32_t timestamp = baseTimestamp + ( ( ( uint32_t )buffer[i] << 8 ) | buffer[i + 1] );
+        uint8_t recordSize = buffer[i + 2];
+        int32_t index;
+
+        i += 3;
+        TEST_CHECK( recordSize == MEASUREMENT_SIZE );
+        memcpy( &index, buffer + i, sizeof( index ) );
+        i += recordSize;
+
+        TEST_CHECK( ( index >= 0 ) && ( index < MAX_MEASUREMENTS ) );
+        if( ( index < 0 ) || ( index >= MAX_MEASUREMENTS ) )
+        {
+            continue;
+        }
+        TEST_CHECK( timestamp == PushTime[index] );
+        if( index <= LastIndex )
+        {
+            NbOutOfOrder++;
+        }
+        LastIndex = index;
+        NbReceived[index]++;
+    }
+    TEST_CHECK( i == size );
+}
+
+LmHandlerErrorStatus_t LmHandlerSendAtDatarate( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                                int8_t datarate )
+{
+    double timeOnAir;
+
+    TEST_CHECK( appData->BufferSize <= MaxPayloadEU868[datarate] );
+    TEST_CHECK( datarate == Datarate );
+    if( Now < DutyCycleEnd )
+    {
+        DutyCycleWaitTime = ( TimerTime_t )( DutyCycleEnd - Now );
+        return LORAMAC_HANDLER_ERROR;
+    }
+    DutyCycleWaitTime = 0;
+
+    // 1 % duty cycle
+    timeOnAir = GetTimeOnAir( datarate, appData->BufferSize );
+    DutyCycleEnd = Now + ( uint64_t )ceil( timeOnAir * 100 );
+    if( ( Now >= ( OUTAGE_END * 1000ULL ) ) && ( IsBackfillDone == false ) )
+    {
+        // Backfill frames
+        Airtime[datarate] += timeOnAir;
+        NbFrames[datarate]++;
+    }
+
+    ReceiveFrame( appData->Buffer, appData->BufferSize );
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+/*!
+ * \brief Resets the simulation
+ */
+static void ResetSimulation( void )
+{
+    EepromHostErase( );
+    Now = 0;
+    IsNetworkAvailable = true;
+    Datarate = DR_0;
+    LinkMarginDatarate = -1;
+    DutyCycleEnd = 0;
+    DutyCycleWaitTime = 0;
+    memset( Airtime, 0, sizeof( Airtime ) );
+    memset( NbFrames, 0, sizeof( NbFrames ) );
+    IsBackfillDone = false;
+    memset( NbReceived, 0, sizeof( NbReceived ) );
+    LastIndex = -1;
+    NbOutOfOrder = 0;
+}
+
+/*!
+ * \brief Pushes the measurement taken now
+ */
+static void Measure( int32_t index )
+{
+    uint8_t data[MEASUREMENT_SIZE];
+
+    memset( data, ( uint8_t )index, sizeof( data ) );
+    memcpy( data, &index, sizeof( index ) );
+    PushTime[index] = ( uint32_t )( Now / 1000 );
+    TEST_CHECK( TelemetryStorePush( data, sizeof( data ) ) == true );
+}
+
+/*!
+ * \brief Runs the outage scenario. The measurements are pushed to the store
+ *        and the store is processed every second.
+ *
+ * \param [IN] linkMarginDatarate Datarate supported by the link once the
+ *                                network is back. -1: unknown
+ * \param [IN] powerCycleTime     Time of a power cycle [s]. 0: none
+ * \param [IN] powerFailTime      Time of a power failure [s]. 0: none
+ *
+ * \retval Number of measurements
+ */
+static int32_t RunOutage( int8_t linkMarginDatarate, uint32_t powerCycleTime, uint32_t powerFailTime )
+{
+    int32_t nbMeasurements = 0;
+
+    ResetSimulation( );
+    TelemetryStoreInit( );
+
+    for( uint32_t t = 0; t < SIMULATION_END; t++ )
+    {
+        Now = ( uint64_t )t * 1000;
+        IsNetworkAvailable = ( t < OUTAGE_START ) || ( t >= OUTAGE_END );
+        // The network commands the datarate back after the rejoin
+        LinkMarginDatarate = ( t >= OUTAGE_END ) ? linkMarginDatarate : -1;
+
+        if( ( t % MEASUREMENT_PERIOD ) == 0 )
+        {
+            Measure( nbMeasurements++ );
+        }
+        if( ( powerCycleTime != 0 ) && ( t == powerCycleTime ) )
+        {
+            TelemetryStoreFlush( );
+            TelemetryStoreInit( );
+        }
+        if( ( powerFailTime != 0 ) && ( t == powerFailTime ) )
+        {
+            TelemetryStoreInit( );
+        }
+        TelemetryStoreProcess( LORAMAC_HANDLER_UNCONFIRMED_MSG );
+        if( ( t >= OUTAGE_END ) && ( TelemetryStoreGetCount( ) == 0 ) )
+        {
+            IsBackfillDone = true;
+        }
+    }
+    TelemetryStoreFlush( );
+    return nbMeasurements;
+}
+
+/*!
+ * \brief Gets the number of measurements received exactly once, and the
+ *        number of duplicates
+ */
+static int32_t GetNbReceivedOnce( int32_t nbMeasurements, int32_t *nbDuplicates )
+{
+    int32_t nbOnce = 0;
+
+    *nbDuplicates = 0;
+    for( int32_t i = 0; i < nbMeasurements; i++ )
+    {
+        if( NbReceived[i] == 1 )
+        {
+            nbOnce++;
+        }
+        if( NbReceived[i] > 1 )
+        {
+            *nbDuplicates += NbReceived[i] - 1;
+        }
+    }
+    return nbOnce;
+}
+
+static double GetTotalAirtime( uint32_t *nbFrames )
+{
+    double airtime = 0;
+
+    *nbFrames = 0;
+    for( int8_t dr = DR_0; dr <= DR_5; dr++ )
+    {
+        airtime += Airtime[dr];
+        *nbFrames += NbFrames[dr];
+    }
+    return airtime;
+}
+
+int main( void )
+{
+    const TelemetryStoreStats_t *stats;
+    int32_t nbMeasurements;
+    int32_t nbDuplicates;
+    uint32_t nbFrames;
+    uint32_t nbHeaderWrites;
+    double airtime;
+    double referenceAirtime;
+
+    // The records of the whole outage fit into the ring
+    TEST_CHECK( ( ( OUTAGE_END - OUTAGE_START ) / MEASUREMENT_PERIOD ) <= TELEMETRY_STORE_NB_RECORDS );
+
+    // Reference: one uplink per measurement at DR0
+    referenceAirtime = ( ( OUTAGE_END - OUTAGE_START ) / MEASUREMENT_PERIOD ) * GetTimeOnAir( DR_0, MEASUREMENT_SIZE + 3 );
+
+    printf( "12 h outage, one %u bytes measurement every %u s\n", MEASUREMENT_SIZE, MEASUREMENT_PERIOD );
+    printf( "  reference, one frame per measurement at DR0: %.0f ms\n", referenceAirtime );
+
+    // Link margin unknown after the rejoin: the backlog is sent at DR0
+    nbMeasurements = RunOutage( -1, 0, 0 );
+    stats = TelemetryStoreGetStats( );
+    airtime = GetTotalAirtime( &nbFrames );
+    printf( "  backfill at the current datarate:             %.0f ms, %u frames\n", airtime, nbFrames );
+    TEST_CHECK( GetNbReceivedOnce( nbMeasurements, &nbDuplicates ) == nbMeasurements );
+    TEST_CHECK( nbDuplicates == 0 );
+    TEST_CHECK( NbOutOfOrder == 0 );
+    TEST_CHECK( NbFrames[DR_0] == nbFrames );
+    TEST_CHECK( airtime < referenceAirtime );
+    TEST_CHECK( stats->NbRecordsDropped == 0 );
+    TEST_CHECK( TelemetryStoreGetCount( ) == 0 );
+
+    // The link supports DR5: the backlog is sent at DR5
+    nbMeasurements = RunOutage( DR_5, 0, 0 );
+    stats = TelemetryStoreGetStats( );
+    airtime = GetTotalAirtime( &nbFrames );
+    printf( "  backfill at the best available datarate:      %.0f ms, %u frames\n", airtime, nbFrames );
+    TEST_CHECK( GetNbReceivedOnce( nbMeasurements, &nbDuplicates ) == nbMeasurements );
+    TEST_CHECK( nbDuplicates == 0 );
+    TEST_CHECK( NbOutOfOrder == 0 );
+    TEST_CHECK( NbFrames[DR_5] == nbFrames );
+    TEST_CHECK( airtime < ( referenceAirtime / 50 ) );
+
+    // NVM wear. The records are written in batches and the ring header only
+    // when the backlog is empty or every TELEMETRY_STORE_RELEASE_BATCH_SIZE
+    // released records.
+    nbHeaderWrites = EepromHostStats.NbCellWrites[TELEMETRY_STORE_NVM_OFFSET];
+    printf( "  NVM: %u writes, %u ring header writes\n", EepromHostStats.NbWrites, nbHeaderWrites );
+    TEST_CHECK( nbHeaderWrites <= ( 1 + ( ( OUTAGE_END - OUTAGE_START ) / MEASUREMENT_PERIOD ) / TELEMETRY_STORE_RELEASE_BATCH_SIZE ) );
+
+    // Graceful power cycle during the outage: nothing is lost
+    nbMeasurements = RunOutage( DR_5, OUTAGE_START + 6 * 3600 + 1, 0 );
+    TEST_CHECK( GetNbReceivedOnce( nbMeasurements, &nbDuplicates ) == nbMeasurements );
+    TEST_CHECK( nbDuplicates == 0 );
+    TEST_CHECK( NbOutOfOrder == 0 );
+
+    // Power failure right after the first backfill frames. The records sent
+    // since the last ring header write are sent again. Only the records
+    // staged in RAM are lost.
+    nbMeasurements = RunOutage( DR_0, 0, OUTAGE_END + 200 );
+    GetNbReceivedOnce( nbMeasurements, &nbDuplicates );
+    printf( "  power failure during the backfill: %d records sent twice\n", nbDuplicates );
+    for( int32_t i = 0; i < nbMeasurements; i++ )
+    {
+        if( NbReceived[i] == 0 )
+        {
+            TEST_CHECK( i <= ( ( OUTAGE_END + 200 ) / MEASUREMENT_PERIOD ) );
+            TEST_CHECK( i > ( ( OUTAGE_END + 200 ) / MEASUREMENT_PERIOD - TELEMETRY_STORE_BATCH_SIZE ) );
+        }
+    }
+    TEST_CHECK( nbDuplicates > 0 );
+    TEST_CHECK( nbDuplicates < TELEMETRY_STORE_RELEASE_BATCH_SIZE );
+
+    // Power failure in the middle of a batch write. The records completely
+    // written are kept, the interrupted one is ignored.
+    ResetSimulation( );
+    TelemetryStoreInit( );
+    IsNetworkAvailable = false;
+    for( int32_t i = 0; i < ( TELEMETRY_STORE_BATCH_SIZE * 2 ); i++ )
+    {
+        Measure( i );
+    }
+    TEST_CHECK( TelemetryStoreGetCount( ) == ( TELEMETRY_STORE_BATCH_SIZE * 2 ) );
+    EepromHostSetPowerFail( 40 );
+    for( int32_t i = TELEMETRY_STORE_BATCH_SIZE * 2; i < ( TELEMETRY_STORE_BATCH_SIZE * 3 ); i++ )
+    {
+        Measure( i );
+    }
+    EepromHostSetPowerFail( -1 );
+    TelemetryStoreInit( );
+    TEST_CHECK( TelemetryStoreGetCount( ) >= ( TELEMETRY_STORE_BATCH_SIZE * 2 ) );
+    TEST_CHECK( TelemetryStoreGetCount( ) < ( TELEMETRY_STORE_BATCH_SIZE * 3 ) );
+    IsNetworkAvailable = true;
+    while( TelemetryStoreProcess( LORAMAC_HANDLER_UNCONFIRMED_MSG ) == true )
+    {
+        Now = DutyCycleEnd;
+    }
+    TEST_CHECK( GetNbReceivedOnce( TELEMETRY_STORE_BATCH_SIZE * 2, &nbDuplicates ) == ( TELEMETRY_STORE_BATCH_SIZE * 2 ) );
+
+    // Ring overflow: the oldest records are dropped, the newest are kept in order
+    ResetSimulation( );
+    TelemetryStoreInit( );
+    IsNetworkAvailable = false;
+    for( int32_t i = 0; i < ( TELEMETRY_STORE_NB_RECORDS + 20 ); i++ )
+    {
+        Now = ( uint64_t )i * 1000;
+        Measure( i );
+    }
+    TelemetryStoreFlush( );
+    TelemetryStoreInit( );
+    TEST_CHECK( TelemetryStoreGetCount( ) <= TELEMETRY_STORE_NB_RECORDS );
+    IsNetworkAvailable = true;
+    while( TelemetryStoreProcess( LORAMAC_HANDLER_UNCONFIRMED_MSG ) == true )
+    {
+        Now = DutyCycleEnd;
+    }
+    TEST_CHECK( NbOutOfOrder == 0 );
+    TEST_CHECK( NbReceived[TELEMETRY_STORE_NB_RECORDS + 19] == 1 );
+    TEST_CHECK( NbReceived[0] == 0 );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,121 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Transmission opportunity host test. Checks that the channel
+ *            selection of the MAC layer, RegionCommonIdentifyChannels,
+ *            accepts an uplink exactly at the time predicted by
+ *            LoRaMacQueryTxOpportunity and not earlier.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "rtc-board-host.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+
+/*!
+ * Number of uplinks per datarate
+ */
+#define NB_UPLINKS                                  200
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * \brief Requests an unconfirmed uplink
+ */
+static LoRaMacStatus_t Send( uint8_t size, int8_t datarate, TimerTime_t* dutyCycleWaitTime )
+{
+    static uint8_t buffer[242];
+    McpsReq_t mcpsReq;
+    LoRaMacStatus_t status;
+
+    mcpsReq.Type = MCPS_UNCONFIRMED;
+    mcpsReq.Req.Unconfirmed.fPort = APP_PORT;
+    mcpsReq.Req.Unconfirmed.fBuffer = buffer;
+    mcpsReq.Req.Unconfirmed.fBufferSize = size;
+    mcpsReq.Req.Unconfirmed.Datarate = datarate;
+    status = LoRaMacMcpsRequest( &mcpsReq );
+    *dutyCycleWaitTime = mcpsReq.ReqReturn.DutyCycleWaitTime;
+    return status;
+}
+
+/*!
+ * \brief Sends uplinks as soon as they are predicted to be accepted
+ *
+ * \retval Number of uplinks which had to wait for the duty cycle
+ */
+static uint32_t SendAtOpportunities( uint8_t size, int8_t datarate )
+{
+    LoRaMacTxOpportunity_t txOpportunity;
+    TimerTime_t dutyCycleWaitTime = 0;
+    uint32_t nbDelayed = 0;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        TEST_CHECK( LoRaMacQueryTxOpportunity( size, datarate, &txOpportunity ) == LORAMAC_STATUS_OK );
+        if( txOpportunity.TimeToWait > 0 )
+        {
+            // Refused until the predicted time
+            RtcHostAdvance( txOpportunity.TimeToWait - 1 );
+            TEST_CHECK( Send( size, datarate, &dutyCycleWaitTime ) == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED );
+            TEST_CHECK( dutyCycleWaitTime == 1 );
+            RtcHostAdvance( 1 );
+            nbDelayed++;
+        }
+        TEST_CHECK( Send( size, datarate, &dutyCycleWaitTime ) == LORAMAC_STATUS_OK );
+        TEST_CHECK( RadioHost.TxTimeOnAir == txOpportunity.TxTimeOnAir );
+
+        // The MAC layer accepts no other transmission until the end of the
+        // reception windows
+        TEST_CHECK( LoRaMacQueryTxOpportunity( size, datarate, &txOpportunity ) == LORAMAC_STATUS_BUSY );
+        LmHandlerHostRunUntilIdle( );
+    }
+    return nbDelayed;
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_0,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = true,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+
+    for( int8_t datarate = DR_0; datarate <= DR_5; datarate++ )
+    {
+        uint32_t nbDelayed = SendAtOpportunities( 51, datarate );
+
+        printf( "DR_%d: %u of %u uplinks delayed by the duty cycle\n", datarate, nbDelayed, NB_UPLINKS );
+        TEST_CHECK( nbDelayed > 0 );
+    }
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,287 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Uplink payload host test. Benchmarks the bytes copied and the
+ *            cycles per uplink of a regular and of a reserved application
+ *            payload, and checks that a reserved payload is never
+ *            overwritten by an empty frame.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LoRaMacCommands.h"
+#include "LmHandler.h"
+
+/*!
+ * Number of uplinks per measurement
+ */
+#define NB_UPLINKS                                  200
+
+/*!
+ * Application port
+ */
+#define APP_PORT                                    2
+
+/*!
+ * Application buffers size
+ */
+#define BUFFER_SIZE                                 255
+
+/*!
+ * Uplink queue entries size, refer to LMHANDLER_UPLINK_QUEUE_BUFFER_SIZE
+ */
+#define QUEUE_BUFFER_SIZE                           64
+
+/*!
+ * Bytes copied by memcpy1
+ */
+static uint32_t NbBytesCopied = 0;
+
+void __real_memcpy1( uint8_t *dst, const uint8_t *src, uint16_t size );
+
+void __wrap_memcpy1( uint8_t *dst, const uint8_t *src, uint16_t size )
+{
+    NbBytesCopied += size;
+    __real_memcpy1( dst, src, size );
+}
+
+static LmHandlerParams_t LmHandlerParams =
+{
+    .Region = LORAMAC_REGION_EU868,
+    .AdrEnable = false,
+    .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+    .TxDatarate = DR_5,
+    .PublicNetworkEnable = true,
+    .DutyCycleEnabled = false,
+    .DataBufferMaxSize = 0,
+    .DataBuffer = NULL,
+    .PingSlotPeriodicity = 0,
+};
+
+/*!
+ * Fills the application payload
+ */
+static void FillPayload( uint8_t *buffer, uint8_t size, uint32_t seed )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        buffer[i] = ( uint8_t )( seed + i );
+    }
+}
+
+/*!
+ * Uplink benchmark results
+ */
+typedef struct UplinkStats_s
+{
+    /*!
+     * Number of uplinks sent
+     */
+    uint32_t NbUplinks;
+    /*!
+     * Bytes copied by all the uplinks
+     */
+    uint32_t NbBytesCopied;
+    /*!
+     * Fastest uplink preparation. The minimum filters out the host noise
+     */
+    uint64_t MinCycles;
+}UplinkStats_t;
+
+/*!
+ * Sends the uplinks from an application buffer
+ */
+static void SendCopied( uint8_t size, UplinkStats_t *stats )
+{
+    static uint8_t buffer[BUFFER_SIZE];
+    LmHandlerAppData_t appData;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        uint32_t nbTx = RadioHost.NbTx;
+        uint32_t nbBytesCopied = NbBytesCopied;
+        uint64_t cycles = TestGetCycles( );
+
+        FillPayload( buffer, size, i );
+        appData.Port = APP_PORT;
+        appData.Buffer = buffer;
+        appData.BufferSize = size;
+        TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+
+        cycles = TestGetCycles( ) - cycles;
+        stats->MinCycles = ( stats->NbUplinks == 0 ) ? cycles : MIN( stats->MinCycles, cycles );
+        stats->NbBytesCopied += NbBytesCopied - nbBytesCopied;
+        stats->NbUplinks++;
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        TEST_CHECK( RadioHost.TxSize == ( 8 + 1 + size + 4 ) );
+        LmHandlerHostRunUntilIdle( );
+    }
+}
+
+/*!
+ * Sends the uplinks written in place in the reserved payload area
+ */
+static void SendReserved( uint8_t size, UplinkStats_t *stats )
+{
+    LmHandlerAppData_t appData;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        uint32_t nbTx = RadioHost.NbTx;
+        uint32_t nbBytesCopied = NbBytesCopied;
+        uint64_t cycles = TestGetCycles( );
+
+        TEST_CHECK( LmHandlerReserveAppData( &appData ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( appData.BufferSize >= size );
+        FillPayload( appData.Buffer, size, i );
+        appData.Port = APP_PORT;
+        appData.BufferSize = size;
+        TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+
+        cycles = TestGetCycles( ) - cycles;
+        stats->MinCycles = ( stats->NbUplinks == 0 ) ? cycles : MIN( stats->MinCycles, cycles );
+        stats->NbBytesCopied += NbBytesCopied - nbBytesCopied;
+        stats->NbUplinks++;
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        TEST_CHECK( RadioHost.TxSize == ( 8 + 1 + size + 4 ) );
+        LmHandlerHostRunUntilIdle( );
+    }
+}
+
+/*!
+ * Sends the uplinks through the uplink queue
+ */
+static void SendQueued( uint8_t size, UplinkStats_t *stats )
+{
+    static uint8_t buffer[BUFFER_SIZE];
+    LmHandlerAppData_t appData;
+
+    for( uint32_t i = 0; i < NB_UPLINKS; i++ )
+    {
+        uint32_t nbTx = RadioHost.NbTx;
+        uint32_t nbBytesCopied = NbBytesCopied;
+        uint64_t cycles = TestGetCycles( );
+
+        FillPayload( buffer, size, i );
+        appData.Port = APP_PORT;
+        appData.Buffer = buffer;
+        appData.BufferSize = size;
+        TEST_CHECK( LmHandlerSendQueued( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG,
+                                         LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        LmHandlerProcess( );
+
+        cycles = TestGetCycles( ) - cycles;
+        stats->MinCycles = ( stats->NbUplinks == 0 ) ? cycles : MIN( stats->MinCycles, cycles );
+        stats->NbBytesCopied += NbBytesCopied - nbBytesCopied;
+        stats->NbUplinks++;
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        LmHandlerHostRunUntilIdle( );
+    }
+}
+
+/*!
+ * A reserved payload which doesn't fit anymore, because of a new sticky MAC
+ * command, is neither overwritten by an empty frame nor sent.
+ */
+static void CheckReservedPayloadGuard( void )
+{
+    LmHandlerAppData_t appData;
+    uint8_t expected[BUFFER_SIZE];
+    uint8_t rxParamSetupAns = 0x07;
+    uint32_t nbTx = RadioHost.NbTx;
+
+    TEST_CHECK( LmHandlerReserveAppData( &appData ) == LORAMAC_HANDLER_SUCCESS );
+    FillPayload( appData.Buffer, appData.BufferSize, 0xA5 );
+    memcpy( expected, appData.Buffer, appData.BufferSize );
+    appData.Port = APP_PORT;
+
+    TEST_CHECK( LoRaMacCommandsAddCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, &rxParamSetupAns, 1 ) == LORAMAC_COMMANDS_SUCCESS );
+    TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_ERROR );
+    TEST_CHECK( RadioHost.NbTx == nbTx );
+    TEST_CHECK( memcmp( expected, appData.Buffer, appData.BufferSize ) == 0 );
+
+    // Reserving again accounts for the MAC command
+    uint8_t maxSize = appData.BufferSize;
+    TEST_CHECK( LmHandlerReserveAppData( &appData ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( appData.BufferSize == ( maxSize - 2 ) );
+    FillPayload( appData.Buffer, appData.BufferSize, 0x5A );
+    appData.Port = APP_PORT;
+    TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+    TEST_CHECK( RadioHost.TxSize == ( 8 + 2 + 1 + appData.BufferSize + 4 ) );
+    LmHandlerHostRunUntilIdle( );
+
+    // The sticky MAC command stays until a downlink is received. A regular
+    // buffer still flushes it with an empty frame.
+    uint8_t buffer[BUFFER_SIZE];
+    appData.Buffer = buffer;
+    appData.BufferSize = maxSize;
+    TEST_CHECK( LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS );
+    TEST_CHECK( RadioHost.NbTx == ( nbTx + 2 ) );
+    // The MAC command is sent as FRMPayload on port 0
+    TEST_CHECK( RadioHost.TxSize == ( 8 + 1 + 2 + 4 ) );
+    LmHandlerHostRunUntilIdle( );
+}
+
+static void PrintStats( const char *name, const UplinkStats_t *stats )
+{
+    printf( "  %-9s %8.1f %12.0f\n", name, ( double )stats->NbBytesCopied / stats->NbUplinks,
+            ( double )stats->MinCycles );
+}
+
+int main( void )
+{
+    const uint8_t sizes[] = { 16, 51, 222 };
+
+    TEST_CHECK( LmHandlerHostInit( &LmHandlerParams ) == true );
+
+    printf( "Per uplink at DR5:  bytes copied, " TEST_CYCLES_UNIT "\n" );
+    for( uint8_t i = 0; i < sizeof( sizes ); i++ )
+    {
+        UplinkStats_t copied = { 0 };
+        UplinkStats_t reserved = { 0 };
+        UplinkStats_t queued = { 0 };
+
+        SendCopied( sizes[i], &copied );
+        SendReserved( sizes[i], &reserved );
+
+        printf( "%u bytes payload\n", sizes[i] );
+        PrintStats( "copied", &copied );
+        PrintStats( "reserved", &reserved );
+
+        // The regular path copies the payload into the MAC context and the
+        // serializer copies it into the frame on each of its 3 passes. The
+        // reserved path doesn't copy it at all.
+        TEST_CHECK( ( copied.NbBytesCopied - reserved.NbBytesCopied ) == ( 4 * sizes[i] * NB_UPLINKS ) );
+
+        if( sizes[i] <= QUEUE_BUFFER_SIZE )
+        {
+            // The queue copies the payload into the queue entry and then
+            // into the reserved area
+            SendQueued( sizes[i], &queued );
+            PrintStats( "queued", &queued );
+            TEST_CHECK( ( queued.NbBytesCopied - reserved.NbBytesCopied ) == ( 2 * sizes[i] * NB_UPLINKS ) );
+        }
+    }
+
+    CheckReservedPayloadGuard( );
+
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
@@ -0,0 +1,248 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     LoRaMac handler uplink queue host test. Checks the dispatch
+ *            order of the priority classes, the coalescing, the eviction,
+ *            the datarate checks and the duty-cycle timer.
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ */
+#include <string.h>
+#include "test.h"
+#include "utilities.h"
+#include "rtc-board-host.h"
+#include "radio-host.h"
+#include "lmhandler-host.h"
+#include "LoRaMac.h"
+#include "LmHandler.h"
+
+/*!
+ * Maximum number of logged uplinks
+ */
+#define UPLINK_LOG_SIZE                             16
+
+/*!
+ * Last uplinks accepted by the MAC layer, indexed by their number modulo
+ * \ref UPLINK_LOG_SIZE
+ */
+static struct
+{
+    uint8_t Port;
+    uint8_t Data;
+    uint32_t Time;
+}UplinkLog[UPLINK_LOG_SIZE];
+static uint32_t NbUplinks;
+
+LoRaMacStatus_t __real_LoRaMacMcpsRequest( McpsReq_t *mcpsRequest );
+
+LoRaMacStatus_t __wrap_LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
+{
+    uint8_t i = NbUplinks % UPLINK_LOG_SIZE;
+    // The MAC layer encrypts the payload in place
+    uint8_t data = ( mcpsRequest->Req.Unconfirmed.fBufferSize > 0 ) ?
+                   ( ( uint8_t* )mcpsRequest->Req.Unconfirmed.fBuffer )[0] : 0;
+    LoRaMacStatus_t status = __real_LoRaMacMcpsRequest( mcpsRequest );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        UplinkLog[i].Port = mcpsRequest->Req.Unconfirmed.fPort;
+        UplinkLog[i].Data = data;
+        UplinkLog[i].Time = RtcHostGetTime( );
+        NbUplinks++;
+    }
+    return status;
+}
+
+/*!
+ * \brief Queues an uplink of the given size filled with the given value
+ */
+static LmHandlerErrorStatus_t Queue( uint8_t port, uint8_t data, uint8_t size, LmHandlerUplinkPriorities_t priority )
+{
+    uint8_t buffer[64];
+    LmHandlerAppData_t appData = { .Port = port, .BufferSize = size, .Buffer = buffer };
+
+    memset1( buffer, data, size );
+    // Give each uplink its own arrival time
+    RtcHostAdvance( 1 );
+    return LmHandlerSendQueued( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG, priority );
+}
+
+static void SetDatarate( int8_t datarate )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = datarate;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*!
+ * \brief Checks the ports of the last logged uplinks
+ */
+static bool CheckPorts( uint32_t first, const uint8_t *ports, uint8_t nbPorts )
+{
+    if( NbUplinks != ( first + nbPorts ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < nbPorts; i++ )
+    {
+        if( UplinkLog[( first + i ) % UPLINK_LOG_SIZE].Port != ports[i] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main( void )
+{
+    LmHandlerParams_t params =
+    {
+        .Region = LORAMAC_REGION_EU868,
+        .AdrEnable = false,
+        .IsTxConfirmed = LORAMAC_HANDLER_UNCONFIRMED_MSG,
+        .TxDatarate = DR_5,
+        .PublicNetworkEnable = true,
+        .DutyCycleEnabled = true,
+        .DataBufferMaxSize = 0,
+        .DataBuffer = NULL,
+        .PingSlotPeriodicity = 0,
+    };
+    const LmHandlerUplinkQueueStats_t *stats;
+    uint32_t first;
+
+    TEST_CHECK( LmHandlerHostInit( &params ) == true );
+    stats = LmHandlerGetUplinkQueueStats( );
+
+    // Highest priority first, then arrival order
+    {
+        static const uint8_t ports[] = { 12, 11, 13, 10 };
+
+        first = NbUplinks;
+        TEST_CHECK( Queue( 10, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 11, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 12, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 13, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( stats->Depth == 4 );
+        LmHandlerHostRunUntilIdle( );
+        TEST_CHECK( CheckPorts( first, ports, sizeof( ports ) ) == true );
+        TEST_CHECK( stats->Depth == 0 );
+        TEST_CHECK( stats->NbSent == 4 );
+        TEST_CHECK( stats->MaxDepth == 4 );
+    }
+
+    // Coalescing keeps the newest data and the highest priority
+    {
+        static const uint8_t ports[] = { 20, 21 };
+
+        first = NbUplinks;
+        TEST_CHECK( Queue( 21, 1, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 20, 1, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 20, 2, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 20, 3, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( stats->Depth == 2 );
+        TEST_CHECK( stats->NbCoalesced == 2 );
+        LmHandlerHostRunUntilIdle( );
+        TEST_CHECK( CheckPorts( first, ports, sizeof( ports ) ) == true );
+        TEST_CHECK( UplinkLog[first % UPLINK_LOG_SIZE].Data == 3 );
+    }
+
+    // A full queue evicts the newest uplink of the lowest priority class, only
+    // for a higher priority uplink
+    {
+        static const uint8_t ports[] = { 35, 30, 31, 32 };
+        uint32_t nbDropped = stats->NbDropped;
+
+        first = NbUplinks;
+        TEST_CHECK( Queue( 30, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 31, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 32, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 33, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 34, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_ERROR );
+        TEST_CHECK( Queue( 34, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_ERROR );
+        TEST_CHECK( Queue( 35, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( stats->Depth == 4 );
+        TEST_CHECK( stats->NbDropped == ( nbDropped + 3 ) );
+        LmHandlerHostRunUntilIdle( );
+        TEST_CHECK( CheckPorts( first, ports, sizeof( ports ) ) == true );
+    }
+
+    // An uplink larger than the maximum payload of the current datarate is
+    // rejected. A queued uplink is dropped once the datarate has been lowered
+    // below its size.
+    {
+        static const uint8_t ports[] = { 41 };
+        uint32_t nbDropped = stats->NbDropped;
+
+        first = NbUplinks;
+        SetDatarate( DR_0 );
+        TEST_CHECK( Queue( 40, 0, 60, LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM ) == LORAMAC_HANDLER_ERROR );
+        TEST_CHECK( stats->Depth == 0 );
+        SetDatarate( DR_5 );
+        TEST_CHECK( Queue( 40, 0, 60, LORAMAC_HANDLER_UPLINK_PRIORITY_ALARM ) == LORAMAC_HANDLER_SUCCESS );
+        TEST_CHECK( Queue( 41, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_BULK ) == LORAMAC_HANDLER_SUCCESS );
+        SetDatarate( DR_0 );
+        LmHandlerHostRunUntilIdle( );
+        TEST_CHECK( CheckPorts( first, ports, sizeof( ports ) ) == true );
+        TEST_CHECK( stats->Depth == 0 );
+        TEST_CHECK( stats->NbDropped == ( nbDropped + 1 ) );
+    }
+
+    // An uplink blocked by the duty cycle is passed to the MAC layer once the
+    // duty cycle allows it, without any other wake-up source
+    {
+        uint8_t appData[] = { 0x00 };
+        LmHandlerAppData_t appDataParams = { .Port = 2, .BufferSize = sizeof( appData ), .Buffer = appData };
+        uint32_t start;
+        uint32_t waitTime;
+        uint32_t nbTx;
+
+        // Use up the duty cycle time credits
+        while( LmHandlerSend( &appDataParams, LORAMAC_HANDLER_UNCONFIRMED_MSG ) == LORAMAC_HANDLER_SUCCESS )
+        {
+            LmHandlerHostRunUntilIdle( );
+        }
+        nbTx = RadioHost.NbTx;
+        first = NbUplinks;
+
+        TEST_CHECK( Queue( 50, 0, 8, LORAMAC_HANDLER_UPLINK_PRIORITY_TELEMETRY ) == LORAMAC_HANDLER_SUCCESS );
+        start = RtcHostGetTime( );
+        LmHandlerProcess( );
+        waitTime = LmHandlerGetDutyCycleWaitTime( );
+        TEST_CHECK( waitTime > 0 );
+        TEST_CHECK( NbUplinks == first );
+        TEST_CHECK( stats->Depth == 1 );
+
+        while( ( NbUplinks == first ) && ( RtcHostRunNextAlarm( ) == true ) )
+        {
+            LmHandlerProcess( );
+        }
+        LmHandlerHostRunUntilIdle( );
+        printf( "duty cycle wait %u ms, queued uplink requested after %u ms\n", waitTime,
+                UplinkLog[first % UPLINK_LOG_SIZE].Time - start );
+        TEST_CHECK( NbUplinks == ( first + 1 ) );
+        TEST_CHECK( UplinkLog[first % UPLINK_LOG_SIZE].Port == 50 );
+        TEST_CHECK( ( UplinkLog[first % UPLINK_LOG_SIZE].Time - start ) >= waitTime );
+        TEST_CHECK( ( UplinkLog[first % UPLINK_LOG_SIZE].Time - start ) <= ( waitTime + 10 ) );
+        TEST_CHECK( RadioHost.NbTx == ( nbTx + 1 ) );
+        TEST_CHECK( stats->Depth == 0 );
+    }
+
+    printf( "enqueued %u, coalesced %u, dropped %u, sent %u, max depth %u, max wait %u ms\n",
+            stats->NbEnqueued, stats->NbCoalesced, stats->NbDropped, stats->NbSent, stats->MaxDepth,
+            ( uint32_t )stats->MaxWaitTime );
+    printf( "%s\n", ( TEST_RESULT( ) == 0 ) ? "PASSED" : "FAILED" );
+    return TEST_RESULT( );
+}
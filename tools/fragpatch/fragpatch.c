@@ -0,0 +1,435 @@
+/*!
+ * \file      fragpatch.c
+ *
+ * \brief     Host tool generating and applying delta firmware updates
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ *            Usage:
+ *              fragpatch diff  <old image> <new image> <patch>
+ *              fragpatch apply <old image> <patch> <new image>
+ *
+ *            The patch format is described in FragPatch.h. The patch is sent
+ *            as a regular file through the fragmentation package. apply uses
+ *            the on-device FragPatch module.
+ *
+ *            Build:
+ *              cmake -S tools/fragpatch -B build-fragpatch
+ *              cmake --build build-fragpatch
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utilities.h"
+#include "FragPatch.h"
+
+/*!
+ * Number of bits of the match finder hash
+ */
+#define HASH_BITS                                   16
+
+/*!
+ * Maximum number of match candidates visited per target position
+ */
+#define MAX_CHAIN_LENGTH                            64
+
+/*!
+ * Minimum match length when the match continues the source cursor
+ */
+#define MIN_MATCH_AT_CURSOR                         4
+
+/*!
+ * Minimum match length when the source cursor moves
+ */
+#define MIN_MATCH_MOVED                             8
+
+/*!
+ * Minimum length of a run of identical bytes encoded as a RUN instruction
+ */
+#define MIN_RUN_LENGTH                              4
+
+/*!
+ * Growable output buffer
+ */
+typedef struct Buffer_s
+{
+    uint8_t *Data;
+    size_t Size;
+    size_t Capacity;
+}Buffer_t;
+
+/*!
+ * Patch statistics
+ */
+typedef struct PatchStats_s
+{
+    size_t NbCopy;
+    size_t NbAdd;
+    size_t NbRun;
+    size_t CopyBytes;
+    size_t AddBytes;
+    size_t RunBytes;
+}PatchStats_t;
+
+/*!
+ * Images used by the apply callbacks
+ */
+static Buffer_t Source;
+static Buffer_t Patch;
+static Buffer_t Target;
+
+static void BufferPut( Buffer_t *buffer, const uint8_t *data, size_t size )
+{
+    if( ( buffer->Size + size ) > buffer->Capacity )
+    {
+        buffer->Capacity = ( buffer->Size + size ) * 2;
+        buffer->Data = realloc( buffer->Data, buffer->Capacity );
+        if( buffer->Data == NULL )
+        {
+            fprintf( stderr, "Out of memory\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    memcpy( &buffer->Data[buffer->Size], data, size );
+    buffer->Size += size;
+}
+
+static void BufferPutByte( Buffer_t *buffer, uint8_t value )
+{
+    BufferPut( buffer, &value, 1 );
+}
+
+static void BufferPutUint32( Buffer_t *buffer, uint32_t value )
+{
+    uint8_t data[4] = { value & 0xFF, ( value >> 8 ) & 0xFF, ( value >> 16 ) & 0xFF, ( value >> 24 ) & 0xFF };
+
+    BufferPut( buffer, data, 4 );
+}
+
+static void BufferPutVarint( Buffer_t *buffer, uint32_t value )
+{
+    while( value >= 0x80 )
+    {
+        BufferPutByte( buffer, ( value & 0x7F ) | 0x80 );
+        value >>= 7;
+    }
+    BufferPutByte( buffer, value );
+}
+
+static bool ReadFile( const char *name, Buffer_t *buffer )
+{
+    FILE *file = fopen( name, "rb" );
+    uint8_t chunk[4096];
+    size_t size;
+
+    if( file == NULL )
+    {
+        perror( name );
+        return false;
+    }
+    while( ( size = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+    {
+        BufferPut( buffer, chunk, size );
+    }
+    fclose( file );
+    return true;
+}
+
+static bool WriteFile( const char *name, Buffer_t *buffer )
+{
+    FILE *file = fopen( name, "wb" );
+
+    if( ( file == NULL ) || ( fwrite( buffer->Data, 1, buffer->Size, file ) != buffer->Size ) )
+    {
+        perror( name );
+        return false;
+    }
+    return fclose( file ) == 0;
+}
+
+static uint32_t ComputeCrc( Buffer_t *buffer )
+{
+    uint32_t crc = Crc32Init( );
+
+    for( size_t i = 0; i < buffer->Size; i += UINT16_MAX )
+    {
+        crc = Crc32Update( crc, &buffer->Data[i], MIN( buffer->Size - i, UINT16_MAX ) );
+    }
+    return Crc32Finalize( crc );
+}
+
+static uint32_t Hash( const uint8_t *data )
+{
+    uint32_t key = ( ( uint32_t )data[0] ) | ( ( uint32_t )data[1] << 8 ) |
+                   ( ( uint32_t )data[2] << 16 ) | ( ( uint32_t )data[3] << 24 );
+
+    return ( key * 2654435761u ) >> ( 32 - HASH_BITS );
+}
+
+static size_t MatchLength( Buffer_t *source, size_t srcPos, Buffer_t *target, size_t tgtPos )
+{
+    size_t length = 0;
+
+    while( ( ( srcPos + length ) < source->Size ) && ( ( tgtPos + length ) < target->Size ) &&
+           ( source->Data[srcPos + length] == target->Data[tgtPos + length] ) )
+    {
+        length++;
+    }
+    return length;
+}
+
+static size_t VarintSize( uint32_t value )
+{
+    size_t size = 1;
+
+    while( value >= 0x80 )
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static uint32_t Zigzag( int64_t offset )
+{
+    return ( offset >= 0 ) ? ( uint32_t )( offset << 1 ) : ( uint32_t )( ( -offset << 1 ) - 1 );
+}
+
+static void PutInstruction( Buffer_t *patch, uint8_t opcode, size_t length )
+{
+    if( length < 64 )
+    {
+        BufferPutByte( patch, ( opcode << 6 ) | ( length - 1 ) );
+    }
+    else
+    {
+        BufferPutByte( patch, ( opcode << 6 ) | 0x3F );
+        BufferPutVarint( patch, length - 64 );
+    }
+}
+
+/*!
+ * \brief Encodes literal bytes as ADD and RUN instructions
+ */
+static void PutLiterals( Buffer_t *patch, const uint8_t *data, size_t size, PatchStats_t *stats )
+{
+    size_t start = 0;
+    size_t i = 0;
+
+    while( i < size )
+    {
+        size_t run = 1;
+
+        while( ( ( i + run ) < size ) && ( data[i + run] == data[i] ) )
+        {
+            run++;
+        }
+        if( run < MIN_RUN_LENGTH )
+        {
+            i += run;
+            continue;
+        }
+        if( i > start )
+        {
+            PutInstruction( patch, 1, i - start );
+            BufferPut( patch, &data[start], i - start );
+            stats->NbAdd++;
+            stats->AddBytes += i - start;
+        }
+        PutInstruction( patch, 2, run );
+        BufferPutByte( patch, data[i] );
+        stats->NbRun++;
+        stats->RunBytes += run;
+        i += run;
+        start = i;
+    }
+    if( size > start )
+    {
+        PutInstruction( patch, 1, size - start );
+        BufferPut( patch, &data[start], size - start );
+        stats->NbAdd++;
+        stats->AddBytes += size - start;
+    }
+}
+
+/*!
+ * \brief Generates a patch rebuilding target from source
+ *
+ *        Greedy matcher. Hash chains over 4 bytes keys of the source find
+ *        the matches; the positions continuing the source cursor are tried
+ *        first as most code changes only shift or replace a few bytes.
+ */
+static void Diff( Buffer_t *source, Buffer_t *target, Buffer_t *patch, PatchStats_t *stats )
+{
+    int32_t *head = malloc( sizeof( int32_t ) << HASH_BITS );
+    int32_t *prev = malloc( sizeof( int32_t ) * ( source->Size + 1 ) );
+    size_t cursor = 0;
+    size_t literalStart = 0;
+    size_t pos = 0;
+
+    memset( head, 0xFF, sizeof( int32_t ) << HASH_BITS );
+    for( size_t i = 0; ( i + 4 ) <= source->Size; i++ )
+    {
+        uint32_t hash = Hash( &source->Data[i] );
+
+        prev[i] = head[hash];
+        head[hash] = ( int32_t )i;
+    }
+
+    BufferPutUint32( patch, 0x31504446 );
+    BufferPutUint32( patch, source->Size );
+    BufferPutUint32( patch, ComputeCrc( source ) );
+    BufferPutUint32( patch, target->Size );
+    BufferPutUint32( patch, ComputeCrc( target ) );
+
+    while( pos < target->Size )
+    {
+        size_t literalSize = pos - literalStart;
+        size_t candidates[2] = { cursor, cursor + literalSize };
+        size_t bestLength = 0;
+        size_t bestStart = 0;
+        int64_t bestGain = 0;
+
+        for( int i = 0; i < 2; i++ )
+        {
+            size_t length;
+
+            if( candidates[i] >= source->Size )
+            {
+                continue;
+            }
+            length = MatchLength( source, candidates[i], target, pos );
+            if( ( length >= MIN_MATCH_AT_CURSOR ) &&
+                ( ( int64_t )length - ( int64_t )VarintSize( Zigzag( ( int64_t )candidates[i] - ( int64_t )cursor ) ) > bestGain ) )
+            {
+                bestLength = length;
+                bestStart = candidates[i];
+                bestGain = ( int64_t )length - ( int64_t )VarintSize( Zigzag( ( int64_t )candidates[i] - ( int64_t )cursor ) );
+            }
+        }
+        if( ( ( pos + 4 ) <= target->Size ) && ( bestLength < 64 ) )
+        {
+            int32_t candidate = head[Hash( &target->Data[pos] )];
+
+            for( int chain = 0; ( candidate >= 0 ) && ( chain < MAX_CHAIN_LENGTH ); chain++ )
+            {
+                size_t length = MatchLength( source, candidate, target, pos );
+                int64_t gain = ( int64_t )length - ( int64_t )VarintSize( Zigzag( ( int64_t )candidate - ( int64_t )cursor ) );
+
+                if( ( length >= MIN_MATCH_MOVED ) && ( gain > bestGain ) )
+                {
+                    bestLength = length;
+                    bestStart = candidate;
+                    bestGain = gain;
+                }
+                candidate = prev[candidate];
+            }
+        }
+
+        if( bestLength == 0 )
+        {
+            pos++;
+            continue;
+        }
+        PutLiterals( patch, &target->Data[literalStart], literalSize, stats );
+        PutInstruction( patch, 0, bestLength );
+        BufferPutVarint( patch, Zigzag( ( int64_t )bestStart - ( int64_t )cursor ) );
+        stats->NbCopy++;
+        stats->CopyBytes += bestLength;
+        cursor = bestStart + bestLength;
+        pos += bestLength;
+        literalStart = pos;
+    }
+    PutLiterals( patch, &target->Data[literalStart], pos - literalStart, stats );
+
+    free( head );
+    free( prev );
+}
+
+static int8_t ImageRead( Buffer_t *buffer, uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( ( ( size_t )addr + size ) > buffer->Size )
+    {
+        return -1;
+    }
+    memcpy( data, &buffer->Data[addr], size );
+    return 0;
+}
+
+static int8_t PatchRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return ImageRead( &Patch, addr, data, size );
+}
+
+static int8_t SourceRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return ImageRead( &Source, addr, data, size );
+}
+
+static int8_t TargetRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    return ImageRead( &Target, addr, data, size );
+}
+
+static int8_t TargetWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    if( addr != Target.Size )
+    {
+        return -1;
+    }
+    BufferPut( &Target, data, size );
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    if( ( argc == 5 ) && ( strcmp( argv[1], "diff" ) == 0 ) )
+    {
+        PatchStats_t stats = { 0 };
+
+        if( ( ReadFile( argv[2], &Source ) == false ) || ( ReadFile( argv[3], &Target ) == false ) )
+        {
+            return EXIT_FAILURE;
+        }
+        Diff( &Source, &Target, &Patch, &stats );
+        printf( "source %zu bytes, target %zu bytes, patch %zu bytes (%.1f%% of target)\n",
+                Source.Size, Target.Size, Patch.Size, ( Target.Size > 0 ) ? ( 100.0 * Patch.Size / Target.Size ) : 0.0 );
+        printf( "COPY %zu (%zu bytes), ADD %zu (%zu bytes), RUN %zu (%zu bytes)\n",
+                stats.NbCopy, stats.CopyBytes, stats.NbAdd, stats.AddBytes, stats.NbRun, stats.RunBytes );
+        return ( WriteFile( argv[4], &Patch ) == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if( ( argc == 5 ) && ( strcmp( argv[1], "apply" ) == 0 ) )
+    {
+        FragPatchCallbacks_t callbacks = { PatchRead, SourceRead, TargetWrite, TargetRead };
+        FragPatchStatus_t status;
+        uint32_t targetSize;
+
+        if( ( ReadFile( argv[2], &Source ) == false ) || ( ReadFile( argv[3], &Patch ) == false ) )
+        {
+            return EXIT_FAILURE;
+        }
+        status = FragPatchApply( &callbacks, Patch.Size, Source.Size, UINT32_MAX, &targetSize );
+        if( status != FRAG_PATCH_STATUS_OK )
+        {
+            fprintf( stderr, "Patch application failed, status %d\n", status );
+            return EXIT_FAILURE;
+        }
+        return ( WriteFile( argv[4], &Target ) == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    fprintf( stderr, "Usage:\n  %s diff <old image> <new image> <patch>\n  %s apply <old image> <patch> <new image>\n",
+             argv[0], argv[0] );
+    return EXIT_FAILURE;
+}